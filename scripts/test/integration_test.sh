@@ -8,3 +8,18 @@ sleep 1
 redis-benchmark -t GET,SET || exit 1
 redis-cli SET test passed | grep OK || exit 1
 redis-cli GET test | grep passed || exit 1
+
+# a client disconnected for malformed input, under io_uring where the build
+# supports it, doesn't take the server down with it
+"$1" --port 6380 --io-backend io_uring & disown
+URING_PID=$!
+trap 'kill $PID $URING_PID 2>/dev/null' EXIT
+
+sleep 1
+if kill -0 $URING_PID 2>/dev/null; then
+  exec 3<>/dev/tcp/127.0.0.1/6380
+  printf '*1\r\n$x\r\n' >&3
+  exec 3>&-
+  sleep 1
+  redis-cli -p 6380 PING | grep PONG || exit 1
+fi
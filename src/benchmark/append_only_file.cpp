@@ -0,0 +1,74 @@
+#include <benchmark/benchmark.h>
+
+#include <append_only_file.hpp>
+#include <command_handler.hpp>
+#include <database.hpp>
+#include <resp.hpp>
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+
+namespace {
+
+constexpr std::size_t depth = 16;
+
+std::string bulk_string(std::string_view s) {
+  return "$" + std::to_string(s.size()) + "\r\n" + std::string(s) + "\r\n";
+}
+
+// pipelines of SETs of random keys to 16 byte values
+std::vector<std::string> sets() {
+  std::vector<std::string> result(1 << 12);
+  std::mt19937 prng(42);
+  std::uniform_int_distribution<std::size_t> index(0, (1 << 16) - 1);
+  for (auto &pipeline : result) {
+    for (std::size_t i = 0; i < depth; ++i)
+      pipeline += "*3\r\n$3\r\nSET\r\n" +
+                  bulk_string("key:" + std::to_string(index(prng))) +
+                  bulk_string(std::string(16, 'v'));
+  }
+  return result;
+}
+
+} // namespace
+
+// pipelines of SETs, each written to an append only file in memory under
+// fsync policy arg 0, or to none if it's -1, as a reactor's round would be
+void pipelined_sets(benchmark::State &state) {
+  const auto data = sets();
+  redis::io::file_descriptor fd{::memfd_create, "", 0};
+  std::unique_ptr<redis::append_only_file> aof;
+  if (state.range(0) >= 0)
+    aof = std::make_unique<redis::append_only_file>(
+        "/proc/self/fd/" + std::to_string(fd.value()),
+        redis::append_only_file::fsync_policy(state.range(0)));
+
+  redis::database db;
+  redis::resp::null_handler output;
+  redis::command_handler handler(db, output, nullptr,
+                                 redis::command_handler::mode::batched,
+                                 aof.get());
+  redis::resp::basic_parser<redis::command_handler> parser(handler);
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    const auto &input = data[i++ % data.size()];
+    parser.parse(input.data(), input.data() + input.size());
+    handler.execute();
+    if (aof)
+      aof->write();
+    // keep the file from growing without bound
+    if (aof && i % data.size() == 0) {
+      state.PauseTiming();
+      redis::io::posix_call(::ftruncate, fd.value(), 0);
+      state.ResumeTiming();
+    }
+  }
+  state.SetItemsProcessed(std::int64_t(state.iterations() * depth));
+}
+
+BENCHMARK(pipelined_sets)->Arg(-1)->Arg(0)->Arg(1)->Arg(2);
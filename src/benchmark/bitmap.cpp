@@ -0,0 +1,77 @@
+#include <benchmark/benchmark.h>
+
+#include <bitmap.hpp>
+#include <simd.hpp>
+
+#include <array>
+#include <random>
+#include <string>
+
+namespace {
+
+// a daily-active-users bitmap: 100M user ids, 10M of them set at random
+std::string users_bitmap(std::uint64_t seed) {
+  constexpr std::uint64_t users = 100'000'000;
+  std::mt19937_64 prng(seed);
+  std::string result(users / 8, '\0');
+  for (std::uint64_t i = 0; i < users / 10; ++i) {
+    const auto user = prng() % users;
+    result[user / 8] = char(result[user / 8] | 0x80 >> user % 8);
+  }
+  return result;
+}
+
+// times op with the instruction set in arg 0
+template <typename Op> void with_isa(benchmark::State &state, Op op) {
+  const auto isa = redis::simd::isa(state.range(0));
+  if (!redis::simd::supported(isa)) {
+    state.SkipWithError("instruction set not supported");
+    return;
+  }
+  const auto previous = redis::simd::current();
+  redis::simd::use(isa);
+  op(state);
+  redis::simd::use(previous);
+}
+
+void bitmap_count(benchmark::State &state) {
+  with_isa(state, [](benchmark::State &state) {
+    const auto bits = users_bitmap(1);
+    std::uint64_t count{};
+    for (auto _ : state)
+      benchmark::DoNotOptimize(
+          count = redis::bitmap::count(bits, 0, bits.size() * 8));
+    state.counters["users"] = double(count);
+    state.SetBytesProcessed(std::int64_t(state.iterations() * bits.size()));
+  });
+}
+
+// the union of a week's daily bitmaps, as BITOP OR does
+void bitmap_or(benchmark::State &state) {
+  with_isa(state, [](benchmark::State &state) {
+    std::array<std::string, 7> days;
+    for (std::size_t i = 0; i < days.size(); ++i)
+      days[i] = users_bitmap(i);
+    const std::array<std::string_view, 7> sources{
+        days[0], days[1], days[2], days[3], days[4], days[5], days[6]};
+    std::size_t size{};
+    for (auto _ : state)
+      size = redis::bitmap::apply(redis::bitmap::operation::or_, sources)
+                 .size();
+    benchmark::DoNotOptimize(size);
+    state.SetBytesProcessed(
+        std::int64_t(state.iterations() * size * sources.size()));
+  });
+}
+
+void isas(benchmark::internal::Benchmark *b) {
+  using redis::simd::isa;
+  for (const auto i : {isa::scalar, isa::sse2, isa::avx2})
+    b->Arg(std::int64_t(i));
+  b->ArgName("isa");
+}
+
+} // namespace
+
+BENCHMARK(bitmap_count)->Apply(isas)->Unit(benchmark::kMicrosecond);
+BENCHMARK(bitmap_or)->Apply(isas)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,112 @@
+#include <benchmark/benchmark.h>
+
+#include <command_handler.hpp>
+#include <database.hpp>
+#include <resp.hpp>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// far more than fits in the last level cache
+constexpr std::size_t keyspace = 1 << 22;
+
+std::string key(std::size_t i) { return "key:" + std::to_string(i); }
+
+redis::database &populated_database() {
+  static redis::database db = []() {
+    redis::database result;
+    for (std::size_t i = 0; i < keyspace; ++i)
+      result.set(key(i), "value:" + std::to_string(i));
+    return result;
+  }();
+  return db;
+}
+
+std::string bulk_string(std::string_view s) {
+  return "$" + std::to_string(s.size()) + "\r\n" + std::string(s) + "\r\n";
+}
+
+// pipelines of arg 0 GETs of random keys
+std::vector<std::string> pipelines(std::size_t depth) {
+  std::vector<std::string> result(1 << 12);
+  std::mt19937 prng(42);
+  std::uniform_int_distribution<std::size_t> index(0, keyspace - 1);
+  for (auto &pipeline : result) {
+    for (std::size_t i = 0; i < depth; ++i)
+      pipeline += "*2\r\n$3\r\nGET\r\n" + bulk_string(key(index(prng)));
+  }
+  return result;
+}
+
+// pipelines of arg 0 INCRs of random counters, of which there are far fewer
+// than keys, as for rate limiting
+std::vector<std::string> incrs(std::size_t depth) {
+  std::vector<std::string> result(1 << 12);
+  std::mt19937 prng(42);
+  std::uniform_int_distribution<std::size_t> index(0, (1 << 16) - 1);
+  for (auto &pipeline : result) {
+    for (std::size_t i = 0; i < depth; ++i)
+      pipeline += "*2\r\n$4\r\nINCR\r\n" +
+                  bulk_string("counter:" + std::to_string(index(prng)));
+  }
+  return result;
+}
+
+// MGETs of arg 0 random keys
+std::vector<std::string> mgets(std::size_t keys) {
+  std::vector<std::string> result(1 << 12);
+  std::mt19937 prng(42);
+  std::uniform_int_distribution<std::size_t> index(0, keyspace - 1);
+  for (auto &command : result) {
+    command = "*" + std::to_string(keys + 1) + "\r\n$4\r\nMGET\r\n";
+    for (std::size_t i = 0; i < keys; ++i)
+      command += bulk_string(key(index(prng)));
+  }
+  return result;
+}
+
+template <redis::command_handler::mode Mode>
+void run(benchmark::State &state, const std::vector<std::string> &data) {
+  redis::resp::null_handler output;
+  redis::command_handler handler(populated_database(), output, nullptr, Mode);
+  redis::resp::basic_parser<redis::command_handler> parser(handler);
+
+  std::size_t i = 0;
+  for (auto _ : state) {
+    const auto &input = data[i++ % data.size()];
+    parser.parse(input.data(), input.data() + input.size());
+    handler.execute();
+  }
+  state.SetItemsProcessed(std::int64_t(state.iterations() * state.range(0)));
+}
+
+} // namespace
+
+template <redis::command_handler::mode Mode>
+void pipelined_gets(benchmark::State &state) {
+  run<Mode>(state, pipelines(std::size_t(state.range(0))));
+}
+
+void mget(benchmark::State &state) {
+  run<redis::command_handler::mode::immediate>(
+      state, mgets(std::size_t(state.range(0))));
+}
+
+void pipelined_incrs(benchmark::State &state) {
+  run<redis::command_handler::mode::batched>(
+      state, incrs(std::size_t(state.range(0))));
+}
+
+BENCHMARK_TEMPLATE(pipelined_gets, redis::command_handler::mode::immediate)
+    ->Arg(16)
+    ->Arg(64)
+    ->Arg(100);
+BENCHMARK_TEMPLATE(pipelined_gets, redis::command_handler::mode::batched)
+    ->Arg(16)
+    ->Arg(64)
+    ->Arg(100);
+BENCHMARK(mget)->Arg(16)->Arg(64)->Arg(100);
+BENCHMARK(pipelined_incrs)->Arg(16)->Arg(100);
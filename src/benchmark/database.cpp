@@ -0,0 +1,163 @@
+#include <benchmark/benchmark.h>
+
+#include <commands.hpp>
+#include <database.hpp>
+#include <memory.hpp>
+#include <resp.hpp>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr std::int64_t keys = 1 << 20;
+constexpr std::int64_t elements = 1 << 20;
+
+// a queue of job ids, RPUSHed one at a time
+void push_jobs(redis::database &db) {
+  redis::resp::null_handler output;
+  for (std::int64_t i = 0; i < elements; ++i) {
+    const auto job = "job:" + std::to_string(i);
+    redis_cmd_rpush({"RPUSH", "queue", job}, db, output);
+  }
+}
+
+// a hash of fields "field:0", "field:1" and so on, with 8 digit values
+void hset_fields(redis::database &db, std::string_view key,
+                 std::int64_t fields) {
+  redis::resp::null_handler output;
+  for (std::int64_t i = 0; i < fields; ++i) {
+    redis_cmd_hset({"HSET", key, "field:" + std::to_string(i), "10000000"},
+                   db, output);
+  }
+}
+
+} // namespace
+
+// bytes allocated per key for keys of about 10 characters and values of
+// arg 0 characters, with an expiry if arg 1
+void memory_footprint(benchmark::State &state) {
+  const std::string value(std::size_t(state.range(0)), 'x');
+  const auto expiry = redis::database::ex(std::chrono::system_clock::now(),
+                                          std::chrono::hours(24) /
+                                              std::chrono::seconds(1));
+  std::uint64_t used{};
+  for (auto _ : state) {
+    const auto before = redis::memory::allocated();
+    redis::database db;
+    for (std::int64_t i = 0; i < keys; ++i) {
+      if (state.range(1))
+        db.set("key:" + std::to_string(i), value, expiry);
+      else
+        db.set("key:" + std::to_string(i), value);
+    }
+    used = redis::memory::allocated() - before;
+  }
+  state.counters["bytes_per_key"] = double(used) / double(keys);
+  state.SetItemsProcessed(state.iterations() * keys);
+}
+
+BENCHMARK(memory_footprint)
+    ->ArgNames({"value_size", "expiry"})
+    ->Args({8, 0})
+    ->Args({15, 0})
+    ->Args({32, 0})
+    ->Args({8, 1})
+    ->Iterations(1)
+    ->Unit(benchmark::kMillisecond);
+
+// bytes allocated per element of a list
+void list_footprint(benchmark::State &state) {
+  std::uint64_t used{};
+  for (auto _ : state) {
+    redis::database db;
+    const auto before = redis::memory::allocated();
+    push_jobs(db);
+    used = redis::memory::allocated() - before;
+  }
+  state.counters["bytes_per_element"] = double(used) / double(elements);
+  state.SetItemsProcessed(state.iterations() * elements);
+}
+
+// LRANGEs of arg 0 elements from random places in the list
+void lrange(benchmark::State &state) {
+  static redis::database db = []() {
+    redis::database result;
+    push_jobs(result);
+    return result;
+  }();
+  std::mt19937 prng(42);
+  std::uniform_int_distribution<std::int64_t> index(0, elements - 1);
+  std::vector<std::string> starts, stops;
+  for (std::size_t i = 0; i < 1 << 12; ++i) {
+    const auto start = index(prng);
+    starts.push_back(std::to_string(start));
+    stops.push_back(std::to_string(start + state.range(0) - 1));
+  }
+
+  redis::resp::null_handler output;
+  std::size_t i = 0;
+  for (auto _ : state) {
+    redis_cmd_lrange({"LRANGE", "queue", starts[i % starts.size()],
+                      stops[i % stops.size()]},
+                     db, output);
+    ++i;
+  }
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+BENCHMARK(list_footprint)->Iterations(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(lrange)->Arg(10)->Arg(100);
+
+// bytes allocated per field, against the bytes of the fields and values
+// themselves, for hashes of arg 0 fields
+void hash_footprint(benchmark::State &state) {
+  const auto hashes = elements / state.range(0);
+  std::uint64_t used{};
+  std::uint64_t payload{};
+  for (auto _ : state) {
+    redis::database db;
+    const auto before = redis::memory::allocated();
+    for (std::int64_t i = 0; i < hashes; ++i)
+      hset_fields(db, "hash:" + std::to_string(i), state.range(0));
+    used = redis::memory::allocated() - before;
+    payload = 0;
+    for (std::int64_t i = 0; i < state.range(0); ++i)
+      payload += ("field:" + std::to_string(i)).size() + 8;
+    payload *= std::uint64_t(hashes);
+  }
+  state.counters["bytes_per_field"] = double(used) / double(elements);
+  state.counters["payload_per_field"] = double(payload) / double(elements);
+  state.SetItemsProcessed(state.iterations() * elements);
+}
+
+// HINCRBY of a random field of a hash of arg 0 fields
+void hincrby(benchmark::State &state) {
+  redis::database db;
+  hset_fields(db, "hash", state.range(0));
+  std::mt19937 prng(42);
+  std::uniform_int_distribution<std::int64_t> index(0, state.range(0) - 1);
+  std::vector<std::string> fields;
+  for (std::size_t i = 0; i < 1 << 12; ++i)
+    fields.push_back("field:" + std::to_string(index(prng)));
+
+  redis::resp::null_handler output;
+  std::size_t i = 0;
+  for (auto _ : state) {
+    redis_cmd_hincrby({"HINCRBY", "hash", fields[i % fields.size()], "1"}, db,
+                      output);
+    ++i;
+  }
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+BENCHMARK(hash_footprint)
+    ->ArgName("fields")
+    ->Arg(10)
+    ->Arg(100)
+    ->Arg(1000)
+    ->Iterations(1)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK(hincrby)->ArgName("fields")->Arg(10)->Arg(100)->Arg(10000);
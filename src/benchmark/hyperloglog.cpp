@@ -0,0 +1,63 @@
+#include <benchmark/benchmark.h>
+
+#include <hyperloglog.hpp>
+#include <simd.hpp>
+
+#include <array>
+#include <string>
+
+namespace {
+
+// a counter of arg 0 distinct users
+void hyperloglog_add(benchmark::State &state) {
+  auto hll = redis::hyperloglog::create();
+  std::uint64_t i = 0;
+  const auto users = std::uint64_t(state.range(0));
+  for (auto _ : state)
+    redis::hyperloglog::add(hll, "user:" + std::to_string(i++ % users));
+  state.counters["bytes"] = double(hll.size());
+  state.counters["count"] = double(redis::hyperloglog::count(hll));
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+// PFCOUNT of a week of daily counters, of 1M users each, merged with the
+// instruction set in arg 0
+void hyperloglog_union(benchmark::State &state) {
+  const auto isa = redis::simd::isa(state.range(0));
+  if (!redis::simd::supported(isa)) {
+    state.SkipWithError("instruction set not supported");
+    return;
+  }
+  const auto previous = redis::simd::current();
+  redis::simd::use(isa);
+
+  std::array<redis::compact_string, 7> days;
+  for (std::size_t day = 0; day < days.size(); ++day) {
+    days[day] = redis::hyperloglog::create();
+    for (int i = 0; i < 1'000'000; ++i)
+      redis::hyperloglog::add(days[day],
+                              "user:" + std::to_string(day * 500'000 + i));
+  }
+  std::uint64_t count{};
+  for (auto _ : state) {
+    redis::hyperloglog::registers_t registers{};
+    for (const auto &day : days)
+      redis::hyperloglog::merge(registers, day.view());
+    benchmark::DoNotOptimize(count = redis::hyperloglog::count(registers));
+  }
+  state.counters["count"] = double(count);
+
+  redis::simd::use(previous);
+}
+
+void isas(benchmark::internal::Benchmark *b) {
+  using redis::simd::isa;
+  for (const auto i : {isa::scalar, isa::sse2, isa::avx2})
+    b->Arg(std::int64_t(i));
+  b->ArgName("isa");
+}
+
+} // namespace
+
+BENCHMARK(hyperloglog_add)->ArgName("users")->Arg(100)->Arg(1'000'000);
+BENCHMARK(hyperloglog_union)->Apply(isas)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,86 @@
+#include <benchmark/benchmark.h>
+
+#include <io.hpp>
+#include <pubsub.hpp>
+#include <resp.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+
+namespace {
+
+// a connection's output, written to /dev/null
+class null_subscriber : public redis::subscriber {
+public:
+  explicit null_subscriber(bool share) : share_(share) {}
+
+  void deliver(const redis::pubsub::frame_t &frame) override {
+    if (share_)
+      out_.share(frame);
+    else
+      out_.sputn(frame->data(), std::streamsize(frame->size()));
+  }
+
+  void flush() { out_.pubsync(); }
+
+private:
+  bool share_;
+  redis::io::ofstreambuf out_{
+      redis::io::file_descriptor(::open, "/dev/null", O_WRONLY), 1 << 13};
+};
+
+// PUBLISH of a message of arg 0 bytes to arg 1 subscribers, with the frame
+// shared by them all if arg 2, or else copied into each one's output, as it
+// would be without sharing
+void pubsub_publish(benchmark::State &state) {
+  const auto size = std::size_t(state.range(0));
+  const auto count = std::size_t(state.range(1));
+  redis::pubsub pubsub;
+  redis::resp::null_handler output;
+  std::vector<std::unique_ptr<null_subscriber>> subscribers;
+  const std::vector<std::string_view> channel{"channel"};
+  for (std::size_t i = 0; i < count; ++i) {
+    subscribers.push_back(std::make_unique<null_subscriber>(state.range(2)));
+    pubsub.subscribe(*subscribers.back(), channel, output);
+  }
+
+  const std::string message(size, 'x');
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        pubsub.publish(redis::pubsub::message("channel", message)));
+    state.PauseTiming();
+    for (auto &s : subscribers)
+      s->flush();
+    state.ResumeTiming();
+  }
+  state.SetItemsProcessed(std::int64_t(state.iterations() * count));
+}
+
+// PUBLISH to a channel matched by one of arg 0 patterns, all with literal
+// prefixes other than the channel's but the one
+void pubsub_publish_patterns(benchmark::State &state) {
+  redis::pubsub pubsub;
+  redis::resp::null_handler output;
+  null_subscriber s(true);
+  for (std::int64_t i = 0; i < state.range(0); ++i) {
+    const std::vector<std::string_view> pattern{
+        i ? "user:" + std::to_string(i) + ":*" : "events.*"};
+    pubsub.psubscribe(s, pattern, output);
+  }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        pubsub.publish(redis::pubsub::message("events.login", "user:42")));
+    s.flush();
+  }
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+} // namespace
+
+BENCHMARK(pubsub_publish)
+    ->ArgNames({"size", "subscribers", "shared"})
+    ->ArgsProduct({{64, 1024, 16384}, {5000}, {0, 1}});
+BENCHMARK(pubsub_publish_patterns)->ArgName("patterns")->Arg(1)->Arg(1000);
@@ -2,6 +2,7 @@
 
 #include <io.hpp>
 #include <resp.hpp>
+#include <simd.hpp>
 
 #include <iostream>
 #include <random>
@@ -132,29 +133,147 @@ const std::vector<std::function<void(redis::resp::handler &)>>
       return std::move(recording.events_);
     }();
 
-void resp_parsing(benchmark::State &state) {
+// one inline command with a lot of arguments, e.g. a big RPUSH
+const std::string large_inline_command = []() {
+  std::mt19937 prng(42);
+  std::uniform_int_distribution<char> alpha_dist('a', 'z');
+  std::uniform_int_distribution<int> len_dist(1, 40);
+  std::string result = "RPUSH key";
+  while (result.size() < 1 << 16) {
+    result += ' ';
+    std::generate_n(std::back_inserter(result), len_dist(prng),
+                    [&]() { return alpha_dist(prng); });
+  }
+  return result + "\r\n";
+}();
+
+const std::string long_simple_strings = []() {
+  std::string result;
+  for (int i = 0; i < 16; ++i)
+    result += '+' + std::string(1 << 12, char('a' + i)) + "\r\n";
+  return result;
+}();
+
+// parses data with the scanning functions for the instruction set in arg 0
+template <typename Parser>
+void parse(benchmark::State &state, const std::string &data) {
+  const auto isa = redis::simd::isa(state.range(0));
+  if (!redis::simd::supported(isa)) {
+    state.SkipWithError("instruction set not supported");
+    return;
+  }
+  const auto previous = redis::simd::current();
+  redis::simd::use(isa);
+
   for (auto _ : state) {
     state.PauseTiming();
     redis::resp::null_handler h;
-    redis::resp::parser parser(h);
+    Parser parser(h);
     state.ResumeTiming();
-    parser.parse(random_data.c_str(), random_data.c_str() + random_data.size());
+    parser.parse(data.c_str(), data.c_str() + data.size());
   }
+  state.SetBytesProcessed(std::int64_t(state.iterations() * data.size()));
+
+  redis::simd::use(previous);
+}
+
+// the handler called through its virtual functions
+using virtual_parser = redis::resp::parser;
+
+// the handler's (empty) functions inlined
+using static_parser = redis::resp::basic_parser<redis::resp::null_handler>;
+
+template <typename Parser> void resp_parsing(benchmark::State &state) {
+  parse<Parser>(state, random_data);
+}
+
+template <typename Parser>
+void resp_parsing_large_inline_command(benchmark::State &state) {
+  parse<Parser>(state, large_inline_command);
+}
+
+template <typename Parser>
+void resp_parsing_long_simple_strings(benchmark::State &state) {
+  parse<Parser>(state, long_simple_strings);
+}
+
+// each of the scanning implementations
+void isas(benchmark::internal::Benchmark *b) {
+  using redis::simd::isa;
+  for (auto i : {isa::scalar, isa::sse2, isa::avx2})
+    b->Arg(int(i));
+  b->ArgName("isa");
+}
+
+redis::io::ofstreambuf make_ofstreambuf() {
+  return {redis::io::file_descriptor(::memfd_create, "resp writing benchmark", 0),
+          1 << 13};
 }
 
 void resp_writing(benchmark::State &state) {
   for (auto _ : state) {
     state.PauseTiming();
-    redis::io::ofstreambuf sb(
-        redis::io::file_descriptor(::memfd_create, "resp writing benchmark", 0),
-        1 << 13);
-    std::ostringstream os2;
-    redis::resp::writer writer2(os2);
+    auto sb = make_ofstreambuf();
+    std::ostream os(&sb);
+    redis::resp::writer writer(os);
+    state.ResumeTiming();
+    for (const auto &event : random_data_events)
+      event(writer);
+    os.flush();
+  }
+}
+
+void resp_buffer_writing(benchmark::State &state) {
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto sb = make_ofstreambuf();
+    redis::resp::buffer_writer writer(sb);
     state.ResumeTiming();
     for (const auto &event : random_data_events)
-      event(writer2);
+      event(writer);
+    sb.pubsync();
+  }
+}
+
+// the kinds of replies GET, SET, INCR and friends make, as whole values
+template <typename Writer> void resp_writing_replies(benchmark::State &state) {
+  const std::string value(state.range(0), 'x');
+  for (auto _ : state) {
+    state.PauseTiming();
+    auto sb = make_ofstreambuf();
+    std::ostream os(&sb);
+    Writer writer = [&]() {
+      if constexpr (std::is_constructible_v<Writer, std::ostream &>)
+        return Writer(os);
+      else
+        return Writer(sb);
+    }();
+    state.ResumeTiming();
+    for (int i = 0; i < 1 << 10; ++i) {
+      writer.simple_string("OK");
+      writer.bulk_string(value);
+      writer.integer(i);
+      writer.null_bulk_string();
+    }
+    sb.pubsync();
   }
 }
 
-BENCHMARK(resp_parsing);
+BENCHMARK_TEMPLATE(resp_parsing, virtual_parser)->Apply(isas);
+BENCHMARK_TEMPLATE(resp_parsing, static_parser)->Apply(isas);
+BENCHMARK_TEMPLATE(resp_parsing_large_inline_command, virtual_parser)
+    ->Apply(isas);
+BENCHMARK_TEMPLATE(resp_parsing_large_inline_command, static_parser)
+    ->Apply(isas);
+BENCHMARK_TEMPLATE(resp_parsing_long_simple_strings, virtual_parser)
+    ->Apply(isas);
+BENCHMARK_TEMPLATE(resp_parsing_long_simple_strings, static_parser)
+    ->Apply(isas);
 BENCHMARK(resp_writing);
+BENCHMARK(resp_buffer_writing);
+BENCHMARK_TEMPLATE(resp_writing_replies, redis::resp::writer)
+    ->Arg(16)
+    ->Arg(1 << 10);
+BENCHMARK_TEMPLATE(resp_writing_replies, redis::resp::buffer_writer)
+    ->Arg(16)
+    ->Arg(1 << 10);
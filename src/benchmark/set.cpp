@@ -0,0 +1,89 @@
+#include <benchmark/benchmark.h>
+
+#include <set.hpp>
+#include <simd.hpp>
+
+#include <random>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace {
+
+// two sets of arg 0 ids each, from a range of 4 times as many, so that about
+// a quarter of each is in the other; intsets if intset, else hash sets
+std::pair<redis::set, redis::set> tag_sets(std::int64_t size, bool intset) {
+  std::mt19937_64 prng(42);
+  const auto make = [&]() {
+    redis::set result(intset ? std::size_t(size) : 0);
+    std::vector<std::string> ids;
+    for (std::int64_t i = 0; i < size; ++i)
+      ids.push_back(std::to_string(prng() % std::uint64_t(4 * size)));
+    const std::vector<std::string_view> views(ids.begin(), ids.end());
+    result.insert(views);
+    return result;
+  };
+  auto a = make();
+  return {std::move(a), make()};
+}
+
+// times op on tag_sets of arg 0 ids, as intsets merged with the instruction
+// set in arg 1, or as hash sets if arg 1 is -1
+template <typename Op> void set_algebra(benchmark::State &state, Op op) {
+  const bool intset = state.range(1) >= 0;
+  const auto isa = intset ? redis::simd::isa(state.range(1))
+                          : redis::simd::current();
+  if (!redis::simd::supported(isa)) {
+    state.SkipWithError("instruction set not supported");
+    return;
+  }
+  const auto previous = redis::simd::current();
+  redis::simd::use(isa);
+
+  const auto [a, b] = tag_sets(state.range(0), intset);
+  const std::vector<const redis::set *> sets{&a, &b};
+  std::size_t size{};
+  for (auto _ : state)
+    size = op(sets).size();
+  state.counters["result"] = double(size);
+  state.SetItemsProcessed(
+      std::int64_t(state.iterations() * (a.size() + b.size())));
+
+  redis::simd::use(previous);
+}
+
+void set_intersect(benchmark::State &state) {
+  set_algebra(state, [](auto sets) {
+    return redis::set::intersect(sets, std::size_t(-1));
+  });
+}
+
+void set_unite(benchmark::State &state) {
+  set_algebra(state, [](auto sets) {
+    return redis::set::unite(sets, std::size_t(-1));
+  });
+}
+
+void set_subtract(benchmark::State &state) {
+  set_algebra(state, [](auto sets) {
+    return redis::set::subtract(*sets[0], std::span(sets).subspan(1),
+                                std::size_t(-1));
+  });
+}
+
+// sets of 10k to 1M ids, as hash sets and as intsets with each instruction set
+void sizes_and_isas(benchmark::internal::Benchmark *b) {
+  using redis::simd::isa;
+  for (const std::int64_t size : {10000, 100000, 1000000}) {
+    b->Args({size, -1});
+    for (const auto i : {isa::scalar, isa::avx2})
+      b->Args({size, std::int64_t(i)});
+  }
+  b->ArgNames({"ids", "isa"});
+}
+
+} // namespace
+
+BENCHMARK(set_intersect)->Apply(sizes_and_isas)->Unit(benchmark::kMicrosecond);
+BENCHMARK(set_unite)->Apply(sizes_and_isas)->Unit(benchmark::kMicrosecond);
+BENCHMARK(set_subtract)->Apply(sizes_and_isas)->Unit(benchmark::kMicrosecond);
@@ -0,0 +1,62 @@
+#include <benchmark/benchmark.h>
+
+#include <commands.hpp>
+#include <database.hpp>
+#include <resp.hpp>
+#include <snapshot.hpp>
+
+#include <memory>
+#include <sstream>
+#include <string>
+
+namespace {
+
+constexpr std::int64_t keys = 1 << 20;
+
+// "key:0", "key:1" and so on, each with a 16 byte value
+void set_keys(redis::database &db) {
+  const std::string value(16, 'v');
+  for (std::int64_t i = 0; i < keys; ++i)
+    db.set("key:" + std::to_string(i), value);
+}
+
+// the same keys, as the commands they were saved as before snapshots
+std::string set_commands() {
+  const std::string value(16, 'v');
+  std::string result;
+  for (std::int64_t i = 0; i < keys; ++i) {
+    const auto key = "key:" + std::to_string(i);
+    result += "*3\r\n$3\r\nSET\r\n$" + std::to_string(key.size()) + "\r\n" +
+              key + "\r\n$16\r\n" + value + "\r\n";
+  }
+  return result;
+}
+
+// LOAD of keys from a snapshot if arg 0, or else by replaying commands
+void snapshot_load(benchmark::State &state) {
+  std::string bytes;
+  if (state.range(0)) {
+    redis::database db;
+    set_keys(db);
+    std::ostringstream os;
+    redis::snapshot::save(db, os);
+    bytes = std::move(os).str();
+  } else {
+    bytes = set_commands();
+  }
+
+  redis::database db(
+      std::chrono::system_clock::now,
+      [&]() { return std::make_unique<std::istringstream>(bytes); });
+  redis::resp::null_handler output;
+  for (auto _ : state) {
+    redis_cmd_load({"LOAD"}, db, output);
+    benchmark::DoNotOptimize(db.size());
+  }
+  state.SetItemsProcessed(state.iterations() * keys);
+  state.SetBytesProcessed(state.iterations() * std::int64_t(bytes.size()));
+}
+
+} // namespace
+
+BENCHMARK(snapshot_load)->Arg(0)->Arg(1)->Unit(benchmark::kMillisecond);
@@ -0,0 +1,109 @@
+#include <benchmark/benchmark.h>
+
+#include <memory.hpp>
+#include <quicklist.hpp>
+#include <stream.hpp>
+
+#include <array>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+constexpr std::uint64_t events = 1000000;
+
+// an event of a log, with the same fields as every other, as XADD
+// user:123 action login ts 1700000000 would add
+std::array<std::string, 6> event(std::uint64_t i) {
+  return {"user",   "user:" + std::to_string(i % 10000),
+          "action", i % 3 ? "view" : "login",
+          "ts",     std::to_string(1700000000 + i / 100)};
+}
+
+void append_events(redis::stream &stream, std::uint64_t count) {
+  for (std::uint64_t i = 0; i < count; ++i) {
+    const auto fields = event(i);
+    const std::array<std::string_view, 6> views{
+        fields[0], fields[1], fields[2], fields[3], fields[4], fields[5]};
+    stream.append({1700000000000 + i / 4, i % 4}, views);
+  }
+}
+
+const redis::stream &event_log() {
+  static const redis::stream log = []() {
+    redis::stream result;
+    append_events(result, events);
+    return result;
+  }();
+  return log;
+}
+
+void stream_append(benchmark::State &state) {
+  const auto fields = event(0);
+  const std::array<std::string_view, 6> views{
+      fields[0], fields[1], fields[2], fields[3], fields[4], fields[5]};
+  redis::stream stream;
+  std::uint64_t i = 0;
+  for (auto _ : state) {
+    stream.append({i / 4, i % 4}, views);
+    ++i;
+  }
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+// as XRANGE id + COUNT arg 0 from a random ID of a million
+void stream_range(benchmark::State &state) {
+  const auto &log = event_log();
+  std::mt19937_64 prng(42);
+  std::vector<redis::stream_id> starts;
+  for (std::size_t i = 0; i < 1 << 12; ++i) {
+    const auto start = prng() % events;
+    starts.push_back({1700000000000 + start / 4, start % 4});
+  }
+  const auto count = std::size_t(state.range(0));
+  std::size_t i = 0;
+  for (auto _ : state) {
+    std::size_t visited = 0;
+    log.visit(starts[i++ % starts.size()], redis::stream_id::max(), false,
+              [&](redis::stream_id id,
+                  const std::vector<std::string_view> &fields_and_values) {
+                benchmark::DoNotOptimize(id);
+                benchmark::DoNotOptimize(fields_and_values.data());
+                return ++visited < count;
+              });
+  }
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+// bytes allocated per entry, against those of a list of the same fields and
+// values, without their IDs, in a quicklist
+void stream_footprint(benchmark::State &state) {
+  std::uint64_t used{};
+  std::uint64_t list_used{};
+  for (auto _ : state) {
+    auto before = redis::memory::allocated();
+    {
+      redis::stream stream;
+      append_events(stream, events);
+      used = redis::memory::allocated() - before;
+    }
+    before = redis::memory::allocated();
+    redis::quicklist list;
+    for (std::uint64_t i = 0; i < events; ++i) {
+      for (const auto &s : event(i))
+        list.push_back(s);
+    }
+    list_used = redis::memory::allocated() - before;
+  }
+  state.counters["bytes_per_entry"] = double(used) / double(events);
+  state.counters["list_bytes_per_entry"] = double(list_used) / double(events);
+  state.SetItemsProcessed(std::int64_t(state.iterations() * events));
+}
+
+} // namespace
+
+BENCHMARK(stream_append);
+BENCHMARK(stream_range)->ArgName("count")->Arg(1)->Arg(10)->Arg(100);
+BENCHMARK(stream_footprint)->Iterations(1)->Unit(benchmark::kMillisecond);
@@ -1,8 +1,14 @@
 #include <benchmark/benchmark.h>
 
+#include <command_table.hpp>
+#include <commands.hpp>
 #include <util.hpp>
 
+#include <ankerl/unordered_dense.h>
+
+#include <array>
 #include <random>
+#include <string_view>
 
 const std::string random_data = []() {
   std::string result;
@@ -32,5 +38,39 @@ void case_insensitive_equal(benchmark::State &state) {
   }
 }
 
+// command names as clients tend to send them
+constexpr std::array<std::string_view, 8> command_names{
+    "GET", "set", "Incr", "LRANGE", "lpush", "PING", "del", "nosuchcommand",
+};
+
+void command_lookup_perfect_hash(benchmark::State &state) {
+  for (auto _ : state) {
+    for (const auto name : command_names) {
+      const redis::commands::command_info *cmd;
+      benchmark::DoNotOptimize(cmd = redis::commands::find(name));
+    }
+    benchmark::ClobberMemory();
+  }
+}
+
+// the per connection table that command_handler used to build
+void command_lookup_map(benchmark::State &state) {
+  ankerl::unordered_dense::map<std::string_view, redis::commands::cmd_t,
+                               redis::util::ci_hash, redis::util::ci_equal>
+      cmds;
+  for (const auto &cmd : redis::commands::all())
+    cmds[cmd.name] = cmd.cmd;
+
+  for (auto _ : state) {
+    for (const auto name : command_names) {
+      bool found;
+      benchmark::DoNotOptimize(found = cmds.find(name) != cmds.end());
+    }
+    benchmark::ClobberMemory();
+  }
+}
+
 BENCHMARK(case_insensitive_hash);
 BENCHMARK(case_insensitive_equal);
+BENCHMARK(command_lookup_perfect_hash);
+BENCHMARK(command_lookup_map);
@@ -0,0 +1,88 @@
+#include <benchmark/benchmark.h>
+
+#include <zset.hpp>
+
+#include <map>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::string player(std::uint64_t i) { return "player:" + std::to_string(i); }
+
+// a leaderboard of size players with random scores, built once per size as
+// the larger ones take seconds to fill
+redis::zset &leaderboard(std::int64_t size) {
+  static std::map<std::int64_t, std::unique_ptr<redis::zset>> boards;
+  auto &board = boards[size];
+  if (!board) {
+    board = std::make_unique<redis::zset>();
+    std::mt19937_64 prng(42);
+    for (std::int64_t i = 0; i < size; ++i)
+      board->insert(player(std::uint64_t(i)), double(prng() % 1000000));
+  }
+  return *board;
+}
+
+// players of a leaderboard of arg 0 players, at random
+std::vector<std::string> players(const benchmark::State &state) {
+  std::mt19937_64 prng(7);
+  std::vector<std::string> result;
+  for (std::size_t i = 0; i < 1 << 12; ++i)
+    result.push_back(player(prng() % std::uint64_t(state.range(0))));
+  return result;
+}
+
+// as ZINCRBY: each moves a player, taking it out of the tree and putting it
+// back elsewhere
+void zset_incr(benchmark::State &state) {
+  auto &board = leaderboard(state.range(0));
+  const auto members = players(state);
+  std::size_t i = 0;
+  for (auto _ : state) {
+    const auto &member = members[i++ % members.size()];
+    board.insert(member, *board.score(member) + 1);
+  }
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+void zset_rank(benchmark::State &state) {
+  const auto &board = leaderboard(state.range(0));
+  const auto members = players(state);
+  std::size_t i = 0;
+  for (auto _ : state)
+    benchmark::DoNotOptimize(board.rank(members[i++ % members.size()]));
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+// as ZRANGEBYSCORE LIMIT 0 10 from a random score
+void zset_range_by_score(benchmark::State &state) {
+  const auto &board = leaderboard(state.range(0));
+  std::mt19937_64 prng(7);
+  std::vector<double> scores;
+  for (std::size_t i = 0; i < 1 << 12; ++i)
+    scores.push_back(double(prng() % 1000000));
+  std::size_t i = 0;
+  for (auto _ : state) {
+    const auto start = board.count_below(scores[i++ % scores.size()], false);
+    board.visit(start, start + 10, [](std::string_view member, double score) {
+      benchmark::DoNotOptimize(member);
+      benchmark::DoNotOptimize(score);
+    });
+  }
+  state.SetItemsProcessed(std::int64_t(state.iterations()));
+}
+
+} // namespace
+
+BENCHMARK(zset_incr)->ArgName("players")->Arg(1000)->Arg(1000000)->Arg(
+    10000000);
+BENCHMARK(zset_rank)->ArgName("players")->Arg(1000)->Arg(1000000)->Arg(
+    10000000);
+BENCHMARK(zset_range_by_score)
+    ->ArgName("players")
+    ->Arg(1000)
+    ->Arg(1000000)
+    ->Arg(10000000);
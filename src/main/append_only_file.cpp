@@ -0,0 +1,361 @@
+#include "append_only_file.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+
+namespace {
+
+// beyond which a deadline in milliseconds isn't accepted, as in EXPIRE
+constexpr std::int64_t max_expire = std::int64_t(1) << 46;
+
+// a buffer that's grown past this, e.g. by a rewrite, isn't kept
+constexpr std::size_t max_retained = 1 << 20;
+
+template <typename Number> void put(std::string &out, Number n) {
+  std::array<char, 32> buf;
+  out.append(buf.data(), std::to_chars(buf.begin(), buf.end(), n).ptr);
+}
+
+std::size_t digits(std::size_t n) {
+  std::size_t result = 1;
+  for (; n >= 10; n /= 10)
+    ++result;
+  return result;
+}
+
+// as an array of bulk strings, grown into once rather than appended to a
+// piece at a time, as that's done for every write command
+void put(std::string &out, const std::vector<std::string_view> &args) {
+  std::size_t size = 1 + digits(args.size()) + 2;
+  for (const auto arg : args)
+    size += 1 + digits(arg.size()) + 2 + arg.size() + 2;
+
+  const auto at = out.size();
+  out.resize(at + size);
+  char *p = out.data() + at;
+  const auto count = [&p](char type, std::size_t n) {
+    *p++ = type;
+    p = std::to_chars(p, p + digits(n), n).ptr;
+    *p++ = '\r';
+    *p++ = '\n';
+  };
+  count('*', args.size());
+  for (const auto arg : args) {
+    count('$', arg.size());
+    p = std::copy(arg.begin(), arg.end(), p);
+    *p++ = '\r';
+    *p++ = '\n';
+  }
+}
+
+std::optional<std::int64_t> to_int(std::string_view s) {
+  std::int64_t result{};
+  const auto [ptr, ec] = std::from_chars(s.begin(), s.end(), result);
+  if (ec != std::errc() || ptr != s.end())
+    return {};
+  return result;
+}
+
+// whether bytes start with the decimal count and CRLF after a type byte
+// that was expected, and if so where they end and what the count is
+enum class parsed { ok, incomplete, malformed };
+
+parsed count(std::string_view bytes, std::size_t &pos, char type,
+             std::int64_t &result) {
+  if (pos == bytes.size())
+    return parsed::incomplete;
+  if (bytes[pos] != type)
+    return parsed::malformed;
+  const auto end = bytes.find("\r\n", pos + 1);
+  if (end == std::string_view::npos)
+    return bytes.size() - pos - 1 > 20 ? parsed::malformed
+                                       : parsed::incomplete;
+  const auto n = to_int(bytes.substr(pos + 1, end - pos - 1));
+  if (!n || *n < 0)
+    return parsed::malformed;
+  result = *n;
+  pos = end + 2;
+  return parsed::ok;
+}
+
+/**
+ * @param bytes commands as they're recorded, each an array of bulk strings
+ * @param pos set to where the last whole command ends
+ * @return incomplete if what's after that is the start of a command cut off
+ * part way through, as by a crash part way through a write
+ */
+parsed whole_commands(std::string_view bytes, std::size_t &pos) {
+  pos = 0;
+  for (;;) {
+    if (pos == bytes.size())
+      return parsed::ok;
+    auto at = pos;
+    std::int64_t args{};
+    if (const auto p = count(bytes, at, '*', args); p != parsed::ok)
+      return p;
+    for (std::int64_t i = 0; i < args; ++i) {
+      std::int64_t size{};
+      if (const auto p = count(bytes, at, '$', size); p != parsed::ok)
+        return p;
+      if (bytes.size() - at < std::uint64_t(size) + 2)
+        return parsed::incomplete;
+      if (bytes.substr(at + std::size_t(size), 2) != "\r\n")
+        return parsed::malformed;
+      at += std::size_t(size) + 2;
+    }
+    pos = at;
+  }
+}
+
+} // namespace
+
+redis::append_only_file::append_only_file(const std::string &path,
+                                          fsync_policy policy)
+    : fd_(::open, path.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC,
+          0644),
+      policy_(policy) {
+  {
+    const io::mapped_streambuf existing(path);
+    const auto bytes = existing.bytes();
+    std::size_t end;
+    if (whole_commands({bytes.data(), bytes.size()}, end) ==
+        parsed::malformed)
+      throw std::runtime_error("bad append only file " + path +
+                               ": not a command at byte " +
+                               std::to_string(end));
+    if (end != bytes.size()) {
+      io::posix_call(::ftruncate, fd_.value(), ::off_t(end));
+      sync();
+    }
+    size_ = end;
+  }
+
+  if (policy_ == fsync_policy::everysec) {
+    syncer_ = std::jthread([this](std::stop_token stop) {
+      std::mutex mutex;
+      std::condition_variable_any stopped;
+      std::unique_lock lock(mutex);
+      while (!stop.stop_requested()) {
+        stopped.wait_for(lock, stop, std::chrono::seconds(1),
+                         []() { return false; });
+        if (unsynced_.exchange(false) && ::fdatasync(fd_.value()) == -1)
+          sync_error_ = errno;
+      }
+    });
+  }
+}
+
+const std::vector<std::string_view> &
+redis::append_only_file::record(const std::vector<std::string_view> &args,
+                                database &db) {
+  const util::ci_equal equal;
+  // only read the clock for the commands that depend on it
+  const auto at = [&db]() {
+    return std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  };
+  const auto now = [&at]() { return at().time_since_epoch().count(); };
+  const std::vector<std::string_view> *result = &args;
+
+  if (args.size() == 5 && equal(args[0], "SET")) {
+    // SET key value EX|PX n, as SET key value PXAT deadline
+    const bool ex = equal(args[3], "EX");
+    const auto n = to_int(args[4]);
+    if ((ex || equal(args[3], "PX")) && n && *n >= 0 && *n <= max_expire) {
+      arg_.clear();
+      put(arg_, now() + *n * (ex ? 1000 : 1));
+      args_ = {args[0], args[1], args[2], "PXAT", arg_};
+      result = &args_;
+    }
+  } else if (args.size() == 3 &&
+             (equal(args[0], "EXPIRE") || equal(args[0], "PEXPIRE"))) {
+    // as PEXPIREAT key deadline, if it's one PEXPIREAT accepts
+    const auto n = to_int(args[2]);
+    const auto unit = args[0].size() == 6 ? 1000 : 1;
+    if (n && *n >= -max_expire && *n <= max_expire &&
+        std::abs(now() + *n * unit) <= max_expire) {
+      arg_.clear();
+      put(arg_, now() + *n * unit);
+      args_ = {"PEXPIREAT", args[1], arg_};
+      result = &args_;
+    }
+  } else if (args.size() >= 5 && equal(args[0], "XADD")) {
+    // an ID of * as ms-*, with ms what * would have taken
+    std::size_t i = 2;
+    while (i < args.size()) {
+      if (equal(args[i], "NOMKSTREAM"))
+        ++i;
+      else if (equal(args[i], "MAXLEN") && i + 1 < args.size())
+        i += args[i + 1] == "~" || args[i + 1] == "=" ? 3 : 2;
+      else
+        break;
+    }
+    if (i < args.size() && args[i] == "*") {
+      try {
+        const auto stream = db.get_stream(args[1], at());
+        arg_.clear();
+        put(arg_, std::max(std::uint64_t(now()),
+                           stream ? stream->get().last_id().ms : 0));
+        arg_ += "-*";
+        args_.assign(args.begin(), args.end());
+        args_[i] = arg_;
+        result = &args_;
+      } catch (const wrong_type &) {
+        // the command fails the same way whenever it's run
+      }
+    }
+  }
+
+  put(buffer_, *result);
+  return *result;
+}
+
+void redis::append_only_file::append(
+    const std::vector<std::string_view> &args) {
+  put(buffer_, args);
+}
+
+void redis::append_only_file::rewrite(database &db) {
+  std::vector<std::string_view> args;
+  std::string expiry;
+  std::vector<std::string> numbers;
+
+  const auto begin = [&](std::string_view command, std::string_view key) {
+    args.assign({command, key});
+  };
+  // the expiry of a key that isn't a string is set after its value
+  const auto pexpireat = [&](std::string_view key,
+                             database::time_point deadline) {
+    if (deadline == database::never)
+      return;
+    expiry.clear();
+    put(expiry, deadline.time_since_epoch().count());
+    append({"PEXPIREAT", key, expiry});
+  };
+
+  db.visit(util::overloaded{
+      [&](std::string_view key, const string_value &value,
+          database::time_point deadline) -> bool {
+        begin("SET", key);
+        args.push_back(value);
+        if (deadline != database::never) {
+          expiry.clear();
+          put(expiry, deadline.time_since_epoch().count());
+          args.insert(args.end(), {"PXAT", expiry});
+        }
+        append(args);
+        return true;
+      },
+      [&](std::string_view key, const database::list_t &list,
+          database::time_point deadline) -> bool {
+        begin("RPUSH", key);
+        args.insert(args.end(), list.begin(), list.end());
+        append(args);
+        pexpireat(key, deadline);
+        return true;
+      },
+      [&](std::string_view key, const database::hash_t &hash,
+          database::time_point deadline) -> bool {
+        begin("HSET", key);
+        hash.visit([&](std::string_view field, std::string_view value) {
+          args.insert(args.end(), {field, value});
+        });
+        append(args);
+        pexpireat(key, deadline);
+        return true;
+      },
+      [&](std::string_view key, const database::set_t &set,
+          database::time_point deadline) -> bool {
+        begin("SADD", key);
+        set.visit([&](std::string_view member) { args.push_back(member); });
+        append(args);
+        pexpireat(key, deadline);
+        return true;
+      },
+      [&](std::string_view key, const database::zset_t &zset,
+          database::time_point deadline) -> bool {
+        // the scores' text has to outlive the views of it
+        numbers.clear();
+        numbers.reserve(zset.size());
+        zset.visit(0, zset.size(), [&](std::string_view, double score) {
+          put(numbers.emplace_back(), score);
+        });
+        begin("ZADD", key);
+        auto score = numbers.begin();
+        zset.visit(0, zset.size(), [&](std::string_view member, double) {
+          args.insert(args.end(), {*score++, member});
+        });
+        append(args);
+        pexpireat(key, deadline);
+        return true;
+      },
+      [&](std::string_view key, const database::stream_t &stream,
+          database::time_point deadline) -> bool {
+        // an entry to a command, as XADD takes one at a time
+        std::string id;
+        const auto put_id = [&](stream_id i) {
+          id.clear();
+          put(id, i.ms);
+          id += '-';
+          put(id, i.seq);
+        };
+        stream.visit(stream_id(), stream_id::max(), false,
+                     [&](stream_id i, const std::vector<std::string_view>
+                                          &fields_and_values) {
+                       put_id(i);
+                       begin("XADD", key);
+                       args.push_back(id);
+                       args.insert(args.end(), fields_and_values.begin(),
+                                   fields_and_values.end());
+                       append(args);
+                       return true;
+                     });
+        // one that's been trimmed to nothing still has its last ID, which
+        // an entry that's added and trimmed straight away brings back
+        if (stream.empty()) {
+          put_id(stream.last_id());
+          append({"XADD", key, "MAXLEN", "0", id, "", ""});
+        }
+        pexpireat(key, deadline);
+        return true;
+      },
+      [](std::string_view, const std::monostate &, database::time_point)
+          -> bool { return true; },
+  });
+}
+
+void redis::append_only_file::write() {
+  if (const auto error = sync_error_.exchange(0))
+    throw std::system_error(error, std::generic_category());
+  if (buffer_.empty())
+    return;
+
+  for (std::string_view rest = buffer_; !rest.empty();) {
+    const auto n =
+        io::posix_call(::write, fd_.value(), rest.data(), rest.size());
+    rest.remove_prefix(std::size_t(n));
+    size_ += std::uint64_t(n);
+  }
+  if (buffer_.capacity() > max_retained)
+    buffer_ = std::string();
+  else
+    buffer_.clear();
+
+  if (policy_ == fsync_policy::always)
+    sync();
+  else
+    unsynced_ = true;
+}
+
+void redis::append_only_file::sync() {
+  io::posix_call(::fdatasync, fd_.value());
+}
@@ -0,0 +1,107 @@
+#ifndef REDIS_SERVER_APPEND_ONLY_FILE_HPP
+#define REDIS_SERVER_APPEND_ONLY_FILE_HPP
+
+#include "command_handler.hpp"
+#include "database.hpp"
+#include "io.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace redis {
+
+/**
+ * A log of the write commands run against a database, in RESP, to be
+ * replayed when the server restarts. Commands are recorded into a buffer as
+ * they run, which is written out by write(), once for however many there
+ * were, and made durable as often as the fsync policy says. Commands whose
+ * effect depends on when they run, such as EXPIRE or XADD with an ID of *,
+ * are recorded, and run, as their absolute equivalents.
+ */
+class append_only_file final : public journal {
+public:
+  enum class fsync_policy {
+    // by write(), before anything that depends on the commands is sent
+    always,
+    // once a second, by a thread of its own
+    everysec,
+    // whenever the kernel gets round to it
+    no
+  };
+
+  /**
+   * Open path to append to, creating it if it's missing, and cut off the
+   * end of a command that was being written when the server stopped.
+   * @param path
+   * @param policy
+   * @throws std::system_error if it can't be opened
+   * @throws std::runtime_error if it isn't a log of commands
+   */
+  append_only_file(const std::string &path, fsync_policy policy);
+
+  append_only_file(const append_only_file &) = delete;
+  append_only_file &operator=(const append_only_file &) = delete;
+
+  const std::vector<std::string_view> &
+  record(const std::vector<std::string_view> &args, database &db) override;
+
+  /**
+   * Record a command that has already been run, as is, e.g. a DEL of a key
+   * the database has evicted.
+   * @param args
+   */
+  void append(const std::vector<std::string_view> &args);
+
+  /**
+   * Record the commands that would recreate the whole of db, e.g. to begin
+   * the file with what was loaded from a snapshot.
+   * @param db
+   */
+  void rewrite(database &db);
+
+  /**
+   * Write what's been recorded since the last write(), and under always,
+   * wait for it to be durable.
+   * @throws std::system_error if it couldn't be written, or an earlier
+   * fsync failed
+   */
+  void write();
+
+  /**
+   * Wait for everything written to be durable, whatever the policy.
+   * @throws std::system_error
+   */
+  void sync();
+
+  [[nodiscard]] fsync_policy policy() const noexcept { return policy_; }
+
+  /**
+   * @return how many bytes have been written, including those there were
+   * when it was opened
+   */
+  [[nodiscard]] std::uint64_t size() const noexcept { return size_; }
+
+private:
+  io::file_descriptor fd_;
+  const fsync_policy policy_;
+  std::uint64_t size_{};
+  // recorded, but not yet written
+  std::string buffer_;
+  // a command as it's to be run, if that isn't as it was given
+  std::vector<std::string_view> args_;
+  std::string arg_;
+  // set by write() for the thread that fsyncs under everysec, which sets
+  // sync_error_ if it fails
+  std::atomic<bool> unsynced_;
+  std::atomic<int> sync_error_;
+  // after fd_, so that it's stopped before that's closed
+  std::jthread syncer_;
+};
+
+} // namespace redis
+
+#endif // REDIS_SERVER_APPEND_ONLY_FILE_HPP
@@ -0,0 +1,56 @@
+#include "background_task.hpp"
+
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+namespace {
+
+std::array<int, 2> make_pipe() {
+  std::array<int, 2> result{};
+  redis::io::posix_call(::pipe2, result.data(), O_CLOEXEC);
+  return result;
+}
+
+} // namespace
+
+redis::background_task::background_task(const std::function<bool()> &task)
+    : background_task(task, make_pipe()) {}
+
+redis::background_task::background_task(const std::function<bool()> &task,
+                                         std::array<int, 2> pipe)
+    : fd_([&]() { return pipe[0]; }) {
+  const io::file_descriptor write_end([&]() { return pipe[1]; });
+
+  const auto start = std::chrono::steady_clock::now();
+  pid_ = io::posix_call(::fork);
+  if (pid_ == 0) {
+    char ok = 0;
+    try {
+      ok = task();
+    } catch (...) {
+    }
+    // _exit, as the atexit handlers and static destructors are the parent's
+    TEMP_FAILURE_RETRY(::write(write_end.value(), &ok, sizeof(ok)));
+    ::_exit(0);
+  }
+  fork_time_ = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+}
+
+redis::background_task::~background_task() noexcept {
+  if (reaped_)
+    return;
+  ::kill(pid_, SIGKILL);
+  TEMP_FAILURE_RETRY(::waitpid(pid_, nullptr, 0));
+}
+
+bool redis::background_task::wait() {
+  char ok = 0;
+  const auto n = TEMP_FAILURE_RETRY(::read(fd_.value(), &ok, sizeof(ok)));
+  int status{};
+  io::posix_call(::waitpid, pid_, &status, 0);
+  reaped_ = true;
+  return n == sizeof(ok) && ok && WIFEXITED(status) &&
+         WEXITSTATUS(status) == 0;
+}
@@ -0,0 +1,73 @@
+#ifndef REDIS_SERVER_BACKGROUND_TASK_HPP
+#define REDIS_SERVER_BACKGROUND_TASK_HPP
+
+#include "io.hpp"
+
+#include <array>
+#include <chrono>
+#include <functional>
+
+#include <sys/types.h>
+
+namespace redis {
+
+/**
+ * Work done by a forked child process, from its copy-on-write view of the
+ * parent's memory as it was at the fork, while the parent carries on. The
+ * child says how it went through a pipe, which becomes readable once it's
+ * done, so that the parent's event loop can wait for it with its sockets.
+ */
+class background_task {
+public:
+  /**
+   * Fork a child that runs task and exits.
+   * @param task returns whether it succeeded. As the child has only the
+   * thread that forked, it mustn't need the others, or anything they might
+   * have been in the middle of.
+   * @throws std::system_error if the child couldn't be forked
+   */
+  explicit background_task(const std::function<bool()> &task);
+
+  background_task(const background_task &) = delete;
+  background_task &operator=(const background_task &) = delete;
+
+  /**
+   * Kill the child if it's still running.
+   */
+  ~background_task() noexcept;
+
+  /**
+   * @return readable once the child is done
+   */
+  [[nodiscard]] int fd() const noexcept { return fd_.value(); }
+
+  [[nodiscard]] pid_t pid() const noexcept { return pid_; }
+
+  /**
+   * @return how long the fork stopped the parent for
+   */
+  [[nodiscard]] std::chrono::microseconds fork_time() const noexcept {
+    return fork_time_;
+  }
+
+  /**
+   * Reap the child, waiting for it to exit if it hasn't yet.
+   * @return whether the task succeeded, which it didn't if the child died
+   * without saying
+   */
+  bool wait();
+
+private:
+  background_task(const std::function<bool()> &task,
+                  std::array<int, 2> pipe);
+
+  // the read end of the pipe
+  io::file_descriptor fd_;
+  pid_t pid_{};
+  std::chrono::microseconds fork_time_{};
+  bool reaped_{};
+};
+
+} // namespace redis
+
+#endif // REDIS_SERVER_BACKGROUND_TASK_HPP
@@ -0,0 +1,131 @@
+#include "bitmap.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace {
+
+namespace ns = redis::bitmap;
+
+unsigned char byte(std::string_view bits, std::uint64_t i) noexcept {
+  return static_cast<unsigned char>(bits[i]);
+}
+
+// the mask of bit offset within its byte
+unsigned char mask(std::uint64_t offset) noexcept {
+  return static_cast<unsigned char>(0x80u >> (offset % 8));
+}
+
+void reach(redis::compact_string &bits, std::uint64_t offset) {
+  if (offset / 8 >= bits.size())
+    bits.resize(offset / 8 + 1);
+}
+
+} // namespace
+
+bool ns::get(std::string_view bits, std::uint64_t offset) noexcept {
+  return offset / 8 < bits.size() && (byte(bits, offset / 8) & mask(offset));
+}
+
+bool ns::set(compact_string &bits, std::uint64_t offset, bool value) {
+  reach(bits, offset);
+  auto &b = bits.data()[offset / 8];
+  const bool result = static_cast<unsigned char>(b) & mask(offset);
+  if (value)
+    b = static_cast<char>(b | mask(offset));
+  else
+    b = static_cast<char>(b & ~mask(offset));
+  return result;
+}
+
+std::uint64_t ns::count(std::string_view bits, std::uint64_t begin,
+                        std::uint64_t end) noexcept {
+  end = std::min<std::uint64_t>(end, bits.size() * 8);
+  if (begin >= end)
+    return 0;
+
+  // the partial bytes at either end are masked, and the whole ones between
+  // counted by the SIMD kernel
+  const auto first = begin / 8;
+  const auto last = (end - 1) / 8;
+  const unsigned head = 0xffu >> (begin % 8);
+  const unsigned tail = (0xff00u >> ((end - 1) % 8 + 1)) & 0xffu;
+  if (first == last)
+    return unsigned(std::popcount(byte(bits, first) & head & tail));
+  return unsigned(std::popcount(byte(bits, first) & head)) +
+         simd::popcount(bits.data() + first + 1, bits.data() + last) +
+         unsigned(std::popcount(byte(bits, last) & tail));
+}
+
+std::optional<std::uint64_t> ns::find(std::string_view bits, bool value,
+                                      std::uint64_t begin,
+                                      std::uint64_t end) noexcept {
+  end = std::min<std::uint64_t>(end, bits.size() * 8);
+  auto i = begin;
+  for (; i < end && i % 8; ++i) {
+    if (get(bits, i) == value)
+      return i;
+  }
+  if (i >= end)
+    return {};
+
+  // whole bytes of the bit that isn't wanted are skipped by the SIMD kernel
+  const char *const pos = simd::find_not(
+      bits.data() + i / 8, bits.data() + end / 8, value ? '\0' : '\xff');
+  for (i = std::uint64_t(pos - bits.data()) * 8; i < end; ++i) {
+    if (get(bits, i) == value)
+      return i;
+  }
+  return {};
+}
+
+std::uint64_t ns::get_field(std::string_view bits, std::uint64_t offset,
+                            unsigned width) noexcept {
+  std::uint64_t result = 0;
+  for (unsigned i = 0; i < width; ++i)
+    result = result << 1 | get(bits, offset + i);
+  return result;
+}
+
+void ns::set_field(compact_string &bits, std::uint64_t offset, unsigned width,
+                   std::uint64_t value) {
+  reach(bits, offset + width - 1);
+  for (unsigned i = 0; i < width; ++i)
+    set(bits, offset + i, (value >> (width - 1 - i)) & 1);
+}
+
+redis::compact_string ns::apply(operation op,
+                                std::span<const std::string_view> sources) {
+  std::size_t size = 0;
+  for (const auto source : sources)
+    size = std::max(size, source.size());
+  compact_string result;
+  result.resize(size);
+  if (sources.empty())
+    return result;
+
+  char *const out = result.data();
+  std::memcpy(out, sources[0].data(), sources[0].size());
+  if (op == operation::not_) {
+    std::transform(out, out + size, out, [](char c) { return char(~c); });
+    return result;
+  }
+
+  for (const auto source : sources.subspan(1)) {
+    switch (op) {
+    case operation::and_:
+      simd::bitwise_and(out, source.data(), source.size());
+      std::memset(out + source.size(), 0, size - source.size());
+      break;
+    case operation::or_:
+      simd::bitwise_or(out, source.data(), source.size());
+      break;
+    default:
+      simd::bitwise_xor(out, source.data(), source.size());
+      break;
+    }
+  }
+  return result;
+}
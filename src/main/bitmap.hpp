@@ -0,0 +1,87 @@
+#ifndef REDIS_SERVER_BITMAP_HPP
+#define REDIS_SERVER_BITMAP_HPP
+
+#include "compact_string.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+
+/**
+ * Strings as arrays of bits, as the bit commands see them: bit 0 is the most
+ * significant bit of the first byte, and bits past the end read as zero.
+ */
+namespace redis::bitmap {
+
+// the largest bit offset, as a bitmap is at most 512MB, as in Redis
+inline constexpr std::uint64_t max_offset = (std::uint64_t(1) << 32) - 1;
+
+enum class operation { and_, or_, xor_, not_ };
+
+[[nodiscard]] bool get(std::string_view bits, std::uint64_t offset) noexcept;
+
+/**
+ * Set or clear a bit, lengthening bits with zeros to reach it.
+ * @param bits
+ * @param offset
+ * @param value
+ * @return the bit's old value
+ */
+bool set(compact_string &bits, std::uint64_t offset, bool value);
+
+/**
+ * @param bits
+ * @param begin
+ * @param end
+ * @return how many of the bits from begin up to but not including end are set
+ */
+[[nodiscard]] std::uint64_t count(std::string_view bits, std::uint64_t begin,
+                                  std::uint64_t end) noexcept;
+
+/**
+ * @param bits
+ * @param value
+ * @param begin
+ * @param end
+ * @return the offset of the first bit from begin up to but not including end,
+ * and before the end of bits, that's value
+ */
+[[nodiscard]] std::optional<std::uint64_t>
+find(std::string_view bits, bool value, std::uint64_t begin,
+     std::uint64_t end) noexcept;
+
+/**
+ * @param bits
+ * @param offset
+ * @param width from 1 to 64
+ * @return the width bits from offset, as an unsigned integer, most
+ * significant first
+ */
+[[nodiscard]] std::uint64_t get_field(std::string_view bits,
+                                      std::uint64_t offset,
+                                      unsigned width) noexcept;
+
+/**
+ * Overwrite the width bits from offset with the low width bits of value,
+ * lengthening bits with zeros to reach them.
+ * @param bits
+ * @param offset
+ * @param width from 1 to 64
+ * @param value
+ */
+void set_field(compact_string &bits, std::uint64_t offset, unsigned width,
+               std::uint64_t value);
+
+/**
+ * Combine sources a byte at a time, as BITOP does, reading shorter ones as
+ * if padded with zeros.
+ * @param op
+ * @param sources just one for not_
+ * @return as long as the longest of sources
+ */
+compact_string apply(operation op, std::span<const std::string_view> sources);
+
+} // namespace redis::bitmap
+
+#endif // REDIS_SERVER_BITMAP_HPP
@@ -1,25 +1,17 @@
 #include "command_handler.hpp"
-#include "commands.hpp"
+#include "command_table.hpp"
+
+#include <algorithm>
 
 namespace {
 [[noreturn]] void unimplemented() { throw std::runtime_error("unimplemented"); }
 } // namespace
 
-redis::command_handler::command_handler(database &dict, resp::handler &handler)
-    : dict_(dict), output_(handler) {
-  cmds_["PING"] = redis_cmd_ping;
-  cmds_["ECHO"] = redis_cmd_echo;
-  cmds_["SET"] = redis_cmd_set;
-  cmds_["GET"] = redis_cmd_get;
-  cmds_["EXISTS"] = redis_cmd_exists;
-  cmds_["DEL"] = redis_cmd_del;
-  cmds_["INCR"] = redis_cmd_incr;
-  cmds_["DECR"] = redis_cmd_decr;
-  cmds_["RPUSH"] = redis_cmd_rpush;
-  cmds_["LPUSH"] = redis_cmd_lpush;
-  cmds_["LRANGE"] = redis_cmd_lrange;
-  cmds_["SAVE"] = redis_cmd_save;
-}
+redis::command_handler::command_handler(database &dict, resp::handler &handler,
+                                        router *router, mode mode,
+                                        journal *journal)
+    : dict_(dict), current_(), output_(handler), router_(router),
+      mode_(mode), journal_(journal) {}
 
 void redis::command_handler::begin_simple_string() { unimplemented(); }
 
@@ -34,35 +26,101 @@ void redis::command_handler::begin_integer() { unimplemented(); }
 void redis::command_handler::end_integer() { unimplemented(); }
 
 void redis::command_handler::begin_array(std::int64_t len) {
-  buf_.clear();
-  args_.clear();
-  ends_.clear();
-  args_.reserve(len);
-  ends_.reserve(len);
+  // drop anything left of a command that wasn't an array of bulk strings
+  parts_.resize(current_);
+  parts_.reserve(current_ + len);
 }
 
 void redis::command_handler::end_array() {
-  std::accumulate(ends_.begin(), ends_.end(), std::size_t(0),
-                  [this](auto begin, auto end) {
-                    args_.emplace_back(&buf_[begin], &buf_[end]);
-                    return end;
-                  });
-  if (auto pos = cmds_.find(args_[0]); pos != cmds_.end()) {
-    pos->second(args_, dict_, output_);
-  } else {
-    std::string_view msg = "ERR unknown command";
-    output_.begin_error();
-    output_.chars(msg.begin(), msg.end());
-    output_.end_error();
+  if (parts_.size() == current_)
+    return;
+  batch_.push_back({current_, parts_.size() - current_});
+  current_ = parts_.size();
+  if (mode_ == mode::immediate)
+    execute();
+}
+
+void redis::command_handler::execute() {
+  if (batch_.size() > 1) {
+    // the lookups don't depend on each other, so their cache misses overlap
+    for (const auto &cmd : batch_) {
+      views(cmd, args_);
+      if (const auto *info = commands::find(args_[0]);
+          info && info->accepts(args_.size())) {
+        info->for_each_key(args_,
+                           [this](std::string_view key) { dict_.prefetch(key); });
+      }
+    }
   }
+
+  for (const auto &cmd : batch_) {
+    views(cmd, args_);
+    if (!router_ || !router_->route(args_))
+      dispatch(args_);
+  }
+  batch_.clear();
+
+  // all that's left is the command being parsed, if there is one
+  parts_.erase(parts_.begin(), parts_.begin() + std::ptrdiff_t(current_));
+  current_ = 0;
+  const auto owned = std::find_if(parts_.begin(), parts_.end(),
+                                  [](const auto &part) { return part.owned; });
+  const auto offset = owned == parts_.end() ? buf_.size() : owned->offset;
+  buf_.erase(0, offset);
+  for (auto &part : parts_)
+    part.offset -= part.owned ? offset : 0;
 }
 
-void redis::command_handler::begin_bulk_string(std::int64_t len) {
-  buf_.reserve(buf_.size() + len);
+void redis::command_handler::views(const command &cmd,
+                                   std::vector<std::string_view> &args) const {
+  args.clear();
+  for (std::size_t i = cmd.first; i < cmd.first + cmd.size; ++i)
+    args.push_back(view(parts_[i]));
 }
 
-void redis::command_handler::end_bulk_string() { ends_.push_back(buf_.size()); }
+void redis::command_handler::dispatch(
+    const std::vector<std::string_view> &args) {
+  if (const auto *cmd = commands::find(args[0]); !cmd)
+    output_.error("ERR unknown command");
+  else if (!cmd->accepts(args.size()))
+    output_.error("ERR wrong number of arguments");
+  else if (!cmd->cmd)
+    output_.error("ERR command is only allowed on a client connection");
+  else if (cmd->flags & commands::denyoom && !dict_.evict())
+    output_.error("OOM command not allowed when used memory > 'maxmemory'.");
+  else if (journal_ && cmd->flags & commands::write)
+    cmd->cmd(journal_->record(args, dict_), dict_, output_);
+  else
+    cmd->cmd(args, dict_, output_);
+}
+
+void redis::command_handler::detach() {
+  for (auto &part : parts_) {
+    if (part.owned)
+      continue;
+    part.offset = buf_.size();
+    part.owned = true;
+    buf_.append(part.data, part.size);
+  }
+}
+
+void redis::command_handler::begin_bulk_string(std::int64_t) {
+  parts_.push_back({});
+}
+
+void redis::command_handler::end_bulk_string() {}
 
 void redis::command_handler::chars(const char *begin, const char *end) {
-  buf_.append(begin, end);
+  auto &part = parts_.back();
+  const std::size_t len = end - begin;
+  if (part.owned) {
+    buf_.append(begin, end);
+  } else if (!part.size) {
+    part.data = begin;
+  } else if (part.data + part.size != begin) {
+    // not contiguous with what came before, so has to be copied after all
+    detach();
+    buf_.append(begin, end);
+  }
+  part.size += len;
 }
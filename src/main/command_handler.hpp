@@ -5,28 +5,85 @@
 #include "resp.hpp"
 #include "util.hpp"
 
-#include <ankerl/unordered_dense.h>
-
 #include <charconv>
 #include <chrono>
-#include <numeric>
 #include <span>
 #include <string_view>
 #include <vector>
 
 namespace redis {
 
-class command_handler : public redis::resp::handler {
+/**
+ * Gets first refusal on every command parsed by a command_handler, e.g. to have
+ * it executed somewhere else.
+ */
+class router {
+public:
+  // true if the command has been dealt with and mustn't be dispatched locally
+  virtual bool route(const std::vector<std::string_view> &args) = 0;
+
+  virtual ~router() = default;
+};
+
+/**
+ * Is handed every write command a command_handler runs, just before it runs,
+ * e.g. to log it.
+ */
+class journal {
+public:
+  /**
+   * @param args
+   * @param db what it's about to be run against
+   * @return the arguments to run it with, which may be args, or what args
+   * does now but spelled so that it does the same when run again later
+   */
+  virtual const std::vector<std::string_view> &
+  record(const std::vector<std::string_view> &args, database &db) = 0;
+
+  virtual ~journal() = default;
+};
+
+/**
+ * Executes the commands it's handed by a parser. Arguments are passed to
+ * commands as views of the parser's input wherever they were contiguous in it,
+ * and are only copied if detach() is called while a command is incomplete.
+ *
+ * In batched mode commands aren't run as they're parsed, but by execute(), so
+ * that the keys of a whole pipeline can be looked up before any of it runs.
+ * Each key is then hashed and looked up twice, so it's only a win where the
+ * overlapped misses outweigh that.
+ */
+class command_handler final : public redis::resp::handler {
 public:
   using command_t = void (*)(const std::vector<std::string_view> &,
                              redis::database &, redis::resp::handler &);
 
-  explicit command_handler(database &dict, resp::handler &handler);
+  enum class mode { immediate, batched };
+
+  explicit command_handler(database &dict, resp::handler &handler,
+                           router *router = nullptr,
+                           mode mode = mode::immediate,
+                           journal *journal = nullptr);
 
   command_handler(const command_handler &) = delete;
   command_handler &operator=(const command_handler &) = delete;
 
-private:
+  void dispatch(const std::vector<std::string_view> &args);
+
+  /**
+   * Run the commands parsed since the last call, in order, having first
+   * prefetched their keys. Must be called before the parser's input is
+   * overwritten, i.e. before detach().
+   */
+  void execute();
+
+  /**
+   * Copy whatever has been parsed of an incomplete command out of the parser's
+   * input, which may then be overwritten. To be called after each parse() that
+   * might have ended part way through a command.
+   */
+  void detach();
+
   void begin_simple_string() override;
   void end_simple_string() override;
   void begin_error() override;
@@ -39,14 +96,39 @@ private:
   void end_bulk_string() override;
   void chars(const char *begin, const char *end) override;
 
+private:
+  // an argument at data in the parser's input, or once detached, at offset in
+  // buf_
+  struct arg {
+    const char *data;
+    std::size_t offset;
+    std::size_t size;
+    bool owned;
+  };
+
+  // the parts_ of a complete command
+  struct command {
+    std::size_t first;
+    std::size_t size;
+  };
+
+  [[nodiscard]] std::string_view view(const arg &part) const {
+    return {part.owned ? buf_.data() + part.offset : part.data, part.size};
+  }
+
+  void views(const command &cmd, std::vector<std::string_view> &args) const;
+
   database &dict_;
   std::string buf_;
-  std::vector<std::size_t> ends_;
+  std::vector<arg> parts_;
+  // where in parts_ the command being parsed starts
+  std::size_t current_;
+  std::vector<command> batch_;
   std::vector<std::string_view> args_;
-  ankerl::unordered_dense::map<std::string_view, command_t,
-                               redis::util::ci_hash, redis::util::ci_equal>
-      cmds_;
   resp::handler &output_;
+  router *const router_;
+  const mode mode_;
+  journal *const journal_;
 };
 
 } // namespace redis
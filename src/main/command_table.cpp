@@ -0,0 +1,248 @@
+#include "command_table.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <stdexcept>
+
+namespace {
+
+namespace ns = redis::commands;
+using ns::command_info;
+
+// the keys of XREAD, which are the first half of the arguments after STREAMS
+std::pair<int, int> xread_keys(const ns::args_t &args) {
+  for (std::size_t i = 1; i < args.size(); ++i) {
+    const auto streams = args.size() - i - 1;
+    if (redis::util::ci_equal()(args[i], "STREAMS"))
+      return streams && !(streams % 2)
+                 ? std::pair(int(i + 1), int(i + streams / 2))
+                 : std::pair(0, 0);
+  }
+  return {0, 0};
+}
+
+constexpr std::array command_list{
+    // name, cmd, arity, first key, last key, key step, flags
+    command_info{"PING", redis_cmd_ping, -1, 0, 0, 0, 0},
+    command_info{"ECHO", redis_cmd_echo, 2, 0, 0, 0, 0},
+    command_info{"SET", redis_cmd_set, -3, 1, 1, 1, ns::write | ns::denyoom},
+    command_info{"GET", redis_cmd_get, 2, 1, 1, 1, ns::readonly},
+    command_info{"MGET", redis_cmd_mget, -2, 1, -1, 1, ns::readonly},
+    command_info{"MSET", redis_cmd_mset, -3, 1, -1, 2, ns::write | ns::denyoom},
+    command_info{"MSETNX", redis_cmd_msetnx, -3, 1, -1, 2,
+                 ns::write | ns::denyoom},
+    command_info{"EXISTS", redis_cmd_exists, -2, 1, -1, 1, ns::readonly},
+    command_info{"DEL", redis_cmd_del, -2, 1, -1, 1, ns::write},
+    command_info{"EXPIRE", redis_cmd_expire, 3, 1, 1, 1, ns::write},
+    command_info{"PEXPIRE", redis_cmd_pexpire, 3, 1, 1, 1, ns::write},
+    command_info{"EXPIREAT", redis_cmd_expireat, 3, 1, 1, 1, ns::write},
+    command_info{"PEXPIREAT", redis_cmd_pexpireat, 3, 1, 1, 1, ns::write},
+    command_info{"TTL", redis_cmd_ttl, 2, 1, 1, 1, ns::readonly},
+    command_info{"PTTL", redis_cmd_pttl, 2, 1, 1, 1, ns::readonly},
+    command_info{"PERSIST", redis_cmd_persist, 2, 1, 1, 1, ns::write},
+    command_info{"INCR", redis_cmd_incr, 2, 1, 1, 1, ns::write | ns::denyoom},
+    command_info{"DECR", redis_cmd_decr, 2, 1, 1, 1, ns::write | ns::denyoom},
+    command_info{"INCRBY", redis_cmd_incrby, 3, 1, 1, 1,
+                 ns::write | ns::denyoom},
+    command_info{"DECRBY", redis_cmd_decrby, 3, 1, 1, 1,
+                 ns::write | ns::denyoom},
+    command_info{"INCRBYFLOAT", redis_cmd_incrbyfloat, 3, 1, 1, 1,
+                 ns::write | ns::denyoom},
+    command_info{"RPUSH", redis_cmd_rpush, -3, 1, 1, 1,
+                 ns::write | ns::denyoom},
+    command_info{"LPUSH", redis_cmd_lpush, -3, 1, 1, 1,
+                 ns::write | ns::denyoom},
+    command_info{"LRANGE", redis_cmd_lrange, 4, 1, 1, 1, ns::readonly},
+    command_info{"HSET", redis_cmd_hset, -4, 1, 1, 1, ns::write | ns::denyoom},
+    command_info{"HGET", redis_cmd_hget, 3, 1, 1, 1, ns::readonly},
+    command_info{"HMGET", redis_cmd_hmget, -3, 1, 1, 1, ns::readonly},
+    command_info{"HDEL", redis_cmd_hdel, -3, 1, 1, 1, ns::write},
+    command_info{"HLEN", redis_cmd_hlen, 2, 1, 1, 1, ns::readonly},
+    command_info{"HGETALL", redis_cmd_hgetall, 2, 1, 1, 1, ns::readonly},
+    command_info{"HINCRBY", redis_cmd_hincrby, 4, 1, 1, 1,
+                 ns::write | ns::denyoom},
+    command_info{"HSCAN", redis_cmd_hscan, -3, 1, 1, 1, ns::readonly},
+    command_info{"SADD", redis_cmd_sadd, -3, 1, 1, 1, ns::write | ns::denyoom},
+    command_info{"SREM", redis_cmd_srem, -3, 1, 1, 1, ns::write},
+    command_info{"SISMEMBER", redis_cmd_sismember, 3, 1, 1, 1, ns::readonly},
+    command_info{"SMEMBERS", redis_cmd_smembers, 2, 1, 1, 1, ns::readonly},
+    command_info{"SCARD", redis_cmd_scard, 2, 1, 1, 1, ns::readonly},
+    command_info{"SINTER", redis_cmd_sinter, -2, 1, -1, 1, ns::readonly},
+    command_info{"SUNION", redis_cmd_sunion, -2, 1, -1, 1, ns::readonly},
+    command_info{"SDIFF", redis_cmd_sdiff, -2, 1, -1, 1, ns::readonly},
+    command_info{"SINTERSTORE", redis_cmd_sinterstore, -3, 1, -1, 1,
+                 ns::write | ns::denyoom},
+    command_info{"SUNIONSTORE", redis_cmd_sunionstore, -3, 1, -1, 1,
+                 ns::write | ns::denyoom},
+    command_info{"SDIFFSTORE", redis_cmd_sdiffstore, -3, 1, -1, 1,
+                 ns::write | ns::denyoom},
+    command_info{"ZADD", redis_cmd_zadd, -4, 1, 1, 1, ns::write | ns::denyoom},
+    command_info{"ZREM", redis_cmd_zrem, -3, 1, 1, 1, ns::write},
+    command_info{"ZSCORE", redis_cmd_zscore, 3, 1, 1, 1, ns::readonly},
+    command_info{"ZRANK", redis_cmd_zrank, 3, 1, 1, 1, ns::readonly},
+    command_info{"ZCARD", redis_cmd_zcard, 2, 1, 1, 1, ns::readonly},
+    command_info{"ZINCRBY", redis_cmd_zincrby, 4, 1, 1, 1,
+                 ns::write | ns::denyoom},
+    command_info{"ZCOUNT", redis_cmd_zcount, 4, 1, 1, 1, ns::readonly},
+    command_info{"ZRANGE", redis_cmd_zrange, -4, 1, 1, 1, ns::readonly},
+    command_info{"ZRANGEBYSCORE", redis_cmd_zrangebyscore, -4, 1, 1, 1,
+                 ns::readonly},
+    command_info{"SETBIT", redis_cmd_setbit, 4, 1, 1, 1,
+                 ns::write | ns::denyoom},
+    command_info{"GETBIT", redis_cmd_getbit, 3, 1, 1, 1, ns::readonly},
+    command_info{"BITCOUNT", redis_cmd_bitcount, -2, 1, 1, 1, ns::readonly},
+    command_info{"BITPOS", redis_cmd_bitpos, -3, 1, 1, 1, ns::readonly},
+    command_info{"BITOP", redis_cmd_bitop, -4, 2, -1, 1,
+                 ns::write | ns::denyoom},
+    command_info{"BITFIELD", redis_cmd_bitfield, -2, 1, 1, 1,
+                 ns::write | ns::denyoom},
+    command_info{"PFADD", redis_cmd_pfadd, -2, 1, 1, 1,
+                 ns::write | ns::denyoom},
+    command_info{"PFCOUNT", redis_cmd_pfcount, -2, 1, -1, 1, ns::readonly},
+    command_info{"PFMERGE", redis_cmd_pfmerge, -2, 1, -1, 1,
+                 ns::write | ns::denyoom},
+    command_info{"XADD", redis_cmd_xadd, -5, 1, 1, 1, ns::write | ns::denyoom},
+    command_info{"XLEN", redis_cmd_xlen, 2, 1, 1, 1, ns::readonly},
+    command_info{"XRANGE", redis_cmd_xrange, -4, 1, 1, 1, ns::readonly},
+    command_info{"XREVRANGE", redis_cmd_xrevrange, -4, 1, 1, 1, ns::readonly},
+    command_info{"XREAD", redis_cmd_xread, -4, 0, 0, 1, ns::readonly,
+                 xread_keys},
+    command_info{"SUBSCRIBE", nullptr, -2, 0, 0, 0, ns::pubsub},
+    command_info{"UNSUBSCRIBE", nullptr, -1, 0, 0, 0, ns::pubsub},
+    command_info{"PSUBSCRIBE", nullptr, -2, 0, 0, 0, ns::pubsub},
+    command_info{"PUNSUBSCRIBE", nullptr, -1, 0, 0, 0, ns::pubsub},
+    command_info{"PUBLISH", nullptr, 3, 0, 0, 0, ns::pubsub},
+    command_info{"SAVE", redis_cmd_save, 1, 0, 0, 0, ns::all_shards},
+    command_info{"BGSAVE", nullptr, 1, 0, 0, 0, ns::server},
+    command_info{"LASTSAVE", nullptr, 1, 0, 0, 0, ns::server},
+    command_info{"INFO", nullptr, -1, 0, 0, 0, ns::server},
+};
+
+constexpr std::size_t max_name_length = 24;
+
+// a name's bytes as words, upper cased by clearing bit 5 of each byte. That's
+// only right for letters, but for a table name of letters it means exactly its
+// upper and lower case bytes get folded to it.
+using folded_name = std::array<std::uint64_t, max_name_length / 8>;
+
+constexpr folded_name fold(std::string_view name) {
+  std::array<char, max_name_length> bytes{};
+  std::copy(name.begin(), name.end(), bytes.begin());
+  auto result = std::bit_cast<folded_name>(bytes);
+  for (auto &word : result)
+    word &= 0xdfdfdfdfdfdfdfdf;
+  return result;
+}
+
+constexpr bool valid_name(std::string_view name) {
+  return !name.empty() && name.size() <= max_name_length &&
+         std::all_of(name.begin(), name.end(),
+                     [](char c) { return c >= 'A' && c <= 'Z'; });
+}
+
+static_assert(std::all_of(command_list.begin(), command_list.end(),
+                          [](const auto &cmd) { return valid_name(cmd.name); }));
+
+constexpr std::uint64_t hash(const folded_name &name) {
+  std::uint64_t result{};
+  for (const auto word : name)
+    result = (result ^ word) * 0x9fb21c651e98df25;
+  return result;
+}
+
+constexpr std::uint64_t mix(std::uint64_t h, std::uint64_t seed) {
+  h ^= seed * 0x9e3779b97f4a7c15;
+  h ^= h >> 31;
+  h *= 0xbf58476d1ce4e5b9;
+  return h ^ (h >> 29);
+}
+
+/**
+ * A minimal perfect hash of the command names ("hash and displace"): a name's
+ * hash picks a bucket, whose seed then picks the name's slot.
+ */
+struct perfect_hash {
+  static constexpr std::size_t buckets = std::bit_ceil(command_list.size());
+  static constexpr std::size_t slots = 2 * buckets;
+  static constexpr std::uint8_t empty = 0xff;
+  static_assert(command_list.size() < empty);
+
+  std::array<std::uint32_t, buckets> seeds{};
+  std::array<std::uint8_t, slots> index{};
+  std::array<folded_name, command_list.size()> names{};
+
+  [[nodiscard]] constexpr std::size_t slot(std::uint64_t h) const {
+    return mix(h, seeds[h % buckets]) % slots;
+  }
+};
+
+constexpr perfect_hash build() {
+  perfect_hash result;
+  result.index.fill(perfect_hash::empty);
+
+  std::array<std::uint64_t, command_list.size()> hashes{};
+  std::array<std::size_t, perfect_hash::buckets> sizes{};
+  for (std::size_t i = 0; i < command_list.size(); ++i) {
+    result.names[i] = fold(command_list[i].name);
+    hashes[i] = hash(result.names[i]);
+    ++sizes[hashes[i] % perfect_hash::buckets];
+  }
+
+  // the most crowded buckets go first, while there are most free slots
+  std::array<std::size_t, perfect_hash::buckets> order{};
+  for (std::size_t b = 0; b < order.size(); ++b)
+    order[b] = b;
+  std::sort(order.begin(), order.end(),
+            [&](auto lhs, auto rhs) { return sizes[lhs] > sizes[rhs]; });
+
+  for (const auto bucket : order) {
+    if (!sizes[bucket])
+      break;
+
+    for (std::uint32_t seed = 1;; ++seed) {
+      if (seed == 1 << 20)
+        throw std::logic_error("no perfect hash for the command table");
+
+      result.seeds[bucket] = seed;
+      bool placed = true;
+      std::size_t i = 0;
+      for (; placed && i < command_list.size(); ++i) {
+        if (hashes[i] % perfect_hash::buckets != bucket)
+          continue;
+        auto &index = result.index[result.slot(hashes[i])];
+        placed = index == perfect_hash::empty;
+        if (placed)
+          index = std::uint8_t(i);
+      }
+      if (placed)
+        break;
+
+      // undo this attempt
+      for (std::size_t j = 0; j + 1 < i; ++j) {
+        if (hashes[j] % perfect_hash::buckets == bucket)
+          result.index[result.slot(hashes[j])] = perfect_hash::empty;
+      }
+    }
+  }
+
+  return result;
+}
+
+constexpr auto table = build();
+
+} // namespace
+
+const command_info *ns::find(std::string_view name) noexcept {
+  if (name.empty() || name.size() > max_name_length)
+    return nullptr;
+  const auto folded = fold(name);
+  const auto i = table.index[table.slot(::hash(folded))];
+  if (i == perfect_hash::empty || table.names[i] != folded ||
+      command_list[i].name.size() != name.size())
+    return nullptr;
+  return &command_list[i];
+}
+
+std::span<const command_info> ns::all() noexcept { return command_list; }
@@ -0,0 +1,88 @@
+#ifndef REDIS_SERVER_COMMAND_TABLE_HPP
+#define REDIS_SERVER_COMMAND_TABLE_HPP
+
+#include "commands.hpp"
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <utility>
+
+namespace redis::commands {
+
+enum flags : std::uint8_t {
+  // only reads the keyspace
+  readonly = 1 << 0,
+  // may modify the keyspace
+  write = 1 << 1,
+  // applies to the whole server, so every shard has to run it
+  all_shards = 1 << 2,
+  // may use more memory, so is refused when over the limit
+  denyoom = 1 << 3,
+  // is about the connection's subscriptions, so is run by the connection
+  // itself, which is why it has no cmd
+  pubsub = 1 << 4,
+  // is about the server as a whole rather than its keyspace, so is run by
+  // the connection's event loop, which is why it has no cmd either
+  server = 1 << 5,
+};
+
+/**
+ * What the server knows about a command besides its implementation, along the
+ * lines of Redis' COMMAND INFO.
+ */
+struct command_info {
+  std::string_view name;
+  cmd_t cmd;
+  // the number of arguments including the name, or at least -arity if negative
+  int arity;
+  // the index of the first key argument, or 0 if it takes no keys
+  int first_key;
+  // the index of the last key argument, counting from the end if negative
+  int last_key;
+  int key_step;
+  std::uint8_t flags;
+  // finds the first and last key arguments in place of first_key and
+  // last_key, for a command whose keys follow a keyword, as Redis'
+  // getkeys_proc does
+  std::pair<int, int> (*find_keys)(const args_t &) = nullptr;
+
+  [[nodiscard]] constexpr bool accepts(std::size_t argc) const {
+    return arity < 0 ? argc >= std::size_t(-arity) : argc == std::size_t(arity);
+  }
+
+  /**
+   * Call visitor with each key in args, which must be of an acceptable length.
+   * @tparam Visitor
+   * @param args
+   * @param visitor
+   */
+  template <typename Visitor>
+  void for_each_key(const args_t &args, Visitor visitor) const {
+    auto [first, last] =
+        find_keys ? find_keys(args) : std::pair(first_key, last_key);
+    if (!first)
+      return;
+    if (last < 0)
+      last += int(args.size());
+    for (auto i = first; i <= last; i += key_step)
+      visitor(args[i]);
+  }
+};
+
+/**
+ * Look up a command by its case-insensitive name in a perfect hash table that
+ * is built at compile time.
+ * @param name
+ * @return nullptr if there is no such command
+ */
+const command_info *find(std::string_view name) noexcept;
+
+/**
+ * @return every command in the table
+ */
+std::span<const command_info> all() noexcept;
+
+} // namespace redis::commands
+
+#endif // REDIS_SERVER_COMMAND_TABLE_HPP
@@ -1,15 +1,18 @@
 #include "commands.hpp"
+#include "bitmap.hpp"
 #include "command_handler.hpp"
+#include "hyperloglog.hpp"
 #include "io.hpp"
+#include "snapshot.hpp"
 #include "util.hpp"
 
-#include <fstream>
+#include <cmath>
+#include <iterator>
 #include <span>
 
 namespace {
 
 using redis::wrong_type;
-using redis::util::overloaded;
 
 class not_an_int : std::runtime_error {
 public:
@@ -17,27 +20,18 @@ public:
 };
 
 void error(redis::resp::handler &output, std::string_view msg) {
-  output.begin_error();
-  output.chars(msg.begin(), msg.end());
-  output.end_error();
+  output.error(msg);
 };
 
 void simple_string(redis::resp::handler &output, std::string_view value) {
-  output.begin_simple_string();
-  output.chars(value.data(), value.data() + value.size());
-  output.end_simple_string();
+  output.simple_string(value);
 }
 
 void bulk_string(redis::resp::handler &output, std::string_view value) {
-  output.begin_bulk_string(std::int64_t(value.size()));
-  output.chars(value.data(), value.data() + value.size());
-  output.end_bulk_string();
+  output.bulk_string(value);
 }
 
-void nil_string(redis::resp::handler &output) {
-  output.begin_bulk_string(-1);
-  output.end_bulk_string();
-}
+void nil_string(redis::resp::handler &output) { output.null_bulk_string(); }
 
 template <typename Integer> auto to_chars(Integer i) {
   std::tuple<std::array<char, std::numeric_limits<Integer>::digits10 + 2>,
@@ -53,10 +47,7 @@ template <typename Integer> auto to_chars(Integer i) {
 
 template <typename Integer>
 void integer(redis::resp::handler &output, Integer i) {
-  auto [buf, len] = to_chars(i);
-  output.begin_integer();
-  output.chars(buf.begin(), buf.begin() + len);
-  output.end_integer();
+  output.integer(std::int64_t(i));
 }
 
 std::int64_t parse_int(std::string_view s) {
@@ -139,9 +130,8 @@ void redis_cmd_get(const redis::commands::args_t &args, redis::database &db,
       auto now =
           std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
 
-      if (const auto opt_value = db.get_string(args[1], now)) {
-        auto value = opt_value->get();
-        return bulk_string(output, value);
+      if (const auto value = db.get_string(args[1], now)) {
+        return bulk_string(output, *value);
       } else {
         return nil_string(output);
       }
@@ -153,6 +143,43 @@ void redis_cmd_get(const redis::commands::args_t &args, redis::database &db,
   }
 }
 
+void redis_cmd_mget(const redis::commands::args_t &args, redis::database &db,
+                    redis::resp::handler &output) {
+  if (args.size() < 2)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  output.begin_array(std::int64_t(args.size() - 1));
+  db.get_strings(std::span(args).subspan(1), now,
+                 [&](const redis::string_value *value) {
+                   if (value)
+                     bulk_string(output, *value);
+                   else
+                     nil_string(output);
+                 });
+  output.end_array();
+}
+
+void redis_cmd_mset(const redis::commands::args_t &args, redis::database &db,
+                    redis::resp::handler &output) {
+  if (args.size() < 3 || args.size() % 2 == 0)
+    return error(output, "ERR wrong number of arguments");
+
+  db.set_strings(std::span(args).subspan(1));
+  simple_string(output, "OK");
+}
+
+void redis_cmd_msetnx(const redis::commands::args_t &args, redis::database &db,
+                      redis::resp::handler &output) {
+  if (args.size() < 3 || args.size() % 2 == 0)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  integer(output, db.set_strings_nx(std::span(args).subspan(1), now));
+}
+
 void redis_cmd_del(const redis::commands::args_t &args, redis::database &db,
                    redis::resp::handler &output) {
   const auto now =
@@ -182,7 +209,7 @@ void redis_cmd_exists(const redis::commands::args_t &args, redis::database &db,
   std::int64_t count{};
 
   for (auto &key : std::span(args.begin() + 1, args.end())) {
-    if (db.get_string(key, now))
+    if (db.exists(key, now))
       ++count;
   }
 
@@ -190,56 +217,215 @@ void redis_cmd_exists(const redis::commands::args_t &args, redis::database &db,
 }
 
 namespace {
-void incr_or_decr(const redis::commands::args_t &args, redis::database &db,
-                  redis::resp::handler &output, void (*f)(std::int64_t &)) {
+void expire(const redis::commands::args_t &args, redis::database &db,
+            redis::resp::handler &output,
+            redis::database::time_point (*to_expiry)(redis::database::now_t,
+                                                     std::int64_t)) {
+  if (args.size() != 3)
+    return error(output, "ERR wrong number of arguments");
+
+  std::int64_t n;
+  try {
+    n = parse_int(args[2]);
+  } catch (const not_an_int &) {
+    return error(output, "ERR value is not an integer or out of range");
+  }
+  // beyond which a deadline in milliseconds could overflow
+  if (n > (std::int64_t(1) << 46) || n < -(std::int64_t(1) << 46))
+    return error(output, "ERR invalid expire time");
+
+  const auto now = db.now();
+  integer(output,
+          db.expire(args[1], to_expiry(now, n),
+                    std::chrono::time_point_cast<std::chrono::milliseconds>(now)));
+}
+
+void ttl(const redis::commands::args_t &args, redis::database &db,
+         redis::resp::handler &output, std::int64_t unit) {
+  if (args.size() != 2)
+    return error(output, "ERR wrong number of arguments");
+
   const auto now =
       std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
-  const auto &key = args[1];
+  const auto expiry = db.expiry(args[1], now);
+  if (!expiry)
+    return integer(output, -2);
+  if (*expiry == redis::database::never)
+    return integer(output, -1);
+  integer(output, ((*expiry - now).count() + unit / 2) / unit);
+}
+} // namespace
 
-  if (args.size() != 2)
-    return error(output, "ERR expected one key argument");
+void redis_cmd_expire(const redis::commands::args_t &args, redis::database &db,
+                      redis::resp::handler &output) {
+  expire(args, db, output, [](auto now, std::int64_t seconds) {
+    return redis::database::ex(now, seconds);
+  });
+}
 
-  auto &value = [&]() -> std::string & {
-    if (auto opt_result = db.get_string(key, now))
-      return opt_result->get();
-    else
-      return db.set(key, "0");
-  }();
+void redis_cmd_pexpire(const redis::commands::args_t &args,
+                       redis::database &db, redis::resp::handler &output) {
+  expire(args, db, output, [](auto now, std::int64_t milliseconds) {
+    return redis::database::px(now, milliseconds);
+  });
+}
+
+void redis_cmd_expireat(const redis::commands::args_t &args,
+                        redis::database &db, redis::resp::handler &output) {
+  expire(args, db, output, [](auto, std::int64_t seconds) {
+    return redis::database::exat(seconds);
+  });
+}
+
+void redis_cmd_pexpireat(const redis::commands::args_t &args,
+                         redis::database &db, redis::resp::handler &output) {
+  expire(args, db, output, [](auto, std::int64_t milliseconds) {
+    return redis::database::pxat(milliseconds);
+  });
+}
 
-  auto i = parse_int(value);
+void redis_cmd_ttl(const redis::commands::args_t &args, redis::database &db,
+                   redis::resp::handler &output) {
+  ttl(args, db, output, 1000);
+}
+
+void redis_cmd_pttl(const redis::commands::args_t &args, redis::database &db,
+                    redis::resp::handler &output) {
+  ttl(args, db, output, 1);
+}
+
+void redis_cmd_persist(const redis::commands::args_t &args,
+                       redis::database &db, redis::resp::handler &output) {
+  if (args.size() != 2)
+    return error(output, "ERR wrong number of arguments");
 
-  f(i);
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto expiry = db.expiry(args[1], now);
+  if (!expiry || *expiry == redis::database::never)
+    return integer(output, 0);
+  db.expire(args[1], redis::database::never, now);
+  integer(output, 1);
+}
 
-  auto [buf, len] = to_chars(i);
+namespace {
+// add delta to the integer held by key, in place, so that it keeps its expiry
+void incr_by(std::string_view key, std::int64_t delta, redis::database &db,
+             redis::resp::handler &output) {
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
 
-  db.set(key, std::string_view(buf.begin(), len));
+  auto [value, inserted] = db.upsert(key, now, std::int64_t());
+  auto *const i = std::get_if<std::int64_t>(&value);
+  // a string that was an integer would be held as one
+  if (!i && std::holds_alternative<redis::compact_string>(value))
+    return error(output, "ERR value is not an integer or out of range");
+  if (!i)
+    return error(output, "WRONGTYPE key refers to object of the wrong type");
 
-  integer(output, i);
+  std::int64_t result;
+  if (__builtin_add_overflow(*i, delta, &result))
+    return error(output, "ERR increment or decrement would overflow");
+  *i = result;
+  integer(output, result);
 }
 } // namespace
 
 void redis_cmd_incr(const redis::commands::args_t &args, redis::database &db,
                     redis::resp::handler &output) {
-  incr_or_decr(args, db, output, [](auto &i) { ++i; });
+  if (args.size() != 2)
+    return error(output, "ERR wrong number of arguments");
+  incr_by(args[1], 1, db, output);
 }
 
 void redis_cmd_decr(const redis::commands::args_t &args, redis::database &db,
                     redis::resp::handler &output) {
-  incr_or_decr(args, db, output, [](auto &i) { --i; });
+  if (args.size() != 2)
+    return error(output, "ERR wrong number of arguments");
+  incr_by(args[1], -1, db, output);
+}
+
+void redis_cmd_incrby(const redis::commands::args_t &args, redis::database &db,
+                      redis::resp::handler &output) {
+  if (args.size() != 3)
+    return error(output, "ERR wrong number of arguments");
+  try {
+    incr_by(args[1], parse_int(args[2]), db, output);
+  } catch (const not_an_int &) {
+    error(output, "ERR value is not an integer or out of range");
+  }
+}
+
+void redis_cmd_decrby(const redis::commands::args_t &args, redis::database &db,
+                      redis::resp::handler &output) {
+  if (args.size() != 3)
+    return error(output, "ERR wrong number of arguments");
+  try {
+    const auto decrement = parse_int(args[2]);
+    if (decrement == std::numeric_limits<std::int64_t>::min())
+      return error(output, "ERR decrement would overflow");
+    incr_by(args[1], -decrement, db, output);
+  } catch (const not_an_int &) {
+    error(output, "ERR value is not an integer or out of range");
+  }
+}
+
+void redis_cmd_incrbyfloat(const redis::commands::args_t &args,
+                           redis::database &db, redis::resp::handler &output) {
+  if (args.size() != 3)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto parse_double = [](std::string_view s) -> std::optional<double> {
+    double result;
+    const auto [ptr, ec] = std::from_chars(s.begin(), s.end(), result);
+    if (s.empty() || ec != std::errc() || ptr != s.end() ||
+        !std::isfinite(result))
+      return {};
+    return result;
+  };
+  const auto delta = parse_double(args[2]);
+  if (!delta)
+    return error(output, "ERR value is not a valid float");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  auto [value, inserted] = db.upsert(args[1], now, std::int64_t());
+  std::optional<double> current;
+  if (const auto *i = std::get_if<std::int64_t>(&value))
+    current = double(*i);
+  else if (const auto *s = std::get_if<redis::compact_string>(&value))
+    current = parse_double(*s);
+  else
+    return error(output, "WRONGTYPE key refers to object of the wrong type");
+  if (!current)
+    return error(output, "ERR value is not a valid float");
+
+  const double result = *current + *delta;
+  if (!std::isfinite(result))
+    return error(output, "ERR increment would produce NaN or Infinity");
+  // the shortest text that reads back as the same double
+  std::array<char, 32> buf;
+  const auto len = std::size_t(
+      std::to_chars(buf.begin(), buf.end(), result).ptr - buf.begin());
+  const std::string_view text(buf.data(), len);
+  value = redis::database::make_string(text);
+  bulk_string(output, text);
 }
 
 namespace {
 void rpush_lpush(const redis::commands::args_t &args, redis::database &db,
                  redis::resp::handler &output,
-                 void (*push)(redis::database::list_t &, const char *,
-                              const char *)) try {
+                 void (*push)(redis::database::list_t &,
+                              std::string_view)) try {
   const auto &key = args[1];
 
   if (args.size() > 2) {
-    auto &list = db.get_or_create_list(key);
+    const auto now =
+        std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+    auto &list = db.get_or_create_list(key, now);
 
     for (auto &s : std::span(args.begin() + 2, args.end()))
-      push(list, s.begin(), s.end());
+      push(list, s);
 
     return integer(output, list.size());
   } else {
@@ -252,16 +438,14 @@ void rpush_lpush(const redis::commands::args_t &args, redis::database &db,
 
 void redis_cmd_rpush(const redis::commands::args_t &args, redis::database &db,
                      redis::resp::handler &output) {
-  return rpush_lpush(args, db, output, [](auto &list, auto begin, auto end) {
-    list.emplace_back(begin, end);
-  });
+  return rpush_lpush(args, db, output,
+                     [](auto &list, auto s) { list.push_back(s); });
 }
 
 void redis_cmd_lpush(const redis::commands::args_t &args, redis::database &db,
                      redis::resp::handler &output) {
-  return rpush_lpush(args, db, output, [](auto &list, auto begin, auto end) {
-    list.emplace_front(begin, end);
-  });
+  return rpush_lpush(args, db, output,
+                     [](auto &list, auto s) { list.push_front(s); });
 }
 
 void redis_cmd_lrange(const redis::commands::args_t &args, redis::database &db,
@@ -269,7 +453,15 @@ void redis_cmd_lrange(const redis::commands::args_t &args, redis::database &db,
   try {
     if (args.size() == 4) {
       const auto &key = args[1];
-      const auto &list = db.get_list(key)->get();
+      const auto now =
+          std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+      const auto opt_list = db.get_list(key, now);
+      if (!opt_list) {
+        output.begin_array(0);
+        output.end_array();
+        return;
+      }
+      const auto &list = opt_list->get();
 
       auto normalise_index = [&](std::int64_t i) -> std::int64_t {
         auto result = i < 0 ? std::int64_t(list.size()) + i : i;
@@ -286,8 +478,7 @@ void redis_cmd_lrange(const redis::commands::args_t &args, redis::database &db,
         return error(output, "ERR stop before start");
       }
 
-      auto iter = list.begin();
-      std::advance(iter, start);
+      auto iter = list.at(std::size_t(start));
 
       output.begin_array(stop - start);
 
@@ -306,79 +497,1501 @@ void redis_cmd_lrange(const redis::commands::args_t &args, redis::database &db,
   }
 }
 
-void redis_cmd_save(const redis::commands::args_t &args, redis::database &db,
-                    redis::resp::handler &output) {
-  if (args.size() != 1)
+void redis_cmd_hset(const redis::commands::args_t &args, redis::database &db,
+                    redis::resp::handler &output) try {
+  if (args.size() < 4 || args.size() % 2)
     return error(output, "ERR wrong number of arguments");
 
-  try {
-    auto file = db.state_ostream();
-    redis::resp::writer writer(*file);
-
-    db.visit(overloaded{
-        [&](auto &key,
-            const redis::database::string_with_expiry_t &elem) -> bool {
-          auto &[value, expiry] = elem;
-          writer.begin_array(expiry ? 5 : 3);
-          bulk_string(writer, "SET");
-          bulk_string(writer, key);
-          bulk_string(writer, value);
-          if (expiry) {
-            bulk_string(writer, "PXAT");
-            auto [buf, len] = to_chars(expiry->time_since_epoch().count());
-            bulk_string(writer, std::string_view(buf.begin(), len));
-          }
-          writer.end_array();
-          return true;
-        },
-        [&](auto &key, const redis::database::list_t &elem) -> bool {
-          writer.begin_array(std::int64_t(elem.size()) + 2);
-          bulk_string(writer, "RPUSH");
-          bulk_string(writer, key);
-          for (const auto &s : elem)
-            bulk_string(writer, s);
-          return true;
-        },
-        [](auto &, const std::monostate &) -> bool {
-          assert(false);
-          return true;
-        },
-    });
-    return simple_string(output, "OK");
-  } catch (const std::exception &) {
-    return error(output, "ERR failed to save db state");
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  auto &hash = db.get_or_create_hash(args[1], now);
+  std::int64_t added = 0;
+  for (std::size_t i = 2; i < args.size(); i += 2)
+    added += hash.set(args[i], args[i + 1]);
+  integer(output, added);
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_hget(const redis::commands::args_t &args, redis::database &db,
+                    redis::resp::handler &output) try {
+  if (args.size() != 3)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto hash = db.get_hash(args[1], now);
+  const auto value = hash ? hash->get().get(args[2]) : std::nullopt;
+  if (value)
+    bulk_string(output, *value);
+  else
+    nil_string(output);
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_hmget(const redis::commands::args_t &args, redis::database &db,
+                     redis::resp::handler &output) try {
+  if (args.size() < 3)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto hash = db.get_hash(args[1], now);
+  output.begin_array(std::int64_t(args.size() - 2));
+  for (const auto field : std::span(args).subspan(2)) {
+    const auto value = hash ? hash->get().get(field) : std::nullopt;
+    if (value)
+      bulk_string(output, *value);
+    else
+      nil_string(output);
   }
+  output.end_array();
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
 }
 
-void redis_cmd_load(const redis::commands::args_t &args, redis::database &db,
-                    redis::resp::handler &output) {
-  if (args.size() != 1)
+void redis_cmd_hdel(const redis::commands::args_t &args, redis::database &db,
+                    redis::resp::handler &output) try {
+  if (args.size() < 3)
     return error(output, "ERR wrong number of arguments");
 
-  auto stream = db.state_istream();
-  redis::resp::null_handler null_handler;
-  redis::command_handler command_handler(db, null_handler);
-  redis::resp::parser parser(command_handler);
-  redis::io::ring_buffer ring_buffer(1 << 13);
-  std::size_t read_index = 0;
-  std::size_t write_index = 0;
-  db.clear();
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto hash = db.get_hash(args[1], now);
+  if (!hash)
+    return integer(output, 0);
+
+  std::int64_t deleted = 0;
+  for (const auto field : std::span(args).subspan(2))
+    deleted += hash->get().erase(field);
+  // as in Redis, a hash with no fields left doesn't exist
+  if (hash->get().empty())
+    db.del(args[1], now);
+  integer(output, deleted);
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
 
-  auto readable_bytes = [&]() {
-    return std::streamsize(write_index - read_index);
-  };
+void redis_cmd_hlen(const redis::commands::args_t &args, redis::database &db,
+                    redis::resp::handler &output) try {
+  if (args.size() != 2)
+    return error(output, "ERR wrong number of arguments");
 
-  auto writable_bytes = [&, size = ring_buffer.size()]() {
-    return std::streamsize(size - (readable_bytes()));
-  };
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto hash = db.get_hash(args[1], now);
+  integer(output, hash ? hash->get().size() : 0);
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_hgetall(const redis::commands::args_t &args,
+                       redis::database &db,
+                       redis::resp::handler &output) try {
+  if (args.size() != 2)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto hash = db.get_hash(args[1], now);
+  if (!hash) {
+    output.begin_array(0);
+    output.end_array();
+    return;
+  }
+
+  output.begin_array(std::int64_t(hash->get().size() * 2));
+  hash->get().visit([&](std::string_view field, std::string_view value) {
+    bulk_string(output, field);
+    bulk_string(output, value);
+  });
+  output.end_array();
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_hincrby(const redis::commands::args_t &args,
+                       redis::database &db,
+                       redis::resp::handler &output) try {
+  if (args.size() != 4)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto delta = parse_int(args[3]);
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  auto &hash = db.get_or_create_hash(args[1], now);
+  std::int64_t current = 0;
+  if (const auto value = hash.get(args[2])) {
+    const auto i = redis::string_value::parse_integer(*value);
+    if (!i)
+      return error(output, "ERR hash value is not an integer");
+    current = *i;
+  }
+
+  std::int64_t result;
+  if (__builtin_add_overflow(current, delta, &result))
+    return error(output, "ERR increment or decrement would overflow");
+  // only this field's value is rewritten, however big the hash
+  const auto [buf, len] = to_chars(result);
+  hash.set(args[2], std::string_view(buf.data(), len));
+  integer(output, result);
+} catch (const not_an_int &) {
+  error(output, "ERR value is not an integer or out of range");
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_hscan(const redis::commands::args_t &args, redis::database &db,
+                     redis::resp::handler &output) try {
+  if (args.size() < 3)
+    return error(output, "ERR wrong number of arguments");
+
+  std::uint64_t cursor{};
+  const auto [ptr, ec] =
+      std::from_chars(args[2].begin(), args[2].end(), cursor);
+  if (args[2].empty() || ptr != args[2].end() || ec != std::errc())
+    return error(output, "ERR invalid cursor");
+
+  std::optional<std::string_view> pattern;
+  std::int64_t count = 10;
+  const redis::util::ci_equal eq;
+  for (std::size_t i = 3; i < args.size(); i += 2) {
+    if (i + 1 == args.size())
+      return error(output, "ERR syntax error");
+    if (eq(args[i], "MATCH")) {
+      pattern = args[i + 1];
+    } else if (eq(args[i], "COUNT")) {
+      count = parse_int(args[i + 1]);
+      if (count < 1)
+        return error(output, "ERR syntax error");
+    } else {
+      return error(output, "ERR syntax error");
+    }
+  }
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto hash = db.get_hash(args[1], now);
+  std::vector<std::pair<std::string_view, std::string_view>> fields;
+  if (hash) {
+    cursor = hash->get().scan(
+        cursor, std::size_t(count),
+        [&](std::string_view field, std::string_view value) {
+          if (!pattern || redis::util::glob_match(*pattern, field))
+            fields.emplace_back(field, value);
+        });
+  } else {
+    cursor = 0;
+  }
+
+  output.begin_array(2);
+  const auto [buf, len] = to_chars(cursor);
+  bulk_string(output, std::string_view(buf.data(), len));
+  output.begin_array(std::int64_t(fields.size() * 2));
+  for (const auto &[field, value] : fields) {
+    bulk_string(output, field);
+    bulk_string(output, value);
+  }
+  output.end_array();
+  output.end_array();
+} catch (const not_an_int &) {
+  error(output, "ERR value is not an integer or out of range");
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_sadd(const redis::commands::args_t &args, redis::database &db,
+                    redis::resp::handler &output) try {
+  if (args.size() < 3)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  auto &set = db.get_or_create_set(args[1], now);
+  integer(output, set.insert(std::span(args).subspan(2)));
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_srem(const redis::commands::args_t &args, redis::database &db,
+                    redis::resp::handler &output) try {
+  if (args.size() < 3)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto set = db.get_set(args[1], now);
+  if (!set)
+    return integer(output, 0);
+
+  std::int64_t removed = 0;
+  for (const auto member : std::span(args).subspan(2))
+    removed += set->get().erase(member);
+  // as in Redis, a set with no members left doesn't exist
+  if (set->get().empty())
+    db.del(args[1], now);
+  integer(output, removed);
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
 
-  while (auto num_read = stream->readsome(ring_buffer.addr(write_index),
-                                          writable_bytes())) {
-    write_index += num_read;
-    const auto read_addr = ring_buffer.addr(read_index);
-    read_index +=
-        parser.parse(read_addr, read_addr + readable_bytes()) - read_addr;
+void redis_cmd_sismember(const redis::commands::args_t &args,
+                         redis::database &db,
+                         redis::resp::handler &output) try {
+  if (args.size() != 3)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto set = db.get_set(args[1], now);
+  integer(output, set && set->get().contains(args[2]));
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_scard(const redis::commands::args_t &args, redis::database &db,
+                     redis::resp::handler &output) try {
+  if (args.size() != 2)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto set = db.get_set(args[1], now);
+  integer(output, set ? set->get().size() : 0);
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+namespace {
+void members(redis::resp::handler &output,
+             const redis::database::set_t &set) {
+  output.begin_array(std::int64_t(set.size()));
+  set.visit([&](std::string_view member) { bulk_string(output, member); });
+  output.end_array();
+}
+
+enum class set_operation { intersect, unite, subtract };
+
+// op applied to the sets held by keys, a missing key being an empty set
+redis::database::set_t combine(set_operation op,
+                               std::span<const std::string_view> keys,
+                               redis::database &db,
+                               redis::database::time_point now) {
+  using set_t = redis::database::set_t;
+
+  // the sets are boxed, so these stay put if looking up a key erases another
+  std::vector<const set_t *> sets;
+  for (std::size_t i = 0; i < keys.size(); ++i) {
+    if (const auto set = db.get_set(keys[i], now))
+      sets.push_back(&set->get());
+    else if (op == set_operation::intersect ||
+             (op == set_operation::subtract && i == 0))
+      return set_t(db.max_intset_entries());
+  }
+
+  switch (op) {
+  case set_operation::intersect:
+    return set_t::intersect(sets, db.max_intset_entries());
+  case set_operation::unite:
+    return set_t::unite(sets, db.max_intset_entries());
+  case set_operation::subtract:
+    return set_t::subtract(*sets.front(), std::span(sets).subspan(1),
+                           db.max_intset_entries());
   }
+  throw std::logic_error("unknown set operation");
+}
+
+void set_algebra(const redis::commands::args_t &args, redis::database &db,
+                 redis::resp::handler &output, set_operation op) try {
+  if (args.size() < 2)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  members(output, combine(op, std::span(args).subspan(1), db, now));
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void set_algebra_store(const redis::commands::args_t &args,
+                       redis::database &db, redis::resp::handler &output,
+                       set_operation op) try {
+  if (args.size() < 3)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  auto result = combine(op, std::span(args).subspan(2), db, now);
+  const auto size = result.size();
+  db.store_set(args[1], now, std::move(result));
+  integer(output, size);
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+} // namespace
+
+void redis_cmd_smembers(const redis::commands::args_t &args,
+                        redis::database &db,
+                        redis::resp::handler &output) try {
+  if (args.size() != 2)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  if (const auto set = db.get_set(args[1], now))
+    return members(output, *set);
+  output.begin_array(0);
+  output.end_array();
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_sinter(const redis::commands::args_t &args,
+                      redis::database &db, redis::resp::handler &output) {
+  set_algebra(args, db, output, set_operation::intersect);
+}
+
+void redis_cmd_sunion(const redis::commands::args_t &args,
+                      redis::database &db, redis::resp::handler &output) {
+  set_algebra(args, db, output, set_operation::unite);
+}
+
+void redis_cmd_sdiff(const redis::commands::args_t &args, redis::database &db,
+                     redis::resp::handler &output) {
+  set_algebra(args, db, output, set_operation::subtract);
+}
+
+void redis_cmd_sinterstore(const redis::commands::args_t &args,
+                           redis::database &db, redis::resp::handler &output) {
+  set_algebra_store(args, db, output, set_operation::intersect);
+}
+
+void redis_cmd_sunionstore(const redis::commands::args_t &args,
+                           redis::database &db, redis::resp::handler &output) {
+  set_algebra_store(args, db, output, set_operation::unite);
+}
+
+void redis_cmd_sdiffstore(const redis::commands::args_t &args,
+                          redis::database &db, redis::resp::handler &output) {
+  set_algebra_store(args, db, output, set_operation::subtract);
+}
+
+namespace {
+// a score as ZADD and ZINCRBY take it: a double, or +inf or -inf, but not NaN
+std::optional<double> parse_score(std::string_view s) {
+  // from_chars takes "inf" and "-inf", but no leading '+'
+  if (s.size() > 1 && s[0] == '+' && s[1] != '-')
+    s.remove_prefix(1);
+  double result;
+  const auto [ptr, ec] = std::from_chars(s.begin(), s.end(), result);
+  if (s.empty() || ec != std::errc() || ptr != s.end() || std::isnan(result))
+    return {};
+  return result;
+}
+
+// a bound of a range of scores, exclusive if it starts with '('
+struct score_bound {
+  double score;
+  bool exclusive;
+};
 
+std::optional<score_bound> parse_bound(std::string_view s) {
+  const bool exclusive = s.starts_with('(');
+  if (exclusive)
+    s.remove_prefix(1);
+  if (const auto score = parse_score(s))
+    return score_bound{*score, exclusive};
+  return {};
+}
+
+// the ranks, from start up to but not including stop, of the members with
+// scores from min to max
+std::pair<std::size_t, std::size_t>
+score_range(const redis::database::zset_t &zset, score_bound min,
+            score_bound max) {
+  const auto start = zset.count_below(min.score, min.exclusive);
+  const auto stop = zset.count_below(max.score, !max.exclusive);
+  return {start, std::max(start, stop)};
+}
+
+// the shortest text that reads back as the same score
+void bulk_score(redis::resp::handler &output, double score) {
+  std::array<char, 32> buf;
+  const auto len = std::size_t(
+      std::to_chars(buf.begin(), buf.end(), score).ptr - buf.begin());
+  bulk_string(output, std::string_view(buf.data(), len));
+}
+
+void reply_range(redis::resp::handler &output,
+                 const redis::database::zset_t &zset, std::size_t start,
+                 std::size_t stop, bool with_scores) {
+  output.begin_array(std::int64_t((stop - start) * (with_scores ? 2 : 1)));
+  zset.visit(start, stop, [&](std::string_view member, double score) {
+    bulk_string(output, member);
+    if (with_scores)
+      bulk_score(output, score);
+  });
+  output.end_array();
+}
+} // namespace
+
+void redis_cmd_zadd(const redis::commands::args_t &args, redis::database &db,
+                    redis::resp::handler &output) try {
+  bool nx = false;
+  bool xx = false;
+  bool ch = false;
+  const redis::util::ci_equal eq;
+  std::size_t i = 2;
+  for (; i < args.size(); ++i) {
+    if (eq(args[i], "NX"))
+      nx = true;
+    else if (eq(args[i], "XX"))
+      xx = true;
+    else if (eq(args[i], "CH"))
+      ch = true;
+    else
+      break;
+  }
+  if (nx && xx) {
+    return error(output,
+                 "ERR XX and NX options at the same time are not compatible");
+  }
+  if (i == args.size() || (args.size() - i) % 2)
+    return error(output, "ERR syntax error");
+
+  // every score is checked before any member is added
+  std::vector<double> scores;
+  for (std::size_t j = i; j < args.size(); j += 2) {
+    const auto score = parse_score(args[j]);
+    if (!score)
+      return error(output, "ERR value is not a valid float");
+    scores.push_back(*score);
+  }
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  // XX only updates, so doesn't create the key
+  const auto existing = db.get_zset(args[1], now);
+  if (!existing && xx)
+    return integer(output, 0);
+  auto &zset = existing ? existing->get() : db.get_or_create_zset(args[1], now);
+
+  std::int64_t added = 0;
+  std::int64_t changed = 0;
+  for (std::size_t j = 0; j < scores.size(); ++j) {
+    const auto &member = args[i + 2 * j + 1];
+    const auto current = zset.score(member);
+    if ((current && nx) || (!current && xx) || current == scores[j])
+      continue;
+    added += zset.insert(member, scores[j]);
+    ++changed;
+  }
+  integer(output, ch ? changed : added);
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_zrem(const redis::commands::args_t &args, redis::database &db,
+                    redis::resp::handler &output) try {
+  if (args.size() < 3)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto zset = db.get_zset(args[1], now);
+  if (!zset)
+    return integer(output, 0);
+
+  std::int64_t removed = 0;
+  for (const auto member : std::span(args).subspan(2))
+    removed += zset->get().erase(member);
+  // as in Redis, a sorted set with no members left doesn't exist
+  if (zset->get().empty())
+    db.del(args[1], now);
+  integer(output, removed);
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_zscore(const redis::commands::args_t &args, redis::database &db,
+                      redis::resp::handler &output) try {
+  if (args.size() != 3)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto zset = db.get_zset(args[1], now);
+  if (const auto score = zset ? zset->get().score(args[2]) : std::nullopt)
+    return bulk_score(output, *score);
+  nil_string(output);
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_zrank(const redis::commands::args_t &args, redis::database &db,
+                     redis::resp::handler &output) try {
+  if (args.size() != 3)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto zset = db.get_zset(args[1], now);
+  if (const auto rank = zset ? zset->get().rank(args[2]) : std::nullopt)
+    return integer(output, *rank);
+  nil_string(output);
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_zcard(const redis::commands::args_t &args, redis::database &db,
+                     redis::resp::handler &output) try {
+  if (args.size() != 2)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto zset = db.get_zset(args[1], now);
+  integer(output, zset ? zset->get().size() : 0);
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_zincrby(const redis::commands::args_t &args,
+                       redis::database &db,
+                       redis::resp::handler &output) try {
+  if (args.size() != 4)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto delta = parse_score(args[2]);
+  if (!delta)
+    return error(output, "ERR value is not a valid float");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  auto &zset = db.get_or_create_zset(args[1], now);
+  const double result = zset.score(args[3]).value_or(0) + *delta;
+  if (std::isnan(result)) {
+    if (zset.empty())
+      db.del(args[1], now);
+    return error(output, "ERR resulting score is not a number (NaN)");
+  }
+  zset.insert(args[3], result);
+  bulk_score(output, result);
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_zcount(const redis::commands::args_t &args, redis::database &db,
+                      redis::resp::handler &output) try {
+  if (args.size() != 4)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto min = parse_bound(args[2]);
+  const auto max = parse_bound(args[3]);
+  if (!min || !max)
+    return error(output, "ERR min or max is not a float");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto zset = db.get_zset(args[1], now);
+  if (!zset)
+    return integer(output, 0);
+  // two descents of the tree, however many members are in range
+  const auto [start, stop] = score_range(*zset, *min, *max);
+  integer(output, stop - start);
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_zrange(const redis::commands::args_t &args, redis::database &db,
+                      redis::resp::handler &output) try {
+  if (args.size() != 4 && args.size() != 5)
+    return error(output, "ERR wrong number of arguments");
+  const bool with_scores = args.size() == 5;
+  if (with_scores && !redis::util::ci_equal()(args[4], "WITHSCORES"))
+    return error(output, "ERR syntax error");
+
+  auto start = parse_int(args[2]);
+  auto stop = parse_int(args[3]);
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto zset = db.get_zset(args[1], now);
+  const auto size = zset ? std::int64_t(zset->get().size()) : 0;
+
+  // as in Redis, negative indexes count from the end, and the range is
+  // clipped to the members there are
+  if (start < 0)
+    start = std::max<std::int64_t>(start + size, 0);
+  if (stop < 0)
+    stop += size;
+  stop = std::min(stop, size - 1);
+  if (!zset || start > stop) {
+    output.begin_array(0);
+    output.end_array();
+    return;
+  }
+  reply_range(output, *zset, std::size_t(start), std::size_t(stop + 1),
+              with_scores);
+} catch (const not_an_int &) {
+  error(output, "ERR value is not an integer or out of range");
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_zrangebyscore(const redis::commands::args_t &args,
+                             redis::database &db,
+                             redis::resp::handler &output) try {
+  if (args.size() < 4)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto min = parse_bound(args[2]);
+  const auto max = parse_bound(args[3]);
+  if (!min || !max)
+    return error(output, "ERR min or max is not a float");
+
+  bool with_scores = false;
+  std::int64_t offset = 0;
+  std::int64_t count = -1;
+  const redis::util::ci_equal eq;
+  for (std::size_t i = 4; i < args.size(); ++i) {
+    if (eq(args[i], "WITHSCORES")) {
+      with_scores = true;
+    } else if (eq(args[i], "LIMIT") && i + 2 < args.size()) {
+      offset = parse_int(args[i + 1]);
+      count = parse_int(args[i + 2]);
+      i += 2;
+    } else {
+      return error(output, "ERR syntax error");
+    }
+  }
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto zset = db.get_zset(args[1], now);
+  if (!zset || offset < 0) {
+    output.begin_array(0);
+    output.end_array();
+    return;
+  }
+  // the range is found by rank, so LIMIT skips offset members without
+  // walking them
+  auto [start, stop] = score_range(*zset, *min, *max);
+  start = std::min(start + std::size_t(offset), stop);
+  if (count >= 0)
+    stop = std::min(stop, start + std::size_t(count));
+  reply_range(output, *zset, start, stop, with_scores);
+} catch (const not_an_int &) {
+  error(output, "ERR value is not an integer or out of range");
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+namespace {
+// a bit offset, as SETBIT, GETBIT and BITFIELD take it
+std::optional<std::uint64_t> parse_offset(std::string_view s) {
+  std::uint64_t result;
+  auto [ptr, ec] = std::from_chars(s.begin(), s.end(), result);
+  if (s.empty() || ptr != s.end() || ec != std::errc() ||
+      result > redis::bitmap::max_offset)
+    return {};
+  return result;
+}
+
+// the bits from begin up to but not including end that the range from start
+// to stop covers, as BITCOUNT and BITPOS take it: inclusive, in bytes or
+// bits, counting back from the end if negative, and clipped to the size bytes
+// there are
+std::pair<std::uint64_t, std::uint64_t>
+bit_range(std::int64_t start, std::int64_t stop, std::size_t size,
+          bool in_bits) {
+  const auto length = std::int64_t(in_bits ? size * 8 : size);
+  if (start < 0)
+    start = std::max<std::int64_t>(start + length, 0);
+  if (stop < 0)
+    stop = std::max<std::int64_t>(stop + length, 0);
+  stop = std::min(stop, length - 1);
+  if (start > stop)
+    return {};
+  const std::uint64_t scale = in_bits ? 1 : 8;
+  return {std::uint64_t(start) * scale, std::uint64_t(stop + 1) * scale};
+}
+
+// whether args[i], if it's there, asks for a range in bits rather than bytes
+std::optional<bool> parse_unit(const redis::commands::args_t &args,
+                               std::size_t i) {
+  const redis::util::ci_equal eq;
+  if (i >= args.size() || eq(args[i], "BYTE"))
+    return false;
+  if (eq(args[i], "BIT"))
+    return true;
+  return {};
+}
+} // namespace
+
+void redis_cmd_setbit(const redis::commands::args_t &args, redis::database &db,
+                      redis::resp::handler &output) try {
+  if (args.size() != 4)
+    return error(output, "ERR wrong number of arguments");
+  const auto offset = parse_offset(args[2]);
+  if (!offset)
+    return error(output, "ERR bit offset is not an integer or out of range");
+  if (args[3] != "0" && args[3] != "1")
+    return error(output, "ERR bit is not an integer or out of range");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  auto &bits = db.get_or_create_raw_string(args[1], now);
+  integer(output, redis::bitmap::set(bits, *offset, args[3] == "1"));
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_getbit(const redis::commands::args_t &args, redis::database &db,
+                      redis::resp::handler &output) try {
+  if (args.size() != 3)
+    return error(output, "ERR wrong number of arguments");
+  const auto offset = parse_offset(args[2]);
+  if (!offset)
+    return error(output, "ERR bit offset is not an integer or out of range");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto bits = db.get_string(args[1], now);
+  integer(output, bits && redis::bitmap::get(bits->view(), *offset));
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_bitcount(const redis::commands::args_t &args,
+                        redis::database &db,
+                        redis::resp::handler &output) try {
+  if (args.size() != 2 && args.size() != 4 && args.size() != 5)
+    return error(output, "ERR syntax error");
+  const auto in_bits = parse_unit(args, 4);
+  if (!in_bits)
+    return error(output, "ERR syntax error");
+  const auto start = args.size() > 2 ? parse_int(args[2]) : 0;
+  const auto stop = args.size() > 2 ? parse_int(args[3]) : -1;
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto bits = db.get_string(args[1], now);
+  if (!bits)
+    return integer(output, 0);
+  const auto view = bits->view();
+  const auto [begin, end] = bit_range(start, stop, view.size(), *in_bits);
+  integer(output, redis::bitmap::count(view, begin, end));
+} catch (const not_an_int &) {
+  error(output, "ERR value is not an integer or out of range");
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_bitpos(const redis::commands::args_t &args, redis::database &db,
+                      redis::resp::handler &output) try {
+  if (args.size() < 3 || args.size() > 6)
+    return error(output, "ERR wrong number of arguments");
+  if (args[2] != "0" && args[2] != "1")
+    return error(output, "ERR The bit argument must be 1 or 0.");
+  const bool bit = args[2] == "1";
+  const auto in_bits = parse_unit(args, 5);
+  if (!in_bits)
+    return error(output, "ERR syntax error");
+  const auto start = args.size() > 3 ? parse_int(args[3]) : 0;
+  const bool bounded = args.size() > 4;
+  const auto stop = bounded ? parse_int(args[4]) : -1;
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto bits = db.get_string(args[1], now);
+  if (!bits)
+    return integer(output, bit ? -1 : 0);
+  const auto view = bits->view();
+  const auto [begin, end] = bit_range(start, stop, view.size(), *in_bits);
+  if (const auto pos = redis::bitmap::find(view, bit, begin, end))
+    return integer(output, *pos);
+  // as in Redis, a string is taken to be padded with zeros to the right when
+  // no end is given, so the first clear bit past an all-set range is next
+  if (!bit && !bounded && begin < end)
+    return integer(output, end);
+  integer(output, -1);
+} catch (const not_an_int &) {
+  error(output, "ERR value is not an integer or out of range");
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_bitop(const redis::commands::args_t &args, redis::database &db,
+                     redis::resp::handler &output) try {
+  if (args.size() < 4)
+    return error(output, "ERR wrong number of arguments");
+  using redis::bitmap::operation;
+  const redis::util::ci_equal eq;
+  operation op;
+  if (eq(args[1], "AND"))
+    op = operation::and_;
+  else if (eq(args[1], "OR"))
+    op = operation::or_;
+  else if (eq(args[1], "XOR"))
+    op = operation::xor_;
+  else if (eq(args[1], "NOT"))
+    op = operation::not_;
+  else
+    return error(output, "ERR syntax error");
+  if (op == operation::not_ && args.size() != 4)
+    return error(output,
+                 "ERR BITOP NOT must be called with a single source key.");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  // a short value is kept in its key's slot, which erasing another key that
+  // has expired can move, so expire every source before taking views of any
+  const auto keys = std::span(args).subspan(3);
+  for (const auto key : keys)
+    db.exists(key, now);
+  std::vector<std::optional<redis::string_value>> values;
+  values.reserve(keys.size());
+  for (const auto key : keys)
+    values.push_back(db.get_string(key, now));
+  std::vector<std::string_view> sources;
+  sources.reserve(values.size());
+  for (const auto &value : values)
+    sources.push_back(value ? value->view() : std::string_view());
+
+  auto result = redis::bitmap::apply(op, sources);
+  const auto size = result.size();
+  db.store_string(args[2], now, std::move(result));
+  integer(output, size);
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+namespace {
+struct bitfield_op {
+  enum { get, set, incrby } kind;
+  bool is_signed;
+  unsigned width;
+  std::uint64_t offset;
+  std::int64_t value;
+  enum { wrap, sat, fail } overflow;
+};
+
+class bitfield_error : std::runtime_error {
+public:
+  using runtime_error::runtime_error;
+
+  [[nodiscard]] std::string_view message() const { return what(); }
+};
+
+// the fields of a BITFIELD type: i1 to i64, or u1 to u63
+std::pair<bool, unsigned> parse_bitfield_type(std::string_view s) {
+  unsigned width = 0;
+  if (s.size() > 1 && (s[0] == 'i' || s[0] == 'u')) {
+    auto [ptr, ec] = std::from_chars(s.begin() + 1, s.end(), width);
+    if (ptr != s.end() || ec != std::errc())
+      width = 0;
+  }
+  const bool is_signed = s.starts_with('i');
+  if (width < 1 || width > (is_signed ? 64 : 63))
+    throw bitfield_error("ERR Invalid bitfield type. Use something like i16 "
+                         "u8. Note that u64 is not supported but i64 is.");
+  return {is_signed, width};
+}
+
+// a BITFIELD offset: a bit offset, or #n for the nth field of width bits
+std::uint64_t parse_bitfield_offset(std::string_view s, unsigned width) {
+  const bool scaled = s.starts_with('#');
+  const auto offset = parse_offset(scaled ? s.substr(1) : s);
+  if (!offset ||
+      (scaled ? *offset * width : *offset) + width - 1 >
+          redis::bitmap::max_offset)
+    throw bitfield_error("ERR bit offset is not an integer or out of range");
+  return scaled ? *offset * width : *offset;
+}
+
+std::vector<bitfield_op> parse_bitfield(const redis::commands::args_t &args) {
+  std::vector<bitfield_op> result;
+  const redis::util::ci_equal eq;
+  auto overflow = bitfield_op::wrap;
+  for (std::size_t i = 2; i < args.size();) {
+    if (eq(args[i], "OVERFLOW") && i + 1 < args.size()) {
+      if (eq(args[i + 1], "WRAP"))
+        overflow = bitfield_op::wrap;
+      else if (eq(args[i + 1], "SAT"))
+        overflow = bitfield_op::sat;
+      else if (eq(args[i + 1], "FAIL"))
+        overflow = bitfield_op::fail;
+      else
+        throw bitfield_error("ERR Invalid OVERFLOW type specified");
+      i += 2;
+      continue;
+    }
+
+    bitfield_op op{};
+    if (eq(args[i], "GET") && i + 2 < args.size())
+      op.kind = bitfield_op::get;
+    else if (eq(args[i], "SET") && i + 3 < args.size())
+      op.kind = bitfield_op::set;
+    else if (eq(args[i], "INCRBY") && i + 3 < args.size())
+      op.kind = bitfield_op::incrby;
+    else
+      throw bitfield_error("ERR syntax error");
+    std::tie(op.is_signed, op.width) = parse_bitfield_type(args[i + 1]);
+    op.offset = parse_bitfield_offset(args[i + 2], op.width);
+    if (op.kind != bitfield_op::get)
+      op.value = parse_int(args[i + 3]);
+    op.overflow = overflow;
+    result.push_back(op);
+    i += op.kind == bitfield_op::get ? 3 : 4;
+  }
+  return result;
+}
+
+// what value becomes once it's fit into op's field, unless op fails
+std::optional<std::int64_t> fit(const bitfield_op &op, __int128 value) {
+  const __int128 min =
+      op.is_signed ? -(__int128(1) << (op.width - 1)) : __int128(0);
+  const __int128 max =
+      op.is_signed ? (__int128(1) << (op.width - 1)) - 1
+                   : (__int128(1) << op.width) - 1;
+  if (value >= min && value <= max)
+    return std::int64_t(value);
+  switch (op.overflow) {
+  case bitfield_op::sat:
+    return std::int64_t(value < min ? min : max);
+  case bitfield_op::fail:
+    return {};
+  default: {
+    // two's complement truncation to the field's width
+    const auto mask = (__int128(1) << op.width) - 1;
+    auto wrapped = value & mask;
+    if (op.is_signed && wrapped > max)
+      wrapped -= mask + 1;
+    return std::int64_t(wrapped);
+  }
+  }
+}
+
+std::int64_t read_field(const bitfield_op &op, std::string_view bits) {
+  const auto raw = redis::bitmap::get_field(bits, op.offset, op.width);
+  if (!op.is_signed || op.width == 64 || !(raw >> (op.width - 1)))
+    return std::int64_t(raw);
+  return std::int64_t(raw | ~std::uint64_t() << op.width);
+}
+} // namespace
+
+void redis_cmd_bitfield(const redis::commands::args_t &args,
+                        redis::database &db,
+                        redis::resp::handler &output) try {
+  if (args.size() < 2)
+    return error(output, "ERR wrong number of arguments");
+  const auto ops = parse_bitfield(args);
+
+  // the key is only created, or an integer converted, if there's a write
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  redis::compact_string *bits = nullptr;
+  std::optional<redis::string_value> read_only;
+  if (std::ranges::any_of(ops, [](const bitfield_op &op) {
+        return op.kind != bitfield_op::get;
+      }))
+    bits = &db.get_or_create_raw_string(args[1], now);
+  else
+    read_only = db.get_string(args[1], now);
+  const auto view = [&] {
+    return bits        ? bits->view()
+           : read_only ? read_only->view()
+                       : std::string_view();
+  };
+
+  output.begin_array(ops.size());
+  for (const auto &op : ops) {
+    const auto old = read_field(op, view());
+    if (op.kind == bitfield_op::get) {
+      integer(output, old);
+      continue;
+    }
+    const auto value = fit(op, op.kind == bitfield_op::set
+                                   ? __int128(op.value)
+                                   : __int128(old) + op.value);
+    if (!value) {
+      nil_string(output);
+      continue;
+    }
+    redis::bitmap::set_field(*bits, op.offset, op.width,
+                             std::uint64_t(*value));
+    integer(output, op.kind == bitfield_op::set ? old : *value);
+  }
+  output.end_array();
+} catch (const bitfield_error &e) {
+  error(output, e.message());
+} catch (const not_an_int &) {
+  error(output, "ERR value is not an integer or out of range");
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+namespace {
+constexpr std::string_view not_a_hyperloglog =
+    "WRONGTYPE Key is not a valid HyperLogLog string value.";
+
+// raise registers to those of each of keys that exists, returning false if
+// one isn't a HyperLogLog
+bool merge_hyperloglogs(redis::hyperloglog::registers_t &registers,
+                        std::span<const std::string_view> keys,
+                        redis::database &db, redis::database::time_point now) {
+  for (const auto key : keys) {
+    const auto value = db.get_string(key, now);
+    if (!value)
+      continue;
+    if (!redis::hyperloglog::valid(value->view()))
+      return false;
+    redis::hyperloglog::merge(registers, value->view());
+  }
+  return true;
+}
+} // namespace
+
+void redis_cmd_pfadd(const redis::commands::args_t &args, redis::database &db,
+                     redis::resp::handler &output) {
+  if (args.size() < 2)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  auto [value, inserted] = db.upsert(args[1], now, redis::compact_string());
+  if (inserted)
+    value = redis::hyperloglog::create();
+  auto *const hll = std::get_if<redis::compact_string>(&value);
+  if (!hll && !std::holds_alternative<std::int64_t>(value))
+    return error(output, "WRONGTYPE key refers to object of the wrong type");
+  if (!hll || !redis::hyperloglog::valid(hll->view()))
+    return error(output, not_a_hyperloglog);
+
+  bool changed = inserted;
+  for (const auto element : std::span(args).subspan(2))
+    changed |= redis::hyperloglog::add(*hll, element);
+  integer(output, changed);
+}
+
+void redis_cmd_pfcount(const redis::commands::args_t &args,
+                       redis::database &db,
+                       redis::resp::handler &output) try {
+  if (args.size() < 2)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  if (args.size() == 2) {
+    // the count is cached in the counter, so it's found again to update it
+    const auto value = db.get_string(args[1], now);
+    if (!value)
+      return integer(output, 0);
+    if (!redis::hyperloglog::valid(value->view()))
+      return error(output, not_a_hyperloglog);
+    return integer(output, redis::hyperloglog::count(
+                               db.get_or_create_raw_string(args[1], now)));
+  }
+
+  // the count of the union, from registers merged with SIMD
+  redis::hyperloglog::registers_t registers{};
+  if (!merge_hyperloglogs(registers, std::span(args).subspan(1), db, now))
+    return error(output, not_a_hyperloglog);
+  integer(output, redis::hyperloglog::count(registers));
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_pfmerge(const redis::commands::args_t &args,
+                       redis::database &db,
+                       redis::resp::handler &output) try {
+  if (args.size() < 2)
+    return error(output, "ERR wrong number of arguments");
+
+  // the destination's own registers are merged too
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  redis::hyperloglog::registers_t registers{};
+  if (!merge_hyperloglogs(registers, std::span(args).subspan(1), db, now))
+    return error(output, not_a_hyperloglog);
+  db.get_or_create_raw_string(args[1], now) =
+      redis::hyperloglog::from_registers(registers);
+  simple_string(output, "OK");
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+namespace {
+constexpr std::string_view invalid_stream_id =
+    "ERR Invalid stream ID specified as stream command argument";
+
+// an ID as ms-seq, or as ms alone, meaning ms-missing_seq
+std::optional<redis::stream_id> parse_stream_id(std::string_view s,
+                                                std::uint64_t missing_seq) {
+  redis::stream_id result{0, missing_seq};
+  const auto dash = s.find('-');
+  const auto ms = s.substr(0, dash);
+  const auto parse = [](std::string_view digits, std::uint64_t &i) {
+    auto [ptr, ec] = std::from_chars(digits.begin(), digits.end(), i);
+    return ptr == digits.end() && ec == std::errc();
+  };
+  if (!parse(ms, result.ms))
+    return {};
+  if (dash != std::string_view::npos && !parse(s.substr(dash + 1), result.seq))
+    return {};
+  return result;
+}
+
+// the ID after id, if there is one
+std::optional<redis::stream_id> successor(redis::stream_id id) {
+  if (id == redis::stream_id::max())
+    return {};
+  return id.seq == redis::stream_id::max().seq
+             ? redis::stream_id{id.ms + 1, 0}
+             : redis::stream_id{id.ms, id.seq + 1};
+}
+
+// the ID before id, if there is one
+std::optional<redis::stream_id> predecessor(redis::stream_id id) {
+  if (id == redis::stream_id())
+    return {};
+  return id.seq ? redis::stream_id{id.ms, id.seq - 1}
+                : redis::stream_id{id.ms - 1, redis::stream_id::max().seq};
+}
+
+// the bound of an XRANGE, with - and + for the first and last IDs there can
+// be, and ( before an ID excluding it, returning false if s isn't one. That
+// leaves bound empty when it excludes the first or last ID there can be.
+bool parse_range_bound(std::string_view s, bool start,
+                       std::optional<redis::stream_id> &bound) {
+  if (s == "-" || s == "+") {
+    bound = s == "-" ? redis::stream_id() : redis::stream_id::max();
+    return true;
+  }
+  const bool exclusive = s.starts_with('(');
+  const auto id = parse_stream_id(s.substr(exclusive),
+                                  start ? 0 : redis::stream_id::max().seq);
+  if (!id)
+    return false;
+  bound = !exclusive ? id : start ? successor(*id) : predecessor(*id);
+  return true;
+}
+
+void bulk_stream_id(redis::resp::handler &output, redis::stream_id id) {
+  std::array<char, 2 * std::numeric_limits<std::uint64_t>::digits10 + 3> buf;
+  auto *end = std::to_chars(buf.begin(), buf.end(), id.ms).ptr;
+  *end++ = '-';
+  end = std::to_chars(end, buf.end(), id.seq).ptr;
+  bulk_string(output, std::string_view(buf.begin(), end));
+}
+
+// reply with up to count of the entries of stream from start to end, each as
+// its ID and its fields and values
+void reply_entries(redis::resp::handler &output,
+                   const redis::database::stream_t &stream,
+                   redis::stream_id start, redis::stream_id end, bool reverse,
+                   std::size_t count) {
+  // the reply's length comes first, so the entries are counted, and then
+  // found again; either way it's a binary search and a walk over the range
+  std::size_t size = 0;
+  if (count)
+    stream.visit(start, end, reverse,
+                 [&](auto, const auto &) { return ++size < count; });
+  output.begin_array(std::int64_t(size));
+  stream.visit(start, end, reverse,
+               [&](redis::stream_id id,
+                   const std::vector<std::string_view> &fields_and_values) {
+                 if (!size)
+                   return false;
+                 output.begin_array(2);
+                 bulk_stream_id(output, id);
+                 output.begin_array(std::int64_t(fields_and_values.size()));
+                 for (const auto s : fields_and_values)
+                   bulk_string(output, s);
+                 output.end_array();
+                 output.end_array();
+                 return --size > 0;
+               });
+  output.end_array();
+}
+
+void xrange(const redis::commands::args_t &args, redis::database &db,
+            redis::resp::handler &output, bool reverse) {
+  if (args.size() != 4 && args.size() != 6)
+    return error(output, "ERR wrong number of arguments");
+
+  auto count = std::numeric_limits<std::size_t>::max();
+  if (args.size() == 6) {
+    if (!redis::util::ci_equal()(args[4], "COUNT"))
+      return error(output, "ERR syntax error");
+    count = std::size_t(std::max<std::int64_t>(parse_int(args[5]), 0));
+  }
+  std::optional<redis::stream_id> start;
+  std::optional<redis::stream_id> end;
+  if (!parse_range_bound(args[reverse ? 3 : 2], true, start) ||
+      !parse_range_bound(args[reverse ? 2 : 3], false, end))
+    return error(output, invalid_stream_id);
+  // as in Redis, COUNT 0 is a null reply
+  if (!count) {
+    output.begin_array(-1);
+    output.end_array();
+    return;
+  }
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto stream = db.get_stream(args[1], now);
+  if (!stream || !start || !end) {
+    output.begin_array(0);
+    output.end_array();
+    return;
+  }
+  reply_entries(output, *stream, *start, *end, reverse, count);
+}
+} // namespace
+
+void redis_cmd_xadd(const redis::commands::args_t &args, redis::database &db,
+                    redis::resp::handler &output) try {
+  if (args.size() < 5)
+    return error(output, "ERR wrong number of arguments");
+
+  bool nomkstream = false;
+  std::optional<std::size_t> max_length;
+  bool approximate = false;
+  std::size_t i = 2;
+  for (; i < args.size(); ++i) {
+    if (redis::util::ci_equal()(args[i], "NOMKSTREAM")) {
+      nomkstream = true;
+    } else if (redis::util::ci_equal()(args[i], "MAXLEN") &&
+               i + 1 < args.size()) {
+      approximate = args[i + 1] == "~";
+      i += approximate || args[i + 1] == "=";
+      if (i + 1 == args.size())
+        return error(output, "ERR syntax error");
+      const auto n = parse_int(args[++i]);
+      if (n < 0)
+        return error(output, "ERR The MAXLEN argument must be >= 0.");
+      max_length = std::size_t(n);
+    } else {
+      break;
+    }
+  }
+  if (i + 3 > args.size() || (args.size() - i - 1) % 2)
+    return error(output, "ERR wrong number of arguments for 'xadd' command");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto existing = db.get_stream(args[1], now);
+  if (!existing && nomkstream)
+    return nil_string(output);
+  const auto last = existing ? existing->get().last_id() : redis::stream_id();
+
+  // * takes the time, or the last ID's if the clock has gone back, and ms-*
+  // the given time, with the next sequence number in that millisecond
+  redis::stream_id id;
+  const auto &spec = args[i];
+  if (spec == "*" || spec.ends_with("-*")) {
+    if (spec == "*") {
+      id.ms = std::max(std::uint64_t(now.time_since_epoch().count()), last.ms);
+    } else if (const auto ms = parse_stream_id(spec.substr(0, spec.size() - 2),
+                                               0)) {
+      id.ms = ms->ms;
+    } else {
+      return error(output, invalid_stream_id);
+    }
+    if (id.ms == last.ms) {
+      const auto next = successor(last);
+      if (!next)
+        return error(output, "ERR The stream has exhausted the last possible "
+                             "ID, unable to add more items");
+      id = *next;
+    }
+  } else if (const auto parsed = parse_stream_id(spec, 0)) {
+    id = *parsed;
+  } else {
+    return error(output, invalid_stream_id);
+  }
+  if (id == redis::stream_id())
+    return error(output,
+                 "ERR The ID specified in XADD must be greater than 0-0");
+  if (id <= last)
+    return error(output, "ERR The ID specified in XADD is equal or smaller "
+                         "than the target stream top item");
+
+  auto &stream =
+      existing ? existing->get() : db.get_or_create_stream(args[1], now);
+  stream.append(id, std::span(args).subspan(i + 1));
+  if (max_length)
+    stream.trim(*max_length, approximate);
+  bulk_stream_id(output, id);
+} catch (const not_an_int &) {
+  error(output, "ERR value is not an integer or out of range");
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_xlen(const redis::commands::args_t &args, redis::database &db,
+                    redis::resp::handler &output) try {
+  if (args.size() != 2)
+    return error(output, "ERR wrong number of arguments");
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  const auto stream = db.get_stream(args[1], now);
+  integer(output, stream ? stream->get().size() : 0);
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_xrange(const redis::commands::args_t &args, redis::database &db,
+                      redis::resp::handler &output) try {
+  xrange(args, db, output, false);
+} catch (const not_an_int &) {
+  error(output, "ERR value is not an integer or out of range");
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_xrevrange(const redis::commands::args_t &args,
+                         redis::database &db,
+                         redis::resp::handler &output) try {
+  xrange(args, db, output, true);
+} catch (const not_an_int &) {
+  error(output, "ERR value is not an integer or out of range");
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_xread(const redis::commands::args_t &args, redis::database &db,
+                     redis::resp::handler &output) try {
+  auto count = std::numeric_limits<std::size_t>::max();
+  std::size_t i = 1;
+  for (; i < args.size(); ++i) {
+    if (redis::util::ci_equal()(args[i], "STREAMS"))
+      break;
+    if (redis::util::ci_equal()(args[i], "COUNT") && i + 1 < args.size()) {
+      // as in Redis, COUNT 0 means no limit
+      if (const auto n = parse_int(args[++i]); n > 0)
+        count = std::size_t(n);
+    } else if (redis::util::ci_equal()(args[i], "BLOCK")) {
+      // a shard's reactor can't be held up waiting
+      return error(output, "ERR XREAD BLOCK is not supported");
+    } else {
+      return error(output, "ERR syntax error");
+    }
+  }
+  const auto streams = args.size() - std::min(i + 1, args.size());
+  if (!streams || streams % 2)
+    return error(output,
+                 "ERR Unbalanced 'xread' list of streams: for each stream key "
+                 "an ID or '$' must be specified.");
+
+  const auto keys = std::span(args).subspan(i + 1, streams / 2);
+  const auto ids = std::span(args).subspan(i + 1 + streams / 2);
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  // the entries after each ID, with $ for the stream's last
+  std::vector<std::optional<redis::stream_id>> starts;
+  for (std::size_t j = 0; j < keys.size(); ++j) {
+    const auto stream = db.get_stream(keys[j], now);
+    std::optional<redis::stream_id> id;
+    if (ids[j] == "$")
+      id = stream ? stream->get().last_id() : redis::stream_id();
+    else if (!(id = parse_stream_id(ids[j], 0)))
+      return error(output, invalid_stream_id);
+    starts.push_back(successor(*id));
+  }
+
+  const auto has_entries = [&](std::size_t j) {
+    const auto stream = db.get_stream(keys[j], now);
+    bool result = false;
+    if (stream && starts[j])
+      stream->get().visit(*starts[j], redis::stream_id::max(), false,
+                          [&](auto, const auto &) { return !(result = true); });
+    return result;
+  };
+  std::size_t size = 0;
+  for (std::size_t j = 0; j < keys.size(); ++j)
+    size += has_entries(j);
+  if (!size) {
+    output.begin_array(-1);
+    output.end_array();
+    return;
+  }
+
+  output.begin_array(std::int64_t(size));
+  for (std::size_t j = 0; j < keys.size(); ++j) {
+    if (!has_entries(j))
+      continue;
+    output.begin_array(2);
+    bulk_string(output, keys[j]);
+    reply_entries(output, *db.get_stream(keys[j], now), *starts[j],
+                  redis::stream_id::max(), false, count);
+    output.end_array();
+  }
+} catch (const not_an_int &) {
+  error(output, "ERR value is not an integer or out of range");
+} catch (const wrong_type &) {
+  error(output, "WRONGTYPE key refers to object of the wrong type");
+}
+
+void redis_cmd_save(const redis::commands::args_t &args, redis::database &db,
+                    redis::resp::handler &output) {
+  if (args.size() != 1)
+    return error(output, "ERR wrong number of arguments");
+
+  try {
+    auto file = db.state_ostream();
+    redis::snapshot::save(db, *file);
+    if (!file->flush())
+      return error(output, "ERR failed to save db state");
+    return simple_string(output, "OK");
+  } catch (const std::exception &) {
+    return error(output, "ERR failed to save db state");
+  }
+}
+
+void redis_cmd_load(const redis::commands::args_t &args, redis::database &db,
+                    redis::resp::handler &output) {
+  if (args.size() != 1)
+    return error(output, "ERR wrong number of arguments");
+
+  // a file that's mapped is loaded in place, and anything else read in first
+  auto stream = db.state_istream();
+  std::string read;
+  std::span<const char> bytes;
+  if (const auto *mapped =
+          dynamic_cast<const redis::io::mapped_streambuf *>(stream->rdbuf()))
+    bytes = mapped->bytes();
+  else
+    bytes = read.assign(std::istreambuf_iterator<char>(*stream), {});
+  db.clear();
+
+  if (redis::snapshot::is_snapshot(bytes)) {
+    try {
+      redis::snapshot::load(bytes, db);
+    } catch (const redis::snapshot::corrupt &e) {
+      db.clear();
+      return error(output, std::string("ERR ") + e.what());
+    }
+    return simple_string(output, "OK");
+  }
+
+  // an append only file, or state saved before snapshots, as commands. The
+  // clock is stopped at the epoch while they're replayed, so that no key
+  // expires part way through commands that were run while it was live, and
+  // keys are only expired once it's done.
+  redis::resp::null_handler null_handler;
+  redis::command_handler command_handler(db, null_handler);
+  redis::resp::basic_parser<redis::command_handler> parser(command_handler);
+  db.stop_clock(redis::database::now_t());
+  try {
+    parser.parse(bytes.data(), bytes.data() + bytes.size());
+  } catch (...) {
+    db.stop_clock({});
+    throw;
+  }
+  db.stop_clock({});
   simple_string(output, "OK");
 }
@@ -22,20 +22,130 @@ void redis_cmd_get(const redis::commands::args_t &, redis::database &,
                    redis::resp::handler &);
 void redis_cmd_set(const redis::commands::args_t &, redis::database &,
                    redis::resp::handler &);
+void redis_cmd_mget(const redis::commands::args_t &, redis::database &,
+                    redis::resp::handler &);
+void redis_cmd_mset(const redis::commands::args_t &, redis::database &,
+                    redis::resp::handler &);
+void redis_cmd_msetnx(const redis::commands::args_t &, redis::database &,
+                      redis::resp::handler &);
 void redis_cmd_del(const redis::commands::args_t &, redis::database &,
                    redis::resp::handler &);
 void redis_cmd_exists(const redis::commands::args_t &, redis::database &,
                       redis::resp::handler &);
+void redis_cmd_expire(const redis::commands::args_t &, redis::database &,
+                      redis::resp::handler &);
+void redis_cmd_pexpire(const redis::commands::args_t &, redis::database &,
+                       redis::resp::handler &);
+void redis_cmd_expireat(const redis::commands::args_t &, redis::database &,
+                        redis::resp::handler &);
+void redis_cmd_pexpireat(const redis::commands::args_t &, redis::database &,
+                         redis::resp::handler &);
+void redis_cmd_ttl(const redis::commands::args_t &, redis::database &,
+                   redis::resp::handler &);
+void redis_cmd_pttl(const redis::commands::args_t &, redis::database &,
+                    redis::resp::handler &);
+void redis_cmd_persist(const redis::commands::args_t &, redis::database &,
+                       redis::resp::handler &);
 void redis_cmd_incr(const redis::commands::args_t &, redis::database &,
                     redis::resp::handler &);
 void redis_cmd_decr(const redis::commands::args_t &, redis::database &,
                     redis::resp::handler &);
+void redis_cmd_incrby(const redis::commands::args_t &, redis::database &,
+                      redis::resp::handler &);
+void redis_cmd_decrby(const redis::commands::args_t &, redis::database &,
+                      redis::resp::handler &);
+void redis_cmd_incrbyfloat(const redis::commands::args_t &, redis::database &,
+                           redis::resp::handler &);
 void redis_cmd_rpush(const redis::commands::args_t &, redis::database &,
                      redis::resp::handler &);
 void redis_cmd_lpush(const redis::commands::args_t &, redis::database &,
                      redis::resp::handler &);
 void redis_cmd_lrange(const redis::commands::args_t &, redis::database &,
                       redis::resp::handler &);
+void redis_cmd_hset(const redis::commands::args_t &, redis::database &,
+                    redis::resp::handler &);
+void redis_cmd_hget(const redis::commands::args_t &, redis::database &,
+                    redis::resp::handler &);
+void redis_cmd_hmget(const redis::commands::args_t &, redis::database &,
+                     redis::resp::handler &);
+void redis_cmd_hdel(const redis::commands::args_t &, redis::database &,
+                    redis::resp::handler &);
+void redis_cmd_hlen(const redis::commands::args_t &, redis::database &,
+                    redis::resp::handler &);
+void redis_cmd_hgetall(const redis::commands::args_t &, redis::database &,
+                       redis::resp::handler &);
+void redis_cmd_hincrby(const redis::commands::args_t &, redis::database &,
+                       redis::resp::handler &);
+void redis_cmd_hscan(const redis::commands::args_t &, redis::database &,
+                     redis::resp::handler &);
+void redis_cmd_sadd(const redis::commands::args_t &, redis::database &,
+                    redis::resp::handler &);
+void redis_cmd_srem(const redis::commands::args_t &, redis::database &,
+                    redis::resp::handler &);
+void redis_cmd_sismember(const redis::commands::args_t &, redis::database &,
+                         redis::resp::handler &);
+void redis_cmd_smembers(const redis::commands::args_t &, redis::database &,
+                        redis::resp::handler &);
+void redis_cmd_scard(const redis::commands::args_t &, redis::database &,
+                     redis::resp::handler &);
+void redis_cmd_sinter(const redis::commands::args_t &, redis::database &,
+                      redis::resp::handler &);
+void redis_cmd_sunion(const redis::commands::args_t &, redis::database &,
+                      redis::resp::handler &);
+void redis_cmd_sdiff(const redis::commands::args_t &, redis::database &,
+                     redis::resp::handler &);
+void redis_cmd_sinterstore(const redis::commands::args_t &, redis::database &,
+                           redis::resp::handler &);
+void redis_cmd_sunionstore(const redis::commands::args_t &, redis::database &,
+                           redis::resp::handler &);
+void redis_cmd_sdiffstore(const redis::commands::args_t &, redis::database &,
+                          redis::resp::handler &);
+void redis_cmd_zadd(const redis::commands::args_t &, redis::database &,
+                    redis::resp::handler &);
+void redis_cmd_zrem(const redis::commands::args_t &, redis::database &,
+                    redis::resp::handler &);
+void redis_cmd_zscore(const redis::commands::args_t &, redis::database &,
+                      redis::resp::handler &);
+void redis_cmd_zrank(const redis::commands::args_t &, redis::database &,
+                     redis::resp::handler &);
+void redis_cmd_zcard(const redis::commands::args_t &, redis::database &,
+                     redis::resp::handler &);
+void redis_cmd_zincrby(const redis::commands::args_t &, redis::database &,
+                       redis::resp::handler &);
+void redis_cmd_zcount(const redis::commands::args_t &, redis::database &,
+                      redis::resp::handler &);
+void redis_cmd_zrange(const redis::commands::args_t &, redis::database &,
+                      redis::resp::handler &);
+void redis_cmd_zrangebyscore(const redis::commands::args_t &, redis::database &,
+                             redis::resp::handler &);
+void redis_cmd_setbit(const redis::commands::args_t &, redis::database &,
+                      redis::resp::handler &);
+void redis_cmd_getbit(const redis::commands::args_t &, redis::database &,
+                      redis::resp::handler &);
+void redis_cmd_bitcount(const redis::commands::args_t &, redis::database &,
+                        redis::resp::handler &);
+void redis_cmd_bitpos(const redis::commands::args_t &, redis::database &,
+                      redis::resp::handler &);
+void redis_cmd_bitop(const redis::commands::args_t &, redis::database &,
+                     redis::resp::handler &);
+void redis_cmd_bitfield(const redis::commands::args_t &, redis::database &,
+                        redis::resp::handler &);
+void redis_cmd_pfadd(const redis::commands::args_t &, redis::database &,
+                     redis::resp::handler &);
+void redis_cmd_pfcount(const redis::commands::args_t &, redis::database &,
+                       redis::resp::handler &);
+void redis_cmd_pfmerge(const redis::commands::args_t &, redis::database &,
+                       redis::resp::handler &);
+void redis_cmd_xadd(const redis::commands::args_t &, redis::database &,
+                    redis::resp::handler &);
+void redis_cmd_xlen(const redis::commands::args_t &, redis::database &,
+                    redis::resp::handler &);
+void redis_cmd_xrange(const redis::commands::args_t &, redis::database &,
+                      redis::resp::handler &);
+void redis_cmd_xrevrange(const redis::commands::args_t &, redis::database &,
+                         redis::resp::handler &);
+void redis_cmd_xread(const redis::commands::args_t &, redis::database &,
+                     redis::resp::handler &);
 void redis_cmd_save(const redis::commands::args_t &, redis::database &,
                     redis::resp::handler &);
 void redis_cmd_load(const redis::commands::args_t &, redis::database &,
@@ -0,0 +1,92 @@
+#include "compact_string.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+redis::compact_string::compact_string(compact_string &&other) noexcept {
+  std::memcpy(bytes_, other.bytes_, sizeof(bytes_));
+  std::memset(other.bytes_, 0, sizeof(other.bytes_));
+}
+
+redis::compact_string &
+redis::compact_string::operator=(compact_string &&other) noexcept {
+  if (this != &other) {
+    release();
+    std::memcpy(bytes_, other.bytes_, sizeof(bytes_));
+    std::memset(other.bytes_, 0, sizeof(other.bytes_));
+  }
+  return *this;
+}
+
+redis::compact_string &redis::compact_string::assign(std::string_view s) {
+  if (s.size() <= max_inline) {
+    // s may be this string's own heap characters
+    char buf[max_inline];
+    std::memcpy(buf, s.data(), s.size());
+    release();
+    std::memcpy(bytes_, buf, s.size());
+    bytes_[max_inline] = static_cast<char>(s.size());
+    return *this;
+  }
+
+  if (s.size() > size_mask)
+    throw std::length_error("string too long");
+  if (!is_inline() && capacity(size()) == capacity(s.size())) {
+    std::memmove(heap_data(), s.data(), s.size());
+    set_heap(heap_data(), s.size());
+    return *this;
+  }
+
+  char *const data = new char[capacity(s.size())];
+  std::memcpy(data, s.data(), s.size());
+  release();
+  set_heap(data, s.size());
+  return *this;
+}
+
+void redis::compact_string::resize(std::size_t size) {
+  const auto old_size = this->size();
+  if (size <= max_inline) {
+    char buf[max_inline]{};
+    std::memcpy(buf, data(), std::min(size, old_size));
+    assign({buf, size});
+    return;
+  }
+  if (!is_inline() && capacity(old_size) == capacity(size)) {
+    if (size > old_size)
+      std::memset(heap_data() + old_size, 0, size - old_size);
+    set_heap(heap_data(), size);
+    return;
+  }
+
+  if (size > size_mask)
+    throw std::length_error("string too long");
+  char *const data = new char[capacity(size)];
+  const auto kept = std::min(size, old_size);
+  std::memcpy(data, this->data(), kept);
+  std::memset(data + kept, 0, size - kept);
+  release();
+  set_heap(data, size);
+}
+
+std::size_t redis::compact_string::capacity(std::size_t size) noexcept {
+  constexpr std::size_t exact = 4096;
+  if (size <= exact)
+    return size;
+  // an eighth of the power of two below size
+  const std::size_t step = std::bit_floor(size - 1) >> 3;
+  return (size + step - 1) & ~(step - 1);
+}
+
+void redis::compact_string::set_heap(char *data, std::size_t size) noexcept {
+  const std::uint64_t word =
+      std::uint64_t(size) | std::uint64_t(heap_flag) << 56;
+  std::memcpy(bytes_, &data, sizeof(data));
+  std::memcpy(bytes_ + 8, &word, sizeof(word));
+}
+
+void redis::compact_string::release() noexcept {
+  if (!is_inline())
+    delete[] heap_data();
+  std::memset(bytes_, 0, sizeof(bytes_));
+}
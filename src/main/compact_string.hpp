@@ -0,0 +1,118 @@
+#ifndef REDIS_SERVER_COMPACT_STRING_HPP
+#define REDIS_SERVER_COMPACT_STRING_HPP
+
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace redis {
+
+/**
+ * A string in 16 bytes: up to 15 characters inline, followed by their count,
+ * or a pointer to characters on the heap, followed by their count in the low
+ * 7 bytes of a word whose top byte flags it as such. Unlike std::string it
+ * keeps no terminating null, and no spare capacity short of a few KB; past
+ * that its characters take the next of eight steps to each power of two, so
+ * that one grown a little at a time, as a bitmap is by SETBIT, is copied a
+ * logarithmic number of times.
+ */
+class compact_string {
+public:
+  // the longest string kept inline
+  static constexpr std::size_t max_inline = 15;
+
+  compact_string() noexcept : bytes_() {}
+
+  explicit compact_string(std::string_view s) : bytes_() { assign(s); }
+
+  compact_string(const compact_string &other) : compact_string(other.view()) {}
+
+  compact_string(compact_string &&other) noexcept;
+
+  compact_string &operator=(const compact_string &other) {
+    return assign(other.view());
+  }
+
+  compact_string &operator=(compact_string &&other) noexcept;
+
+  ~compact_string() noexcept { release(); }
+
+  compact_string &assign(std::string_view s);
+
+  /**
+   * Shorten it, or lengthen it with zeros.
+   * @param size
+   */
+  void resize(std::size_t size);
+
+  [[nodiscard]] bool is_inline() const noexcept {
+    return !(tag() & heap_flag);
+  }
+
+  [[nodiscard]] std::size_t size() const noexcept {
+    return is_inline() ? tag() : std::size_t(word() & size_mask);
+  }
+
+  [[nodiscard]] bool empty() const noexcept { return !size(); }
+
+  [[nodiscard]] const char *data() const noexcept {
+    return is_inline() ? bytes_ : heap_data();
+  }
+
+  [[nodiscard]] char *data() noexcept {
+    return is_inline() ? bytes_ : heap_data();
+  }
+
+  [[nodiscard]] std::string_view view() const noexcept {
+    return {data(), size()};
+  }
+
+  operator std::string_view() const noexcept { return view(); }
+
+  friend bool operator==(const compact_string &lhs,
+                         const compact_string &rhs) noexcept {
+    return lhs.view() == rhs.view();
+  }
+
+  friend bool operator==(const compact_string &lhs,
+                         std::string_view rhs) noexcept {
+    return lhs.view() == rhs;
+  }
+
+private:
+  static_assert(std::endian::native == std::endian::little,
+                "the tag has to be the top byte of the size word");
+
+  static constexpr unsigned char heap_flag = 0x80;
+  static constexpr std::uint64_t size_mask = (std::uint64_t(1) << 56) - 1;
+
+  [[nodiscard]] unsigned char tag() const noexcept {
+    return static_cast<unsigned char>(bytes_[max_inline]);
+  }
+
+  [[nodiscard]] std::uint64_t word() const noexcept {
+    std::uint64_t result;
+    std::memcpy(&result, bytes_ + 8, sizeof(result));
+    return result;
+  }
+
+  [[nodiscard]] char *heap_data() const noexcept {
+    char *result;
+    std::memcpy(&result, bytes_, sizeof(result));
+    return result;
+  }
+
+  // how many bytes are allocated for size characters on the heap
+  static std::size_t capacity(std::size_t size) noexcept;
+
+  void set_heap(char *data, std::size_t size) noexcept;
+
+  void release() noexcept;
+
+  alignas(8) char bytes_[16];
+};
+
+} // namespace redis
+
+#endif // REDIS_SERVER_COMPACT_STRING_HPP
@@ -1,72 +1,430 @@
 #include "database.hpp"
 
-using redis::util::overloaded;
+#include <algorithm>
+
+namespace {
+
+using time_point = redis::database::time_point;
+
+// how many keys are sampled for each one evicted
+constexpr std::size_t eviction_samples = 5;
+// evicted by one call to evict(), in case it isn't keys that are using memory
+constexpr std::size_t max_evictions = 128;
+
+// the LRU clock is in seconds and wraps after 24 bits, as in Redis
+constexpr std::uint32_t lru_mask = (1 << 24) - 1;
+
+std::uint32_t lru_clock(time_point now) {
+  return std::uint32_t(now.time_since_epoch() / std::chrono::seconds(1)) &
+         lru_mask;
+}
+
+// the LFU counter is a logarithmic 8 bit count below the time in minutes,
+// wrapping after 16 bits, when it last decayed, as in Redis
+constexpr std::uint32_t lfu_initial = 5;
+constexpr std::uint32_t lfu_log_factor = 10;
+
+std::uint32_t lfu_minutes(time_point now) {
+  return std::uint32_t(now.time_since_epoch() / std::chrono::minutes(1)) &
+         0xffff;
+}
+
+// the counter once it's lost one for every minute since it last decayed
+std::uint32_t lfu_decayed(std::uint32_t access, time_point now) {
+  const auto elapsed = (lfu_minutes(now) - (access >> 8)) & 0xffff;
+  const auto counter = access & 0xff;
+  return elapsed > counter ? 0 : counter - elapsed;
+}
+
+std::uint64_t xorshift(std::uint64_t &state) {
+  state ^= state << 13;
+  state ^= state >> 7;
+  state ^= state << 17;
+  return state;
+}
+
+} // namespace
 
 redis::database::database(
     std::function<now_t()> now,
     std::function<std::unique_ptr<std::istream>()> state_istream,
     std::function<std::unique_ptr<std::ostream>()> state_ostream)
-    : now_(std::move(now)), state_istream_(std::move(state_istream)), state_ostream_(std::move(state_ostream)) {
+    : now_(std::move(now)),
+      expiry_index_(
+          std::chrono::time_point_cast<std::chrono::milliseconds>(now_())),
+      state_istream_(std::move(state_istream)), state_ostream_(std::move(state_ostream)) {
   map_.reserve(1 << 20);
 }
 
-std::optional<std::reference_wrapper<std::string>>
+std::optional<redis::string_value>
 redis::database::get_string(std::string_view key, time_point now) {
-  if (const auto pos = map_.find(key); pos != map_.end()) {
-    return std::visit(
-        overloaded{
-            [&](string_with_expiry_t &x)
-                -> std::optional<std::reference_wrapper<std::string>> {
-              auto &[value, opt_expiry] = x;
-              if (opt_expiry) {
-                if (now < *opt_expiry) {
-                  return std::ref(value);
-                } else {
-                  map_.erase(pos);
-                  return {};
-                }
-              } else {
-                return std::ref(value);
-              }
-            },
-            [](auto &) -> std::optional<std::reference_wrapper<std::string>> {
-              throw wrong_type();
-            }},
-        pos->second);
+  if (const auto pos = find(key, now); pos != map_.end()) {
+    if (auto result = as_string(pos->second.value))
+      return result;
+    throw wrong_type();
   }
   return {};
 }
 
-std::string &redis::database::set(std::string_view key, std::string_view value,
-                                  std::optional<time_point> expiry) {
-  if (auto pos = map_.find(key); pos == map_.end()) {
-    return std::get<0>(std::get<string_with_expiry_t>(
-        map_.emplace(
-                std::piecewise_construct, std::forward_as_tuple(key),
-                std::forward_as_tuple(std::in_place_type<string_with_expiry_t>,
-                                      value, expiry))
-            .first->second));
+redis::compact_string &
+redis::database::get_or_create_raw_string(std::string_view key,
+                                          time_point now) {
+  auto &value = upsert(key, now, compact_string()).first;
+  if (const auto *i = std::get_if<std::int64_t>(&value))
+    value = compact_string(string_value(*i).view());
+  if (auto *result = std::get_if<compact_string>(&value))
+    return *result;
+  throw wrong_type();
+}
+
+void redis::database::set(std::string_view key, std::string_view value,
+                          std::optional<time_point> expiry) {
+  auto pos = map_.find(key);
+  auto &entry = pos == map_.end() ? emplace(key, {}) : pos->second;
+  if (pos != map_.end())
+    touch(entry);
+  entry.value = make_string(value);
+  set_expiry(key, entry, expiry.value_or(never));
+}
+
+std::pair<redis::database::value_t &, bool>
+redis::database::upsert(std::string_view key, time_point now, value_t value) {
+  clock_ = now;
+  auto [pos, inserted] = map_.try_emplace(key, std::move(value));
+  auto &entry = pos->second;
+  if (inserted) {
+    admit(entry);
+  } else if (expired(key, entry, now)) {
+    // as good as erased and inserted again, without hashing the key again;
+    // value wasn't moved from, as nothing was inserted
+    set_expiry(key, entry, never);
+    ++expired_keys_;
+    entry.value = std::move(value);
+    admit(entry);
+    inserted = true;
   } else {
-    pos->second = string_with_expiry_t(value, expiry);
-    return std::get<0>(std::get<string_with_expiry_t>(pos->second));
+    touch(entry);
+  }
+  return {entry.value, inserted};
+}
+
+bool redis::database::restore(std::string_view key, value_t value,
+                              time_point expiry) {
+  auto [pos, inserted] = map_.try_emplace(key, std::move(value));
+  if (!inserted)
+    return false;
+  admit(pos->second);
+  set_expiry(key, pos->second, expiry);
+  return true;
+}
+
+void redis::database::reserve(std::size_t count) { map_.reserve(count); }
+
+redis::database::value_t redis::database::make_string(std::string_view s) {
+  if (const auto i = string_value::parse_integer(s))
+    return *i;
+  return value_t(std::in_place_type<compact_string>, s);
+}
+
+std::optional<redis::string_value>
+redis::database::as_string(const value_t &value) {
+  if (const auto *s = std::get_if<compact_string>(&value))
+    return string_value(s->view());
+  if (const auto *i = std::get_if<std::int64_t>(&value))
+    return string_value(*i);
+  return {};
+}
+
+void redis::database::set_strings(
+    std::span<const std::string_view> keys_and_values) {
+  find_all(keys_and_values, 2);
+  // inserting invalidates found_, so look each key up again now it's in cache
+  for (std::size_t i = 0; i < hashed_.size(); ++i) {
+    const auto value = keys_and_values[2 * i + 1];
+    if (const auto pos = map_.find(hashed_[i]); pos != map_.end()) {
+      touch(pos->second);
+      pos->second.value = make_string(value);
+      set_expiry(hashed_[i].key, pos->second, never);
+    } else {
+      emplace(hashed_[i].key, make_string(value));
+    }
+  }
+}
+
+bool redis::database::set_strings_nx(
+    std::span<const std::string_view> keys_and_values, time_point now) {
+  find_all(keys_and_values, 2);
+  for (std::size_t i = 0; i < found_.size(); ++i) {
+    if (found_[i] && !expired(hashed_[i].key, *found_[i], now))
+      return false;
+  }
+  set_strings(keys_and_values);
+  return true;
+}
+
+void redis::database::find_all(std::span<const std::string_view> keys,
+                               std::size_t step) {
+  hashed_.clear();
+  for (std::size_t i = 0; i < keys.size(); i += step)
+    hashed_.emplace_back(keys[i]);
+
+  // none of these depend on another, so their misses overlap
+  found_.clear();
+  for (const auto &key : hashed_) {
+    const auto pos = map_.find(key);
+    found_.push_back(pos == map_.end() ? nullptr : &pos->second);
   }
 }
 
 bool redis::database::del(std::string_view key, const time_point now) {
-  if (const auto pos = map_.find(key); pos != map_.end()) {
-    const auto expired =
-        std::visit(overloaded{[&](string_with_expiry_t &x) -> bool {
-                                auto &[value, opt_expiry] = x;
-                                return opt_expiry && *opt_expiry < now;
-                              },
-                              [](auto &) -> bool { return false; }},
-                   pos->second);
-    map_.erase(pos);
-    return !expired;
+  if (const auto pos = find(key, now); pos != map_.end()) {
+    erase(pos);
+    return true;
   }
   return false;
 }
 
+bool redis::database::exists(std::string_view key, time_point now) {
+  // find() first, as it can move end()
+  const auto pos = find(key, now);
+  return pos != map_.end();
+}
+
+bool redis::database::expire(std::string_view key, time_point expiry,
+                             time_point now) {
+  const auto pos = find(key, now);
+  if (pos == map_.end())
+    return false;
+  if (now < expiry)
+    set_expiry(key, pos->second, expiry);
+  else
+    erase(pos);
+  return true;
+}
+
+std::optional<redis::database::time_point>
+redis::database::expiry(std::string_view key, time_point now) {
+  if (const auto pos = find(key, now); pos != map_.end())
+    return expiry_of(key, pos->second);
+  return {};
+}
+
+bool redis::database::active_expire(time_point now,
+                                    std::chrono::microseconds budget) {
+  const auto start = std::chrono::steady_clock::now();
+  std::size_t visited = 0;
+
+  return expiry_index_.expire(now, [&](time_point deadline,
+                                        compact_string key) {
+    // the index entry is stale if the key has lost its expiry or been
+    // indexed again since
+    const auto pos = map_.find(key);
+    auto *const expiry = pos != map_.end() && pos->second.expires
+                             ? &expires_.find(key)->second
+                             : nullptr;
+    if (expiry && expiry->indexed == deadline) {
+      if (!(now < expiry->expiry)) {
+        erase_expired(pos);
+      } else {
+        // its expiry has been put back since it was indexed
+        expiry->indexed = expiry->expiry;
+        expiry_index_.insert(expiry->expiry, std::move(key));
+      }
+    }
+    // reading the clock costs more than expiring a key
+    return ++visited % 32 || std::chrono::steady_clock::now() - start < budget;
+  });
+}
+
+redis::database::map_t::iterator redis::database::find(std::string_view key,
+                                                       time_point now) {
+  clock_ = now;
+  const auto pos = map_.find(key);
+  if (pos == map_.end())
+    return pos;
+  if (expired(key, pos->second, now)) {
+    erase_expired(pos);
+    return map_.end();
+  }
+  touch(pos->second);
+  return pos;
+}
+
+redis::database::entry &redis::database::emplace(std::string_view key,
+                                                 value_t value) {
+  auto &result = map_
+                     .emplace(std::piecewise_construct,
+                              std::forward_as_tuple(key),
+                              std::forward_as_tuple(std::move(value)))
+                     .first->second;
+  admit(result);
+  return result;
+}
+
+void redis::database::set_expiry(std::string_view key, entry &entry,
+                                 time_point expiry) {
+  if (expiry == never) {
+    // its index entry, if any, is left to go stale
+    if (entry.expires)
+      expires_.erase(key);
+    entry.expires = false;
+    return;
+  }
+
+  auto &result = entry.expires
+                     ? expires_.find(key)->second
+                     : expires_
+                           .emplace(std::piecewise_construct,
+                                    std::forward_as_tuple(key),
+                                    std::forward_as_tuple())
+                           .first->second;
+  entry.expires = true;
+  result.expiry = expiry;
+  // otherwise the key's earlier index entry will find it and index it again
+  if (expiry < result.indexed) {
+    result.indexed = expiry;
+    expiry_index_.insert(expiry, compact_string(key));
+  }
+}
+
+void redis::database::erase(map_t::iterator pos) {
+  if (pos->second.expires)
+    expires_.erase(pos->first);
+  map_.erase(pos);
+}
+
+void redis::database::erase_expired(map_t::iterator pos) {
+  erase(pos);
+  ++expired_keys_;
+}
+
+void redis::database::touch(entry &entry) {
+  switch (policy_) {
+  case eviction_policy::allkeys_lru:
+    entry.access = lru_clock(clock_);
+    break;
+  case eviction_policy::allkeys_lfu: {
+    auto counter = lfu_decayed(entry.access, clock_);
+    // the higher it is, the less likely it is to go up
+    const auto base = counter > lfu_initial ? counter - lfu_initial : 0;
+    const double p = 1.0 / (base * lfu_log_factor + 1);
+    if (counter < 255 &&
+        double(xorshift(random_) >> 11) * 0x1p-53 < p)
+      ++counter;
+    entry.access = lfu_minutes(clock_) << 8 | counter;
+  } break;
+  default:
+    break;
+  }
+}
+
+void redis::database::admit(entry &entry) {
+  // counted as a few accesses, so that it isn't the first to go
+  if (policy_ == eviction_policy::allkeys_lfu)
+    entry.access = lfu_minutes(clock_) << 8 | lfu_initial;
+  else
+    entry.access = lru_clock(clock_);
+}
+
+void redis::database::limit_memory(
+    std::uint64_t maxmemory, eviction_policy policy,
+    std::function<std::uint64_t()> used_memory) {
+  maxmemory_ = maxmemory;
+  policy_ = policy;
+  used_memory_ = std::move(used_memory);
+}
+
+std::uint64_t redis::database::used_memory() const {
+  if (used_memory_)
+    return used_memory_();
+  // room the map has already allocated for more keys isn't going to run out
+  const auto &values = map_.values();
+  const auto spare =
+      (values.capacity() - values.size()) * sizeof(map_t::value_type);
+  const auto allocated = memory::allocated();
+  return allocated > spare ? allocated - spare : 0;
+}
+
+bool redis::database::evict() {
+  if (!maxmemory_)
+    return true;
+  // it's called ahead of writes, which don't otherwise know the time
+  clock_ = std::chrono::time_point_cast<std::chrono::milliseconds>(now());
+  if (used_memory() <= maxmemory_)
+    return true;
+  if (policy_ == eviction_policy::noeviction)
+    return false;
+
+  for (std::size_t evicted = 0; evicted < max_evictions; ++evicted) {
+    const auto victim = sample_victim();
+    if (victim == map_.end())
+      return false;
+    if (evicted_)
+      evicted_(victim->first.view());
+    erase(victim);
+    ++evicted_keys_;
+    if (used_memory() <= maxmemory_)
+      return true;
+  }
+  return true;
+}
+
+redis::database::map_t::iterator redis::database::sample_victim() {
+  // the maps keep their entries in a vector, so they can be picked directly
+  const auto sample = [this](auto &map) {
+    return map.begin() + std::ptrdiff_t(xorshift(random_) % map.size());
+  };
+
+  if (policy_ == eviction_policy::volatile_ttl) {
+    if (expires_.empty())
+      return map_.end();
+    auto victim = sample(expires_);
+    for (std::size_t i = 1; i < eviction_samples; ++i) {
+      const auto pos = sample(expires_);
+      if (pos->second.expiry < victim->second.expiry)
+        victim = pos;
+    }
+    return map_.find(victim->first);
+  }
+
+  if (map_.empty())
+    return map_.end();
+  auto victim = map_.end();
+  std::uint32_t best{};
+  for (std::size_t i = 0; i < eviction_samples; ++i) {
+    const auto pos = sample(map_);
+    const auto &entry = pos->second;
+
+    // the higher the better a victim
+    std::uint32_t score;
+    switch (policy_) {
+    case eviction_policy::allkeys_lru:
+      score = (lru_clock(clock_) - entry.access) & lru_mask;
+      break;
+    case eviction_policy::allkeys_lfu:
+      score = 255 - lfu_decayed(entry.access, clock_);
+      break;
+    default:
+      return map_.end();
+    }
+
+    if (!i || score > best) {
+      victim = pos;
+      best = score;
+    }
+  }
+  return victim;
+}
+
+void redis::database::prefetch(std::string_view key) const {
+  if (const auto pos = map_.find(key); pos != map_.end()) {
+    // short strings are in the entry itself
+    if (const auto *value = std::get_if<compact_string>(&pos->second.value);
+        value && !value->is_inline())
+      __builtin_prefetch(value->data());
+  }
+}
+
 redis::database::time_point
 redis::database::ex(decltype(std::chrono::system_clock::now()) now,
                     std::int64_t seconds) {
@@ -89,46 +447,109 @@ redis::database::time_point redis::database::pxat(std::int64_t milliseconds) {
   return time_point() + std::chrono::milliseconds(milliseconds);
 }
 
-redis::database::now_t redis::database::now() { return now_(); }
+redis::database::now_t redis::database::now() {
+  return stopped_at_ ? *stopped_at_ : now_();
+}
 
-std::optional<std::reference_wrapper<redis::database::list_t>>
-redis::database::get_list(std::string_view key) {
-  if (const auto pos = map_.find(key); pos == map_.end()) {
-    return {};
-  } else {
-    return std::visit(overloaded{
-                          [](list_t &l) -> list_t & { return l; },
-                          [](auto &) -> list_t & { throw wrong_type(); },
-                      },
-                      pos->second);
+template <typename T>
+std::optional<std::reference_wrapper<T>>
+redis::database::get_boxed(std::string_view key, time_point now) {
+  if (const auto pos = find(key, now); pos != map_.end()) {
+    if (auto *value = std::get_if<std::unique_ptr<T>>(&pos->second.value))
+      return std::ref(**value);
+    throw wrong_type();
   }
+  return {};
+}
+
+template <typename T>
+T &redis::database::create_boxed(std::string_view key, time_point now,
+                                 T value) {
+  if (const auto pos = find(key, now); pos != map_.end())
+    throw redis::would_clobber();
+  return *std::get<std::unique_ptr<T>>(
+      emplace(key, std::make_unique<T>(std::move(value))).value);
+}
+
+std::optional<std::reference_wrapper<redis::database::list_t>>
+redis::database::get_list(std::string_view key, time_point now) {
+  return get_boxed<list_t>(key, now);
 }
 
 redis::database::list_t &redis::database::create_list(std::string_view key,
+                                                      time_point now,
                                                       list_t list) {
-  if (const auto pos = map_.find(key); pos == map_.end()) {
-    return std::ref(std::get<list_t>(
-        map_.emplace(std::piecewise_construct, std::forward_as_tuple(key),
-                     std::forward_as_tuple(std::in_place_type<list_t>,
-                                           std::move(list)))
-            .first->second));
-
-  } else {
-    throw redis::would_clobber();
-  }
+  return create_boxed(key, now, std::move(list));
 }
 
 redis::database::list_t &
-redis::database::get_or_create_list(std::string_view key, list_t list) {
-  if (const auto pos = map_.find(key); pos == map_.end()) {
-    return create_list(key, std::move(list));
-  } else {
-    return std::visit(overloaded{
-                          [](list_t &l) -> list_t & { return l; },
-                          [](auto &) -> list_t & { throw wrong_type(); },
-                      },
-                      pos->second);
-  }
+redis::database::get_or_create_list(std::string_view key, time_point now,
+                                    list_t list) {
+  if (const auto result = get_list(key, now))
+    return *result;
+  return create_list(key, now, std::move(list));
+}
+
+std::optional<std::reference_wrapper<redis::database::hash_t>>
+redis::database::get_hash(std::string_view key, time_point now) {
+  return get_boxed<hash_t>(key, now);
+}
+
+redis::database::hash_t &
+redis::database::get_or_create_hash(std::string_view key, time_point now) {
+  if (const auto result = get_hash(key, now))
+    return *result;
+  return create_boxed(key, now, hash_t());
+}
+
+std::optional<std::reference_wrapper<redis::database::set_t>>
+redis::database::get_set(std::string_view key, time_point now) {
+  return get_boxed<set_t>(key, now);
+}
+
+redis::database::set_t &
+redis::database::get_or_create_set(std::string_view key, time_point now) {
+  if (const auto result = get_set(key, now))
+    return *result;
+  return create_boxed(key, now, set_t(max_intset_entries_));
+}
+
+std::optional<std::reference_wrapper<redis::database::zset_t>>
+redis::database::get_zset(std::string_view key, time_point now) {
+  return get_boxed<zset_t>(key, now);
+}
+
+redis::database::zset_t &
+redis::database::get_or_create_zset(std::string_view key, time_point now) {
+  if (const auto result = get_zset(key, now))
+    return *result;
+  return create_boxed(key, now, zset_t());
+}
+
+std::optional<std::reference_wrapper<redis::database::stream_t>>
+redis::database::get_stream(std::string_view key, time_point now) {
+  return get_boxed<stream_t>(key, now);
+}
+
+redis::database::stream_t &
+redis::database::get_or_create_stream(std::string_view key, time_point now) {
+  if (const auto result = get_stream(key, now))
+    return *result;
+  return create_boxed(key, now, stream_t());
+}
+
+void redis::database::store_set(std::string_view key, time_point now,
+                                set_t set) {
+  del(key, now);
+  if (!set.empty())
+    create_boxed(key, now, std::move(set));
+}
+
+void redis::database::store_string(std::string_view key, time_point now,
+                                   compact_string s) {
+  del(key, now);
+  if (!s.empty())
+    upsert(key, now, std::move(s));
 }
 
 std::unique_ptr<std::istream> redis::database::state_istream() {
@@ -141,4 +562,6 @@ std::unique_ptr<std::ostream> redis::database::state_ostream() {
 
 void redis::database::clear() {
   map_.clear();
+  expires_.clear();
+  expiry_index_.clear();
 }
@@ -1,19 +1,28 @@
 #ifndef REDIS_SERVER_DATABASE_HPP
 #define REDIS_SERVER_DATABASE_HPP
 
+#include "compact_string.hpp"
+#include "hash.hpp"
+#include "memory.hpp"
+#include "quicklist.hpp"
+#include "set.hpp"
+#include "stream.hpp"
+#include "string_value.hpp"
+#include "timing_wheel.hpp"
 #include "util.hpp"
+#include "zset.hpp"
 
 #include <ankerl/unordered_dense.h>
 
 #include <chrono>
 #include <fstream>
-#include <list>
 #include <memory>
 #include <optional>
 #include <span>
 #include <string>
 #include <unordered_map>
 #include <variant>
+#include <vector>
 
 namespace redis {
 
@@ -27,15 +36,54 @@ public:
   would_clobber() : std::runtime_error("attempt to clobber existing key") {}
 };
 
+enum class eviction_policy {
+  noeviction,
+  allkeys_lru,
+  allkeys_lfu,
+  volatile_ttl
+};
+
 class database {
 public:
   using time_point = std::chrono::sys_time<std::chrono::milliseconds>;
-  using string_with_expiry_t =
-      std::tuple<std::string, std::optional<time_point>>;
-  using list_t = std::list<std::string>;
-  using value_t = std::variant<std::monostate, string_with_expiry_t, list_t>;
-  using map_t = ankerl::unordered_dense::map<std::string, value_t,
+  using list_t = quicklist;
+  using hash_t = hash;
+  using set_t = redis::set;
+  using zset_t = zset;
+  using stream_t = stream;
+  // strings that are integers are held as such; other than strings, values
+  // are boxed, so as not to grow every entry
+  using value_t =
+      std::variant<std::monostate, compact_string, std::int64_t,
+                   std::unique_ptr<list_t>, std::unique_ptr<hash_t>,
+                   std::unique_ptr<set_t>, std::unique_ptr<zset_t>,
+                   std::unique_ptr<stream_t>>;
+
+  // the expiry of a key that doesn't expire
+  static constexpr time_point never = time_point::max();
+
+  struct entry {
+    value_t value;
+    // when it was last accessed, or how often, depending on the eviction
+    // policy: see touch()
+    std::uint32_t access{};
+    // whether the key has an entry in expires_
+    bool expires = false;
+  };
+
+  using map_t = ankerl::unordered_dense::map<compact_string, entry,
                                              util::cs_hash, std::equal_to<>>;
+
+  // kept aside for the keys that have an expiry, as in Redis, so that the
+  // rest don't pay for it
+  struct expiry_entry {
+    time_point expiry = never;
+    // the deadline of the key's live entry in the expiry index, if any
+    time_point indexed = never;
+  };
+
+  using expires_t = ankerl::unordered_dense::map<compact_string, expiry_entry,
+                                                 util::cs_hash, std::equal_to<>>;
   using now_t = std::remove_cvref_t<decltype(std::chrono::system_clock::now())>;
 
   explicit database(
@@ -48,18 +96,209 @@ public:
       }
       );
 
-  std::optional<std::reference_wrapper<std::string>>
-  get_string(std::string_view key, time_point now);
+  std::optional<string_value> get_string(std::string_view key, time_point now);
+
+  /**
+   * Find the string key holds, or create an empty one, for the bit commands
+   * to change in place, converting it to its bytes if it's held as an
+   * integer.
+   * @param key
+   * @param now
+   * @return key's value
+   */
+  compact_string &get_or_create_raw_string(std::string_view key,
+                                           time_point now);
+
+  std::optional<std::reference_wrapper<list_t>> get_list(std::string_view key,
+                                                         time_point now);
+  list_t &create_list(std::string_view key, time_point now, list_t list = {});
+  list_t &get_or_create_list(std::string_view key, time_point now,
+                             list_t list = {});
+
+  std::optional<std::reference_wrapper<hash_t>> get_hash(std::string_view key,
+                                                         time_point now);
+  hash_t &get_or_create_hash(std::string_view key, time_point now);
+
+  std::optional<std::reference_wrapper<set_t>> get_set(std::string_view key,
+                                                       time_point now);
+  set_t &get_or_create_set(std::string_view key, time_point now);
+
+  std::optional<std::reference_wrapper<zset_t>> get_zset(std::string_view key,
+                                                         time_point now);
+  zset_t &get_or_create_zset(std::string_view key, time_point now);
+
+  std::optional<std::reference_wrapper<stream_t>>
+  get_stream(std::string_view key, time_point now);
+  stream_t &get_or_create_stream(std::string_view key, time_point now);
+
+  /**
+   * Replace whatever key holds, and its expiry, with set, or delete key if set
+   * is empty, as the STORE forms of the set operations do.
+   * @param key
+   * @param now
+   * @param set
+   */
+  void store_set(std::string_view key, time_point now, set_t set);
+
+  /**
+   * Replace whatever key holds, and its expiry, with s, or delete key if s is
+   * empty, as BITOP does.
+   * @param key
+   * @param now
+   * @param s
+   */
+  void store_string(std::string_view key, time_point now, compact_string s);
+
+  /**
+   * @param max_intset_entries how many integers a set created from now on
+   * may hold before it's converted to a hash set
+   */
+  void limit_intsets(std::size_t max_intset_entries) {
+    max_intset_entries_ = max_intset_entries;
+  }
+
+  [[nodiscard]] std::size_t max_intset_entries() const {
+    return max_intset_entries_;
+  }
+
+  void set(std::string_view key, std::string_view value,
+           std::optional<time_point> = {});
+
+  /**
+   * Find key, or insert it with value if it's missing, hashing it once.
+   * @param key
+   * @param now
+   * @param value
+   * @return key's value, and whether it was inserted
+   */
+  std::pair<value_t &, bool> upsert(std::string_view key, time_point now,
+                                    value_t value);
+
+  /**
+   * @param s
+   * @return how the string s is held: as an integer if it is one
+   */
+  static value_t make_string(std::string_view s);
+
+  /**
+   * Add key, which mustn't exist already, as loading a snapshot does.
+   * @param key
+   * @param value
+   * @param expiry
+   * @return false if key did exist, in which case it's left as it was
+   */
+  bool restore(std::string_view key, value_t value, time_point expiry);
+
+  /**
+   * Make room for count keys in all, so that adding that many doesn't rehash.
+   * @param count
+   */
+  void reserve(std::size_t count);
 
-  std::optional<std::reference_wrapper<list_t>> get_list(std::string_view key);
-  list_t &create_list(std::string_view key, list_t list = {});
-  list_t &get_or_create_list(std::string_view key, list_t list = {});
+  /**
+   * Look up a batch of strings, calling visitor with each key's value in
+   * order, or nullptr if the key doesn't hold a live string. All the keys are
+   * hashed and looked up before any is visited, so that their cache misses
+   * overlap, and expired keys are erased once the batch has been visited.
+   * @tparam Visitor
+   * @param keys
+   * @param now
+   * @param visitor
+   */
+  template <typename Visitor>
+  void get_strings(std::span<const std::string_view> keys, time_point now,
+                   Visitor visitor);
 
-  std::string &set(std::string_view key, std::string_view value,
-                   std::optional<time_point> = {});
+  /**
+   * Set a batch of strings without expiry, as set() would one at a time.
+   * @param keys_and_values alternating keys and values
+   */
+  void set_strings(std::span<const std::string_view> keys_and_values);
+
+  /**
+   * Set a batch of strings without expiry, unless any of the keys exists.
+   * @param keys_and_values alternating keys and values
+   * @param now
+   * @return whether the strings were set
+   */
+  bool set_strings_nx(std::span<const std::string_view> keys_and_values,
+                      time_point now);
 
   bool del(std::string_view key, time_point now);
 
+  bool exists(std::string_view key, time_point now);
+
+  /**
+   * Set when an existing key of any type expires.
+   * @param key
+   * @param expiry never to make it persistent
+   * @param now
+   * @return false if there's no such key
+   */
+  bool expire(std::string_view key, time_point expiry, time_point now);
+
+  /**
+   * @param key
+   * @param now
+   * @return when key expires, never if it doesn't, or nothing if there's no
+   * such key
+   */
+  std::optional<time_point> expiry(std::string_view key, time_point now);
+
+  /**
+   * Erase expired keys from the expiry index, soonest first, until none are
+   * left or budget has been spent.
+   * @param now
+   * @param budget
+   * @return false if it ran out of budget
+   */
+  bool active_expire(time_point now, std::chrono::microseconds budget);
+
+  /**
+   * @return how many keys have been erased because they expired
+   */
+  [[nodiscard]] std::uint64_t expired_keys() const { return expired_keys_; }
+
+  /**
+   * Keep memory use under maxmemory by evicting keys chosen by policy.
+   * @param maxmemory 0 for no limit
+   * @param policy
+   * @param used_memory measures memory use, by default what's allocated
+   * through operator new less the spare capacity of the map
+   */
+  void limit_memory(std::uint64_t maxmemory, eviction_policy policy,
+                    std::function<std::uint64_t()> used_memory = {});
+
+  /**
+   * Evict keys until memory use is under the limit. Each victim is the best
+   * of a few keys sampled at random, as in Redis, rather than the best of all.
+   * @return false if memory use is over the limit and nothing can be evicted
+   */
+  bool evict();
+
+  /**
+   * @param evicted called with each key evict() chooses, just before it's
+   * erased, e.g. so that the eviction can be logged along with the writes
+   */
+  void on_evict(std::function<void(std::string_view key)> evicted) {
+    evicted_ = std::move(evicted);
+  }
+
+  [[nodiscard]] std::size_t size() const { return map_.size(); }
+
+  /**
+   * @return how many keys have been evicted to stay under the memory limit
+   */
+  [[nodiscard]] std::uint64_t evicted_keys() const { return evicted_keys_; }
+
+  /**
+   * Start pulling key's entry and value into cache ahead of a lookup that's
+   * about to follow. The map doesn't expose its buckets, so this looks the
+   * key up, which lets the misses of several keys overlap.
+   * @param key
+   */
+  void prefetch(std::string_view key) const;
+
   void clear();
 
   static time_point ex(decltype(std::chrono::system_clock::now()) now,
@@ -73,11 +312,26 @@ public:
   static time_point pxat(std::int64_t milliseconds);
 
   template <typename Visitor> void visit(Visitor visitor) {
-    auto visit = [visitor = std::move(visitor)](auto &elem) -> bool {
-      auto &key = std::get<0>(elem);
-      return std::visit(
-          [&](auto &value) -> bool { return visitor(key, value); },
-          std::get<1>(elem));
+    auto visit = [this, visitor = std::move(visitor)](auto &elem) -> bool {
+      auto &[key, entry] = elem;
+      const auto expiry = expiry_of(key, entry);
+      return std::visit(util::overloaded{
+                            [&](const std::monostate &value) -> bool {
+                              return visitor(key, value, expiry);
+                            },
+                            [&](const compact_string &value) -> bool {
+                              return visitor(key, string_value(value.view()),
+                                             expiry);
+                            },
+                            [&](std::int64_t value) -> bool {
+                              return visitor(key, string_value(value), expiry);
+                            },
+                            [&]<typename T>(
+                                const std::unique_ptr<T> &value) -> bool {
+                              return visitor(key, *value, expiry);
+                            },
+                        },
+                        entry.value);
     };
 
     for (const auto &elem : map_) {
@@ -88,17 +342,120 @@ public:
 
   now_t now();
 
+  /**
+   * Have now() keep returning at, rather than the clock's time, or the
+   * clock's time again if it's empty.
+   * @param at
+   */
+  void stop_clock(std::optional<now_t> at) { stopped_at_ = at; }
+
   std::unique_ptr<std::istream> state_istream();
 
   std::unique_ptr<std::ostream> state_ostream();
 
 private:
+  bool expired(std::string_view key, const entry &entry, time_point now) const {
+    return !(now < expiry_of(key, entry));
+  }
+
+  time_point expiry_of(std::string_view key, const entry &entry) const {
+    return entry.expires ? expires_.find(key)->second.expiry : never;
+  }
+
+  // the key's entry, unless it's missing or has just been found to be expired
+  map_t::iterator find(std::string_view key, time_point now);
+
+  entry &emplace(std::string_view key, value_t value);
+
+  // key's value, if it has one and it's a T, boxed in value_t
+  template <typename T>
+  std::optional<std::reference_wrapper<T>> get_boxed(std::string_view key,
+                                                     time_point now);
+
+  template <typename T>
+  T &create_boxed(std::string_view key, time_point now, T value);
+
+  // the text of value, if it's a string
+  static std::optional<string_value> as_string(const value_t &value);
+
+  void set_expiry(std::string_view key, entry &entry, time_point expiry);
+
+  void erase(map_t::iterator pos);
+
+  void erase_expired(map_t::iterator pos);
+
+  // note an access to entry for the eviction policy
+  void touch(entry &entry);
+
+  // note a new entry for the eviction policy
+  void admit(entry &entry);
+
+  std::uint64_t used_memory() const;
+
+  // the next victim for the eviction policy, of a sample of keys
+  map_t::iterator sample_victim();
+
+  // hash and look up every step'th key into hashed_ and found_
+  void find_all(std::span<const std::string_view> keys, std::size_t step);
+
   map_t map_;
+  std::vector<util::hashed_key> hashed_;
+  std::vector<entry *> found_;
   std::function<now_t()> now_;
+  std::optional<now_t> stopped_at_;
+  expires_t expires_;
+  // keys with an expiry, by deadline, some stale
+  timing_wheel<compact_string> expiry_index_;
+  std::uint64_t expired_keys_{};
+  // the latest time the database has been told of, for touch()
+  time_point clock_{};
+  std::uint64_t maxmemory_{};
+  eviction_policy policy_ = eviction_policy::noeviction;
+  std::function<std::uint64_t()> used_memory_;
+  std::uint64_t evicted_keys_{};
+  std::function<void(std::string_view)> evicted_;
+  std::size_t max_intset_entries_ = set_t::default_max_intset_entries;
+  // xorshift state, for sampling and the LFU counter
+  std::uint64_t random_ = 0x9e3779b97f4a7c15;
   std::function<std::unique_ptr<std::istream>()> state_istream_;
   std::function<std::unique_ptr<std::ostream>()> state_ostream_;
 };
 
 } // namespace redis
 
+template <typename Visitor>
+void redis::database::get_strings(std::span<const std::string_view> keys,
+                                  time_point now, Visitor visitor) {
+  find_all(keys, 1);
+
+  bool any_expired = false;
+  clock_ = now;
+  for (std::size_t i = 0; i < found_.size(); ++i) {
+    auto &found = found_[i];
+    std::optional<string_value> value;
+    if (found && expired(hashed_[i].key, *found, now)) {
+      any_expired = true;
+    } else {
+      if (found) {
+        touch(*found);
+        value = as_string(found->value);
+      }
+      // only the expired keys are left marked for erasure
+      found = nullptr;
+    }
+    visitor(value ? &*value : nullptr);
+  }
+
+  if (!any_expired)
+    return;
+  for (std::size_t i = 0; i < found_.size(); ++i) {
+    // found_ is stale after the first erase, so look the key up again
+    if (found_[i]) {
+      const auto pos = map_.find(hashed_[i]);
+      if (pos != map_.end() && expired(pos->first, pos->second, now))
+        erase_expired(pos);
+    }
+  }
+}
+
 #endif // REDIS_SERVER_DATABASE_HPP
@@ -0,0 +1,101 @@
+#include "hash.hpp"
+
+#include <cstring>
+
+redis::hash::hash(
+    std::initializer_list<std::pair<std::string_view, std::string_view>>
+        fields) {
+  for (const auto &[field, value] : fields)
+    set(field, value);
+}
+
+std::optional<std::string_view>
+redis::hash::get(std::string_view field) const {
+  if (map_) {
+    const auto pos = map_->find(field);
+    if (pos == map_->end())
+      return {};
+    return pos->second.view();
+  }
+
+  if (const char *const pos = find_packed(field))
+    return packed::decode(packed::next(packed::decode(pos)));
+  return {};
+}
+
+bool redis::hash::set(std::string_view field, std::string_view value) {
+  const char *const pos = map_ ? nullptr : find_packed(field);
+  if (!map_ && (field.size() > max_packed_value ||
+                value.size() > max_packed_value ||
+                (!pos && count_ == max_packed_entries)))
+    convert();
+
+  if (map_) {
+    auto [found, inserted] = map_->try_emplace(field);
+    found->second.assign(value);
+    return inserted;
+  }
+
+  if (!pos) {
+    packed::append(packed_, field);
+    packed::append(packed_, value);
+    ++count_;
+    return true;
+  }
+
+  // splice the new value over the old one, moving what follows it only if
+  // their sizes differ
+  const char *const old_pos = packed::next(packed::decode(pos));
+  const auto offset = old_pos - packed_.data();
+  const auto old_bytes = packed::next(packed::decode(old_pos)) - old_pos;
+  std::array<char, packed::max_varint> length;
+  const auto length_bytes = packed::encode_length(length, value.size());
+  const auto new_bytes = std::ptrdiff_t(length_bytes + value.size());
+  if (new_bytes > old_bytes) {
+    packed_.insert(packed_.begin() + offset + old_bytes,
+                   std::size_t(new_bytes - old_bytes), 0);
+  } else if (new_bytes < old_bytes) {
+    packed_.erase(packed_.begin() + offset + new_bytes,
+                  packed_.begin() + offset + old_bytes);
+  }
+  std::memcpy(packed_.data() + offset, length.data(), length_bytes);
+  std::memcpy(packed_.data() + offset + std::ptrdiff_t(length_bytes),
+              value.data(), value.size());
+  return false;
+}
+
+bool redis::hash::erase(std::string_view field) {
+  if (map_)
+    return map_->erase(field);
+
+  const char *const pos = find_packed(field);
+  if (!pos)
+    return false;
+  const auto value = packed::decode(packed::next(packed::decode(pos)));
+  packed_.erase(packed_.begin() + (pos - packed_.data()),
+                packed_.begin() + (packed::next(value) - packed_.data()));
+  --count_;
+  return true;
+}
+
+const char *redis::hash::find_packed(std::string_view field) const noexcept {
+  for (const char *pos = packed_.data(), *const end = pos + packed_.size();
+       pos != end;) {
+    const auto found = packed::decode(pos);
+    if (found == field)
+      return pos;
+    pos = packed::next(packed::decode(packed::next(found)));
+  }
+  return nullptr;
+}
+
+void redis::hash::convert() {
+  auto map = std::make_unique<map_t>();
+  map->reserve(count_ + 1);
+  visit([&](std::string_view field, std::string_view value) {
+    map->try_emplace(field, value);
+  });
+  map_ = std::move(map);
+  packed_ = {};
+  count_ = 0;
+}
@@ -0,0 +1,142 @@
+#ifndef REDIS_SERVER_HASH_HPP
+#define REDIS_SERVER_HASH_HPP
+
+#include "compact_string.hpp"
+#include "packed.hpp"
+#include "util.hpp"
+
+#include <ankerl/unordered_dense.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace redis {
+
+/**
+ * A map of fields to values. A small one is kept as its fields and values
+ * packed alternately into one buffer, as in Redis' listpack encoding, and
+ * looked up by walking it, which for a few short fields is faster than hashing
+ * and takes little more memory than the fields and values themselves. Once it
+ * grows past max_packed_entries, or is given a field or value longer than
+ * max_packed_value, it's converted to a hash map for good.
+ */
+class hash {
+public:
+  using map_t = ankerl::unordered_dense::map<compact_string, compact_string,
+                                             util::cs_hash, std::equal_to<>>;
+
+  // as Redis' default hash-max-listpack-entries and hash-max-listpack-value
+  static constexpr std::size_t max_packed_entries = 128;
+  static constexpr std::size_t max_packed_value = 64;
+
+  hash() = default;
+
+  hash(std::initializer_list<std::pair<std::string_view, std::string_view>>
+           fields);
+
+  [[nodiscard]] std::size_t size() const noexcept {
+    return map_ ? map_->size() : count_;
+  }
+
+  [[nodiscard]] bool empty() const noexcept { return !size(); }
+
+  /**
+   * @return whether it's still in the packed encoding
+   */
+  [[nodiscard]] bool packed() const noexcept { return !map_; }
+
+  [[nodiscard]] std::optional<std::string_view>
+  get(std::string_view field) const;
+
+  /**
+   * @param field
+   * @param value mustn't point into this hash
+   * @return whether field is new
+   */
+  bool set(std::string_view field, std::string_view value);
+
+  /**
+   * @param field
+   * @return whether there was such a field
+   */
+  bool erase(std::string_view field);
+
+  /**
+   * Call visitor with each field and its value.
+   * @tparam Visitor
+   * @param visitor
+   */
+  template <typename Visitor> void visit(Visitor visitor) const;
+
+  /**
+   * Visit some of the fields, as HSCAN does, starting from cursor, 0 for the
+   * first call. A field that's there for the whole of a scan is visited at
+   * least once. A packed hash is visited in one go.
+   * @tparam Visitor
+   * @param cursor
+   * @param count roughly how many fields to visit
+   * @param visitor
+   * @return the cursor to carry on from, or 0 if the scan is complete
+   */
+  template <typename Visitor>
+  std::uint64_t scan(std::uint64_t cursor, std::size_t count,
+                     Visitor visitor) const;
+
+private:
+  // the start of field in packed_, or nullptr if there's no such field
+  const char *find_packed(std::string_view field) const noexcept;
+
+  void convert();
+
+  std::vector<char> packed_;
+  std::uint32_t count_{};
+  std::unique_ptr<map_t> map_;
+};
+
+} // namespace redis
+
+template <typename Visitor> void redis::hash::visit(Visitor visitor) const {
+  if (map_) {
+    for (const auto &[field, value] : *map_)
+      visitor(field.view(), value.view());
+    return;
+  }
+
+  for (const char *pos = packed_.data(), *const end = pos + packed_.size();
+       pos != end;) {
+    const auto field = packed::decode(pos);
+    const auto value = packed::decode(packed::next(field));
+    visitor(field, value);
+    pos = packed::next(value);
+  }
+}
+
+template <typename Visitor>
+std::uint64_t redis::hash::scan(std::uint64_t cursor, std::size_t count,
+                                Visitor visitor) const {
+  if (!map_) {
+    visit(visitor);
+    return 0;
+  }
+
+  // the cursor is how many of the map's values are left to visit, walking
+  // down from the back: erasing moves the last value into the gap, and
+  // inserting appends, so neither moves a value that's still to be visited
+  // past the cursor
+  const auto &values = map_->values();
+  auto i = cursor ? std::min<std::uint64_t>(cursor, values.size())
+                  : values.size();
+  for (std::size_t n = 0; i && n < std::max<std::size_t>(count, 1); ++n) {
+    --i;
+    visitor(values[i].first.view(), values[i].second.view());
+  }
+  return i;
+}
+
+#endif // REDIS_SERVER_HASH_HPP
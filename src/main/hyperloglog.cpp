@@ -0,0 +1,306 @@
+#include "hyperloglog.hpp"
+#include "simd.hpp"
+
+#include <ankerl/unordered_dense.h>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+namespace ns = redis::hyperloglog;
+
+// the header: "HYLL", the encoding, 3 unused bytes, and the cached count,
+// little endian, which is stale if the top bit of its last byte is set
+constexpr std::string_view magic = "HYLL";
+constexpr std::size_t encoding_offset = 4;
+constexpr std::size_t cache_offset = 8;
+constexpr std::size_t header_size = 16;
+constexpr unsigned char dense_encoding = 0;
+constexpr unsigned char sparse_encoding = 1;
+constexpr unsigned char stale = 0x80;
+
+constexpr unsigned index_bits = 14;
+constexpr std::size_t dense_size = header_size + ns::register_count * 6 / 8;
+
+// the largest register a sparse counter holds
+constexpr unsigned max_sparse_value = 32;
+
+unsigned char *bytes(redis::compact_string &hll) noexcept {
+  return reinterpret_cast<unsigned char *>(hll.data());
+}
+
+const unsigned char *bytes(std::string_view hll) noexcept {
+  return reinterpret_cast<const unsigned char *>(hll.data());
+}
+
+// the register an element falls to, from the low bits of its hash, and the
+// value it offers it: one more than the zeros that lead the other 50 bits
+std::pair<std::size_t, unsigned> hash(std::string_view element) noexcept {
+  const std::uint64_t h =
+      ankerl::unordered_dense::hash<std::string_view>()(element);
+  const auto rest = h >> index_bits | std::uint64_t(1) << (64 - index_bits);
+  return {h & (ns::register_count - 1), unsigned(std::countr_zero(rest)) + 1};
+}
+
+// The sparse encoding's opcodes, as in Redis:
+//   00xxxxxx           ZERO: xxxxxx + 1 registers of 0
+//   01xxxxxx yyyyyyyy  XZERO: xxxxxxyyyyyyyy + 1 registers of 0
+//   1vvvvvxx           VAL: xx + 1 registers of vvvvv + 1
+
+struct run {
+  unsigned value;
+  unsigned length;
+  unsigned size;
+};
+
+run decode(const unsigned char *p) noexcept {
+  if (*p & 0x80)
+    return {((*p >> 2) & 0x1fu) + 1, (*p & 3u) + 1, 1};
+  if (*p & 0x40)
+    return {0, ((*p & 0x3fu) << 8 | p[1]) + 1, 2};
+  return {0, (*p & 0x3fu) + 1, 1};
+}
+
+// write the opcode for length registers of value, at most 4 of them unless
+// value is 0, returning its size
+unsigned encode(unsigned char *out, unsigned value, unsigned length) noexcept {
+  if (value) {
+    *out = static_cast<unsigned char>(0x80 | (value - 1) << 2 | (length - 1));
+    return 1;
+  }
+  if (length <= 64) {
+    *out = static_cast<unsigned char>(length - 1);
+    return 1;
+  }
+  out[0] = static_cast<unsigned char>(0x40 | (length - 1) >> 8);
+  out[1] = static_cast<unsigned char>((length - 1) & 0xff);
+  return 2;
+}
+
+// the dense encoding's registers are 6 bits each, least significant first,
+// and are unpacked by simd::max_registers()
+
+unsigned dense_get(const unsigned char *registers, std::size_t i) noexcept {
+  const auto byte = i * 6 / 8;
+  const auto shift = i * 6 % 8;
+  unsigned result = registers[byte] >> shift;
+  if (shift > 2)
+    result |= unsigned(registers[byte + 1]) << (8 - shift);
+  return result & 63;
+}
+
+void dense_set(unsigned char *registers, std::size_t i,
+               unsigned value) noexcept {
+  const auto byte = i * 6 / 8;
+  const auto shift = i * 6 % 8;
+  registers[byte] = static_cast<unsigned char>(
+      (registers[byte] & ~(63u << shift)) | value << shift);
+  if (shift > 2)
+    registers[byte + 1] = static_cast<unsigned char>(
+        (registers[byte + 1] & ~(63u >> (8 - shift))) | value >> (8 - shift));
+}
+
+void pack(const ns::registers_t &registers, unsigned char *p) noexcept {
+  for (std::size_t i = 0; i < ns::register_count; i += 4, p += 3) {
+    p[0] = static_cast<unsigned char>(registers[i] | registers[i + 1] << 6);
+    p[1] = static_cast<unsigned char>(registers[i + 1] >> 2 |
+                                      registers[i + 2] << 4);
+    p[2] = static_cast<unsigned char>(registers[i + 2] >> 4 |
+                                      registers[i + 3] << 2);
+  }
+}
+
+// call visitor(first, run) for each run of a valid sparse counter, first
+// being the index of its first register
+template <typename Visitor>
+void visit_sparse(std::string_view hll, Visitor visitor) {
+  std::size_t first = 0;
+  for (const auto *p = bytes(hll) + header_size,
+                  *const end = bytes(hll) + hll.size();
+       p != end;) {
+    const auto r = decode(p);
+    visitor(first, r);
+    first += r.length;
+    p += r.size;
+  }
+}
+
+// raise register index of a sparse counter to value, at most
+// max_sparse_value, if it's lower, by splitting the run it's in around it
+bool sparse_set(redis::compact_string &hll, std::size_t index,
+                unsigned value) {
+  std::size_t first = 0;
+  std::size_t offset = header_size;
+  run r;
+  for (;; offset += r.size) {
+    r = decode(bytes(hll) + offset);
+    if (index < first + r.length)
+      break;
+    first += r.length;
+  }
+  if (r.value >= value)
+    return false;
+
+  // the registers before index, index's, and those after, at most 5 bytes
+  std::array<unsigned char, 5> replacement;
+  unsigned size = 0;
+  if (index > first)
+    size += encode(replacement.data(), r.value, unsigned(index - first));
+  size += encode(replacement.data() + size, value, 1);
+  if (const auto after = first + r.length - index - 1)
+    size += encode(replacement.data() + size, r.value, unsigned(after));
+
+  const auto old_size = hll.size();
+  if (size > r.size)
+    hll.resize(old_size + size - r.size);
+  auto *const p = bytes(hll) + offset;
+  std::memmove(p + size, p + r.size, old_size - offset - r.size);
+  std::memcpy(p, replacement.data(), size);
+  if (size < r.size)
+    hll.resize(old_size + size - r.size);
+  return true;
+}
+
+void to_dense(redis::compact_string &hll) {
+  ns::registers_t registers{};
+  ns::merge(registers, hll.view());
+  hll = ns::from_registers(registers);
+}
+
+// LogLog-Beta, as Redis 4 estimated counts: the harmonic mean of the
+// registers, corrected for those still 0 by a polynomial fitted for 16384
+// registers, so that small counts need no separate linear counting
+std::uint64_t estimate(double sum, double zeros) {
+  constexpr double m = ns::register_count;
+  constexpr double alpha = 0.721347520444481703680; // 1 / (2 ln 2)
+  const double zl = std::log(zeros + 1);
+  const double beta =
+      -0.370393911 * zeros +
+      zl * (0.070471823 +
+            zl * (0.17393686 +
+                  zl * (0.16339839 +
+                        zl * (-0.09237745 +
+                              zl * (0.03738027 +
+                                    zl * (-0.005384159 +
+                                          zl * 0.00042419))))));
+  return std::uint64_t(std::llround(alpha * m * (m - zeros) / (beta + sum)));
+}
+
+} // namespace
+
+redis::compact_string ns::create() {
+  compact_string result;
+  result.resize(header_size + 2);
+  auto *const p = bytes(result);
+  std::memcpy(p, magic.data(), magic.size());
+  p[encoding_offset] = sparse_encoding;
+  encode(p + header_size, 0, register_count);
+  return result;
+}
+
+bool ns::valid(std::string_view hll) noexcept {
+  if (hll.size() < header_size || !hll.starts_with(magic))
+    return false;
+  const auto *p = bytes(hll);
+  if (p[encoding_offset] == dense_encoding)
+    return hll.size() == dense_size;
+  if (p[encoding_offset] != sparse_encoding)
+    return false;
+
+  std::size_t registers = 0;
+  const auto *const end = p + hll.size();
+  for (p += header_size; p != end && registers < register_count;) {
+    if ((*p & 0xc0) == 0x40 && end - p < 2)
+      return false;
+    const auto r = decode(p);
+    registers += r.length;
+    p += r.size;
+  }
+  return p == end && registers == register_count;
+}
+
+bool ns::dense(std::string_view hll) noexcept {
+  return bytes(hll)[encoding_offset] == dense_encoding;
+}
+
+bool ns::add(compact_string &hll, std::string_view element) {
+  const auto [index, value] = hash(element);
+  bool changed;
+  if (!dense(hll.view()) && value <= max_sparse_value) {
+    changed = sparse_set(hll, index, value);
+    if (hll.size() > sparse_max_bytes)
+      to_dense(hll);
+  } else {
+    if (!dense(hll.view()))
+      to_dense(hll);
+    auto *const registers = bytes(hll) + header_size;
+    changed = dense_get(registers, index) < value;
+    if (changed)
+      dense_set(registers, index, value);
+  }
+  if (changed)
+    bytes(hll)[cache_offset + 7] |= stale;
+  return changed;
+}
+
+std::uint64_t ns::count(compact_string &hll) {
+  auto *const cache = bytes(hll) + cache_offset;
+  std::uint64_t result = 0;
+  if (!(cache[7] & stale)) {
+    for (int i = 7; i >= 0; --i)
+      result = result << 8 | cache[i];
+    return result;
+  }
+
+  if (dense(hll.view())) {
+    registers_t registers{};
+    merge(registers, hll.view());
+    result = count(registers);
+  } else {
+    // a run's registers all add the same to the sum
+    double sum = 0;
+    double zeros = 0;
+    visit_sparse(hll.view(), [&](std::size_t, run r) {
+      sum += std::ldexp(double(r.length), -int(r.value));
+      zeros += r.value ? 0 : r.length;
+    });
+    result = estimate(sum, zeros);
+  }
+  for (int i = 0; i < 8; ++i)
+    cache[i] = static_cast<unsigned char>(result >> (8 * i));
+  return result;
+}
+
+void ns::merge(registers_t &registers, std::string_view hll) {
+  if (dense(hll)) {
+    simd::max_registers(registers.data(), bytes(hll) + header_size,
+                        register_count);
+    return;
+  }
+  visit_sparse(hll, [&](std::size_t first, run r) {
+    if (!r.value)
+      return;
+    for (auto i = first; i < first + r.length; ++i)
+      registers[i] = std::max(registers[i], std::uint8_t(r.value));
+  });
+}
+
+std::uint64_t ns::count(const registers_t &registers) {
+  return estimate(
+      simd::harmonic_sum(registers.data(), registers.data() + register_count),
+      double(std::ranges::count(registers, 0)));
+}
+
+redis::compact_string ns::from_registers(const registers_t &registers) {
+  compact_string result;
+  result.resize(dense_size);
+  auto *const p = bytes(result);
+  std::memcpy(p, magic.data(), magic.size());
+  p[encoding_offset] = dense_encoding;
+  p[cache_offset + 7] = stale;
+  pack(registers, p + header_size);
+  return result;
+}
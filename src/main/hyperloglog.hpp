@@ -0,0 +1,80 @@
+#ifndef REDIS_SERVER_HYPERLOGLOG_HPP
+#define REDIS_SERVER_HYPERLOGLOG_HPP
+
+#include "compact_string.hpp"
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * HyperLogLog counters, held as strings laid out as Redis lays them out: a
+ * 16 byte header, with a cached count, and then 16384 registers, each the
+ * most leading zeros, plus one, seen in the hashes of the elements that fell
+ * to it. A new counter is sparse, its registers run length encoded, and it's
+ * converted for good to the dense 12KB array of 6 bit registers once it
+ * outgrows sparse_max_bytes or a register outgrows what the sparse encoding
+ * holds. Counts have a standard error of about 0.81%.
+ */
+namespace redis::hyperloglog {
+
+inline constexpr std::size_t register_count = 16384;
+
+// as Redis' default hll-sparse-max-bytes
+inline constexpr std::size_t sparse_max_bytes = 3000;
+
+// registers unpacked to a byte each, for merging and counting
+using registers_t = std::array<std::uint8_t, register_count>;
+
+/**
+ * @return an empty counter
+ */
+[[nodiscard]] compact_string create();
+
+/**
+ * @param hll
+ * @return whether hll is a well formed counter
+ */
+[[nodiscard]] bool valid(std::string_view hll) noexcept;
+
+/**
+ * @param hll must be valid()
+ * @return whether hll has been converted to the dense encoding
+ */
+[[nodiscard]] bool dense(std::string_view hll) noexcept;
+
+/**
+ * @param hll must be valid()
+ * @param element
+ * @return whether a register changed, and so perhaps the count
+ */
+bool add(compact_string &hll, std::string_view element);
+
+/**
+ * @param hll must be valid()
+ * @return hll's count, cached in its header until it next changes
+ */
+std::uint64_t count(compact_string &hll);
+
+/**
+ * Raise each of registers to at least hll's register.
+ * @param registers
+ * @param hll must be valid()
+ */
+void merge(registers_t &registers, std::string_view hll);
+
+/**
+ * @param registers
+ * @return the count of the elements registers were made from
+ */
+[[nodiscard]] std::uint64_t count(const registers_t &registers);
+
+/**
+ * @param registers
+ * @return a dense counter with registers
+ */
+[[nodiscard]] compact_string from_registers(const registers_t &registers);
+
+} // namespace redis::hyperloglog
+
+#endif // REDIS_SERVER_HYPERLOGLOG_HPP
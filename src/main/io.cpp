@@ -1,9 +1,13 @@
 #include "io.hpp"
 
+#include <array>
 #include <cassert>
 #include <utility>
 
+#include <fcntl.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
 
 namespace ns = redis::io;
 
@@ -68,6 +72,25 @@ void ns::memory_map::reset() noexcept {
 
 ns::memory_map::~memory_map() noexcept { reset(); }
 
+ns::mapped_streambuf::mapped_streambuf(const std::string &path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1 && errno == ENOENT)
+    return;
+  const file_descriptor file([fd]() { return fd; });
+  struct stat st {};
+  posix_call(::fstat, file.value(), &st);
+  if (!st.st_size)
+    return;
+
+  map_.emplace(nullptr, std::size_t(st.st_size), PROT_READ, MAP_PRIVATE,
+               file.value(), off_t());
+  const auto [ptr, len] = map_->value();
+  // it's read once, front to back, so the kernel may as well read ahead
+  ::madvise(ptr, len, MADV_SEQUENTIAL);
+  auto *const begin = static_cast<char *>(ptr);
+  setg(begin, begin, begin + len);
+}
+
 void ns::swap(memory_map &lhs, memory_map &rhs) noexcept {
   using std::swap;
   swap(lhs.ptr_, rhs.ptr_);
@@ -108,40 +131,165 @@ ns::ring_buffer::ring_buffer(std::size_t len)
 }
 
 ns::ofstreambuf::ofstreambuf(file_descriptor fd, std::size_t size)
-    : fd_(std::move(fd)), buf_(size), read_index_(), write_index_() {}
+    : fd_(std::move(fd)), buf_(size), read_index_(), write_index_(),
+      queue_offset_(), queued_(), prepared_(), writing_async_() {}
+
+std::span<const char> ns::ofstreambuf::begin_async_write() {
+  writing_async_ = true;
+  if (write_index_ != read_index_)
+    return {buf_.addr(read_index_), write_index_ - read_index_};
+  if (!queue_.empty())
+    return std::span<const char>(queue_.front().view()).subspan(queue_offset_);
+  return {};
+}
 
+void ns::ofstreambuf::end_async_write(std::size_t written) {
+  assert(writing_async_);
+  writing_async_ = false;
+  if (write_index_ != read_index_) {
+    assert(written <= write_index_ - read_index_);
+    read_index_ += written;
+  } else if (written) {
+    assert(written <= queue_.front().view().size() - queue_offset_);
+    queued_ -= written;
+    if ((queue_offset_ += written) == queue_.front().view().size()) {
+      queue_.pop_front();
+      queue_offset_ = 0;
+    }
+  }
+}
+
+/**
+ * Write as much as the file descriptor will take, the ring buffer's contents
+ * first then the queue's, in one writev().
+ * @return EOF on error, otherwise 0 even if some output is still pending
+ */
 int ns::ofstreambuf::sync() {
-  auto len = write_index_ - read_index_;
-  if (len == 0)
+  if (writing_async_ || held_)
     return 0;
-  int result{};
-  TEMP_FAILURE_RETRY(result =
-                         ::write(fd_.value(), buf_.addr(read_index_), len));
-  if (result != len)
-    return EOF;
-  read_index_ += len;
+
+  while (pending()) {
+    std::array<::iovec, 64> iov{};
+    std::size_t iovcnt = 0;
+    std::size_t total = 0;
+
+    if (const auto len = write_index_ - read_index_) {
+      iov[iovcnt++] = {buf_.addr(read_index_), len};
+      total += len;
+    }
+
+    for (auto i = queue_.begin(); i != queue_.end() && iovcnt < iov.size();
+         ++i) {
+      const auto offset = i == queue_.begin() ? queue_offset_ : 0;
+      const auto bytes = i->view().substr(offset);
+      iov[iovcnt++] = {const_cast<char *>(bytes.data()), bytes.size()};
+      total += bytes.size();
+    }
+
+    ssize_t result;
+    TEMP_FAILURE_RETRY(result = ::writev(fd_.value(), iov.data(), int(iovcnt)));
+    if (result == -1)
+      return errno == EAGAIN || errno == EWOULDBLOCK ? 0 : EOF;
+
+    std::size_t written = result;
+
+    const auto from_buf = std::min(written, write_index_ - read_index_);
+    read_index_ += from_buf;
+    written -= from_buf;
+
+    queued_ -= written;
+    while (written) {
+      const auto size = queue_.front().view().size();
+      const auto from_chunk = std::min(written, size - queue_offset_);
+      written -= from_chunk;
+      if ((queue_offset_ += from_chunk) == size) {
+        queue_.pop_front();
+        queue_offset_ = 0;
+      }
+    }
+
+    if (std::size_t(result) < total)
+      return 0;
+  }
+
   return 0;
 }
 
 std::streamsize ns::ofstreambuf::xsputn(const char_type *s,
                                         const std::streamsize n_) {
   assert(n_ >= 0);
-  for (std::size_t n = n_; n > 0;) {
-    const std::size_t len =
-        std::min(buf_.size() - (write_index_ - read_index_), n);
-    std::copy(s, s + len, buf_.addr(write_index_));
-    s += len;
-    write_index_ += len;
-    n -= std::streamsize(len);
-    if (n && sync() == EOF)
+  std::size_t n = n_;
+
+  // anything queued must go out first, so the ring buffer has to wait
+  if (queue_.empty()) {
+    if (buf_.size() - (write_index_ - read_index_) < n && sync() == EOF)
       return EOF;
+
+    if (queue_.empty()) {
+      const std::size_t len =
+          std::min(buf_.size() - (write_index_ - read_index_), n);
+      std::copy(s, s + len, buf_.addr(write_index_));
+      s += len;
+      write_index_ += len;
+      n -= len;
+    }
   }
+
+  enqueue(s, n);
+
   return n_;
 }
 
+void ns::ofstreambuf::enqueue(const char_type *s, std::size_t n) {
+  queued_ += n;
+  while (n) {
+    if (queue_.empty() || !queue_.back().fits(1))
+      queue_.emplace_back().own.reserve(chunk_size);
+    auto &chunk = queue_.back().own;
+    const auto len = std::min(chunk.capacity() - chunk.size(), n);
+    chunk.append(s, len);
+    s += len;
+    n -= len;
+  }
+}
+
+std::span<char> ns::ofstreambuf::prepare_queued(std::size_t n) {
+  if (queue_.empty()) {
+    sync();
+    if (queue_.empty() && buf_.size() - (write_index_ - read_index_) >= n)
+      return {buf_.addr(write_index_), n};
+  }
+
+  if (queue_.empty() || !queue_.back().fits(n))
+    queue_.emplace_back().own.reserve(std::max(chunk_size, n));
+  auto &chunk = queue_.back().own;
+  const auto size = chunk.size();
+  chunk.resize(size + n);
+  prepared_ = n;
+  return {chunk.data() + size, n};
+}
+
+void ns::ofstreambuf::commit_queued(std::size_t n) {
+  assert(n <= prepared_);
+  auto &chunk = queue_.back().own;
+  chunk.resize(chunk.size() - (prepared_ - n));
+  if (chunk.empty())
+    queue_.pop_back();
+  queued_ += n;
+  prepared_ = 0;
+}
+
+void ns::ofstreambuf::share(std::shared_ptr<const std::string> bytes) {
+  if (bytes->size() < min_shared) {
+    xsputn(bytes->data(), std::streamsize(bytes->size()));
+    return;
+  }
+  queued_ += bytes->size();
+  queue_.push_back({{}, std::move(bytes)});
+}
+
 int ns::ofstreambuf::overflow(int_type ch) {
   if (ch != EOF) {
-    sync();
     auto c = static_cast<char>(static_cast<unsigned char>(ch));
     return xsputn(&c, 1) == EOF ? EOF : 0;
   }
@@ -3,9 +3,15 @@
 
 #include <cstdint>
 
+#include <deque>
 #include <functional>
+#include <istream>
+#include <memory>
+#include <optional>
+#include <span>
 #include <stdexcept>
 #include <streambuf>
+#include <string>
 #include <system_error>
 
 #include <sys/mman.h>
@@ -109,7 +115,45 @@ private:
 };
 
 /**
- * A streambuf for outputting to a file_descriptor.
+ * A streambuf for reading a whole file mapped into memory, whose bytes can
+ * also be had in place, without being copied through the stream.
+ */
+class mapped_streambuf : public std::streambuf {
+public:
+  /**
+   * @param path the file, which is as good as empty if there's no such file
+   * @throws std::system_error if it couldn't be opened or mapped
+   */
+  explicit mapped_streambuf(const std::string &path);
+
+  [[nodiscard]] std::span<const char> bytes() const noexcept {
+    return {eback(), egptr()};
+  }
+
+private:
+  std::optional<memory_map> map_;
+};
+
+/**
+ * An input stream with a mapped_streambuf of its own.
+ */
+class mapped_istream : public std::istream {
+public:
+  explicit mapped_istream(const std::string &path)
+      : std::istream(nullptr), buf_(path) {
+    rdbuf(&buf_);
+  }
+
+private:
+  mapped_streambuf buf_;
+};
+
+/**
+ * A streambuf for outputting to a non-blocking file_descriptor. Output the
+ * descriptor won't take yet is kept, first in a ring buffer and then in a queue
+ * of chunks that grows as needed, until a later sync() (e.g. on EPOLLOUT). A
+ * chunk may also be bytes shared with other streams, e.g. a message published
+ * to many subscribers.
  */
 class ofstreambuf : public std::streambuf {
 public:
@@ -117,15 +161,111 @@ public:
   ofstreambuf(const ofstreambuf &) = delete;
   ofstreambuf &operator=(const ofstreambuf &) = delete;
 
+  /**
+   * Hand out the oldest buffered bytes for writing asynchronously (e.g. by
+   * io_uring). sync() writes nothing itself until end_async_write() is called.
+   * @return
+   */
+  std::span<const char> begin_async_write();
+
+  /**
+   * Discard the first written bytes handed out by begin_async_write().
+   * @param written
+   */
+  void end_async_write(std::size_t written);
+
+  [[nodiscard]] bool writing_async() const { return writing_async_; }
+
+  /**
+   * Have sync() write nothing until release(), however much is written in
+   * the meantime, e.g. until what's been written is safe to send.
+   */
+  void hold() { held_ = true; }
+
+  void release() { held_ = false; }
+
+  [[nodiscard]] bool held() const { return held_; }
+
+  /**
+   * @return the number of bytes buffered but not yet written
+   */
+  [[nodiscard]] std::size_t pending() const {
+    return write_index_ - read_index_ + queued_;
+  }
+
+  /**
+   * Room to write n bytes straight into the buffer, behind everything already
+   * written, without going through xsputn(). Must be followed by commit().
+   * @param n
+   * @return
+   */
+  std::span<char> prepare(std::size_t n) {
+    if (queue_.empty() && buf_.size() - (write_index_ - read_index_) >= n)
+      return {buf_.addr(write_index_), n};
+    return prepare_queued(n);
+  }
+
+  /**
+   * Keep the first n bytes of those handed out by the last prepare().
+   * @param n
+   */
+  void commit(std::size_t n) {
+    if (prepared_)
+      commit_queued(n);
+    else
+      write_index_ += n;
+  }
+
+  /**
+   * Write bytes after everything already written. Unless they're fewer than
+   * min_shared, they aren't copied, but queued as a chunk of their own, so the
+   * same bytes can be written to any number of streams for a reference count
+   * each.
+   * @param bytes
+   */
+  void share(std::shared_ptr<const std::string> bytes);
+
+  // below this many bytes, copying them costs less than queueing a reference
+  static constexpr std::size_t min_shared = 512;
+
 private:
+  // bytes of its own, which are appended to, or bytes shared with other
+  // streams, which aren't
+  struct chunk {
+    std::string own;
+    std::shared_ptr<const std::string> shared;
+
+    [[nodiscard]] std::string_view view() const {
+      return shared ? std::string_view(*shared) : std::string_view(own);
+    }
+
+    // whether it's one of its own with room for n more bytes
+    [[nodiscard]] bool fits(std::size_t n) const {
+      return !shared && own.capacity() - own.size() >= n;
+    }
+  };
+
   int sync() override;
   std::streamsize xsputn(const char_type *, std::streamsize) override;
   int overflow(int_type) override;
 
+  void enqueue(const char_type *, std::size_t);
+  std::span<char> prepare_queued(std::size_t);
+  void commit_queued(std::size_t);
+
+  static constexpr std::size_t chunk_size = 1 << 14;
+
   file_descriptor fd_;
   ring_buffer buf_;
   std::size_t read_index_;
   std::size_t write_index_;
+  std::deque<chunk> queue_;
+  std::size_t queue_offset_;
+  std::size_t queued_;
+  // how much of the queue's last chunk was handed out by prepare()
+  std::size_t prepared_;
+  bool writing_async_;
+  bool held_{};
 };
 
 } // namespace redis::io
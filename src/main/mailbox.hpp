@@ -0,0 +1,94 @@
+#ifndef REDIS_SERVER_MAILBOX_HPP
+#define REDIS_SERVER_MAILBOX_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+
+namespace redis {
+
+/**
+ * A bounded, lock-free, single producer, single consumer queue for passing
+ * messages between event loop threads.
+ * @tparam T
+ */
+template <typename T> class mailbox {
+public:
+  explicit mailbox(std::size_t capacity);
+  mailbox(const mailbox &) = delete;
+  mailbox &operator=(const mailbox &) = delete;
+
+  /**
+   * Producer side; value is only moved from if there was room for it.
+   * @param value
+   * @return true if value was enqueued
+   */
+  bool try_push(T &&value);
+
+  /**
+   * Consumer side.
+   * @return the oldest value, if any
+   */
+  std::optional<T> try_pop();
+
+  [[nodiscard]] std::size_t capacity() const { return mask_ + 1; }
+
+private:
+  static constexpr std::size_t cache_line = 64;
+
+  const std::size_t mask_;
+  const std::unique_ptr<std::optional<T>[]> slots_;
+
+  // written by the consumer
+  alignas(cache_line) std::atomic<std::size_t> read_index_{};
+  std::size_t cached_write_index_{};
+
+  // written by the producer
+  alignas(cache_line) std::atomic<std::size_t> write_index_{};
+  std::size_t cached_read_index_{};
+};
+
+} // namespace redis
+
+template <typename T>
+redis::mailbox<T>::mailbox(std::size_t capacity)
+    : mask_(capacity - 1),
+      slots_(std::make_unique<std::optional<T>[]>(capacity)) {
+  if (!capacity || (capacity & mask_))
+    throw std::invalid_argument("mailbox capacity must be a power of two");
+}
+
+template <typename T> bool redis::mailbox<T>::try_push(T &&value) {
+  const auto write_index = write_index_.load(std::memory_order_relaxed);
+
+  if (write_index - cached_read_index_ > mask_) {
+    cached_read_index_ = read_index_.load(std::memory_order_acquire);
+    if (write_index - cached_read_index_ > mask_)
+      return false;
+  }
+
+  slots_[write_index & mask_].emplace(std::move(value));
+  write_index_.store(write_index + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T> std::optional<T> redis::mailbox<T>::try_pop() {
+  const auto read_index = read_index_.load(std::memory_order_relaxed);
+
+  if (read_index == cached_write_index_) {
+    cached_write_index_ = write_index_.load(std::memory_order_acquire);
+    if (read_index == cached_write_index_)
+      return {};
+  }
+
+  auto &slot = slots_[read_index & mask_];
+  std::optional<T> result(std::move(slot));
+  slot.reset();
+  read_index_.store(read_index + 1, std::memory_order_release);
+  return result;
+}
+
+#endif // REDIS_SERVER_MAILBOX_HPP
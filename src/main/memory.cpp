@@ -0,0 +1,69 @@
+#include "memory.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include <malloc.h>
+
+namespace {
+
+// threads beyond this many share counters, which is still right, just slower
+constexpr std::size_t max_counters = 256;
+
+struct alignas(64) counter {
+  // may go negative, for memory freed by a thread other than the allocator
+  std::atomic<std::int64_t> bytes;
+};
+
+counter counters[max_counters];
+std::atomic<std::size_t> threads;
+
+counter &local_counter() noexcept {
+  thread_local counter &result =
+      counters[threads.fetch_add(1, std::memory_order_relaxed) % max_counters];
+  return result;
+}
+
+void *allocate(std::size_t size) noexcept {
+  void *const result = std::malloc(size ? size : 1);
+  if (result)
+    local_counter().bytes.fetch_add(std::int64_t(::malloc_usable_size(result)),
+                                    std::memory_order_relaxed);
+  return result;
+}
+
+} // namespace
+
+std::uint64_t redis::memory::allocated() noexcept {
+  const auto n = std::min(threads.load(std::memory_order_relaxed), max_counters);
+  std::int64_t result{};
+  for (std::size_t i = 0; i < n; ++i)
+    result += counters[i].bytes.load(std::memory_order_relaxed);
+  return std::uint64_t(std::max(result, std::int64_t()));
+}
+
+// the rest of the replaceable forms are defined in terms of these
+
+void *operator new(std::size_t size) {
+  for (;;) {
+    if (void *const result = allocate(size))
+      return result;
+    if (const auto handler = std::get_new_handler())
+      handler();
+    else
+      throw std::bad_alloc();
+  }
+}
+
+void operator delete(void *ptr) noexcept {
+  if (!ptr)
+    return;
+  local_counter().bytes.fetch_sub(std::int64_t(::malloc_usable_size(ptr)),
+                                  std::memory_order_relaxed);
+  std::free(ptr);
+}
+
+// the size is ignored, as what's counted is malloc_usable_size()
+void operator delete(void *ptr, std::size_t) noexcept { operator delete(ptr); }
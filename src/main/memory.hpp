@@ -0,0 +1,18 @@
+#ifndef REDIS_SERVER_MEMORY_HPP
+#define REDIS_SERVER_MEMORY_HPP
+
+#include <cstdint>
+
+namespace redis::memory {
+
+/**
+ * How much memory is allocated through operator new, which is replaced to
+ * keep count, as Redis' zmalloc does. Each thread counts into its own cache
+ * line, so this only has to add them up.
+ * @return bytes, including malloc's rounding up
+ */
+std::uint64_t allocated() noexcept;
+
+} // namespace redis::memory
+
+#endif // REDIS_SERVER_MEMORY_HPP
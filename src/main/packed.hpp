@@ -0,0 +1,54 @@
+#ifndef REDIS_SERVER_PACKED_HPP
+#define REDIS_SERVER_PACKED_HPP
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+/**
+ * Strings packed back to back in a buffer, each after its length as a varint,
+ * as in the nodes of a quicklist and small hashes.
+ */
+namespace redis::packed {
+
+inline constexpr std::size_t max_varint = 10;
+
+// length as a varint, 7 bits to a byte, low bits first
+inline std::size_t encode_length(std::array<char, max_varint> &buf,
+                                 std::uint64_t length) noexcept {
+  std::size_t result = 0;
+  for (; length >= 0x80; length >>= 7)
+    buf[result++] = static_cast<char>(length | 0x80);
+  buf[result++] = static_cast<char>(length);
+  return result;
+}
+
+// the element at p
+inline std::string_view decode(const char *p) noexcept {
+  std::uint64_t length = 0;
+  for (unsigned shift = 0;; shift += 7) {
+    const auto byte = static_cast<unsigned char>(*p++);
+    length |= std::uint64_t(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      break;
+  }
+  return {p, length};
+}
+
+// where the element after element starts
+inline const char *next(std::string_view element) noexcept {
+  return element.data() + element.size();
+}
+
+inline void append(std::vector<char> &bytes, std::string_view s) {
+  std::array<char, max_varint> length;
+  const auto length_bytes = encode_length(length, s.size());
+  bytes.insert(bytes.end(), length.begin(),
+               length.begin() + std::ptrdiff_t(length_bytes));
+  bytes.insert(bytes.end(), s.begin(), s.end());
+}
+
+} // namespace redis::packed
+
+#endif // REDIS_SERVER_PACKED_HPP
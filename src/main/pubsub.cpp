@@ -0,0 +1,242 @@
+#include "pubsub.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+
+namespace {
+
+constexpr std::string_view message_header = "*3\r\n$7\r\nmessage\r\n";
+
+void append_bulk_string(std::string &frame, std::string_view s) {
+  std::array<char, 24> length;
+  length[0] = '$';
+  const auto end =
+      std::to_chars(length.begin() + 1, length.end(), s.size()).ptr;
+  frame.append(length.begin(), end);
+  frame += "\r\n";
+  frame += s;
+  frame += "\r\n";
+}
+
+// the channel of a frame made by pubsub::message()
+std::string_view channel_of(std::string_view frame) {
+  std::size_t size{};
+  const auto *const begin = frame.data() + message_header.size() + 1;
+  const auto *const end =
+      std::from_chars(begin, frame.data() + frame.size(), size).ptr;
+  return {end + 2, size};
+}
+
+// the text a pattern starts with, before any character special to it
+std::string_view literal_prefix(std::string_view pattern) {
+  return pattern.substr(0, std::min(pattern.find_first_of("*?[\\"),
+                                    pattern.size()));
+}
+
+// remove the first of value from v, in no particular order
+template <typename T> void erase_unordered(std::vector<T> &v, const T &value) {
+  const auto pos = std::find(v.begin(), v.end(), value);
+  if (pos == v.end())
+    return;
+  *pos = std::move(v.back());
+  v.pop_back();
+}
+
+} // namespace
+
+redis::pubsub::frame_t redis::pubsub::message(std::string_view channel,
+                                              std::string_view message) {
+  auto result = std::make_shared<std::string>();
+  result->reserve(message_header.size() + channel.size() + message.size() +
+                  2 * 24);
+  *result += message_header;
+  append_bulk_string(*result, channel);
+  append_bulk_string(*result, message);
+  return result;
+}
+
+std::size_t redis::pubsub::publish(const frame_t &frame) {
+  const auto channel = channel_of(*frame);
+  std::size_t result = 0;
+  if (const auto pos = channels_.find(channel); pos != channels_.end()) {
+    for (auto *const s : pos->second)
+      s->deliver(frame);
+    result += pos->second.size();
+  }
+
+  for (const auto &[length, count] : prefix_lengths_) {
+    if (length > channel.size())
+      break;
+    const auto pos = patterns_.find(channel.substr(0, length));
+    if (pos == patterns_.end())
+      continue;
+    for (const auto &p : pos->second) {
+      if (!util::glob_match(std::string_view(p.text).substr(length),
+                            channel.substr(length)))
+        continue;
+      // pmessage, the pattern, and then the channel and message as they are
+      auto pmessage = std::make_shared<std::string>("*4\r\n$8\r\npmessage\r\n");
+      append_bulk_string(*pmessage, p.text);
+      *pmessage += std::string_view(*frame).substr(message_header.size());
+      const frame_t shared = std::move(pmessage);
+      for (auto *const s : p.subscribers)
+        s->deliver(shared);
+      result += p.subscribers.size();
+    }
+  }
+  return result;
+}
+
+void redis::pubsub::subscribe(subscriber &s,
+                              std::span<const std::string_view> channels,
+                              resp::handler &output) {
+  for (const auto channel : channels) {
+    add_channel(s, channel);
+    reply(output, "subscribe", channel, s);
+  }
+}
+
+void redis::pubsub::unsubscribe(subscriber &s,
+                                std::span<const std::string_view> channels,
+                                resp::handler &output) {
+  if (!channels.empty()) {
+    for (const auto channel : channels) {
+      remove_channel(s, channel);
+      reply(output, "unsubscribe", channel, s);
+    }
+  } else if (auto *const subscriptions = find(s);
+             subscriptions && !subscriptions->channels.empty()) {
+    for (const auto &channel : names_t(subscriptions->channels)) {
+      remove_channel(s, channel);
+      reply(output, "unsubscribe", channel, s);
+    }
+  } else {
+    reply(output, "unsubscribe", std::nullopt, s);
+  }
+  tidy(s);
+}
+
+void redis::pubsub::psubscribe(subscriber &s,
+                               std::span<const std::string_view> patterns,
+                               resp::handler &output) {
+  for (const auto text : patterns) {
+    add_pattern(s, text);
+    reply(output, "psubscribe", text, s);
+  }
+}
+
+void redis::pubsub::punsubscribe(subscriber &s,
+                                 std::span<const std::string_view> patterns,
+                                 resp::handler &output) {
+  if (!patterns.empty()) {
+    for (const auto text : patterns) {
+      remove_pattern(s, text);
+      reply(output, "punsubscribe", text, s);
+    }
+  } else if (auto *const subscriptions = find(s);
+             subscriptions && !subscriptions->patterns.empty()) {
+    for (const auto &text : names_t(subscriptions->patterns)) {
+      remove_pattern(s, text);
+      reply(output, "punsubscribe", text, s);
+    }
+  } else {
+    reply(output, "punsubscribe", std::nullopt, s);
+  }
+  tidy(s);
+}
+
+void redis::pubsub::unsubscribe_all(subscriber &s) {
+  auto *const subscriptions = find(s);
+  if (!subscriptions)
+    return;
+  for (const auto &channel : names_t(subscriptions->channels))
+    remove_channel(s, channel);
+  for (const auto &text : names_t(subscriptions->patterns))
+    remove_pattern(s, text);
+  subscribers_.erase(&s);
+}
+
+std::size_t redis::pubsub::subscriptions(const subscriber &s) const {
+  const auto pos = subscribers_.find(&s);
+  return pos == subscribers_.end()
+             ? 0
+             : pos->second.channels.size() + pos->second.patterns.size();
+}
+
+redis::pubsub::subscriptions_t *redis::pubsub::find(const subscriber &s) {
+  const auto pos = subscribers_.find(&s);
+  return pos == subscribers_.end() ? nullptr : &pos->second;
+}
+
+void redis::pubsub::add_channel(subscriber &s, std::string_view channel) {
+  if (subscribers_[&s].channels.emplace(channel).second)
+    channels_[channel].push_back(&s);
+}
+
+void redis::pubsub::remove_channel(subscriber &s, std::string_view channel) {
+  auto *const subscriptions = find(s);
+  if (!subscriptions || !subscriptions->channels.erase(channel))
+    return;
+  const auto pos = channels_.find(channel);
+  erase_unordered(pos->second, &s);
+  if (pos->second.empty())
+    channels_.erase(pos);
+}
+
+void redis::pubsub::add_pattern(subscriber &s, std::string_view text) {
+  if (!subscribers_[&s].patterns.emplace(text).second)
+    return;
+  const auto prefix = literal_prefix(text);
+  auto &patterns = patterns_[prefix];
+  auto pos = std::find_if(patterns.begin(), patterns.end(),
+                          [&](const pattern &p) { return p.text == text; });
+  if (pos == patterns.end()) {
+    pos = patterns.insert(patterns.end(), {std::string(text), {}});
+    ++prefix_lengths_[prefix.size()];
+  }
+  pos->subscribers.push_back(&s);
+}
+
+void redis::pubsub::remove_pattern(subscriber &s, std::string_view text) {
+  auto *const subscriptions = find(s);
+  if (!subscriptions || !subscriptions->patterns.erase(text))
+    return;
+  const auto prefix = literal_prefix(text);
+  const auto bucket = patterns_.find(prefix);
+  auto &patterns = bucket->second;
+  const auto pos =
+      std::find_if(patterns.begin(), patterns.end(),
+                   [&](const pattern &p) { return p.text == text; });
+  erase_unordered(pos->subscribers, &s);
+  if (!pos->subscribers.empty())
+    return;
+
+  *pos = std::move(patterns.back());
+  patterns.pop_back();
+  if (patterns.empty())
+    patterns_.erase(bucket);
+  if (const auto length = prefix_lengths_.find(prefix.size());
+      !--length->second)
+    prefix_lengths_.erase(length);
+}
+
+void redis::pubsub::tidy(const subscriber &s) {
+  if (const auto pos = subscribers_.find(&s);
+      pos != subscribers_.end() && pos->second.channels.empty() &&
+      pos->second.patterns.empty())
+    subscribers_.erase(pos);
+}
+
+void redis::pubsub::reply(resp::handler &output, std::string_view kind,
+                          std::optional<std::string_view> name,
+                          const subscriber &s) const {
+  output.begin_array(3);
+  output.bulk_string(kind);
+  if (name)
+    output.bulk_string(*name);
+  else
+    output.null_bulk_string();
+  output.integer(std::int64_t(subscriptions(s)));
+  output.end_array();
+}
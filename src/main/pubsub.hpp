@@ -0,0 +1,146 @@
+#ifndef REDIS_SERVER_PUBSUB_HPP
+#define REDIS_SERVER_PUBSUB_HPP
+
+#include "resp.hpp"
+#include "util.hpp"
+
+#include <ankerl/unordered_dense.h>
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace redis {
+
+/**
+ * Something that can be sent published messages, e.g. a client connection.
+ */
+class subscriber {
+public:
+  /**
+   * Queue up a message for sending. The frame is shared with every other
+   * subscriber it's sent to, so it should be kept, not copied.
+   * @param frame the message as RESP
+   */
+  virtual void deliver(const std::shared_ptr<const std::string> &frame) = 0;
+
+  virtual ~subscriber() = default;
+};
+
+/**
+ * The channels and patterns subscribed to, and by whom, for SUBSCRIBE,
+ * PSUBSCRIBE, their UNSUBSCRIBE counterparts and PUBLISH. A message is
+ * encoded once, and the same frame handed to each subscriber, so that
+ * publishing to thousands costs a reference each rather than a copy. Patterns
+ * are filed under the literal text they start with, so that a channel is only
+ * matched against those that start with some prefix of it.
+ */
+class pubsub {
+public:
+  using frame_t = std::shared_ptr<const std::string>;
+
+  /**
+   * @param channel
+   * @param message
+   * @return message on channel as subscribers to channel are sent it
+   */
+  static frame_t message(std::string_view channel, std::string_view message);
+
+  /**
+   * Send a message to the subscribers to its channel and to patterns
+   * matching it.
+   * @param frame made by message()
+   * @return how many subscriptions it was sent for
+   */
+  std::size_t publish(const frame_t &frame);
+
+  /**
+   * Subscribe s to each of channels, replying for each with how many
+   * subscriptions s then has, as SUBSCRIBE does.
+   * @param s
+   * @param channels
+   * @param output
+   */
+  void subscribe(subscriber &s, std::span<const std::string_view> channels,
+                 resp::handler &output);
+
+  /**
+   * Unsubscribe s from each of channels, or from all of its channels if none
+   * are given, replying as UNSUBSCRIBE does.
+   * @param s
+   * @param channels
+   * @param output
+   */
+  void unsubscribe(subscriber &s, std::span<const std::string_view> channels,
+                   resp::handler &output);
+
+  void psubscribe(subscriber &s, std::span<const std::string_view> patterns,
+                  resp::handler &output);
+
+  void punsubscribe(subscriber &s, std::span<const std::string_view> patterns,
+                    resp::handler &output);
+
+  /**
+   * Drop all of the subscriptions of s, e.g. as it disconnects.
+   * @param s
+   */
+  void unsubscribe_all(subscriber &s);
+
+  /**
+   * @param s
+   * @return how many channels and patterns s is subscribed to
+   */
+  [[nodiscard]] std::size_t subscriptions(const subscriber &s) const;
+
+private:
+  using names_t =
+      ankerl::unordered_dense::set<std::string, util::cs_hash, std::equal_to<>>;
+
+  struct pattern {
+    std::string text;
+    std::vector<subscriber *> subscribers;
+  };
+
+  // the channels and patterns of a subscriber
+  struct subscriptions_t {
+    names_t channels;
+    names_t patterns;
+  };
+
+  // s's subscriptions, or nullptr if it has none
+  subscriptions_t *find(const subscriber &s);
+
+  void add_channel(subscriber &s, std::string_view channel);
+  void remove_channel(subscriber &s, std::string_view channel);
+  void add_pattern(subscriber &s, std::string_view text);
+  void remove_pattern(subscriber &s, std::string_view text);
+
+  // forget s if it has no subscriptions left
+  void tidy(const subscriber &s);
+
+  // a reply to a (P)(UN)SUBSCRIBE, with no name if s had nothing to
+  // unsubscribe from
+  void reply(resp::handler &output, std::string_view kind,
+             std::optional<std::string_view> name, const subscriber &s) const;
+
+  ankerl::unordered_dense::map<std::string, std::vector<subscriber *>,
+                               util::cs_hash, std::equal_to<>>
+      channels_;
+  // patterns by the text before the first of their special characters
+  ankerl::unordered_dense::map<std::string, std::vector<pattern>,
+                               util::cs_hash, std::equal_to<>>
+      patterns_;
+  // how many patterns have a prefix of each length, so that a channel is
+  // looked up by its prefixes of only those lengths
+  std::map<std::size_t, std::size_t> prefix_lengths_;
+  ankerl::unordered_dense::map<const subscriber *, subscriptions_t>
+      subscribers_;
+};
+
+} // namespace redis
+
+#endif // REDIS_SERVER_PUBSUB_HPP
@@ -0,0 +1,102 @@
+#include "quicklist.hpp"
+#include "packed.hpp"
+
+#include <cstring>
+
+using redis::packed::decode;
+using redis::packed::next;
+
+redis::quicklist::const_iterator::const_iterator(node_iterator node,
+                                                 node_iterator end,
+                                                 const char *pos) noexcept
+    : node_(node), end_(end), current_(node == end ? std::string_view()
+                                                   : decode(pos)) {}
+
+redis::quicklist::const_iterator &
+redis::quicklist::const_iterator::operator++() noexcept {
+  const char *const pos = next(current_);
+  if (pos != node_->bytes.data() + node_->bytes.size()) {
+    current_ = decode(pos);
+  } else if (++node_ != end_) {
+    current_ = decode(node_->bytes.data());
+  } else {
+    current_ = {};
+  }
+  return *this;
+}
+
+redis::quicklist::quicklist(std::initializer_list<std::string_view> elements) {
+  for (const auto s : elements)
+    push_back(s);
+}
+
+void redis::quicklist::push_back(std::string_view s) {
+  std::array<char, packed::max_varint> length;
+  auto &node = node_for(packed::encode_length(length, s.size()) + s.size(),
+                        false);
+  packed::append(node.bytes, s);
+  ++node.count;
+  ++size_;
+}
+
+void redis::quicklist::push_front(std::string_view s) {
+  std::array<char, packed::max_varint> length;
+  const auto length_bytes = packed::encode_length(length, s.size());
+  auto &node = node_for(length_bytes + s.size(), true);
+  // one move of what's there already
+  node.bytes.insert(node.bytes.begin(), length_bytes + s.size(), 0);
+  std::memcpy(node.bytes.data(), length.data(), length_bytes);
+  std::memcpy(node.bytes.data() + length_bytes, s.data(), s.size());
+  ++node.count;
+  ++size_;
+}
+
+redis::quicklist::node &redis::quicklist::node_for(std::size_t bytes,
+                                                   bool front) {
+  // an element too big for any node gets one to itself
+  const auto full = [&](const node &node) {
+    return node.count && node.bytes.size() + bytes > max_node_bytes;
+  };
+  if (front) {
+    if (nodes_.empty() || full(nodes_.front()))
+      nodes_.emplace_front();
+    return nodes_.front();
+  }
+  if (nodes_.empty() || full(nodes_.back()))
+    nodes_.emplace_back();
+  return nodes_.back();
+}
+
+redis::quicklist::const_iterator redis::quicklist::begin() const noexcept {
+  return {nodes_.begin(), nodes_.end(),
+          nodes_.empty() ? nullptr : nodes_.front().bytes.data()};
+}
+
+redis::quicklist::const_iterator redis::quicklist::end() const noexcept {
+  return {nodes_.end(), nodes_.end(), nullptr};
+}
+
+redis::quicklist::const_iterator
+redis::quicklist::at(std::size_t index) const noexcept {
+  if (index >= size_)
+    return end();
+
+  node_iterator node;
+  if (index < size_ / 2) {
+    node = nodes_.begin();
+    for (; index >= node->count; ++node)
+      index -= node->count;
+  } else {
+    // counting back from the end
+    auto from_end = size_ - index;
+    node = nodes_.end();
+    while (from_end > (--node)->count)
+      from_end -= node->count;
+    index = node->count - from_end;
+  }
+
+  const char *pos = node->bytes.data();
+  for (; index; --index)
+    pos = next(decode(pos));
+  return {node, nodes_.end(), pos};
+}
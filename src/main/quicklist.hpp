@@ -0,0 +1,104 @@
+#ifndef REDIS_SERVER_QUICKLIST_HPP
+#define REDIS_SERVER_QUICKLIST_HPP
+
+#include <cstdint>
+#include <deque>
+#include <initializer_list>
+#include <iterator>
+#include <string_view>
+#include <vector>
+
+namespace redis {
+
+/**
+ * A list of strings kept as a chain of packed nodes, as in Redis' quicklist.
+ * Each node holds up to about 8KB of elements back to back, each after its
+ * length as a varint, along with how many there are, so that an element is
+ * found by index by skipping whole nodes and then walking one.
+ */
+class quicklist {
+  struct node {
+    std::vector<char> bytes;
+    std::uint32_t count{};
+  };
+
+  using node_iterator = std::deque<node>::const_iterator;
+
+public:
+  class const_iterator {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const std::string_view *;
+    using reference = std::string_view;
+
+    const_iterator() = default;
+
+    std::string_view operator*() const noexcept { return current_; }
+
+    const std::string_view *operator->() const noexcept { return &current_; }
+
+    const_iterator &operator++() noexcept;
+
+    const_iterator operator++(int) noexcept {
+      auto result = *this;
+      ++*this;
+      return result;
+    }
+
+    friend bool operator==(const const_iterator &lhs,
+                           const const_iterator &rhs) noexcept {
+      return lhs.node_ == rhs.node_ &&
+             lhs.current_.data() == rhs.current_.data();
+    }
+
+  private:
+    friend class quicklist;
+
+    // pos is the start of an element of node, unless node is end
+    const_iterator(node_iterator node, node_iterator end,
+                   const char *pos) noexcept;
+
+    node_iterator node_;
+    node_iterator end_;
+    std::string_view current_;
+  };
+
+  quicklist() = default;
+
+  quicklist(std::initializer_list<std::string_view> elements);
+
+  void push_back(std::string_view s);
+
+  void push_front(std::string_view s);
+
+  [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+  [[nodiscard]] bool empty() const noexcept { return !size_; }
+
+  [[nodiscard]] const_iterator begin() const noexcept;
+
+  [[nodiscard]] const_iterator end() const noexcept;
+
+  /**
+   * @param index
+   * @return the element at index, or end() if there's no such element, found
+   * from whichever end of the list is nearer
+   */
+  [[nodiscard]] const_iterator at(std::size_t index) const noexcept;
+
+private:
+  // nodes are split at this size, as with Redis' default list-max-listpack-size
+  static constexpr std::size_t max_node_bytes = 8192;
+
+  // the node to push onto at the front or back, adding one if it's full
+  node &node_for(std::size_t bytes, bool front);
+
+  std::deque<node> nodes_;
+  std::size_t size_{};
+};
+
+} // namespace redis
+
+#endif // REDIS_SERVER_QUICKLIST_HPP
@@ -1,17 +1,45 @@
+#include "append_only_file.hpp"
+#include "background_task.hpp"
 #include "command_handler.hpp"
+#include "command_table.hpp"
 #include "commands.hpp"
 #include "database.hpp"
 #include "io.hpp"
+#include "mailbox.hpp"
+#include "pubsub.hpp"
 #include "resp.hpp"
+#include "util.hpp"
+
+#ifdef REDIS_SERVER_IO_URING
+#include "uring.hpp"
+#endif
+
+#include <ankerl/unordered_dense.h>
 
 #include <array>
+#include <atomic>
+#include <barrier>
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <fstream>
 #include <iostream>
 #include <list>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <fcntl.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
 #include <signal.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/socket.h>
 
 namespace {
@@ -59,16 +87,212 @@ void install_sig_handlers() {
   ::sigaction(SIGPIPE, &sa, nullptr);
 }
 
-class client {
-public:
-  explicit client(redis::io::file_descriptor fd, redis::database &dict)
-      : in_fd_(std::move(fd)), dict_(dict) {
-    set_socket_option(in_fd_.value(), SOL_SOCKET, SO_SNDBUF, 1 << 20);
+// how much unsent output a client may have before it gets disconnected; it
+// can go over the soft limit, but not for soft_seconds in a row. 0 is no limit.
+struct output_limit {
+  std::uint64_t hard{};
+  std::uint64_t soft{};
+  std::chrono::seconds soft_seconds{};
+};
+
+struct options {
+  enum class io_backend { epoll, io_uring };
+
+  std::size_t threads = 1;
+  std::uint16_t port = 6379;
+  io_backend io = io_backend::epoll;
+  output_limit client_output_limit;
+  // shared between the shards, each of which evicts its own keys
+  std::uint64_t maxmemory{};
+  redis::eviction_policy maxmemory_policy = redis::eviction_policy::noeviction;
+  std::size_t set_max_intset_entries = redis::set::default_max_intset_entries;
+  // whether each shard logs its writes to an append only file, which is
+  // loaded rather than the snapshot on start up
+  bool appendonly{};
+  redis::append_only_file::fsync_policy appendfsync =
+      redis::append_only_file::fsync_policy::everysec;
+};
+
+template <typename Integer>
+Integer parse_option(std::string_view name, std::string_view value) {
+  Integer result{};
+  auto [ptr, ec] = std::from_chars(value.begin(), value.end(), result);
+  if (ec != std::errc() || ptr != value.end())
+    throw std::invalid_argument("bad value for " + std::string(name));
+  return result;
+}
+
+std::uint64_t parse_memory_option(std::string_view name,
+                                  std::string_view value) {
+  if (auto result = redis::util::parse_memory(value))
+    return *result;
+  throw std::invalid_argument("bad value for " + std::string(name));
+}
+
+redis::eviction_policy parse_eviction_policy(std::string_view name,
+                                             std::string_view value) {
+  if (value == "noeviction")
+    return redis::eviction_policy::noeviction;
+  if (value == "allkeys-lru")
+    return redis::eviction_policy::allkeys_lru;
+  if (value == "allkeys-lfu")
+    return redis::eviction_policy::allkeys_lfu;
+  if (value == "volatile-ttl")
+    return redis::eviction_policy::volatile_ttl;
+  throw std::invalid_argument("bad value for " + std::string(name));
+}
+
+bool parse_yes_no(std::string_view name, std::string_view value) {
+  if (value == "yes")
+    return true;
+  if (value == "no")
+    return false;
+  throw std::invalid_argument("bad value for " + std::string(name));
+}
+
+redis::append_only_file::fsync_policy
+parse_fsync_policy(std::string_view name, std::string_view value) {
+  using policy = redis::append_only_file::fsync_policy;
+  if (value == "always")
+    return policy::always;
+  if (value == "everysec")
+    return policy::everysec;
+  if (value == "no")
+    return policy::no;
+  throw std::invalid_argument("bad value for " + std::string(name));
+}
+
+// "<hard limit> <soft limit> <soft seconds>", as in redis.conf
+output_limit parse_output_limit(std::string_view name, std::string_view value) {
+  std::vector<std::string_view> fields;
+  redis::util::tokenize(value.begin(), value.end(),
+                        [&fields](const char *begin, const char *end) {
+                          fields.emplace_back(begin, end - begin);
+                          return true;
+                        });
+  if (fields.size() != 3)
+    throw std::invalid_argument("bad value for " + std::string(name));
+  return {parse_memory_option(name, fields[0]),
+          parse_memory_option(name, fields[1]),
+          std::chrono::seconds(parse_option<std::uint32_t>(name, fields[2]))};
+}
+
+options parse_options(int argc, char *argv[]) {
+  options result;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view name = argv[i];
+    if (i + 1 == argc)
+      throw std::invalid_argument("missing value for " + std::string(name));
+    const std::string_view value = argv[++i];
+    if (name == "--threads")
+      result.threads = parse_option<std::size_t>(name, value);
+    else if (name == "--port")
+      result.port = parse_option<std::uint16_t>(name, value);
+    else if (name == "--io-backend" && value == "epoll")
+      result.io = options::io_backend::epoll;
+#ifdef REDIS_SERVER_IO_URING
+    else if (name == "--io-backend" && value == "io_uring")
+      result.io = options::io_backend::io_uring;
+#endif
+    else if (name == "--client-output-buffer-limit")
+      result.client_output_limit = parse_output_limit(name, value);
+    else if (name == "--maxmemory")
+      result.maxmemory = parse_memory_option(name, value);
+    else if (name == "--maxmemory-policy")
+      result.maxmemory_policy = parse_eviction_policy(name, value);
+    else if (name == "--set-max-intset-entries")
+      result.set_max_intset_entries = parse_option<std::size_t>(name, value);
+    else if (name == "--appendonly")
+      result.appendonly = parse_yes_no(name, value);
+    else if (name == "--appendfsync")
+      result.appendfsync = parse_fsync_policy(name, value);
+    else if (name == "--io-backend")
+      throw std::invalid_argument("unsupported io backend " +
+                                  std::string(value));
+    else
+      throw std::invalid_argument("unknown option " + std::string(name));
   }
+  if (result.threads == 0)
+    throw std::invalid_argument("--threads must be at least 1");
+  return result;
+}
+
+std::int64_t unix_time() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+/**
+ * How saving is going, shared by the reactors, any of which may start a
+ * background save and all of which report on it.
+ */
+struct persistence {
+  explicit persistence(std::size_t shards)
+      : barrier(std::ptrdiff_t(shards)) {}
+
+  // where the others wait while the reactor starting a background save forks
+  std::barrier<> barrier;
+  // set while that reactor waits for them to stop
+  std::atomic<bool> forking;
+  std::atomic<bool> bgsave_in_progress;
+  std::atomic<bool> last_bgsave_ok{true};
+  // in seconds since the epoch
+  std::atomic<std::int64_t> last_save{unix_time()};
+  std::atomic<std::int64_t> bgsave_started;
+  std::atomic<std::int64_t> last_bgsave_seconds{-1};
+  // how long the last fork stopped the server for
+  std::atomic<std::int64_t> latest_fork_usec;
+};
+
+/**
+ * A command or its reply passed between the event loops of different shards,
+ * or a message published to the subscribers of every shard.
+ */
+struct message {
+  enum class kind { request, reply, publish };
+
+  kind type;
+  std::size_t origin;
+  std::uint64_t client_id;
+  std::string payload;
+  // a published message, shared rather than copied for each shard
+  redis::pubsub::frame_t frame;
+};
+
+// where a command should be executed
+struct destination {
+  enum class kind { local, shard, all_shards, cross_shard };
+
+  kind type;
+  std::size_t shard;
+};
+
+std::string encode(const std::vector<std::string_view> &args) {
+  std::ostringstream os;
+  redis::resp::writer writer(os);
+  writer.begin_array(std::int64_t(args.size()));
+  for (const auto &arg : args) {
+    writer.begin_bulk_string(std::int64_t(arg.size()));
+    writer.chars(arg.data(), arg.data() + arg.size());
+    writer.end_bulk_string();
+  }
+  writer.end_array();
+  return std::move(os).str();
+}
+
+class reactor;
+
+class client : public redis::router, public redis::subscriber {
+public:
+  explicit client(redis::io::file_descriptor fd, reactor &reactor,
+                  std::uint64_t id);
 
   client(const client &) = delete;
   client &operator=(const client &) = delete;
 
+  ~client() override;
+
   void on_readable() {
     for (;;) {
       const auto len = in_.size() - (in_write_index_ - in_read_index_);
@@ -83,7 +307,7 @@ public:
         if (errno == EINTR) {
           continue;
         } else if (errno == EWOULDBLOCK) {
-          ostream_.flush();
+          flush();
           return;
         } else
           throw std::system_error(errno, std::generic_category());
@@ -98,99 +322,1118 @@ public:
           in_.addr(in_read_index_) + (in_write_index_ - in_read_index_);
 
       in_read_index_ += parser_.parse(begin, end) - begin;
+      server_.execute();
+      server_.detach();
 
-      if (ostream_.bad())
-        throw std::runtime_error("slow consumer");
+      check_output();
 
       if (n < len) {
-        ostream_.flush();
+        flush();
         return;
       }
     }
   }
 
+  /**
+   * Consume bytes already read from the socket on the client's behalf, e.g.
+   * by io_uring into a provided buffer. The buffer is parsed in place and only
+   * an incomplete trailing command is copied into the input ring.
+   * @param begin
+   * @param end
+   */
+  void on_received(const char *begin, const char *end) {
+    while (begin != end) {
+      if (in_read_index_ == in_write_index_) {
+        begin = parser_.parse(begin, end);
+        server_.execute();
+        server_.detach();
+        if (std::size_t(end - begin) > in_.size())
+          throw std::runtime_error("input buffer overflow");
+        std::copy(begin, end, in_.addr(in_write_index_));
+        in_write_index_ += end - begin;
+        break;
+      }
+
+      // top up the incomplete command in the input ring, a bit at a time
+      const auto n = std::min<std::size_t>(
+          end - begin, in_.size() - (in_write_index_ - in_read_index_));
+      if (n == 0)
+        throw std::runtime_error("input buffer overflow");
+      std::copy(begin, begin + n, in_.addr(in_write_index_));
+      in_write_index_ += n;
+      begin += n;
+
+      const char *const pos = in_.addr(in_read_index_);
+      in_read_index_ +=
+          parser_.parse(pos, pos + (in_write_index_ - in_read_index_)) - pos;
+      server_.execute();
+      server_.detach();
+    }
+
+    check_output();
+  }
+
+  /**
+   * The socket has room for more output again.
+   */
+  void on_writable() {
+    flush();
+    check_output();
+  }
+
+  /**
+   * Disconnect by throwing if writing failed, or if the client isn't reading
+   * its replies fast enough to stay within the output buffer limits.
+   */
+  void check_output();
+
+  /**
+   * Called by the reactor with a reply from another shard to the command at
+   * the front of the pending queue. Output is left buffered.
+   * @param reply
+   */
+  void on_reply(std::string_view reply);
+
+  /**
+   * Queue up a message published to a channel the client is subscribed to,
+   * to be sent once the reactor is done with what it's doing.
+   * @param frame
+   */
+  void deliver(const redis::pubsub::frame_t &frame) override;
+
   [[nodiscard]] int fd() const { return in_fd_.value(); }
 
+  [[nodiscard]] std::uint64_t id() const { return id_; }
+
+  // whether the reactor has queued it up to have its output sent
+  bool send_scheduled_{};
+
+  // whether it has been disconnected, but can't go until in flight I/O is done
+  bool closing_{};
+
+private:
+  // a command that was either sent to other shards or is queued up behind one
+  // that was, so that replies go out in the order the commands came in
+  struct pending_command {
+    std::vector<std::string> args;
+    std::size_t awaited_replies{};
+    bool relay_reply{};
+  };
+
+  bool route(const std::vector<std::string_view> &args) override;
+
+  // send buffered output, or have the reactor send it at the end of the
+  // round if it's held until the writes it acknowledges are durable
+  void flush();
+
+  bool execute(const std::vector<std::string_view> &args);
+
+  // run a command with the pubsub flag
+  void pubsub_command(const std::vector<std::string_view> &args);
+
+  // run a command with the server flag
+  void server_command(const std::vector<std::string_view> &args);
+
+  void info(const std::vector<std::string_view> &args);
+
+  void error(std::string_view msg);
+
+  reactor &reactor_;
+  const std::uint64_t id_;
+  std::deque<pending_command> pending_;
+  // when pending output last went over the soft limit, if it still is
+  std::optional<std::chrono::steady_clock::time_point> over_soft_limit_since_;
+
 public:
   redis::io::file_descriptor in_fd_;
-  redis::database &dict_;
   redis::io::ring_buffer in_{1 << 13};
   std::size_t in_read_index_{};
   std::size_t in_write_index_{};
   redis::io::ofstreambuf ofstreambuf_{
       redis::io::file_descriptor{::dup, in_fd_.value()}, 1 << 13};
   std::ostream ostream_{&ofstreambuf_};
-  redis::resp::writer writer_{ostream_};
-  redis::command_handler server_{dict_, writer_};
-  redis::resp::parser parser_{server_};
+  redis::resp::buffer_writer writer_{ofstreambuf_};
+  redis::command_handler server_;
+  redis::resp::basic_parser<redis::command_handler> parser_{server_};
 };
 
+// a snapshot that can't be loaded is left for someone to look into, rather
+// than started without and then saved over
 void load(redis::database &db) {
-  redis::resp::null_handler null_handler;
-  redis_cmd_load({"load"}, db, null_handler);
+  std::ostringstream reply;
+  redis::resp::writer writer(reply);
+  redis_cmd_load({"load"}, db, writer);
+  // an error's message, without its framing
+  if (const auto view = reply.view(); view != "+OK\r\n")
+    throw std::runtime_error("failed to load state: " +
+                             std::string(view.substr(1, view.size() - 3)));
 }
 
-} // namespace
+// @return whether it worked
+bool save(redis::database &db) {
+  std::ostringstream reply;
+  redis::resp::writer writer(reply);
+  redis_cmd_save({"save"}, db, writer);
+  return reply.view() == "+OK\r\n";
+}
 
-int main(int, char *[]) {
-  namespace ns = redis;
-  using ns::io::posix_call;
+// each shard persists its own keys, so the thread count must not change
+// between a save and a load
+std::string state_path(const options &opts, std::size_t shard) {
+  return opts.threads == 1 ? "state.db"
+                           : "state." + std::to_string(shard) + ".db";
+}
 
-  install_sig_handlers();
+// likewise for the append only files
+std::string aof_path(const options &opts, std::size_t shard) {
+  return opts.threads == 1 ? "appendonly.aof"
+                           : "appendonly." + std::to_string(shard) + ".aof";
+}
+
+std::unique_ptr<redis::append_only_file> open_aof(const options &opts,
+                                                  std::size_t shard) {
+  if (!opts.appendonly)
+    return {};
+  return std::make_unique<redis::append_only_file>(aof_path(opts, shard),
+                                                   opts.appendfsync);
+}
+
+/**
+ * A snapshot written beside its path and renamed over it once it's complete,
+ * so that a save that fails part way, or is killed, leaves the last one be.
+ * The name it's written under has the writer's pid in it, as a SAVE and a
+ * BGSAVE's child may be writing at the same time.
+ */
+class snapshot_file : public std::fstream {
+public:
+  snapshot_file(std::string path, std::atomic<std::int64_t> &last_save)
+      : std::fstream(path + "." + std::to_string(::getpid()) + ".tmp",
+                     std::fstream::out | std::fstream::trunc),
+        path_(std::move(path)),
+        temp_path_(path_ + "." + std::to_string(::getpid()) + ".tmp"),
+        last_save_(last_save) {}
+
+  ~snapshot_file() override {
+    close();
+    if (!fail() && std::rename(temp_path_.c_str(), path_.c_str()) == 0)
+      last_save_ = unix_time();
+    else
+      std::remove(temp_path_.c_str());
+  }
+
+private:
+  std::string path_;
+  std::string temp_path_;
+  std::atomic<std::int64_t> &last_save_;
+};
+
+/**
+ * An event loop serving its own listening socket, clients and shard of the
+ * keyspace. Commands for keys owned by other shards are forwarded to their
+ * reactors through lock-free mailboxes.
+ */
+class reactor {
+public:
+  reactor(std::size_t index, std::vector<std::unique_ptr<reactor>> &reactors,
+          struct persistence &persistence, const options &opts)
+      : index_(index), reactors_(reactors), persistence_(persistence),
+        io_(opts.io), client_output_limit_(opts.client_output_limit),
+        aof_(open_aof(opts, index)),
+        db_(
+            std::chrono::system_clock::now,
+            // the append only file has every write, once it's been begun
+            [this, path = state_path(opts, index),
+             aof_path = aof_path(opts, index)]() {
+              return std::make_unique<redis::io::mapped_istream>(
+                  aof_ && aof_->size() ? aof_path : path);
+            },
+            [path = state_path(opts, index), &persistence]() {
+              return std::make_unique<snapshot_file>(path,
+                                                     persistence.last_save);
+            }) {
+    db_.limit_intsets(opts.set_max_intset_entries);
+    for (std::size_t i = 0; i < opts.threads; ++i)
+      inboxes_.push_back(std::make_unique<redis::mailbox<message>>(1 << 12));
+    outboxes_.resize(opts.threads);
+
+    sockaddr_in listen_address{
+        .sin_family = AF_INET,
+        .sin_port = htons(opts.port),
+    };
+
+    listen_address.sin_addr.s_addr = INADDR_ANY;
+
+    fcntl_set_flags(sockfd_.value(), O_NONBLOCK);
+
+    set_socket_option(sockfd_.value(), SOL_SOCKET, SO_REUSEADDR, 1);
+    set_socket_option(sockfd_.value(), SOL_SOCKET, SO_REUSEPORT, 1);
+
+    bind(sockfd_.value(), listen_address);
+
+    redis::io::posix_call(::listen, sockfd_.value(), 128);
+
+    epoll_add(epollfd_.value(), sockfd_.value(), EPOLLIN, {});
+    epoll_add(epollfd_.value(), wakeup_.value(), EPOLLIN, {.ptr = &wakeup_});
+
+    load(db_);
+    if (aof_) {
+      // a new file begins with what was loaded from the snapshot
+      if (!aof_->size() && db_.size()) {
+        aof_->rewrite(db_);
+        aof_->write();
+        aof_->sync();
+      }
+      db_.on_evict(
+          [this](std::string_view key) { aof_->append({"DEL", key}); });
+    }
+    // as in Redis, loading doesn't evict
+    db_.limit_memory(opts.maxmemory, opts.maxmemory_policy);
+  }
+
+  reactor(const reactor &) = delete;
+  reactor &operator=(const reactor &) = delete;
+
+  [[noreturn]] void run() {
+#ifdef REDIS_SERVER_IO_URING
+    if (io_ == options::io_backend::io_uring)
+      run_uring();
+#endif
+    run_epoll();
+  }
+
+  /**
+   * Which shard(s) should execute a command.
+   * @param args
+   * @return
+   */
+  [[nodiscard]] destination
+  route(const std::vector<std::string_view> &args) const;
+
+  void forward(std::size_t shard, std::uint64_t client_id,
+               const std::vector<std::string_view> &args) {
+    outboxes_[shard].push_back(
+        {message::kind::request, index_, client_id, encode(args), {}});
+  }
+
+  [[nodiscard]] std::size_t index() const { return index_; }
+
+  [[nodiscard]] std::size_t shards() const { return reactors_.size(); }
+
+  [[nodiscard]] const output_limit &client_output_limit() const {
+    return client_output_limit_;
+  }
+
+  redis::database &db() { return db_; }
+
+  // or nullptr if writes aren't logged
+  redis::append_only_file *aof() { return aof_.get(); }
+
+  redis::pubsub &pubsub() { return pubsub_; }
+
+  /**
+   * Send a message to its subscribers here, and have the other shards send it
+   * to theirs.
+   * @param frame
+   * @return how many subscribers it was sent to here: as with PUBLISH in a
+   * Redis Cluster, those elsewhere aren't waited for to be counted
+   */
+  std::size_t publish(const redis::pubsub::frame_t &frame) {
+    for (std::size_t i = 0; i < outboxes_.size(); ++i) {
+      if (i != index_)
+        outboxes_[i].push_back({message::kind::publish, index_, 0, {}, frame});
+    }
+    return pubsub_.publish(frame);
+  }
+
+  [[nodiscard]] const struct persistence &persistence() const {
+    return persistence_;
+  }
+
+  /**
+   * Start saving every shard in a forked child, unless a background save is
+   * already under way. The other reactors are stopped between commands while
+   * this one forks, so that the child sees the whole keyspace as it was at
+   * one moment.
+   * @return whether a save was started
+   * @throws std::system_error if the fork failed
+   */
+  bool bgsave() {
+    if (persistence_.bgsave_in_progress.exchange(true))
+      return false;
+
+    persistence_.forking = true;
+    for (auto &r : reactors_) {
+      if (r.get() != this)
+        wake(*r);
+    }
+    persistence_.barrier.arrive_and_wait();
+    std::exception_ptr failure;
+    try {
+      bgsave_ = std::make_unique<redis::background_task>([this]() {
+        bool ok = true;
+        for (auto &r : reactors_)
+          ok &= save(r->db_);
+        return ok;
+      });
+    } catch (const std::exception &) {
+      failure = std::current_exception();
+    }
+    persistence_.forking = false;
+    persistence_.barrier.arrive_and_wait();
+
+    if (failure) {
+      persistence_.last_bgsave_ok = false;
+      persistence_.bgsave_in_progress = false;
+      std::rethrow_exception(failure);
+    }
+    persistence_.bgsave_started = unix_time();
+    persistence_.latest_fork_usec = bgsave_->fork_time().count();
+    watch_bgsave();
+    return true;
+  }
+
+  // have the client's output sent once the loop is done with this round of
+  // events, however many messages it's been given in the meantime
+  void schedule_flush(client &c) {
+    if (!std::exchange(c.send_scheduled_, true))
+      unsent_.push_back(c.id());
+  }
+
+private:
+  [[noreturn]] void run_epoll() {
+    std::array<epoll_event, 128> events{};
+
+    for (;;) {
+      auto timeout = int(expire_keys().count());
+      // a full mailbox means we have to come back for another go soon
+      if (backlogged_)
+        timeout = std::min(timeout, 1);
+      auto n = TEMP_FAILURE_RETRY(::epoll_wait(
+          epollfd_.value(), events.begin(), events.size(), timeout));
+      if (n == -1 && errno != ETIMEDOUT)
+        throw std::system_error(errno, std::generic_category());
+      for (auto &event : std::span(events.begin(), events.begin() + n)) {
+        if (!event.data.ptr) {
+          accept();
+        } else if (event.data.ptr == &wakeup_) {
+          receive();
+        } else if (event.data.ptr == &bgsave_) {
+          finish_bgsave();
+        } else {
+          auto &c = *static_cast<client *>(event.data.ptr);
+          try {
+            if (event.events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+              c.on_readable();
+            if (event.events & EPOLLOUT)
+              c.on_writable();
+          } catch (const std::exception &e) {
+            disconnect(c);
+          }
+        }
+      }
+      write_aof();
+      send();
+      flush_unsent();
+    }
+  }
+
+  // log the writes of this round of events in one go, before any reply to
+  // them, or any request to another shard that came after them, is sent
+  void write_aof() {
+    if (aof_)
+      aof_->write();
+  }
+
+  // push out the output of the clients scheduled to have it sent
+  void flush_unsent() {
+    for (auto id : std::exchange(unsent_, {})) {
+      if (auto pos = client_index_.find(id); pos != client_index_.end()) {
+        auto &c = *pos->second;
+        c.send_scheduled_ = false;
+        try {
+          // what's held back until the writes it acknowledges are durable
+          // can go now that they are
+          const bool held = c.ofstreambuf_.held();
+          c.ofstreambuf_.release();
+          c.ostream_.flush();
+          if (held)
+            c.ofstreambuf_.hold();
+          c.check_output();
+        } catch (const std::exception &) {
+          disconnect(c);
+        }
+      }
+    }
+  }
 
-  ns::io::file_descriptor epollfd(::epoll_create, 1);
+  // how often keys are expired actively, as with Redis' default hz of 10
+  static constexpr std::chrono::milliseconds expire_period{100};
+  // how much of each period that may take
+  static constexpr std::chrono::microseconds expire_budget{25000};
 
-  sockaddr_in listen_address{
-      .sin_family = AF_INET,
-      .sin_port = htons(6379),
+  // expire keys if it's time to
+  // @return how long until it's time again
+  std::chrono::milliseconds expire_keys() {
+    const auto now = std::chrono::steady_clock::now();
+    if (now >= next_expire_) {
+      const bool done = db_.active_expire(
+          std::chrono::time_point_cast<std::chrono::milliseconds>(db_.now()),
+          expire_budget);
+      // if there are more keys due, carry on once the loop has been round
+      next_expire_ = done ? now + expire_period : now;
+    }
+    return std::chrono::ceil<std::chrono::milliseconds>(next_expire_ - now);
+  }
+
+  [[nodiscard]] std::size_t shard_of(std::string_view key) const {
+    return redis::util::cs_hash()(key) % reactors_.size();
+  }
+
+  void accept() {
+    redis::io::file_descriptor clientfd(::accept, sockfd_.value(), nullptr,
+                                        nullptr);
+    fcntl_set_flags(clientfd.value(), O_NONBLOCK);
+    auto &c = add_client(std::move(clientfd));
+    epoll_add(epollfd_.value(), c.fd(), EPOLLIN | EPOLLOUT | EPOLLET,
+              {.ptr = &c});
+  }
+
+  client &add_client(redis::io::file_descriptor fd) {
+    auto &c = clients_.emplace_back(std::move(fd), *this, next_id_++);
+    client_index_[c.id()] = std::prev(clients_.end());
+    return c;
+  }
+
+  void disconnect(client &c) {
+#ifdef REDIS_SERVER_IO_URING
+    if (io_ == options::io_backend::io_uring)
+      return uring_disconnect(c);
+#endif
+    if (auto pos = client_index_.find(c.id()); pos != client_index_.end()) {
+      epoll_del(epollfd_.value(), c.fd());
+      clients_.erase(pos->second);
+      client_index_.erase(pos);
+    }
+  }
+
+  // wait for the background save's child to be done
+  void watch_bgsave() {
+#ifdef REDIS_SERVER_IO_URING
+    if (io_ == options::io_backend::io_uring)
+      return submit_bgsave_poll();
+#endif
+    epoll_add(epollfd_.value(), bgsave_->fd(), EPOLLIN, {.ptr = &bgsave_});
+  }
+
+  // the background save's child is done
+  void finish_bgsave() {
+    const bool ok = bgsave_->wait();
+    if (io_ == options::io_backend::epoll)
+      epoll_del(epollfd_.value(), bgsave_->fd());
+    bgsave_.reset();
+
+    const auto now = unix_time();
+    if (ok)
+      persistence_.last_save = now;
+    persistence_.last_bgsave_ok = ok;
+    persistence_.last_bgsave_seconds = now - persistence_.bgsave_started;
+    persistence_.bgsave_in_progress = false;
+  }
+
+  // push out whatever output the client has buffered
+  void flush(client &c) {
+    if (io_ == options::io_backend::io_uring || c.ofstreambuf_.held())
+      return schedule_flush(c);
+    c.ostream_.flush();
+    c.check_output();
+  }
+
+#ifdef REDIS_SERVER_IO_URING
+  // what an io_uring completion is for, kept in the low bits of its user_data
+  enum class op : std::uint64_t {
+    accept,
+    wakeup,
+    recv,
+    send,
+    timeout,
+    cancel,
+    bgsave
   };
 
-  listen_address.sin_addr.s_addr = INADDR_ANY;
+  static std::uint64_t user_data(op o, std::uint64_t client_id = 0) {
+    return client_id << 3 | std::uint64_t(o);
+  }
 
-  ns::io::file_descriptor sockfd(::socket, AF_INET, SOCK_STREAM, 0);
-  fcntl_set_flags(sockfd.value(), O_NONBLOCK);
+  [[noreturn]] void run_uring() {
+    // created on the thread that uses it, as IORING_SETUP_SINGLE_ISSUER needs
+    redis::io::uring ring(1 << 10);
+    redis::io::provided_buffers buffers(ring, 0, 1 << 8, 1 << 14);
+    ring_ = &ring;
+    buffers_ = &buffers;
 
-  set_socket_option(sockfd.value(), SOL_SOCKET, SO_REUSEADDR, 1);
+    submit_accept();
+    submit_wakeup();
 
-  bind(sockfd.value(), listen_address);
+    for (;;) {
+      const auto now = std::chrono::steady_clock::now();
+      auto wake_at = now + expire_keys();
+      // a full mailbox means we have to come back for another go soon
+      if (backlogged_)
+        wake_at = std::min(wake_at, now + std::chrono::milliseconds(1));
+      if (!timeout_at_ || wake_at < *timeout_at_)
+        submit_timeout(wake_at);
 
-  posix_call(::listen, sockfd.value(), 128);
+      // all the sends queued up since the last time go in the same syscall
+      ring.submit(1);
+      ring.for_each_cqe(
+          [this](const ::io_uring_cqe &cqe) { on_completion(cqe); });
+      write_aof();
+      send();
 
-  epoll_add(epollfd.value(), sockfd.value(), EPOLLIN, {});
+      for (auto id : std::exchange(unsent_, {})) {
+        if (auto pos = client_index_.find(id); pos != client_index_.end()) {
+          auto &c = *pos->second;
+          c.send_scheduled_ = false;
+          if (!c.closing_ && !c.ofstreambuf_.writing_async() &&
+              c.ofstreambuf_.pending())
+            submit_send(c);
+        }
+      }
+    }
+  }
 
-  redis::database db;
-  load(db);
+  void on_completion(const ::io_uring_cqe &cqe) {
+    const auto client_id = cqe.user_data >> 3;
+    const bool more = cqe.flags & IORING_CQE_F_MORE;
 
-  std::list<client> clients;
-  std::array<epoll_event, 128> events{};
+    switch (op(cqe.user_data & 7)) {
+    case op::accept:
+      if (cqe.res >= 0) {
+        redis::io::file_descriptor clientfd([fd = cqe.res]() { return fd; });
+        auto &c = add_client(std::move(clientfd));
+        submit_recv(c);
+      }
+      if (!more)
+        submit_accept();
+      break;
+    case op::wakeup:
+      receive();
+      if (!more)
+        submit_wakeup();
+      break;
+    case op::recv: {
+      const auto pos = client_index_.find(client_id);
+      client *c = pos == client_index_.end() ? nullptr : &*pos->second;
+      if (cqe.flags & IORING_CQE_F_BUFFER) {
+        const auto id = std::uint16_t(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        if (c && !c->closing_ && cqe.res > 0) {
+          const char *const begin = buffers_->addr(id);
+          try {
+            c->on_received(begin, begin + cqe.res);
+            flush(*c);
+          } catch (const std::exception &) {
+            disconnect(*c);
+            // which may have freed it
+            c = nullptr;
+          }
+        }
+        buffers_->recycle(id);
+      }
+      if (!c || c->closing_)
+        break;
+      if (cqe.res == 0 || (cqe.res < 0 && cqe.res != -ENOBUFS))
+        disconnect(*c);
+      else if (!more)
+        submit_recv(*c);
+    } break;
+    case op::send:
+      if (auto pos = client_index_.find(client_id);
+          pos != client_index_.end()) {
+        auto &c = *pos->second;
+        c.ofstreambuf_.end_async_write(cqe.res > 0 ? cqe.res : 0);
+        if (c.closing_ || cqe.res < 0) {
+          erase(c);
+          break;
+        }
+        try {
+          c.check_output();
+          // anything held is sent at the end of the round
+          if (c.ofstreambuf_.held())
+            schedule_flush(c);
+          else if (c.ofstreambuf_.pending())
+            submit_send(c);
+        } catch (const std::exception &) {
+          disconnect(c);
+        }
+      }
+      break;
+    case op::timeout:
+      timeout_at_.reset();
+      break;
+    case op::cancel:
+      break;
+    case op::bgsave:
+      finish_bgsave();
+      break;
+    }
+  }
+
+  void submit_accept() {
+    auto &sqe = ring_->get_sqe();
+    sqe.opcode = IORING_OP_ACCEPT;
+    sqe.fd = sockfd_.value();
+    sqe.ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe.accept_flags = SOCK_NONBLOCK;
+    sqe.user_data = user_data(op::accept);
+  }
+
+  void submit_wakeup() {
+    auto &sqe = ring_->get_sqe();
+    sqe.opcode = IORING_OP_POLL_ADD;
+    sqe.fd = wakeup_.value();
+    sqe.len = IORING_POLL_ADD_MULTI;
+    sqe.poll32_events = POLLIN;
+    sqe.user_data = user_data(op::wakeup);
+  }
 
-  for (;;) {
-    auto n = TEMP_FAILURE_RETRY(
-        ::epoll_wait(epollfd.value(), events.begin(), events.size(), -1));
-    if (n == -1 && errno != ETIMEDOUT)
+  void submit_bgsave_poll() {
+    auto &sqe = ring_->get_sqe();
+    sqe.opcode = IORING_OP_POLL_ADD;
+    sqe.fd = bgsave_->fd();
+    sqe.poll32_events = POLLIN;
+    sqe.user_data = user_data(op::bgsave);
+  }
+
+  void submit_timeout(std::chrono::steady_clock::time_point at) {
+    // steady_clock is CLOCK_MONOTONIC, the default for absolute timeouts
+    const auto since_epoch = at.time_since_epoch();
+    const auto seconds =
+        std::chrono::duration_cast<std::chrono::seconds>(since_epoch);
+    timeout_ = {.tv_sec = seconds.count(),
+                .tv_nsec = (since_epoch - seconds).count()};
+    timeout_at_ = at;
+
+    auto &sqe = ring_->get_sqe();
+    sqe.opcode = IORING_OP_TIMEOUT;
+    sqe.addr = reinterpret_cast<std::uintptr_t>(&timeout_);
+    sqe.len = 1;
+    sqe.timeout_flags = IORING_TIMEOUT_ABS;
+    sqe.user_data = user_data(op::timeout);
+  }
+
+  void submit_recv(client &c) {
+    auto &sqe = ring_->get_sqe();
+    sqe.opcode = IORING_OP_RECV;
+    sqe.fd = c.fd();
+    sqe.ioprio = IORING_RECV_MULTISHOT;
+    sqe.flags = IOSQE_BUFFER_SELECT;
+    sqe.buf_group = buffers_->group();
+    sqe.user_data = user_data(op::recv, c.id());
+  }
+
+  void submit_send(client &c) {
+    const auto pending = c.ofstreambuf_.begin_async_write();
+    auto &sqe = ring_->get_sqe();
+    sqe.opcode = IORING_OP_SEND;
+    sqe.fd = c.fd();
+    sqe.addr = reinterpret_cast<std::uintptr_t>(pending.data());
+    sqe.len = unsigned(pending.size());
+    sqe.msg_flags = MSG_NOSIGNAL;
+    sqe.user_data = user_data(op::send, c.id());
+  }
+
+  // the client's buffers have to outlive any send in flight from them
+  void uring_disconnect(client &c) {
+    if (c.closing_)
+      return;
+    c.closing_ = true;
+
+    auto &sqe = ring_->get_sqe();
+    sqe.opcode = IORING_OP_ASYNC_CANCEL;
+    sqe.addr = user_data(op::recv, c.id());
+    sqe.user_data = user_data(op::cancel);
+
+    if (!c.ofstreambuf_.writing_async())
+      erase(c);
+  }
+
+  void erase(client &c) {
+    if (auto pos = client_index_.find(c.id()); pos != client_index_.end()) {
+      clients_.erase(pos->second);
+      client_index_.erase(pos);
+    }
+  }
+
+  redis::io::uring *ring_{};
+  redis::io::provided_buffers *buffers_{};
+  // the earliest timeout in flight, if any
+  std::optional<std::chrono::steady_clock::time_point> timeout_at_;
+  // read by the kernel when the timeout is submitted
+  __kernel_timespec timeout_{};
+#endif
+
+  // drain every inbox, executing requests and passing on replies
+  void receive() {
+    std::uint64_t count;
+    if (::read(wakeup_.value(), &count, sizeof(count)) == -1 &&
+        errno != EAGAIN)
       throw std::system_error(errno, std::generic_category());
-    for (auto &event : std::span(events.begin(), events.begin() + n)) {
-      if (!event.data.ptr) {
-        ns::io::file_descriptor clientfd(::accept, sockfd.value(), nullptr,
-                                         nullptr);
-        fcntl_set_flags(clientfd.value(), O_NONBLOCK);
-        clients.emplace_back(std::move(clientfd), db);
-        epoll_add(epollfd.value(), clients.back().fd(), EPOLLIN | EPOLLET,
-                  {.ptr = &clients.back()});
-      } else if (event.events & EPOLLIN | EPOLLHUP | EPOLLERR) {
-        try {
-          static_cast<client *>(event.data.ptr)->on_readable();
-        } catch (const std::exception &e) {
-          auto pos = std::find_if(
-              clients.begin(), clients.end(), [&event](const auto &c) {
-                return &c == static_cast<const client *>(event.data.ptr);
-              });
-          if (pos != clients.end()) {
-            epoll_del(epollfd.value(), pos->fd());
-            clients.erase(pos);
+
+    // another reactor is forking for a background save, and has to have us
+    // stay out of the keyspace until it has
+    if (persistence_.forking) {
+      persistence_.barrier.arrive_and_wait();
+      persistence_.barrier.arrive_and_wait();
+    }
+
+    for (auto &inbox : inboxes_) {
+      while (auto msg = inbox->try_pop()) {
+        switch (msg->type) {
+        case message::kind::request:
+          remote_output_.str({});
+          remote_parser_.parse(msg->payload.data(),
+                               msg->payload.data() + msg->payload.size());
+          msg->type = message::kind::reply;
+          msg->payload = std::move(remote_output_).str();
+          outboxes_[msg->origin].push_back(std::move(*msg));
+          break;
+        case message::kind::publish:
+          pubsub_.publish(msg->frame);
+          break;
+        case message::kind::reply:
+          if (auto pos = client_index_.find(msg->client_id);
+              pos != client_index_.end()) {
+            auto &c = *pos->second;
+            try {
+              c.on_reply(msg->payload);
+              flush(c);
+            } catch (const std::exception &) {
+              disconnect(c);
+            }
           }
+          break;
         }
       }
     }
   }
+
+  // move outgoing messages into their mailboxes and wake up the recipients
+  void send() {
+    backlogged_ = false;
+    for (std::size_t i = 0; i < outboxes_.size(); ++i) {
+      auto &outbox = outboxes_[i];
+      if (outbox.empty())
+        continue;
+
+      auto &inbox = *reactors_[i]->inboxes_[index_];
+      while (!outbox.empty() && inbox.try_push(std::move(outbox.front())))
+        outbox.pop_front();
+      backlogged_ |= !outbox.empty();
+      wake(*reactors_[i]);
+    }
+  }
+
+  static void wake(reactor &r) {
+    const std::uint64_t one = 1;
+    redis::io::posix_call(::write, r.wakeup_.value(), &one, sizeof(one));
+  }
+
+  const std::size_t index_;
+  std::vector<std::unique_ptr<reactor>> &reactors_;
+  struct persistence &persistence_;
+  const options::io_backend io_;
+  const output_limit client_output_limit_;
+  redis::io::file_descriptor epollfd_{::epoll_create, 1};
+  redis::io::file_descriptor sockfd_{::socket, AF_INET, SOCK_STREAM, 0};
+  redis::io::file_descriptor wakeup_{::eventfd, 0, EFD_NONBLOCK};
+  std::vector<std::unique_ptr<redis::mailbox<message>>> inboxes_;
+  std::vector<std::deque<message>> outboxes_;
+  bool backlogged_{};
+  std::chrono::steady_clock::time_point next_expire_;
+  // opened, with any torn command cut off, before load() reads it through
+  // db_'s state_istream(), and before remote_handler_, which logs to it
+  std::unique_ptr<redis::append_only_file> aof_;
+  redis::database db_;
+  // the background save this reactor started, if it's still going
+  std::unique_ptr<redis::background_task> bgsave_;
+  // before clients_, which unsubscribe as they're destroyed
+  redis::pubsub pubsub_;
+  std::list<client> clients_;
+  // the clients to have their output sent at the end of the round
+  std::vector<std::uint64_t> unsent_;
+  ankerl::unordered_dense::map<std::uint64_t, std::list<client>::iterator>
+      client_index_;
+  std::uint64_t next_id_{};
+  std::ostringstream remote_output_;
+  redis::resp::writer remote_writer_{remote_output_};
+  redis::command_handler remote_handler_{
+      db_, remote_writer_, nullptr, redis::command_handler::mode::immediate,
+      aof_.get()};
+  redis::resp::basic_parser<redis::command_handler> remote_parser_{
+      remote_handler_};
+};
+
+destination reactor::route(const std::vector<std::string_view> &args) const {
+  using kind = destination::kind;
+
+  if (reactors_.size() == 1)
+    return {kind::local, index_};
+
+  // anything malformed gets its error locally
+  const auto *cmd = redis::commands::find(args[0]);
+  if (!cmd || !cmd->accepts(args.size()))
+    return {kind::local, index_};
+
+  if (cmd->flags & redis::commands::all_shards)
+    return {kind::all_shards, index_};
+
+  std::optional<std::size_t> shard;
+  bool cross_shard = false;
+  cmd->for_each_key(args, [&](std::string_view key) {
+    const auto key_shard = shard_of(key);
+    cross_shard |= shard.value_or(key_shard) != key_shard;
+    shard = key_shard;
+  });
+
+  if (cross_shard)
+    return {kind::cross_shard, index_};
+  if (!shard || *shard == index_)
+    return {kind::local, index_};
+  return {kind::shard, *shard};
+}
+
+client::client(redis::io::file_descriptor fd, reactor &reactor,
+               std::uint64_t id)
+    : reactor_(reactor), id_(id), in_fd_(std::move(fd)),
+      // batched mode's lookups ahead of each pipeline cost more than the
+      // misses they overlap save, on pipelined_gets
+      server_(reactor.db(), writer_, this,
+              redis::command_handler::mode::immediate, reactor.aof()) {
+  set_socket_option(in_fd_.value(), SOL_SOCKET, SO_SNDBUF, 1 << 20);
+  // as in Redis, so that replies relayed from another shard, sent after the
+  // rest of a pipeline's, aren't held back for the client's delayed ACK
+  set_socket_option(in_fd_.value(), IPPROTO_TCP, TCP_NODELAY, 1);
+  if (reactor.aof() && reactor.aof()->policy() ==
+                           redis::append_only_file::fsync_policy::always)
+    ofstreambuf_.hold();
+}
+
+void client::flush() {
+  if (ofstreambuf_.held())
+    reactor_.schedule_flush(*this);
+  else
+    ostream_.flush();
+}
+
+client::~client() { reactor_.pubsub().unsubscribe_all(*this); }
+
+bool client::route(const std::vector<std::string_view> &args) {
+  if (!pending_.empty()) {
+    pending_.push_back({{args.begin(), args.end()}});
+    return true;
+  }
+  return execute(args);
+}
+
+// false if the command should be dispatched locally, right now
+bool client::execute(const std::vector<std::string_view> &args) {
+  using kind = destination::kind;
+
+  const auto *const cmd = redis::commands::find(args[0]);
+  const bool pubsub = cmd && cmd->flags & redis::commands::pubsub &&
+                      cmd->accepts(args.size());
+  // once subscribed, a connection is only good for receiving messages and
+  // changing what it's subscribed to, as in RESP2
+  if (reactor_.pubsub().subscriptions(*this)) {
+    if (redis::util::ci_equal()(args[0], "PING") && args.size() <= 2) {
+      writer_.begin_array(2);
+      writer_.bulk_string("pong");
+      writer_.bulk_string(args.size() == 2 ? args[1] : "");
+      writer_.end_array();
+      return true;
+    }
+    if (!pubsub || redis::util::ci_equal()(args[0], "PUBLISH")) {
+      error("ERR Can't execute '" + std::string(args[0]) +
+            "': only (P)SUBSCRIBE / (P)UNSUBSCRIBE / PING are allowed in "
+            "this context");
+      return true;
+    }
+  }
+  if (pubsub) {
+    pubsub_command(args);
+    return true;
+  }
+  if (cmd && cmd->flags & redis::commands::server &&
+      cmd->accepts(args.size())) {
+    server_command(args);
+    return true;
+  }
+
+  switch (const auto dest = reactor_.route(args); dest.type) {
+  case kind::local:
+    return false;
+  case kind::cross_shard:
+    error("CROSSSLOT Keys in request don't hash to the same shard");
+    return true;
+  case kind::shard:
+    reactor_.forward(dest.shard, id_, args);
+    pending_.push_front({{}, 1, true});
+    return true;
+  case kind::all_shards:
+    // the local reply stands for all of them
+    server_.dispatch(args);
+    for (std::size_t i = 0; i < reactor_.shards(); ++i) {
+      if (i != reactor_.index())
+        reactor_.forward(i, id_, args);
+    }
+    pending_.push_front({{}, reactor_.shards() - 1, false});
+    return true;
+  }
+  return false;
+}
+
+void client::on_reply(std::string_view reply) {
+  assert(!pending_.empty() && pending_.front().awaited_replies);
+
+  auto &front = pending_.front();
+
+  if (front.relay_reply)
+    ostream_.write(reply.data(), std::streamsize(reply.size()));
+
+  if (--front.awaited_replies)
+    return;
+
+  pending_.pop_front();
+
+  while (!pending_.empty() && !pending_.front().awaited_replies) {
+    const auto queued = std::move(pending_.front().args);
+    pending_.pop_front();
+    const std::vector<std::string_view> args(queued.begin(), queued.end());
+    if (!execute(args))
+      server_.dispatch(args);
+  }
+
+  check_output();
+}
+
+void client::pubsub_command(const std::vector<std::string_view> &args) {
+  auto &pubsub = reactor_.pubsub();
+  const auto names = std::span(args).subspan(1);
+  const redis::util::ci_equal equal;
+  if (equal(args[0], "PUBLISH"))
+    writer_.integer(std::int64_t(
+        reactor_.publish(redis::pubsub::message(args[1], args[2]))));
+  else if (equal(args[0], "SUBSCRIBE"))
+    pubsub.subscribe(*this, names, writer_);
+  else if (equal(args[0], "UNSUBSCRIBE"))
+    pubsub.unsubscribe(*this, names, writer_);
+  else if (equal(args[0], "PSUBSCRIBE"))
+    pubsub.psubscribe(*this, names, writer_);
+  else if (equal(args[0], "PUNSUBSCRIBE"))
+    pubsub.punsubscribe(*this, names, writer_);
+}
+
+void client::server_command(const std::vector<std::string_view> &args) {
+  const redis::util::ci_equal equal;
+  if (equal(args[0], "BGSAVE")) {
+    try {
+      if (reactor_.bgsave())
+        writer_.simple_string("Background saving started");
+      else
+        error("ERR Background save already in progress");
+    } catch (const std::system_error &) {
+      error("ERR Background save failed to start");
+    }
+  } else if (equal(args[0], "LASTSAVE")) {
+    writer_.integer(reactor_.persistence().last_save);
+  } else if (equal(args[0], "INFO")) {
+    info(args);
+  }
+}
+
+// the persistence and stats sections of Redis' INFO, as far as they go here
+void client::info(const std::vector<std::string_view> &args) {
+  const redis::util::ci_equal equal;
+  const auto wanted = [&](std::string_view section) {
+    return args.size() == 1 ||
+           std::any_of(args.begin() + 1, args.end(), [&](auto arg) {
+             return equal(arg, section) || equal(arg, "all") ||
+                    equal(arg, "default") || equal(arg, "everything");
+           });
+  };
+
+  const auto &persistence = reactor_.persistence();
+  std::ostringstream os;
+  if (wanted("persistence")) {
+    const bool in_progress = persistence.bgsave_in_progress;
+    os << "# Persistence\r\n"
+       << "rdb_bgsave_in_progress:" << in_progress << "\r\n"
+       << "rdb_last_save_time:" << persistence.last_save << "\r\n"
+       << "rdb_last_bgsave_status:"
+       << (persistence.last_bgsave_ok ? "ok" : "err") << "\r\n"
+       << "rdb_last_bgsave_time_sec:" << persistence.last_bgsave_seconds
+       << "\r\n"
+       << "rdb_current_bgsave_time_sec:"
+       << (in_progress ? unix_time() - persistence.bgsave_started : -1)
+       << "\r\n"
+       << "aof_enabled:" << (reactor_.aof() != nullptr) << "\r\n";
+  }
+  if (wanted("stats")) {
+    if (os.tellp())
+      os << "\r\n";
+    os << "# Stats\r\n"
+       << "latest_fork_usec:" << persistence.latest_fork_usec << "\r\n";
+  }
+  writer_.bulk_string(os.view());
+}
+
+void client::deliver(const redis::pubsub::frame_t &frame) {
+  if (closing_)
+    return;
+  ofstreambuf_.share(frame);
+  reactor_.schedule_flush(*this);
+}
+
+void client::check_output() {
+  if (ostream_.bad())
+    throw std::runtime_error("output error");
+
+  const auto &limit = reactor_.client_output_limit();
+  const auto pending = ofstreambuf_.pending();
+
+  if (limit.hard && pending > limit.hard)
+    throw std::runtime_error("output buffer over hard limit");
+
+  if (!limit.soft || pending <= limit.soft) {
+    over_soft_limit_since_.reset();
+    return;
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  if (!over_soft_limit_since_)
+    over_soft_limit_since_ = now;
+  else if (now - *over_soft_limit_since_ >= limit.soft_seconds)
+    throw std::runtime_error("output buffer over soft limit");
+}
+
+void client::error(std::string_view msg) { writer_.error(msg); }
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  install_sig_handlers();
+
+  const auto opts = parse_options(argc, argv);
+
+  persistence persistence(opts.threads);
+  std::vector<std::unique_ptr<reactor>> reactors;
+  for (std::size_t i = 0; i < opts.threads; ++i)
+    reactors.push_back(
+        std::make_unique<reactor>(i, reactors, persistence, opts));
+
+  std::vector<std::thread> threads;
+  for (std::size_t i = 1; i < opts.threads; ++i)
+    threads.emplace_back([&reactor = *reactors[i]]() { reactor.run(); });
+
+  reactors[0]->run();
 }
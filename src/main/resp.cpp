@@ -1,6 +1,8 @@
 #include "resp.hpp"
+#include "simd.hpp"
 #include "util.hpp"
 
+#include <array>
 #include <cassert>
 #include <charconv>
 #include <regex>
@@ -16,8 +18,72 @@ constexpr char lf = '\n';
 
 inline void end(std::ostream &os_) { os_ << "\r\n"; }
 
+// the longest header, e.g. "$-9223372036854775808\r\n"
+constexpr std::size_t max_header_size = 24;
+
+// values bigger than this are written to the buffer piecemeal
+constexpr std::size_t max_prepared_size = 1 << 12;
+
+// ":0\r\n" and so on for the integers replies are most often made of
+struct encoded_integer {
+  std::array<char, 8> chars;
+  std::size_t size;
+
+  [[nodiscard]] constexpr std::string_view view() const {
+    return {chars.data(), size};
+  }
+};
+
+constexpr auto small_integers = []() {
+  std::array<encoded_integer, 1 << 10> result{};
+  for (std::size_t i = 0; i < result.size(); ++i) {
+    auto &[chars, size] = result[i];
+    std::array<char, 4> digits{};
+    std::size_t n = 0;
+    for (auto j = i; n == 0 || j; j /= 10)
+      digits[n++] = char('0' + j % 10);
+    chars[size++] = ':';
+    while (n)
+      chars[size++] = digits[--n];
+    chars[size++] = cr;
+    chars[size++] = lf;
+  }
+  return result;
+}();
+
 } // namespace
 
+void ns::handler::simple_string(std::string_view s) {
+  begin_simple_string();
+  chars(s.data(), s.data() + s.size());
+  end_simple_string();
+}
+
+void ns::handler::error(std::string_view s) {
+  begin_error();
+  chars(s.data(), s.data() + s.size());
+  end_error();
+}
+
+void ns::handler::integer(std::int64_t i) {
+  std::array<char, max_header_size> buf{};
+  auto [ptr, ec] = std::to_chars(buf.begin(), buf.end(), i);
+  begin_integer();
+  chars(buf.begin(), ptr);
+  end_integer();
+}
+
+void ns::handler::bulk_string(std::string_view s) {
+  begin_bulk_string(std::int64_t(s.size()));
+  chars(s.data(), s.data() + s.size());
+  end_bulk_string();
+}
+
+void ns::handler::null_bulk_string() {
+  begin_bulk_string(-1);
+  end_bulk_string();
+}
+
 void ns::writer::begin_simple_string() { os_ << '+'; }
 
 void ns::writer::end_simple_string() { end(os_); }
@@ -48,182 +114,107 @@ void ns::writer::chars(const char *begin, const char *end) {
 
 ns::writer::writer(std::ostream &os) : os_(os), depth_() {}
 
-ns::parser_state_base::parser_state_base(parser &self) : self(self) {}
-
-ns::simple_state::simple_state(parser &self, void (handler::*end_callback)())
-    : parser_state_base(self), end_callback_(end_callback) {}
-
-ns::length_state::length_state(
-    parser &self, void (handler::*const begin_callback)(std::int64_t),
-    void (*const factory)(parser &, std::int64_t))
-    : parser_state_base(self), begin_callback_(begin_callback),
-      factory_(factory) {}
-
-ns::bulk_string_state::bulk_string_state(parser &self, std::int64_t length)
-    : parser_state_base(self), length_(length) {}
+ns::buffer_writer::buffer_writer(io::ofstreambuf &buf) : buf_(buf) {}
 
-ns::array_state::array_state(parser &self, std::int64_t length)
-    : parser_state_base(self), length_(length) {}
+void ns::buffer_writer::write(std::string_view s) {
+  if (s.size() > max_prepared_size) {
+    buf_.sputn(s.data(), std::streamsize(s.size()));
+    return;
+  }
+  std::copy(s.begin(), s.end(), buf_.prepare(s.size()).begin());
+  buf_.commit(s.size());
+}
 
-ns::parser::parser(handler &handler) : stack_(), handler_(handler) {
-  stack_.emplace_back(std::in_place_type<init_state<true>>, *this);
+void ns::buffer_writer::write_header(char type, std::int64_t i) {
+  const auto room = buf_.prepare(max_header_size);
+  room[0] = type;
+  auto [ptr, ec] = std::to_chars(room.data() + 1, room.data() + room.size(), i);
+  *ptr++ = cr;
+  *ptr++ = lf;
+  buf_.commit(ptr - room.data());
 }
 
-const char *ns::parser::parse(const char *begin, const char *end) {
-  for (bool keep_going = true; keep_going;) {
-    std::tie(keep_going, begin) = stack_.back().parse(begin, end);
+void ns::buffer_writer::write_simple(char type, std::string_view s) {
+  const auto size = s.size() + 3;
+  if (size > max_prepared_size) {
+    write({&type, 1});
+    write(s);
+    write(crlf);
+    return;
   }
-
-  return begin;
+  const auto room = buf_.prepare(size);
+  room[0] = type;
+  std::copy(crlf.begin(), crlf.end(),
+            std::copy(s.begin(), s.end(), room.begin() + 1));
+  buf_.commit(size);
 }
 
-template <bool is_terminal>
-std::tuple<bool, const char *>
-ns::init_state<is_terminal>::parse(const char *begin, const char *end) {
-  if (begin == end)
-    return {false, begin};
+void ns::buffer_writer::begin_simple_string() { write("+"); }
 
-  if constexpr (!is_terminal) {
-    self.stack_.pop_back();
-  }
+void ns::buffer_writer::end_simple_string() { write(crlf); }
 
-  switch (*begin) {
-  case '+':
-    self.handler_.begin_simple_string();
-    self.stack_.emplace_back(std::in_place_type<simple_state>, self,
-                             &handler::end_simple_string);
-    break;
-  case '-':
-    self.handler_.begin_error();
-    self.stack_.emplace_back(std::in_place_type<simple_state>, self,
-                             &handler::end_error);
-    break;
-  case ':':
-    self.handler_.begin_integer();
-    self.stack_.emplace_back(std::in_place_type<simple_state>, self,
-                             &handler::end_integer);
-    break;
-  case '$':
-    self.stack_.emplace_back(
-        std::in_place_type<length_state>, self, &handler::begin_bulk_string,
-        [](auto &self, auto len) {
-          self.stack_.pop_back();
-          self.stack_.emplace_back(std::in_place_type<bulk_string_state>, self,
-                                   len);
-        });
-    break;
-  case '*':
-    self.stack_.emplace_back(std::in_place_type<length_state>, self,
-                             &handler::begin_array, [](auto &self, auto len) {
-                               self.stack_.pop_back();
-                               self.stack_.emplace_back(
-                                   std::in_place_type<array_state>, self, len);
-                             });
-    break;
-  default:
-    self.stack_.emplace_back(std::in_place_type<inline_command_state>, self);
-    return {true, begin};
-  }
-  return {true, begin + 1};
-}
+void ns::buffer_writer::begin_error() { write("-"); }
 
-std::tuple<bool, const char *> ns::simple_state::parse(const char *begin,
-                                                       const char *end) {
-  if (begin == end)
-    return {false, begin};
+void ns::buffer_writer::end_error() { write(crlf); }
 
-  const auto pos = std::find(begin, end, cr);
+void ns::buffer_writer::begin_integer() { write(":"); }
 
-  self.handler_.chars(begin, pos);
+void ns::buffer_writer::end_integer() { write(crlf); }
 
-  if (end - pos < 2) {
-    return {false, pos};
-  } else if (pos[1] == lf) {
-    (self.handler_.*end_callback_)();
-    self.stack_.pop_back();
-    return {true, pos + 2};
-  } else {
-    throw resp_error("carriage return without newline");
-  }
+void ns::buffer_writer::begin_bulk_string(std::int64_t len) {
+  if (len == -1)
+    write("$-1");
+  else
+    write_header('$', len);
 }
 
-std::tuple<bool, const char *> ns::length_state::parse(const char *begin,
-                                                       const char *end) {
-  if (begin == end)
-    return {false, begin};
-
-  if (auto pos = std::search(begin, end, crlf.begin(), crlf.end());
-      pos != end) {
-    std::int64_t length{};
-    auto [ptr, ec] = std::from_chars(begin, end, length);
-    if (ec != std::errc() || ptr != pos)
-      throw std::runtime_error("bad length");
-    (self.handler_.*begin_callback_)(length);
-    factory_(self, length);
-    return {true, ptr + 2};
-  } else {
-    return {false, begin};
-  }
-}
+void ns::buffer_writer::end_bulk_string() { write(crlf); }
 
-std::tuple<bool, const char *> ns::bulk_string_state::parse(const char *begin,
-                                                            const char *end) {
-  if (length_ == -1) {
-    self.handler_.end_bulk_string();
-    self.stack_.pop_back();
-    return {true, begin};
-  }
+void ns::buffer_writer::begin_array(std::int64_t len) {
+  write_header('*', len);
+}
 
-  if (begin == end)
-    return {false, begin};
+void ns::buffer_writer::end_array() {}
 
-  const std::int64_t input_length = end - begin;
-  const std::int64_t output_length = std::min(length_, input_length);
-  self.handler_.chars(begin, begin + output_length);
-  length_ -= output_length;
+void ns::buffer_writer::chars(const char *begin, const char *end) {
+  write({begin, end});
+}
 
-  if (length_ == 0 && input_length >= output_length + 2) {
-    self.handler_.end_bulk_string();
-    self.stack_.pop_back();
-    return {true, begin + output_length + 2};
-  } else {
-    return {false, begin + output_length};
-  }
+void ns::buffer_writer::simple_string(std::string_view s) {
+  write_simple('+', s);
 }
 
-std::tuple<bool, const char *> ns::array_state::parse(const char *begin,
-                                                      const char *) {
-  if (length_ == 0 || length_ == -1) {
-    self.handler_.end_array();
-    self.stack_.pop_back();
-    return {true, begin};
-  } else if (length_ > 0) {
-    --length_;
-    self.stack_.emplace_back(std::in_place_type<init_state<false>>, self);
-    return {true, begin};
-  } else {
-    throw resp_error("bad array length");
-  }
+void ns::buffer_writer::error(std::string_view s) { write_simple('-', s); }
+
+void ns::buffer_writer::integer(std::int64_t i) {
+  if (i >= 0 && std::size_t(i) < small_integers.size())
+    write(small_integers[i].view());
+  else
+    write_header(':', i);
 }
 
-std::tuple<bool, const char *>
-ns::inline_command_state::parse(const char *const begin,
-                                const char *const end) {
-  if (auto pos = std::search(begin, end, crlf.begin(), crlf.end());
-      pos != end) {
-    std::int64_t len{};
-    redis::util::tokenize(begin, pos, [&](auto...) { return ++len; });
-    self.handler_.begin_array(len);
-    redis::util::tokenize(begin, pos, [&](auto begin, auto end) {
-      self.handler_.begin_bulk_string(end - begin);
-      self.handler_.chars(begin, end);
-      self.handler_.end_bulk_string();
-      return true;
-    });
-    self.handler_.end_array();
-    self.stack_.pop_back();
-    return {true, pos + 2};
-  } else {
-    return {false, begin};
+void ns::buffer_writer::bulk_string(std::string_view s) {
+  const auto size = max_header_size + s.size() + crlf.size();
+  if (size > max_prepared_size) {
+    write_header('$', std::int64_t(s.size()));
+    write(s);
+    write(crlf);
+    return;
   }
+
+  // all in one go
+  const auto room = buf_.prepare(size);
+  room[0] = '$';
+  auto [ptr, ec] = std::to_chars(room.data() + 1, room.data() + max_header_size,
+                                 s.size());
+  ptr = std::copy(crlf.begin(), crlf.end(), ptr);
+  ptr = std::copy(s.begin(), s.end(), ptr);
+  ptr = std::copy(crlf.begin(), crlf.end(), ptr);
+  buf_.commit(ptr - room.data());
 }
+
+void ns::buffer_writer::null_bulk_string() { write("$-1\r\n"); }
+
+template class redis::resp::basic_parser<redis::resp::handler>;
+
+ns::parser::parser(handler &handler) : basic_parser(handler) {}
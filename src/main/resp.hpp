@@ -1,9 +1,16 @@
 #ifndef REDIS_SERVER_RESP_HPP
 #define REDIS_SERVER_RESP_HPP
 
+#include "io.hpp"
+#include "simd.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <array>
 #include <charconv>
 #include <cstdint>
 #include <stdexcept>
+#include <string_view>
 #include <tuple>
 #include <utility>
 #include <vector>
@@ -38,12 +45,25 @@ public:
 
   virtual void chars(const char *begin, const char *end) = 0;
 
+  // whole values at once, which writers can encode more efficiently than the
+  // begin/chars/end calls these default to
+
+  virtual void simple_string(std::string_view s);
+
+  virtual void error(std::string_view s);
+
+  virtual void integer(std::int64_t i);
+
+  virtual void bulk_string(std::string_view s);
+
+  virtual void null_bulk_string();
+
   handler() = default;
 
   virtual ~handler() = default;
 };
 
-class null_handler : public redis::resp::handler {
+class null_handler final : public redis::resp::handler {
 public:
   void begin_simple_string() override {}
   void end_simple_string() override {}
@@ -94,126 +114,249 @@ private:
   std::size_t depth_;
 };
 
-class parser;
-
-class parser_state_base {
+/**
+ * Writes RESP straight into an ofstreambuf's buffer, rather than through an
+ * std::ostream.
+ */
+class buffer_writer : public handler {
 public:
-  explicit parser_state_base(parser &self);
-
-protected:
-  parser &self;
-};
-
-template <bool is_terminal = false>
-class init_state : public parser_state_base {
-public:
-  using parser_state_base::parser_state_base;
-
-  std::tuple<bool, const char *> parse(const char *begin, const char *end);
-};
+  explicit buffer_writer(io::ofstreambuf &buf);
+  buffer_writer(const buffer_writer &) = delete;
+  buffer_writer &operator=(const buffer_writer &) = delete;
 
-class simple_state : public parser_state_base {
-public:
-  using parser_state_base::parser_state_base;
-
-  simple_state(parser &self, void (handler::*end_callback)());
+  void begin_simple_string() override;
+  void end_simple_string() override;
+  void begin_error() override;
+  void end_error() override;
+  void begin_integer() override;
+  void end_integer() override;
+  void begin_bulk_string(std::int64_t len) override;
+  void end_bulk_string() override;
+  void begin_array(std::int64_t len) override;
+  void end_array() override;
+  void chars(const char *begin, const char *end) override;
 
-  std::tuple<bool, const char *> parse(const char *begin, const char *end);
+  void simple_string(std::string_view s) override;
+  void error(std::string_view s) override;
+  void integer(std::int64_t i) override;
+  void bulk_string(std::string_view s) override;
+  void null_bulk_string() override;
 
 private:
-  void (handler::*const end_callback_)();
-};
-
-class length_state : public parser_state_base {
-public:
-  length_state(parser &self, void (handler::*begin_callback)(std::int64_t),
-               void (*factory)(parser &, std::int64_t));
-
-  std::tuple<bool, const char *> parse(const char *begin, const char *end);
+  void write(std::string_view s);
+  void write_header(char type, std::int64_t i);
+  void write_simple(char type, std::string_view s);
 
-  void (handler::*const begin_callback_)(std::int64_t);
-
-  void (*const factory_)(parser &, std::int64_t);
+  io::ofstreambuf &buf_;
 };
 
-class bulk_string_state : public parser_state_base {
+/**
+ * Parses RESP, calling back Handler for each part of it as it goes. Handler
+ * is called directly, so with a final Handler the callbacks can be inlined.
+ * Values may be split across calls to parse(), e.g. as they arrive from a
+ * socket, and the parts of bulk and simple strings are handed to the handler
+ * as soon as they are seen.
+ * @tparam Handler
+ */
+template <typename Handler> class basic_parser {
 public:
-  bulk_string_state(parser &self, std::int64_t length);
-
-  std::tuple<bool, const char *> parse(const char *begin, const char *end);
-
-  std::int64_t length_;
-};
-
-class array_state : public parser_state_base {
-public:
-  array_state(parser &self, std::int64_t length);
+  explicit basic_parser(Handler &handler);
+  basic_parser(const basic_parser &) = delete;
+  basic_parser &operator=(const basic_parser &) = delete;
+
+  /**
+   * @param begin
+   * @param end
+   * @return the first byte that wasn't consumed, to be passed in again with
+   * more after it
+   */
+  const char *parse(const char *begin, const char *end);
 
-  std::tuple<bool, const char *> parse(const char *begin, const char *end);
+  // how deeply arrays may be nested
+  static constexpr std::size_t max_depth = 32;
 
-  std::int64_t length_;
-};
+private:
+  enum class state : std::uint8_t { type, simple, bulk };
 
-class inline_command_state : public parser_state_base {
-public:
-  using parser_state_base::parser_state_base;
+  // a value is complete, along with any arrays it completes
+  void end_value();
 
-  std::tuple<bool, const char *> parse(const char *begin, const char *end);
-};
+  void end_simple();
 
-struct parser_state {
-  using parse_t = std::tuple<bool, const char *> (*)(void *, const char *,
-                                                     const char *);
-
-  template <typename T, typename... Args>
-  explicit parser_state(std::in_place_type_t<T>, Args &&...ctor_args)
-      : parse_([](void *ptr, auto... parse_args) {
-          return static_cast<T *>(ptr)->parse(parse_args...);
-        }),
-        storage_{} {
-    static_assert(sizeof(T) <= sizeof(storage_));
-    static_assert(alignof(T) <= alignof(storage_));
-    static_assert(std::is_trivially_destructible_v<T>);
-    static_assert(std::is_trivially_copy_constructible_v<T>);
-    new (static_cast<void *>(&storage_)) T(std::forward<Args>(ctor_args)...);
-  }
+  void inline_command(const char *begin, const char *end);
 
-  std::tuple<bool, const char *> parse(const char *begin, const char *end) {
-    return parse_(static_cast<void *>(&storage_), begin, end);
-  }
+  static std::int64_t parse_length(const char *begin, const char *end);
 
-private:
-  const parse_t parse_;
-  std::aligned_storage_t<std::max({
-                             sizeof(init_state<>),
-                             sizeof(simple_state),
-                             sizeof(length_state),
-                             sizeof(bulk_string_state),
-                             sizeof(array_state),
-                             sizeof(inline_command_state),
-                         }),
-                         std::max({
-                             alignof(init_state<>),
-                             alignof(simple_state),
-                             alignof(length_state),
-                             alignof(bulk_string_state),
-                             alignof(array_state),
-                             alignof(inline_command_state),
-                         })>
-      storage_;
+  Handler &handler_;
+  state state_;
+  // which simple type is being parsed
+  char simple_type_;
+  std::int64_t bulk_remaining_;
+  // how many elements are left in each array being parsed
+  std::array<std::int64_t, max_depth> remaining_;
+  std::size_t depth_;
 };
 
-class parser {
+/**
+ * A parser for any handler, called through its virtual functions.
+ */
+class parser : public basic_parser<handler> {
 public:
   explicit parser(handler &handler);
-
-  const char *parse(const char *begin, const char *end);
-
-  std::vector<parser_state> stack_;
-  handler &handler_;
-  std::vector<std::string_view> inline_args_;
 };
 
 } // namespace redis::resp
 
+template <typename Handler>
+redis::resp::basic_parser<Handler>::basic_parser(Handler &handler)
+    : handler_(handler), state_(state::type), simple_type_(),
+      bulk_remaining_(), remaining_(), depth_() {}
+
+template <typename Handler>
+const char *redis::resp::basic_parser<Handler>::parse(const char *begin,
+                                                     const char *end) {
+  for (;;) {
+    switch (state_) {
+    case state::type:
+      if (begin == end)
+        return begin;
+
+      switch (*begin) {
+      case '+':
+        handler_.begin_simple_string();
+        break;
+      case '-':
+        handler_.begin_error();
+        break;
+      case ':':
+        handler_.begin_integer();
+        break;
+      case '$':
+      case '*': {
+        const auto eol = simd::find_crlf(begin + 1, end);
+        if (eol == end)
+          return begin;
+        const auto len = parse_length(begin + 1, eol);
+        const bool array = *begin == '*';
+        begin = eol + 2;
+        if (len < -1)
+          throw resp_error(array ? "bad array length" : "bad bulk length");
+
+        if (!array) {
+          handler_.begin_bulk_string(len);
+          if (len == -1) {
+            handler_.end_bulk_string();
+            end_value();
+          } else {
+            bulk_remaining_ = len;
+            state_ = state::bulk;
+          }
+        } else {
+          handler_.begin_array(len);
+          if (len <= 0) {
+            handler_.end_array();
+            end_value();
+          } else if (depth_ == max_depth) {
+            throw resp_error("arrays nested too deeply");
+          } else {
+            remaining_[depth_++] = len;
+          }
+        }
+      }
+        continue;
+      default: {
+        if (depth_)
+          throw resp_error("unknown type");
+        const auto eol = simd::find_crlf(begin, end);
+        if (eol == end)
+          return begin;
+        inline_command(begin, eol);
+        begin = eol + 2;
+      }
+        continue;
+      }
+
+      simple_type_ = *begin++;
+      state_ = state::simple;
+      [[fallthrough]];
+
+    case state::simple: {
+      const auto pos = simd::find(begin, end, '\r');
+      if (pos != begin)
+        handler_.chars(begin, pos);
+      if (end - pos < 2)
+        return pos;
+      if (pos[1] != '\n')
+        throw resp_error("carriage return without newline");
+      begin = pos + 2;
+      end_simple();
+      end_value();
+    } break;
+
+    case state::bulk: {
+      const auto n = std::min(bulk_remaining_, std::int64_t(end - begin));
+      if (n)
+        handler_.chars(begin, begin + n);
+      begin += n;
+      bulk_remaining_ -= n;
+      if (bulk_remaining_ || end - begin < 2)
+        return begin;
+      if (begin[0] != '\r' || begin[1] != '\n')
+        throw resp_error("bulk string without crlf");
+      begin += 2;
+      handler_.end_bulk_string();
+      end_value();
+    } break;
+    }
+  }
+}
+
+template <typename Handler>
+void redis::resp::basic_parser<Handler>::end_value() {
+  state_ = state::type;
+  while (depth_ && --remaining_[depth_ - 1] == 0) {
+    --depth_;
+    handler_.end_array();
+  }
+}
+
+template <typename Handler>
+void redis::resp::basic_parser<Handler>::end_simple() {
+  switch (simple_type_) {
+  case '+':
+    return handler_.end_simple_string();
+  case '-':
+    return handler_.end_error();
+  default:
+    return handler_.end_integer();
+  }
+}
+
+template <typename Handler>
+void redis::resp::basic_parser<Handler>::inline_command(const char *begin,
+                                                      const char *end) {
+  std::int64_t len{};
+  util::tokenize(begin, end, [&](auto...) { return ++len; });
+  handler_.begin_array(len);
+  util::tokenize(begin, end, [&](auto begin, auto end) {
+    handler_.begin_bulk_string(end - begin);
+    handler_.chars(begin, end);
+    handler_.end_bulk_string();
+    return true;
+  });
+  handler_.end_array();
+}
+
+template <typename Handler>
+std::int64_t redis::resp::basic_parser<Handler>::parse_length(const char *begin,
+                                                            const char *end) {
+  std::int64_t result{};
+  auto [ptr, ec] = std::from_chars(begin, end, result);
+  if (ec != std::errc() || ptr != end)
+    throw resp_error("bad length");
+  return result;
+}
+
+extern template class redis::resp::basic_parser<redis::resp::handler>;
+
 #endif
@@ -0,0 +1,328 @@
+#include "score_tree.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <numeric>
+
+namespace {
+
+using entry = redis::score_tree::entry;
+
+bool less(const entry &e, double score, std::string_view member) noexcept {
+  return e.score < score || (e.score == score && e.member.view() < member);
+}
+
+bool less(double score, std::string_view member, const entry &e) noexcept {
+  return score < e.score || (score == e.score && member < e.member.view());
+}
+
+template <typename T, std::size_t N>
+void insert_at(std::array<T, N> &a, std::size_t size, std::size_t pos,
+               T value) {
+  std::move_backward(a.begin() + std::ptrdiff_t(pos),
+                     a.begin() + std::ptrdiff_t(size),
+                     a.begin() + std::ptrdiff_t(size + 1));
+  a[pos] = std::move(value);
+}
+
+// leaves the slot at size - 1 empty, so that it holds on to nothing
+template <typename T, std::size_t N>
+void erase_at(std::array<T, N> &a, std::size_t size, std::size_t pos) {
+  std::move(a.begin() + std::ptrdiff_t(pos + 1),
+            a.begin() + std::ptrdiff_t(size), a.begin() + std::ptrdiff_t(pos));
+  a[size - 1] = T();
+}
+
+} // namespace
+
+redis::score_tree::score_tree() : root_(std::make_unique<leaf_node>()) {}
+
+void redis::score_tree::insert(double score, std::string_view member) {
+  entry separator;
+  auto right = insert(*root_, {score, compact_string(member)}, separator);
+  ++size_;
+  if (!right)
+    return;
+
+  // the root was split, so the tree grows a level
+  auto root = std::make_unique<inner_node>();
+  root->counts[1] = count(*right);
+  root->counts[0] = size_ - root->counts[1];
+  root->keys[1] = std::move(separator);
+  root->children[0] = std::move(root_);
+  root->children[1] = std::move(right);
+  root->size = 2;
+  root_ = std::move(root);
+}
+
+void redis::score_tree::erase(double score, std::string_view member) {
+  erase(*root_, score, member);
+  --size_;
+  // the tree shrinks a level when the root is left with one child
+  if (!root_->leaf && root_->size == 1)
+    root_ = std::move(static_cast<inner_node &>(*root_).children[0]);
+}
+
+std::size_t redis::score_tree::rank(double score,
+                                    std::string_view member) const {
+  return count_while(
+      [&](const entry &e) { return less(e, score, member); });
+}
+
+std::size_t redis::score_tree::count_below(double score,
+                                           bool inclusive) const {
+  if (inclusive)
+    return count_while([&](const entry &e) { return e.score <= score; });
+  return count_while([&](const entry &e) { return e.score < score; });
+}
+
+redis::score_tree::const_iterator
+redis::score_tree::at(std::size_t rank) const {
+  if (rank >= size_)
+    return end();
+
+  const node *n = root_.get();
+  while (!n->leaf) {
+    const auto &inner = static_cast<const inner_node &>(*n);
+    std::size_t i = 0;
+    for (; rank >= inner.counts[i]; ++i)
+      rank -= inner.counts[i];
+    n = inner.children[i].get();
+  }
+  return {static_cast<const leaf_node *>(n), std::uint32_t(rank)};
+}
+
+template <typename Before>
+std::size_t redis::score_tree::count_while(Before before) const {
+  std::size_t result = 0;
+  const node *n = root_.get();
+  while (!n->leaf) {
+    // the entries below every child up to the first whose key isn't before
+    // are, except perhaps for some of those below the child before it
+    const auto &inner = static_cast<const inner_node &>(*n);
+    const auto i = std::size_t(
+        std::partition_point(inner.keys.begin() + 1,
+                             inner.keys.begin() + inner.size, before) -
+        inner.keys.begin() - 1);
+    result += std::accumulate(inner.counts.begin(),
+                              inner.counts.begin() + std::ptrdiff_t(i),
+                              std::size_t());
+    n = inner.children[i].get();
+  }
+  const auto &leaf = static_cast<const leaf_node &>(*n);
+  return result + std::size_t(std::partition_point(leaf.entries.begin(),
+                                                   leaf.entries.begin() +
+                                                       leaf.size,
+                                                   before) -
+                              leaf.entries.begin());
+}
+
+std::size_t redis::score_tree::count(const node &n) noexcept {
+  if (n.leaf)
+    return n.size;
+  const auto &inner = static_cast<const inner_node &>(n);
+  return std::accumulate(inner.counts.begin(),
+                         inner.counts.begin() + inner.size, std::size_t());
+}
+
+std::size_t redis::score_tree::child_for(const inner_node &inner,
+                                         double score,
+                                         std::string_view member) noexcept {
+  // the last child whose key is no greater: keys are lower bounds, so an
+  // entry equal to one is below that key's child
+  return std::size_t(std::partition_point(
+                         inner.keys.begin() + 1,
+                         inner.keys.begin() + inner.size,
+                         [&](const entry &key) {
+                           return !less(score, member, key);
+                         }) -
+                     inner.keys.begin() - 1);
+}
+
+std::unique_ptr<redis::score_tree::node>
+redis::score_tree::insert(node &n, entry e, entry &separator) {
+  const auto before = [&](const entry &other) {
+    return less(other, e.score, e.member.view());
+  };
+
+  if (n.leaf) {
+    auto &leaf = static_cast<leaf_node &>(n);
+    const auto pos = std::size_t(
+        std::partition_point(leaf.entries.begin(),
+                             leaf.entries.begin() + leaf.size, before) -
+        leaf.entries.begin());
+    if (leaf.size < leaf_capacity) {
+      insert_at(leaf.entries, leaf.size++, pos, std::move(e));
+      return {};
+    }
+
+    auto right = std::make_unique<leaf_node>();
+    constexpr auto half = leaf_capacity / 2;
+    std::move(leaf.entries.begin() + half, leaf.entries.end(),
+              right->entries.begin());
+    right->size = leaf_capacity - half;
+    leaf.size = half;
+    right->next = leaf.next;
+    leaf.next = right.get();
+    if (pos <= half)
+      insert_at(leaf.entries, leaf.size++, pos, std::move(e));
+    else
+      insert_at(right->entries, right->size++, pos - half, std::move(e));
+    separator = right->entries[0];
+    return right;
+  }
+
+  auto &inner = static_cast<inner_node &>(n);
+  const auto i = child_for(inner, e.score, e.member.view());
+  entry child_separator;
+  auto child_right =
+      insert(*inner.children[i], std::move(e), child_separator);
+  if (!child_right) {
+    ++inner.counts[i];
+    return {};
+  }
+
+  const auto right_count = count(*child_right);
+  inner.counts[i] += 1 - right_count;
+
+  // where the new child goes, splitting this node first if it's full
+  auto *to = &inner;
+  auto pos = i + 1;
+  std::unique_ptr<node> right;
+  if (inner.size == inner_capacity) {
+    auto right_inner = std::make_unique<inner_node>();
+    constexpr auto half = inner_capacity / 2;
+    std::move(inner.keys.begin() + half, inner.keys.end(),
+              right_inner->keys.begin());
+    std::copy(inner.counts.begin() + half, inner.counts.end(),
+              right_inner->counts.begin());
+    std::fill(inner.counts.begin() + half, inner.counts.end(), 0);
+    std::move(inner.children.begin() + half, inner.children.end(),
+              right_inner->children.begin());
+    right_inner->size = inner_capacity - half;
+    inner.size = half;
+    separator = std::move(right_inner->keys[0]);
+    if (pos > half) {
+      to = right_inner.get();
+      pos -= half;
+    }
+    right = std::move(right_inner);
+  }
+  insert_at(to->keys, to->size, pos, std::move(child_separator));
+  insert_at(to->counts, to->size, pos, right_count);
+  insert_at(to->children, to->size, pos, std::move(child_right));
+  ++to->size;
+  return right;
+}
+
+void redis::score_tree::erase(node &n, double score,
+                              std::string_view member) {
+  const auto before = [&](const entry &e) { return less(e, score, member); };
+
+  if (n.leaf) {
+    auto &leaf = static_cast<leaf_node &>(n);
+    const auto pos = std::size_t(
+        std::partition_point(leaf.entries.begin(),
+                             leaf.entries.begin() + leaf.size, before) -
+        leaf.entries.begin());
+    assert(pos < leaf.size && leaf.entries[pos].member.view() == member);
+    erase_at(leaf.entries, leaf.size--, pos);
+    return;
+  }
+
+  auto &inner = static_cast<inner_node &>(n);
+  const auto i = child_for(inner, score, member);
+  auto &child = *inner.children[i];
+  erase(child, score, member);
+  --inner.counts[i];
+  if (child.size < (child.leaf ? leaf_capacity : inner_capacity) / 4)
+    rebalance(inner, i);
+}
+
+void redis::score_tree::rebalance(inner_node &parent, std::size_t i) {
+  // the child and its left sibling, or its right one if it's the first
+  const auto l = i ? i - 1 : i;
+  const auto r = l + 1;
+  auto &left = *parent.children[l];
+  auto &right = *parent.children[r];
+  const auto capacity = left.leaf ? leaf_capacity : inner_capacity;
+
+  if (left.size + right.size <= capacity) {
+    // merge right into left
+    if (left.leaf) {
+      auto &from = static_cast<leaf_node &>(right);
+      auto &to = static_cast<leaf_node &>(left);
+      std::move(from.entries.begin(), from.entries.begin() + from.size,
+                to.entries.begin() + to.size);
+      to.next = from.next;
+    } else {
+      auto &from = static_cast<inner_node &>(right);
+      auto &to = static_cast<inner_node &>(left);
+      to.keys[to.size] = std::move(parent.keys[r]);
+      std::move(from.keys.begin() + 1, from.keys.begin() + from.size,
+                to.keys.begin() + to.size + 1);
+      std::copy(from.counts.begin(), from.counts.begin() + from.size,
+                to.counts.begin() + to.size);
+      std::move(from.children.begin(), from.children.begin() + from.size,
+                to.children.begin() + to.size);
+    }
+    left.size += right.size;
+    parent.counts[l] += parent.counts[r];
+    erase_at(parent.keys, parent.size, r);
+    erase_at(parent.counts, parent.size, r);
+    erase_at(parent.children, parent.size, r);
+    --parent.size;
+    return;
+  }
+
+  // or else move one entry, or child, from the fuller of the two
+  std::size_t moved;
+  if (left.leaf) {
+    auto &lhs = static_cast<leaf_node &>(left);
+    auto &rhs = static_cast<leaf_node &>(right);
+    if (i == r) {
+      insert_at(rhs.entries, rhs.size++, 0,
+                std::move(lhs.entries[lhs.size - 1]));
+      lhs.entries[--lhs.size] = entry();
+    } else {
+      lhs.entries[lhs.size++] = std::move(rhs.entries[0]);
+      erase_at(rhs.entries, rhs.size--, 0);
+    }
+    moved = 1;
+    parent.keys[r] = rhs.entries[0];
+  } else {
+    auto &lhs = static_cast<inner_node &>(left);
+    auto &rhs = static_cast<inner_node &>(right);
+    if (i == r) {
+      const auto last = lhs.size - 1;
+      moved = lhs.counts[last];
+      insert_at(rhs.keys, rhs.size, 0, entry());
+      insert_at(rhs.counts, rhs.size, 0, moved);
+      insert_at(rhs.children, rhs.size, 0, std::move(lhs.children[last]));
+      ++rhs.size;
+      rhs.keys[1] = std::move(parent.keys[r]);
+      parent.keys[r] = std::move(lhs.keys[last]);
+      lhs.keys[last] = entry();
+      lhs.counts[last] = 0;
+      --lhs.size;
+    } else {
+      moved = rhs.counts[0];
+      lhs.keys[lhs.size] = std::move(parent.keys[r]);
+      lhs.counts[lhs.size] = moved;
+      lhs.children[lhs.size] = std::move(rhs.children[0]);
+      ++lhs.size;
+      parent.keys[r] = std::move(rhs.keys[1]);
+      erase_at(rhs.keys, rhs.size, 0);
+      erase_at(rhs.counts, rhs.size, 0);
+      erase_at(rhs.children, rhs.size, 0);
+      --rhs.size;
+    }
+  }
+  if (i == r) {
+    parent.counts[l] -= moved;
+    parent.counts[r] += moved;
+  } else {
+    parent.counts[l] += moved;
+    parent.counts[r] -= moved;
+  }
+}
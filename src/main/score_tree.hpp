@@ -0,0 +1,151 @@
+#ifndef REDIS_SERVER_SCORE_TREE_HPP
+#define REDIS_SERVER_SCORE_TREE_HPP
+
+#include "compact_string.hpp"
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace redis {
+
+/**
+ * The members of a sorted set in order of score, and then of member, as a
+ * B+tree of wide nodes. Each inner node counts the entries below each of its
+ * children, so an entry's rank, or the entry at a rank, is found on the way
+ * down, and the leaves are linked so that a range is walked from there. With
+ * up to 64 entries to a node, 10M members are 4 or 5 levels deep, each a binary
+ * search over contiguous keys, where a skiplist takes a cache miss per step.
+ */
+class score_tree {
+public:
+  struct entry {
+    double score{};
+    compact_string member;
+  };
+
+  static constexpr std::size_t leaf_capacity = 64;
+  static constexpr std::size_t inner_capacity = 64;
+
+private:
+  struct node {
+    explicit node(bool leaf) : leaf(leaf) {}
+    virtual ~node() = default;
+
+    std::uint32_t size{};
+    const bool leaf;
+  };
+
+  struct leaf_node : node {
+    leaf_node() : node(true) {}
+
+    std::array<entry, leaf_capacity> entries;
+    leaf_node *next{};
+  };
+
+  struct inner_node : node {
+    inner_node() : node(false) {}
+
+    // keys[i] is no greater than any entry below children[i], and greater
+    // than any below children[i - 1]; keys[0] is unused
+    std::array<entry, inner_capacity> keys;
+    std::array<std::size_t, inner_capacity> counts{};
+    std::array<std::unique_ptr<node>, inner_capacity> children;
+  };
+
+public:
+  class const_iterator {
+  public:
+    const entry &operator*() const noexcept { return leaf_->entries[pos_]; }
+
+    const entry *operator->() const noexcept { return &**this; }
+
+    const_iterator &operator++() noexcept {
+      if (++pos_ == leaf_->size) {
+        leaf_ = leaf_->next;
+        pos_ = 0;
+      }
+      return *this;
+    }
+
+    bool operator==(const const_iterator &) const noexcept = default;
+
+  private:
+    friend class score_tree;
+
+    const_iterator(const leaf_node *leaf, std::uint32_t pos) noexcept
+        : leaf_(leaf), pos_(pos) {}
+
+    const leaf_node *leaf_{};
+    std::uint32_t pos_{};
+  };
+
+  score_tree();
+
+  [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+  /**
+   * @param score
+   * @param member mustn't be in the tree already
+   */
+  void insert(double score, std::string_view member);
+
+  /**
+   * @param score
+   * @param member must be in the tree with score
+   */
+  void erase(double score, std::string_view member);
+
+  /**
+   * @param score
+   * @param member
+   * @return how many entries come before (score, member)
+   */
+  [[nodiscard]] std::size_t rank(double score, std::string_view member) const;
+
+  /**
+   * @param score
+   * @param inclusive
+   * @return how many entries have a score less than score, or no greater
+   * than it if inclusive
+   */
+  [[nodiscard]] std::size_t count_below(double score, bool inclusive) const;
+
+  /**
+   * @param rank
+   * @return the entry with rank, or end() if there are no more than rank
+   */
+  [[nodiscard]] const_iterator at(std::size_t rank) const;
+
+  [[nodiscard]] const_iterator end() const noexcept { return {nullptr, 0}; }
+
+private:
+  // the number of leading entries for which before(entry) holds, before
+  // being a predicate that's true of the entries up to some point only
+  template <typename Before>
+  std::size_t count_while(Before before) const;
+
+  // how many entries there are below n
+  static std::size_t count(const node &n) noexcept;
+
+  // the index of the child of inner that (score, member) belongs below
+  static std::size_t child_for(const inner_node &inner, double score,
+                               std::string_view member) noexcept;
+
+  // insert e below n, returning n's new right sibling, with separator set to
+  // the key between them, if n had to be split
+  static std::unique_ptr<node> insert(node &n, entry e, entry &separator);
+
+  static void erase(node &n, double score, std::string_view member);
+
+  // top up or merge parent's ith child, which has fallen below a quarter full
+  static void rebalance(inner_node &parent, std::size_t i);
+
+  std::unique_ptr<node> root_;
+  std::size_t size_{};
+};
+
+} // namespace redis
+
+#endif // REDIS_SERVER_SCORE_TREE_HPP
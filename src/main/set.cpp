@@ -0,0 +1,226 @@
+#include "set.hpp"
+#include "simd.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+
+namespace {
+
+using redis::set;
+
+// a range this many times smaller than the other is quicker to look up in it
+// than to merge with it
+constexpr std::size_t search_ratio = 32;
+
+bool all_intsets(std::span<const set *const> sets) {
+  return std::all_of(sets.begin(), sets.end(),
+                     [](const set *s) { return s->is_intset(); });
+}
+
+std::vector<const set *> by_size(std::span<const set *const> sets) {
+  std::vector<const set *> result(sets.begin(), sets.end());
+  std::sort(result.begin(), result.end(), [](const set *lhs, const set *rhs) {
+    return lhs->size() < rhs->size();
+  });
+  return result;
+}
+
+// the result of one of the simd set functions on a and b, which takes at
+// most room integers
+template <typename Kernel>
+set::intset_t merge(const set::intset_t &a, const set::intset_t &b,
+                    std::size_t room, Kernel kernel) {
+  set::intset_t result(room);
+  const auto end = kernel(a.data(), a.data() + a.size(), b.data(),
+                          b.data() + b.size(), result.data());
+  result.resize(std::size_t(end - result.data()));
+  return result;
+}
+
+// the integers in both a and b, a being the smaller
+set::intset_t intersect_ints(const set::intset_t &a, const set::intset_t &b) {
+  if (a.size() * search_ratio >= b.size())
+    return merge(a, b, a.size(), redis::simd::intersect);
+
+  set::intset_t result;
+  auto pos = b.begin();
+  for (const auto i : a) {
+    pos = std::lower_bound(pos, b.end(), i);
+    if (pos == b.end())
+      break;
+    if (*pos == i)
+      result.push_back(i);
+  }
+  return result;
+}
+
+// adds the members of from that keep(member) to to, as a batch so that an
+// intset takes them in one merge
+template <typename Keep>
+void insert_if(set &to, const set &from, Keep keep) {
+  std::vector<std::string> kept;
+  from.visit([&](std::string_view member) {
+    if (keep(member))
+      kept.emplace_back(member);
+  });
+  const std::vector<std::string_view> views(kept.begin(), kept.end());
+  to.insert(views);
+}
+
+} // namespace
+
+redis::set::set(std::size_t max_intset_entries)
+    : max_intset_entries_(std::uint32_t(std::min<std::size_t>(
+          max_intset_entries, std::numeric_limits<std::uint32_t>::max()))) {}
+
+redis::set::set(std::initializer_list<std::string_view> members) : set() {
+  for (const auto member : members)
+    insert(member);
+}
+
+bool redis::set::insert(std::string_view member) {
+  if (!members_) {
+    if (const auto i = string_value::parse_integer(member)) {
+      const auto pos = std::lower_bound(ints_.begin(), ints_.end(), *i);
+      if (pos != ints_.end() && *pos == *i)
+        return false;
+      if (ints_.size() < max_intset_entries_) {
+        ints_.insert(pos, *i);
+        return true;
+      }
+    }
+    convert();
+  }
+  return members_->emplace(member).second;
+}
+
+std::size_t redis::set::insert(std::span<const std::string_view> members) {
+  intset_t ints;
+  if (!members_ && members.size() > 1) {
+    ints.reserve(members.size());
+    for (const auto member : members) {
+      const auto i = string_value::parse_integer(member);
+      if (!i)
+        break;
+      ints.push_back(*i);
+    }
+  }
+
+  if (ints.size() != members.size() ||
+      ints_.size() + ints.size() > max_intset_entries_) {
+    std::size_t result = 0;
+    for (const auto member : members)
+      result += insert(member);
+    return result;
+  }
+
+  std::sort(ints.begin(), ints.end());
+  ints.erase(std::unique(ints.begin(), ints.end()), ints.end());
+  const auto before = ints_.size();
+  ints_ = merge(ints_, ints, ints_.size() + ints.size(), simd::unite);
+  return ints_.size() - before;
+}
+
+bool redis::set::erase(std::string_view member) {
+  if (members_)
+    return members_->erase(member);
+
+  const auto i = string_value::parse_integer(member);
+  if (!i)
+    return false;
+  const auto pos = std::lower_bound(ints_.begin(), ints_.end(), *i);
+  if (pos == ints_.end() || *pos != *i)
+    return false;
+  ints_.erase(pos);
+  return true;
+}
+
+bool redis::set::contains(std::string_view member) const {
+  if (members_)
+    return members_->contains(member);
+
+  const auto i = string_value::parse_integer(member);
+  return i && std::binary_search(ints_.begin(), ints_.end(), *i);
+}
+
+redis::set redis::set::intersect(std::span<const set *const> sets,
+                                 std::size_t max_intset_entries) {
+  set result(max_intset_entries);
+  const auto sorted = by_size(sets);
+  if (all_intsets(sets)) {
+    // smallest first, so that the running result is as small as can be
+    result.ints_ = sorted.front()->ints_;
+    for (const auto *s : std::span(sorted).subspan(1))
+      result.ints_ = intersect_ints(result.ints_, s->ints_);
+    result.fit();
+    return result;
+  }
+
+  insert_if(result, *sorted.front(), [&](std::string_view member) {
+    const auto in = [&](const set *s) { return s->contains(member); };
+    return std::all_of(sorted.begin() + 1, sorted.end(), in);
+  });
+  return result;
+}
+
+redis::set redis::set::unite(std::span<const set *const> sets,
+                             std::size_t max_intset_entries) {
+  set result(max_intset_entries);
+  if (all_intsets(sets)) {
+    for (const auto *s : by_size(sets)) {
+      result.ints_ = merge(result.ints_, s->ints_,
+                           result.ints_.size() + s->ints_.size(), simd::unite);
+    }
+    result.fit();
+    return result;
+  }
+
+  // one of them isn't an intset, so neither is the result
+  result.convert();
+  const auto sorted = by_size(sets);
+  result.members_->reserve(sorted.back()->size());
+  for (const auto *s : sorted) {
+    s->visit(
+        [&](std::string_view member) { result.members_->emplace(member); });
+  }
+  return result;
+}
+
+redis::set redis::set::subtract(const set &from,
+                                std::span<const set *const> sets,
+                                std::size_t max_intset_entries) {
+  set result(max_intset_entries);
+  if (from.is_intset() && all_intsets(sets)) {
+    result.ints_ = from.ints_;
+    for (const auto *s : sets) {
+      result.ints_ = merge(result.ints_, s->ints_, result.ints_.size(),
+                           simd::subtract);
+    }
+    result.fit();
+    return result;
+  }
+
+  insert_if(result, from, [&](std::string_view member) {
+    const auto in = [&](const set *s) { return s->contains(member); };
+    return std::none_of(sets.begin(), sets.end(), in);
+  });
+  return result;
+}
+
+void redis::set::fit() {
+  if (members_)
+    return;
+  if (ints_.size() > max_intset_entries_)
+    convert();
+  else
+    ints_.shrink_to_fit();
+}
+
+void redis::set::convert() {
+  auto members = std::make_unique<hash_set_t>();
+  members->reserve(ints_.size() + 1);
+  visit([&](std::string_view member) { members->emplace(member); });
+  members_ = std::move(members);
+  ints_ = {};
+}
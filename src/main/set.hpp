@@ -0,0 +1,130 @@
+#ifndef REDIS_SERVER_SET_HPP
+#define REDIS_SERVER_SET_HPP
+
+#include "compact_string.hpp"
+#include "string_value.hpp"
+#include "util.hpp"
+
+#include <ankerl/unordered_dense.h>
+
+#include <cstdint>
+#include <initializer_list>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace redis {
+
+/**
+ * A set of strings. While its members are all integers, and there are no more
+ * than max_intset_entries of them, it's kept as a sorted array of them, as in
+ * Redis' intset encoding, which takes a fraction of the memory of a hash set
+ * and which intersections, unions and differences can merge a block of
+ * integers at a time. Otherwise it's converted to a hash set for good.
+ */
+class set {
+public:
+  using intset_t = std::vector<std::int64_t>;
+  using hash_set_t = ankerl::unordered_dense::set<compact_string, util::cs_hash,
+                                                  std::equal_to<>>;
+
+  // as Redis' default set-max-intset-entries
+  static constexpr std::size_t default_max_intset_entries = 512;
+
+  explicit set(std::size_t max_intset_entries = default_max_intset_entries);
+
+  set(std::initializer_list<std::string_view> members);
+
+  [[nodiscard]] std::size_t size() const noexcept {
+    return members_ ? members_->size() : ints_.size();
+  }
+
+  [[nodiscard]] bool empty() const noexcept { return !size(); }
+
+  /**
+   * @return whether it's still in the intset encoding
+   */
+  [[nodiscard]] bool is_intset() const noexcept { return !members_; }
+
+  /**
+   * @param member
+   * @return whether member is new
+   */
+  bool insert(std::string_view member);
+
+  /**
+   * Insert a batch of members. If they're all integers that the intset has
+   * room for, they're sorted and merged into it in one pass, rather than
+   * each moving the integers above it.
+   * @param members
+   * @return how many of them were new
+   */
+  std::size_t insert(std::span<const std::string_view> members);
+
+  /**
+   * @param member
+   * @return whether there was such a member
+   */
+  bool erase(std::string_view member);
+
+  [[nodiscard]] bool contains(std::string_view member) const;
+
+  /**
+   * Call visitor with each member, in order if it's an intset.
+   * @tparam Visitor
+   * @param visitor
+   */
+  template <typename Visitor> void visit(Visitor visitor) const;
+
+  /**
+   * @param sets at least one
+   * @param max_intset_entries for the result
+   * @return the members that are in all of sets
+   */
+  static set intersect(std::span<const set *const> sets,
+                       std::size_t max_intset_entries);
+
+  /**
+   * @param sets
+   * @param max_intset_entries for the result
+   * @return the members that are in any of sets
+   */
+  static set unite(std::span<const set *const> sets,
+                   std::size_t max_intset_entries);
+
+  /**
+   * @param from
+   * @param sets
+   * @param max_intset_entries for the result
+   * @return the members of from that aren't in any of sets
+   */
+  static set subtract(const set &from, std::span<const set *const> sets,
+                      std::size_t max_intset_entries);
+
+private:
+  // convert to a hash set if there are too many integers for an intset, or
+  // else give back any room that merging them left spare
+  void fit();
+
+  void convert();
+
+  intset_t ints_;
+  std::unique_ptr<hash_set_t> members_;
+  std::uint32_t max_intset_entries_;
+};
+
+} // namespace redis
+
+template <typename Visitor> void redis::set::visit(Visitor visitor) const {
+  if (members_) {
+    for (const auto &member : *members_)
+      visitor(member.view());
+    return;
+  }
+
+  for (const auto i : ints_)
+    visitor(string_value(i).view());
+}
+
+#endif // REDIS_SERVER_SET_HPP
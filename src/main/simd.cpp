@@ -0,0 +1,940 @@
+#include "simd.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#ifdef __x86_64__
+#include <immintrin.h>
+#endif
+
+namespace {
+
+namespace ns = redis::simd;
+
+struct kernels {
+  const char *(*find_crlf)(const char *, const char *) noexcept;
+  const char *(*find)(const char *, const char *, char) noexcept;
+  const char *(*find_space)(const char *, const char *) noexcept;
+  const char *(*find_non_space)(const char *, const char *) noexcept;
+  const char *(*find_not)(const char *, const char *, char) noexcept;
+  std::int64_t *(*intersect)(const std::int64_t *, const std::int64_t *,
+                             const std::int64_t *, const std::int64_t *,
+                             std::int64_t *) noexcept;
+  std::int64_t *(*unite)(const std::int64_t *, const std::int64_t *,
+                         const std::int64_t *, const std::int64_t *,
+                         std::int64_t *) noexcept;
+  std::int64_t *(*subtract)(const std::int64_t *, const std::int64_t *,
+                            const std::int64_t *, const std::int64_t *,
+                            std::int64_t *) noexcept;
+  std::uint64_t (*popcount)(const char *, const char *) noexcept;
+  void (*bitwise_and)(char *, const char *, std::size_t) noexcept;
+  void (*bitwise_or)(char *, const char *, std::size_t) noexcept;
+  void (*bitwise_xor)(char *, const char *, std::size_t) noexcept;
+  void (*max_registers)(std::uint8_t *, const std::uint8_t *,
+                        std::size_t) noexcept;
+  double (*harmonic_sum)(const std::uint8_t *, const std::uint8_t *) noexcept;
+  std::uint32_t (*crc32c)(std::uint32_t, const char *, const char *) noexcept;
+};
+
+enum class bitwise { and_, or_, xor_ };
+
+constexpr bool is_space(const unsigned char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+const char *find_crlf_scalar(const char *p, const char *end) noexcept {
+  for (; end - p >= 2; ++p) {
+    if (p[0] == '\r' && p[1] == '\n')
+      return p;
+  }
+  return end;
+}
+
+const char *find_scalar(const char *begin, const char *end, char c) noexcept {
+  return std::find(begin, end, c);
+}
+
+const char *find_space_scalar(const char *begin, const char *end) noexcept {
+  return std::find_if(begin, end, is_space);
+}
+
+const char *find_non_space_scalar(const char *begin, const char *end) noexcept {
+  return std::find_if_not(begin, end, is_space);
+}
+
+const char *find_not_scalar(const char *begin, const char *end,
+                            char c) noexcept {
+  return std::find_if(begin, end, [c](char x) { return x != c; });
+}
+
+// the set merges are branch free, as which of two integers is the smaller is
+// unpredictable
+
+std::int64_t *intersect_scalar(const std::int64_t *a, const std::int64_t *a_end,
+                               const std::int64_t *b, const std::int64_t *b_end,
+                               std::int64_t *out) noexcept {
+  while (a != a_end && b != b_end) {
+    const auto x = *a;
+    const auto y = *b;
+    *out = x;
+    out += x == y;
+    a += x <= y;
+    b += y <= x;
+  }
+  return out;
+}
+
+std::int64_t *unite_scalar(const std::int64_t *a, const std::int64_t *a_end,
+                           const std::int64_t *b, const std::int64_t *b_end,
+                           std::int64_t *out) noexcept {
+  while (a != a_end && b != b_end) {
+    const auto x = *a;
+    const auto y = *b;
+    *out++ = std::min(x, y);
+    a += x <= y;
+    b += y <= x;
+  }
+  return std::copy(b, b_end, std::copy(a, a_end, out));
+}
+
+std::int64_t *subtract_scalar(const std::int64_t *a, const std::int64_t *a_end,
+                              const std::int64_t *b, const std::int64_t *b_end,
+                              std::int64_t *out) noexcept {
+  while (a != a_end && b != b_end) {
+    const auto x = *a;
+    const auto y = *b;
+    *out = x;
+    out += x < y;
+    a += x <= y;
+    b += y <= x;
+  }
+  return std::copy(a, a_end, out);
+}
+
+std::uint64_t popcount_scalar(const char *p, const char *end) noexcept {
+  std::uint64_t result = 0;
+  for (; end - p >= 8; p += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    result += unsigned(std::popcount(word));
+  }
+  for (; p != end; ++p)
+    result += unsigned(std::popcount(static_cast<unsigned char>(*p)));
+  return result;
+}
+
+template <bitwise Op>
+void bitwise_scalar(char *out, const char *in, std::size_t size) noexcept {
+  for (std::size_t i = 0; i < size; ++i) {
+    if constexpr (Op == bitwise::and_)
+      out[i] &= in[i];
+    else if constexpr (Op == bitwise::or_)
+      out[i] |= in[i];
+    else
+      out[i] ^= in[i];
+  }
+}
+
+void max_registers_scalar(std::uint8_t *registers, const std::uint8_t *p,
+                          std::size_t count) noexcept {
+  for (std::size_t i = 0; i < count; i += 4, p += 3) {
+    const unsigned b0 = p[0];
+    const unsigned b1 = p[1];
+    const unsigned b2 = p[2];
+    auto *const r = registers + i;
+    r[0] = std::uint8_t(std::max(unsigned(r[0]), b0 & 63));
+    r[1] = std::uint8_t(std::max(unsigned(r[1]), (b0 >> 6 | b1 << 2) & 63));
+    r[2] = std::uint8_t(std::max(unsigned(r[2]), (b1 >> 4 | b2 << 4) & 63));
+    r[3] = std::uint8_t(std::max(unsigned(r[3]), b2 >> 2));
+  }
+}
+
+// 2^-x, made from its exponent, as x is a whole number
+double inverse_power(std::uint64_t x) noexcept {
+  return std::bit_cast<double>((1023 - x) << 52);
+}
+
+double harmonic_sum_scalar(const std::uint8_t *p,
+                           const std::uint8_t *end) noexcept {
+  double result = 0;
+  for (; p != end; ++p)
+    result += inverse_power(*p);
+  return result;
+}
+
+// the Castagnoli polynomial, bit reversed
+constexpr std::uint32_t crc32c_polynomial = 0x82f63b78;
+
+// tables[k][b] is the CRC of byte b followed by k zero bytes, so that 8 bytes
+// can be folded in at a time, one lookup each ("slicing by 8")
+constexpr auto crc32c_tables = []() {
+  std::array<std::array<std::uint32_t, 256>, 8> result{};
+  for (std::uint32_t b = 0; b < 256; ++b) {
+    auto crc = b;
+    for (int bit = 0; bit < 8; ++bit)
+      crc = crc >> 1 ^ (crc & 1 ? crc32c_polynomial : 0);
+    result[0][b] = crc;
+  }
+  for (std::size_t k = 1; k < 8; ++k) {
+    for (std::size_t b = 0; b < 256; ++b)
+      result[k][b] = result[k - 1][b] >> 8 ^
+                     result[0][result[k - 1][b] & 0xff];
+  }
+  return result;
+}();
+
+std::uint32_t crc32c_scalar(std::uint32_t crc, const char *p,
+                            const char *end) noexcept {
+  const auto &t = crc32c_tables;
+  crc = ~crc;
+  for (; end - p >= 8; p += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    if constexpr (std::endian::native == std::endian::big)
+      word = __builtin_bswap64(word);
+    word ^= crc;
+    crc = t[7][word & 0xff] ^ t[6][word >> 8 & 0xff] ^
+          t[5][word >> 16 & 0xff] ^ t[4][word >> 24 & 0xff] ^
+          t[3][word >> 32 & 0xff] ^ t[2][word >> 40 & 0xff] ^
+          t[1][word >> 48 & 0xff] ^ t[0][word >> 56];
+  }
+  for (; p != end; ++p)
+    crc = crc >> 8 ^ t[0][(crc ^ static_cast<unsigned char>(*p)) & 0xff];
+  return ~crc;
+}
+
+constexpr kernels scalar_kernels{find_crlf_scalar,
+                                 find_scalar,
+                                 find_space_scalar,
+                                 find_non_space_scalar,
+                                 find_not_scalar,
+                                 intersect_scalar,
+                                 unite_scalar,
+                                 subtract_scalar,
+                                 popcount_scalar,
+                                 bitwise_scalar<bitwise::and_>,
+                                 bitwise_scalar<bitwise::or_>,
+                                 bitwise_scalar<bitwise::xor_>,
+                                 max_registers_scalar,
+                                 harmonic_sum_scalar,
+                                 crc32c_scalar};
+
+#ifdef __x86_64__
+
+// SSE2 is part of x86-64, so these need no runtime check
+
+__m128i load_sse2(const char *p) {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+
+// a bit set for each byte of v that is whitespace
+unsigned space_mask_sse2(__m128i v) {
+  // '\t' to '\r' are the bytes that are at most 4 after subtracting '\t'
+  const auto offset = _mm_sub_epi8(v, _mm_set1_epi8('\t'));
+  const auto control =
+      _mm_cmpeq_epi8(_mm_min_epu8(offset, _mm_set1_epi8(4)), offset);
+  const auto space = _mm_cmpeq_epi8(v, _mm_set1_epi8(' '));
+  return unsigned(_mm_movemask_epi8(_mm_or_si128(control, space)));
+}
+
+const char *find_crlf_sse2(const char *p, const char *end) noexcept {
+  const auto cr = _mm_set1_epi8('\r');
+  const auto lf = _mm_set1_epi8('\n');
+  // each step looks at one byte beyond the 16 for the '\n'
+  for (; end - p > 16; p += 16) {
+    const auto mask =
+        unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(load_sse2(p), cr))) &
+        unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(load_sse2(p + 1), lf)));
+    if (mask)
+      return p + __builtin_ctz(mask);
+  }
+  return find_crlf_scalar(p, end);
+}
+
+const char *find_sse2(const char *p, const char *end, char c) noexcept {
+  const auto needle = _mm_set1_epi8(c);
+  for (; end - p >= 16; p += 16) {
+    const auto mask =
+        unsigned(_mm_movemask_epi8(_mm_cmpeq_epi8(load_sse2(p), needle)));
+    if (mask)
+      return p + __builtin_ctz(mask);
+  }
+  return find_scalar(p, end, c);
+}
+
+const char *find_space_sse2(const char *p, const char *end) noexcept {
+  for (; end - p >= 16; p += 16) {
+    if (const auto mask = space_mask_sse2(load_sse2(p)))
+      return p + __builtin_ctz(mask);
+  }
+  return find_space_scalar(p, end);
+}
+
+const char *find_non_space_sse2(const char *p, const char *end) noexcept {
+  for (; end - p >= 16; p += 16) {
+    if (const auto mask = ~space_mask_sse2(load_sse2(p)) & 0xffff)
+      return p + __builtin_ctz(mask);
+  }
+  return find_non_space_scalar(p, end);
+}
+
+const char *find_not_sse2(const char *p, const char *end, char c) noexcept {
+  const auto needle = _mm_set1_epi8(c);
+  for (; end - p >= 16; p += 16) {
+    const auto mask = ~unsigned(_mm_movemask_epi8(
+                          _mm_cmpeq_epi8(load_sse2(p), needle))) &
+                      0xffff;
+    if (mask)
+      return p + __builtin_ctz(mask);
+  }
+  return find_not_scalar(p, end, c);
+}
+
+// the bits of each byte are added up in place, in pairs, nibbles and then
+// bytes, and the bytes summed by psadbw
+std::uint64_t popcount_sse2(const char *p, const char *end) noexcept {
+  const auto m1 = _mm_set1_epi8(0x55);
+  const auto m2 = _mm_set1_epi8(0x33);
+  const auto m4 = _mm_set1_epi8(0x0f);
+  auto total = _mm_setzero_si128();
+  for (; end - p >= 16; p += 16) {
+    auto v = load_sse2(p);
+    v = _mm_sub_epi8(v, _mm_and_si128(_mm_srli_epi16(v, 1), m1));
+    v = _mm_add_epi8(_mm_and_si128(v, m2),
+                     _mm_and_si128(_mm_srli_epi16(v, 2), m2));
+    v = _mm_and_si128(_mm_add_epi8(v, _mm_srli_epi16(v, 4)), m4);
+    total = _mm_add_epi64(total, _mm_sad_epu8(v, _mm_setzero_si128()));
+  }
+  return std::uint64_t(_mm_cvtsi128_si64(total)) +
+         std::uint64_t(_mm_cvtsi128_si64(_mm_unpackhi_epi64(total, total))) +
+         popcount_scalar(p, end);
+}
+
+template <bitwise Op>
+void bitwise_sse2(char *out, const char *in, std::size_t size) noexcept {
+  std::size_t i = 0;
+  for (; size - i >= 16; i += 16) {
+    const auto a = load_sse2(out + i);
+    const auto b = load_sse2(in + i);
+    __m128i result;
+    if constexpr (Op == bitwise::and_)
+      result = _mm_and_si128(a, b);
+    else if constexpr (Op == bitwise::or_)
+      result = _mm_or_si128(a, b);
+    else
+      result = _mm_xor_si128(a, b);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), result);
+  }
+  bitwise_scalar<Op>(out + i, in + i, size - i);
+}
+
+// the 8 registers packed into the 6 bytes at p, a byte each: spread to 12
+// bits each 16, and then to 6 each 8; 8 bytes are read
+std::uint64_t spread_registers(const std::uint8_t *p) noexcept {
+  std::uint64_t x;
+  std::memcpy(&x, p, sizeof(x));
+  x = (x & 0xfff) | (x & 0xfff000) << 4 | (x & 0xfff000000) << 8 |
+      (x & 0xfff000000000) << 12;
+  return (x & 0x003f003f003f003f) | (x & 0x0fc00fc00fc00fc0) << 2;
+}
+
+void max_registers_sse2(std::uint8_t *registers, const std::uint8_t *p,
+                        std::size_t count) noexcept {
+  // 14 bytes are read for the 12 unpacked
+  std::size_t i = 0;
+  for (; count - i >= 20; i += 16, p += 12) {
+    auto *const to = reinterpret_cast<__m128i *>(registers + i);
+    const auto unpacked = _mm_set_epi64x(std::int64_t(spread_registers(p + 6)),
+                                         std::int64_t(spread_registers(p)));
+    _mm_storeu_si128(to, _mm_max_epu8(_mm_loadu_si128(to), unpacked));
+  }
+  max_registers_scalar(registers + i, p, count - i);
+}
+
+// 2^-x for each 64 bit lane x
+__m128d inverse_powers_sse2(__m128i x) {
+  return _mm_castsi128_pd(
+      _mm_slli_epi64(_mm_sub_epi64(_mm_set1_epi64x(1023), x), 52));
+}
+
+// the bytes are widened to 64 bit lanes by unpacking them with zeros
+double harmonic_sum_sse2(const std::uint8_t *p,
+                         const std::uint8_t *end) noexcept {
+  const auto zero = _mm_setzero_si128();
+  auto even = _mm_setzero_pd();
+  auto odd = _mm_setzero_pd();
+  for (; end - p >= 16; p += 16) {
+    const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    for (const auto words : {_mm_unpacklo_epi8(v, zero),
+                             _mm_unpackhi_epi8(v, zero)}) {
+      for (const auto dwords : {_mm_unpacklo_epi16(words, zero),
+                                _mm_unpackhi_epi16(words, zero)}) {
+        const auto lo = _mm_unpacklo_epi32(dwords, zero);
+        const auto hi = _mm_unpackhi_epi32(dwords, zero);
+        even = _mm_add_pd(even, inverse_powers_sse2(lo));
+        odd = _mm_add_pd(odd, inverse_powers_sse2(hi));
+      }
+    }
+  }
+  const auto sum = _mm_add_pd(even, odd);
+  return _mm_cvtsd_f64(sum) + _mm_cvtsd_f64(_mm_unpackhi_pd(sum, sum)) +
+         harmonic_sum_scalar(p, end);
+}
+
+// SSE2 has no 64 bit comparisons, so sets are merged as scalars
+constexpr kernels sse2_kernels{find_crlf_sse2,
+                               find_sse2,
+                               find_space_sse2,
+                               find_non_space_sse2,
+                               find_not_sse2,
+                               intersect_scalar,
+                               unite_scalar,
+                               subtract_scalar,
+                               popcount_sse2,
+                               bitwise_sse2<bitwise::and_>,
+                               bitwise_sse2<bitwise::or_>,
+                               bitwise_sse2<bitwise::xor_>,
+                               max_registers_sse2,
+                               harmonic_sum_sse2,
+                               crc32c_scalar};
+
+// the same again 32 bytes at a time, for CPUs that turn out to have AVX2
+
+[[gnu::target("avx2")]] __m256i load_avx2(const char *p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+[[gnu::target("avx2")]] unsigned space_mask_avx2(__m256i v) {
+  const auto offset = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+  const auto control =
+      _mm256_cmpeq_epi8(_mm256_min_epu8(offset, _mm256_set1_epi8(4)), offset);
+  const auto space = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+  return unsigned(_mm256_movemask_epi8(_mm256_or_si256(control, space)));
+}
+
+[[gnu::target("avx2")]] const char *find_crlf_avx2(const char *p,
+                                                   const char *end) noexcept {
+  const auto cr = _mm256_set1_epi8('\r');
+  const auto lf = _mm256_set1_epi8('\n');
+  for (; end - p > 32; p += 32) {
+    const auto mask =
+        unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(load_avx2(p), cr))) &
+        unsigned(_mm256_movemask_epi8(_mm256_cmpeq_epi8(load_avx2(p + 1), lf)));
+    if (mask)
+      return p + __builtin_ctz(mask);
+  }
+  return find_crlf_sse2(p, end);
+}
+
+[[gnu::target("avx2")]] const char *find_avx2(const char *p, const char *end,
+                                              char c) noexcept {
+  const auto needle = _mm256_set1_epi8(c);
+  for (; end - p >= 32; p += 32) {
+    const auto mask = unsigned(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(load_avx2(p), needle)));
+    if (mask)
+      return p + __builtin_ctz(mask);
+  }
+  return find_sse2(p, end, c);
+}
+
+[[gnu::target("avx2")]] const char *find_space_avx2(const char *p,
+                                                    const char *end) noexcept {
+  for (; end - p >= 32; p += 32) {
+    if (const auto mask = space_mask_avx2(load_avx2(p)))
+      return p + __builtin_ctz(mask);
+  }
+  return find_space_sse2(p, end);
+}
+
+[[gnu::target("avx2")]] const char *
+find_non_space_avx2(const char *p, const char *end) noexcept {
+  for (; end - p >= 32; p += 32) {
+    if (const auto mask = ~space_mask_avx2(load_avx2(p)))
+      return p + __builtin_ctz(mask);
+  }
+  return find_non_space_sse2(p, end);
+}
+
+[[gnu::target("avx2")]] const char *
+find_not_avx2(const char *p, const char *end, char c) noexcept {
+  const auto needle = _mm256_set1_epi8(c);
+  for (; end - p >= 32; p += 32) {
+    const auto mask = ~unsigned(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(load_avx2(p), needle)));
+    if (mask)
+      return p + __builtin_ctz(mask);
+  }
+  return find_not_sse2(p, end, c);
+}
+
+// each nibble's bits are looked up with vpshufb, and the byte counts, of at
+// most 8 each, added up for up to 31 blocks before they're summed by vpsadbw
+// into 64 bit lanes; every AVX2 CPU has POPCNT for the tail
+[[gnu::target("avx2,popcnt")]] std::uint64_t
+popcount_avx2(const char *p, const char *end) noexcept {
+  const auto lookup =
+      _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4, 0, 1,
+                       1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  const auto low = _mm256_set1_epi8(0x0f);
+  auto total = _mm256_setzero_si256();
+  while (end - p >= 32) {
+    auto counts = _mm256_setzero_si256();
+    for (int i = 0; i < 31 && end - p >= 32; ++i, p += 32) {
+      const auto v = load_avx2(p);
+      const auto lo = _mm256_shuffle_epi8(lookup, _mm256_and_si256(v, low));
+      const auto hi = _mm256_shuffle_epi8(
+          lookup, _mm256_and_si256(_mm256_srli_epi16(v, 4), low));
+      counts = _mm256_add_epi8(counts, _mm256_add_epi8(lo, hi));
+    }
+    total = _mm256_add_epi64(total,
+                             _mm256_sad_epu8(counts, _mm256_setzero_si256()));
+  }
+  std::uint64_t result = std::uint64_t(_mm256_extract_epi64(total, 0)) +
+                         std::uint64_t(_mm256_extract_epi64(total, 1)) +
+                         std::uint64_t(_mm256_extract_epi64(total, 2)) +
+                         std::uint64_t(_mm256_extract_epi64(total, 3));
+  for (; end - p >= 8; p += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    result += std::uint64_t(_mm_popcnt_u64(word));
+  }
+  return result + popcount_scalar(p, end);
+}
+
+template <bitwise Op>
+[[gnu::target("avx2")]] void bitwise_avx2(char *out, const char *in,
+                                          std::size_t size) noexcept {
+  std::size_t i = 0;
+  for (; size - i >= 32; i += 32) {
+    const auto a = load_avx2(out + i);
+    const auto b = load_avx2(in + i);
+    __m256i result;
+    if constexpr (Op == bitwise::and_)
+      result = _mm256_and_si256(a, b);
+    else if constexpr (Op == bitwise::or_)
+      result = _mm256_or_si256(a, b);
+    else
+      result = _mm256_xor_si256(a, b);
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(out + i), result);
+  }
+  bitwise_sse2<Op>(out + i, in + i, size - i);
+}
+
+// each 3 bytes b0 b1 b2 are shuffled to b0 b1 b1 b2, so that the 4 registers
+// in them are at fixed shifts within its two 16 bit halves, which are made by
+// multiplying, as AVX2 has no variable 16 bit shifts; each lane takes 12
+// bytes, so 28 are read for the 24 unpacked
+[[gnu::target("avx2")]] void max_registers_avx2(std::uint8_t *registers,
+                                                const std::uint8_t *p,
+                                                std::size_t count) noexcept {
+  const auto shuffle =
+      _mm256_setr_epi8(0, 1, 1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11, 0, 1,
+                       1, 2, 3, 4, 4, 5, 6, 7, 7, 8, 9, 10, 10, 11);
+  std::size_t i = 0;
+  for (; count - i >= 40; i += 32, p += 24) {
+    const auto lo = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    const auto hi =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + 12));
+    const auto t = _mm256_shuffle_epi8(
+        _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1), shuffle);
+    const auto r0 = _mm256_and_si256(t, _mm256_set1_epi32(0x0000003f));
+    const auto r1 =
+        _mm256_and_si256(_mm256_mullo_epi16(t, _mm256_set1_epi32(4)),
+                         _mm256_set1_epi32(0x00003f00));
+    const auto r2 = _mm256_and_si256(
+        _mm256_mulhi_epu16(t, _mm256_set1_epi32(0x10000000)),
+        _mm256_set1_epi32(0x003f0000));
+    const auto r3 = _mm256_and_si256(
+        _mm256_mulhi_epu16(t, _mm256_set1_epi32(0x40000000)),
+        _mm256_set1_epi32(0x3f000000));
+    const auto unpacked =
+        _mm256_or_si256(_mm256_or_si256(r0, r1), _mm256_or_si256(r2, r3));
+    auto *const to = reinterpret_cast<__m256i *>(registers + i);
+    _mm256_storeu_si256(to, _mm256_max_epu8(_mm256_loadu_si256(to), unpacked));
+  }
+  max_registers_sse2(registers + i, p, count - i);
+}
+
+// 2^-x for each of the low 4 bytes x of v
+[[gnu::target("avx2")]] __m256d inverse_powers_avx2(__m128i v) {
+  const auto x = _mm256_cvtepu8_epi64(v);
+  return _mm256_castsi256_pd(
+      _mm256_slli_epi64(_mm256_sub_epi64(_mm256_set1_epi64x(1023), x), 52));
+}
+
+// 16 bytes at a time, into 4 sums so that the additions' latencies overlap
+[[gnu::target("avx2")]] double
+harmonic_sum_avx2(const std::uint8_t *p, const std::uint8_t *end) noexcept {
+  auto sum0 = _mm256_setzero_pd();
+  auto sum1 = _mm256_setzero_pd();
+  auto sum2 = _mm256_setzero_pd();
+  auto sum3 = _mm256_setzero_pd();
+  for (; end - p >= 16; p += 16) {
+    const auto v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    sum0 = _mm256_add_pd(sum0, inverse_powers_avx2(v));
+    sum1 = _mm256_add_pd(sum1, inverse_powers_avx2(_mm_srli_si128(v, 4)));
+    sum2 = _mm256_add_pd(sum2, inverse_powers_avx2(_mm_srli_si128(v, 8)));
+    sum3 = _mm256_add_pd(sum3, inverse_powers_avx2(_mm_srli_si128(v, 12)));
+  }
+  const auto sum =
+      _mm256_add_pd(_mm256_add_pd(sum0, sum1), _mm256_add_pd(sum2, sum3));
+  std::array<double, 4> lanes;
+  _mm256_storeu_pd(lanes.data(), sum);
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] +
+         harmonic_sum_scalar(p, end);
+}
+
+// SSE4.2's crc32 instruction, 8 bytes at a time: every CPU with AVX2 has it
+[[gnu::target("sse4.2")]] std::uint32_t
+crc32c_sse42(std::uint32_t crc, const char *p, const char *end) noexcept {
+  std::uint64_t result = ~crc;
+  for (; end - p >= 8; p += 8) {
+    std::uint64_t word;
+    std::memcpy(&word, p, sizeof(word));
+    result = _mm_crc32_u64(result, word);
+  }
+  auto crc32 = std::uint32_t(result);
+  for (; p != end; ++p)
+    crc32 = _mm_crc32_u8(crc32, static_cast<unsigned char>(*p));
+  return ~crc32;
+}
+
+// the sets' integers are taken 4 at a time
+
+[[gnu::target("avx2")]] __m256i load_avx2(const std::int64_t *p) {
+  return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+}
+
+// for each mask of 64 bit lanes, the 32 bit lanes that gather them at the
+// bottom of a vector, in order
+constexpr auto compress_lanes = []() {
+  std::array<std::array<std::int32_t, 8>, 16> result{};
+  for (unsigned mask = 0; mask < 16; ++mask) {
+    unsigned n = 0;
+    for (unsigned lane = 0; lane < 4; ++lane) {
+      if (!(mask & (1u << lane)))
+        continue;
+      result[mask][2 * n] = std::int32_t(2 * lane);
+      result[mask][2 * n + 1] = std::int32_t(2 * lane + 1);
+      ++n;
+    }
+  }
+  return result;
+}();
+
+// write the lanes of v picked by mask to out, and only them, one after another
+[[gnu::target("avx2")]] std::int64_t *
+compress_store_avx2(std::int64_t *out, __m256i v, unsigned mask) noexcept {
+  const auto lanes = _mm256_loadu_si256(
+      reinterpret_cast<const __m256i *>(compress_lanes[mask].data()));
+  const auto n = __builtin_popcount(mask);
+  const auto store = _mm256_cmpgt_epi64(_mm256_set1_epi64x(n),
+                                        _mm256_setr_epi64x(0, 1, 2, 3));
+  _mm256_maskstore_epi64(reinterpret_cast<long long *>(out), store,
+                         _mm256_permutevar8x32_epi32(v, lanes));
+  return out + n;
+}
+
+// which lanes of a are equal to any lane of b, comparing a with each rotation
+// of b
+[[gnu::target("avx2")]] unsigned match_mask_avx2(__m256i a, __m256i b) {
+  auto eq = _mm256_cmpeq_epi64(a, b);
+  eq = _mm256_or_si256(
+      eq, _mm256_cmpeq_epi64(
+              a, _mm256_permute4x64_epi64(b, _MM_SHUFFLE(0, 3, 2, 1))));
+  eq = _mm256_or_si256(
+      eq, _mm256_cmpeq_epi64(
+              a, _mm256_permute4x64_epi64(b, _MM_SHUFFLE(1, 0, 3, 2))));
+  eq = _mm256_or_si256(
+      eq, _mm256_cmpeq_epi64(
+              a, _mm256_permute4x64_epi64(b, _MM_SHUFFLE(2, 1, 0, 3))));
+  return unsigned(_mm256_movemask_pd(_mm256_castsi256_pd(eq)));
+}
+
+// a block of each range is compared all against all, and then whichever block
+// has the lower maximum, or both, is moved past
+[[gnu::target("avx2")]] std::int64_t *
+intersect_avx2(const std::int64_t *a, const std::int64_t *a_end,
+               const std::int64_t *b, const std::int64_t *b_end,
+               std::int64_t *out) noexcept {
+  while (a_end - a >= 4 && b_end - b >= 4) {
+    const auto a_max = a[3];
+    const auto b_max = b[3];
+    const auto va = load_avx2(a);
+    out = compress_store_avx2(out, va, match_mask_avx2(va, load_avx2(b)));
+    a += 4 * (a_max <= b_max);
+    b += 4 * (b_max <= a_max);
+  }
+  return intersect_scalar(a, a_end, b, b_end, out);
+}
+
+[[gnu::target("avx2")]] std::int64_t *
+subtract_avx2(const std::int64_t *a, const std::int64_t *a_end,
+              const std::int64_t *b, const std::int64_t *b_end,
+              std::int64_t *out) noexcept {
+  // the lanes of a's block matched by b's blocks so far
+  unsigned matched = 0;
+  while (a_end - a >= 4 && b_end - b >= 4) {
+    const auto a_max = a[3];
+    const auto b_max = b[3];
+    const auto va = load_avx2(a);
+    matched |= match_mask_avx2(va, load_avx2(b));
+    if (a_max <= b_max) {
+      out = compress_store_avx2(out, va, ~matched & 0xf);
+      matched = 0;
+      a += 4;
+    }
+    b += 4 * (b_max <= a_max);
+  }
+  if (matched) {
+    // a's block was partly matched by blocks of b that have been moved past
+    std::int64_t rest[4];
+    const auto rest_end =
+        compress_store_avx2(rest, load_avx2(a), ~matched & 0xf);
+    out = subtract_scalar(rest, rest_end, b, b_end, out);
+    a += 4;
+  }
+  return subtract_scalar(a, a_end, b, b_end, out);
+}
+
+// the lower of each pair of lanes of lo and hi into lo, the higher into hi
+[[gnu::target("avx2")]] void minmax_avx2(__m256i &lo, __m256i &hi) noexcept {
+  const auto gt = _mm256_cmpgt_epi64(lo, hi);
+  const auto min = _mm256_blendv_epi8(lo, hi, gt);
+  hi = _mm256_blendv_epi8(hi, lo, gt);
+  lo = min;
+}
+
+// merge sorted lo and hi with a bitonic network, leaving the lowest 4 lanes
+// in lo and the highest in hi, each sorted
+[[gnu::target("avx2")]] void merge_avx2(__m256i &lo, __m256i &hi) noexcept {
+  hi = _mm256_permute4x64_epi64(hi, _MM_SHUFFLE(0, 1, 2, 3));
+  minmax_avx2(lo, hi);
+  // lanes 2 apart
+  auto l = _mm256_permute2x128_si256(lo, hi, 0x20);
+  auto h = _mm256_permute2x128_si256(lo, hi, 0x31);
+  minmax_avx2(l, h);
+  // lanes 1 apart
+  auto l1 = _mm256_unpacklo_epi64(l, h);
+  auto h1 = _mm256_unpackhi_epi64(l, h);
+  minmax_avx2(l1, h1);
+  const auto l2 = _mm256_unpacklo_epi64(l1, h1);
+  const auto h2 = _mm256_unpackhi_epi64(l1, h1);
+  lo = _mm256_permute2x128_si256(l2, h2, 0x20);
+  hi = _mm256_permute2x128_si256(l2, h2, 0x31);
+}
+
+// write the sorted lanes of v to out, but for those equal to the lane before,
+// with last taken as the lane before the first, and update last
+[[gnu::target("avx2")]] std::int64_t *
+store_distinct_avx2(std::int64_t *out, __m256i v, std::int64_t &last) noexcept {
+  const auto before =
+      _mm256_blend_epi32(_mm256_permute4x64_epi64(v, _MM_SHUFFLE(2, 1, 0, 0)),
+                         _mm256_set1_epi64x(last), 0x03);
+  const auto same = unsigned(_mm256_movemask_pd(
+      _mm256_castsi256_pd(_mm256_cmpeq_epi64(v, before))));
+  last = _mm256_extract_epi64(v, 3);
+  return compress_store_avx2(out, v, ~same & 0xf);
+}
+
+// a block of 4 is merged at a time with the highest 4 so far, taken from
+// whichever range has the lower next integer
+[[gnu::target("avx2")]] std::int64_t *
+unite_avx2(const std::int64_t *a, const std::int64_t *a_end,
+           const std::int64_t *b, const std::int64_t *b_end,
+           std::int64_t *out) noexcept {
+  if (a_end - a < 4 || b_end - b < 4)
+    return unite_scalar(a, a_end, b, b_end, out);
+
+  // anything but the lowest integer of all, for it not to be dropped
+  std::int64_t last = ~std::min(*a, *b);
+  auto lo = load_avx2(a);
+  auto hi = load_avx2(b);
+  a += 4;
+  b += 4;
+  merge_avx2(lo, hi);
+  out = store_distinct_avx2(out, lo, last);
+  while (a_end - a >= 4 && b_end - b >= 4) {
+    if (*a < *b) {
+      lo = load_avx2(a);
+      a += 4;
+    } else {
+      lo = load_avx2(b);
+      b += 4;
+    }
+    merge_avx2(lo, hi);
+    out = store_distinct_avx2(out, lo, last);
+  }
+
+  // merge what's in hi, which may hold an integer twice, with what's left of
+  // the range that's nearly done, and that with the rest of the other,
+  // leaving out the one integer that may have been written last already
+  const auto written = last;
+  std::int64_t pending[4];
+  const auto pending_end = store_distinct_avx2(pending, hi, last);
+  const bool a_done = a_end - a < 4;
+  std::int64_t merged[7];
+  const std::int64_t *merged_begin = merged;
+  const auto merged_end = unite_scalar(pending, pending_end, a_done ? a : b,
+                                       a_done ? a_end : b_end, merged);
+  auto rest = a_done ? b : a;
+  const auto rest_end = a_done ? b_end : a_end;
+  merged_begin += merged_begin != merged_end && *merged_begin == written;
+  rest += rest != rest_end && *rest == written;
+  return unite_scalar(merged_begin, merged_end, rest, rest_end, out);
+}
+
+constexpr kernels avx2_kernels{find_crlf_avx2,
+                               find_avx2,
+                               find_space_avx2,
+                               find_non_space_avx2,
+                               find_not_avx2,
+                               intersect_avx2,
+                               unite_avx2,
+                               subtract_avx2,
+                               popcount_avx2,
+                               bitwise_avx2<bitwise::and_>,
+                               bitwise_avx2<bitwise::or_>,
+                               bitwise_avx2<bitwise::xor_>,
+                               max_registers_avx2,
+                               harmonic_sum_avx2,
+                               crc32c_sse42};
+
+#endif
+
+const kernels &kernels_for(ns::isa i) noexcept {
+  switch (i) {
+#ifdef __x86_64__
+  case ns::isa::avx2:
+    return avx2_kernels;
+  case ns::isa::sse2:
+    return sse2_kernels;
+#endif
+  default:
+    return scalar_kernels;
+  }
+}
+
+ns::isa best() noexcept {
+  for (auto i : {ns::isa::avx2, ns::isa::sse2}) {
+    if (ns::supported(i))
+      return i;
+  }
+  return ns::isa::scalar;
+}
+
+// chosen on first use, as parsing can happen during static initialisation
+std::atomic<const kernels *> active{};
+std::atomic<ns::isa> active_isa{};
+
+const kernels &get() noexcept {
+  const auto *result = active.load(std::memory_order_relaxed);
+  if (!result) {
+    ns::use(best());
+    result = active.load(std::memory_order_relaxed);
+  }
+  return *result;
+}
+
+} // namespace
+
+bool ns::supported(isa i) noexcept {
+  switch (i) {
+  case isa::scalar:
+    return true;
+#ifdef __x86_64__
+  case isa::sse2:
+    return true;
+  case isa::avx2:
+    return __builtin_cpu_supports("avx2") &&
+           __builtin_cpu_supports("sse4.2");
+#endif
+  default:
+    return false;
+  }
+}
+
+void ns::use(isa i) noexcept {
+  active_isa.store(i, std::memory_order_relaxed);
+  active.store(&kernels_for(i), std::memory_order_relaxed);
+}
+
+ns::isa ns::current() noexcept {
+  get();
+  return active_isa.load(std::memory_order_relaxed);
+}
+
+const char *ns::find_crlf(const char *begin, const char *end) noexcept {
+  return get().find_crlf(begin, end);
+}
+
+const char *ns::find(const char *begin, const char *end, char c) noexcept {
+  return get().find(begin, end, c);
+}
+
+const char *ns::find_space(const char *begin, const char *end) noexcept {
+  return get().find_space(begin, end);
+}
+
+const char *ns::find_non_space(const char *begin, const char *end) noexcept {
+  return get().find_non_space(begin, end);
+}
+
+const char *ns::find_not(const char *begin, const char *end,
+                         char c) noexcept {
+  return get().find_not(begin, end, c);
+}
+
+std::int64_t *ns::intersect(const std::int64_t *a, const std::int64_t *a_end,
+                            const std::int64_t *b, const std::int64_t *b_end,
+                            std::int64_t *out) noexcept {
+  return get().intersect(a, a_end, b, b_end, out);
+}
+
+std::int64_t *ns::unite(const std::int64_t *a, const std::int64_t *a_end,
+                        const std::int64_t *b, const std::int64_t *b_end,
+                        std::int64_t *out) noexcept {
+  return get().unite(a, a_end, b, b_end, out);
+}
+
+std::int64_t *ns::subtract(const std::int64_t *a, const std::int64_t *a_end,
+                           const std::int64_t *b, const std::int64_t *b_end,
+                           std::int64_t *out) noexcept {
+  return get().subtract(a, a_end, b, b_end, out);
+}
+
+std::uint64_t ns::popcount(const char *begin, const char *end) noexcept {
+  return get().popcount(begin, end);
+}
+
+void ns::bitwise_and(char *out, const char *in, std::size_t size) noexcept {
+  get().bitwise_and(out, in, size);
+}
+
+void ns::bitwise_or(char *out, const char *in, std::size_t size) noexcept {
+  get().bitwise_or(out, in, size);
+}
+
+void ns::bitwise_xor(char *out, const char *in, std::size_t size) noexcept {
+  get().bitwise_xor(out, in, size);
+}
+
+void ns::max_registers(std::uint8_t *registers, const std::uint8_t *packed,
+                       std::size_t count) noexcept {
+  get().max_registers(registers, packed, count);
+}
+
+double ns::harmonic_sum(const std::uint8_t *begin,
+                        const std::uint8_t *end) noexcept {
+  return get().harmonic_sum(begin, end);
+}
+
+std::uint32_t ns::crc32c(std::uint32_t crc, const char *begin,
+                         const char *end) noexcept {
+  return get().crc32c(crc, begin, end);
+}
@@ -0,0 +1,177 @@
+#ifndef REDIS_SERVER_SIMD_HPP
+#define REDIS_SERVER_SIMD_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace redis::simd {
+
+/**
+ * Instruction sets the scanning, set, bitmap, HyperLogLog and checksum
+ * functions have implementations for.
+ */
+enum class isa { scalar, sse2, avx2 };
+
+/**
+ * @param i
+ * @return whether this CPU can run the implementation for i
+ */
+bool supported(isa i) noexcept;
+
+/**
+ * Switch every scanning, set, bitmap, HyperLogLog and checksum function to the
+ * implementation for i, which must be supported. The best available is chosen
+ * at startup; this is for tests and benchmarks, and isn't thread safe.
+ * @param i
+ */
+void use(isa i) noexcept;
+
+/**
+ * @return the implementation in use
+ */
+isa current() noexcept;
+
+/**
+ * @param begin
+ * @param end
+ * @return the first "\r\n" in [begin, end), or end
+ */
+const char *find_crlf(const char *begin, const char *end) noexcept;
+
+/**
+ * @param begin
+ * @param end
+ * @param c
+ * @return the first c in [begin, end), or end
+ */
+const char *find(const char *begin, const char *end, char c) noexcept;
+
+/**
+ * @param begin
+ * @param end
+ * @return the first whitespace character, as ::isspace() has it in the "C"
+ * locale, in [begin, end), or end
+ */
+const char *find_space(const char *begin, const char *end) noexcept;
+
+/**
+ * @param begin
+ * @param end
+ * @return the first character in [begin, end) that isn't whitespace, or end
+ */
+const char *find_non_space(const char *begin, const char *end) noexcept;
+
+/**
+ * @param begin
+ * @param end
+ * @param c
+ * @return the first character in [begin, end) other than c, or end
+ */
+const char *find_not(const char *begin, const char *end, char c) noexcept;
+
+/**
+ * Write the integers that are in both of the sorted ranges of distinct
+ * integers [a, a_end) and [b, b_end) to out, in order.
+ * @param a
+ * @param a_end
+ * @param b
+ * @param b_end
+ * @param out with room for the smaller range
+ * @return the end of what's written to out
+ */
+std::int64_t *intersect(const std::int64_t *a, const std::int64_t *a_end,
+                        const std::int64_t *b, const std::int64_t *b_end,
+                        std::int64_t *out) noexcept;
+
+/**
+ * Write the integers that are in either of the sorted ranges of distinct
+ * integers [a, a_end) and [b, b_end) to out, in order and once each.
+ * @param a
+ * @param a_end
+ * @param b
+ * @param b_end
+ * @param out with room for both ranges
+ * @return the end of what's written to out
+ */
+std::int64_t *unite(const std::int64_t *a, const std::int64_t *a_end,
+                    const std::int64_t *b, const std::int64_t *b_end,
+                    std::int64_t *out) noexcept;
+
+/**
+ * Write the integers of the sorted range of distinct integers [a, a_end) that
+ * aren't in the sorted range of distinct integers [b, b_end) to out, in order.
+ * @param a
+ * @param a_end
+ * @param b
+ * @param b_end
+ * @param out with room for [a, a_end)
+ * @return the end of what's written to out
+ */
+std::int64_t *subtract(const std::int64_t *a, const std::int64_t *a_end,
+                       const std::int64_t *b, const std::int64_t *b_end,
+                       std::int64_t *out) noexcept;
+
+/**
+ * @param begin
+ * @param end
+ * @return how many bits are set in [begin, end)
+ */
+std::uint64_t popcount(const char *begin, const char *end) noexcept;
+
+/**
+ * out[i] &= in[i] for each i below size.
+ * @param out
+ * @param in
+ * @param size
+ */
+void bitwise_and(char *out, const char *in, std::size_t size) noexcept;
+
+/**
+ * out[i] |= in[i] for each i below size.
+ * @param out
+ * @param in
+ * @param size
+ */
+void bitwise_or(char *out, const char *in, std::size_t size) noexcept;
+
+/**
+ * out[i] ^= in[i] for each i below size.
+ * @param out
+ * @param in
+ * @param size
+ */
+void bitwise_xor(char *out, const char *in, std::size_t size) noexcept;
+
+/**
+ * Raise each of registers to at least the register of the same index packed
+ * into packed, 6 bits each and least significant bits first, as HyperLogLogs'
+ * dense registers are merged.
+ * @param registers
+ * @param packed count * 6 / 8 bytes
+ * @param count a multiple of 4
+ */
+void max_registers(std::uint8_t *registers, const std::uint8_t *packed,
+                   std::size_t count) noexcept;
+
+/**
+ * @param begin
+ * @param end
+ * @return the sum of 2^-x over the x in [begin, end), each below 64: the
+ * denominator of the harmonic mean of HyperLogLog registers
+ */
+double harmonic_sum(const std::uint8_t *begin,
+                    const std::uint8_t *end) noexcept;
+
+/**
+ * @param crc the CRC of whatever came before [begin, end), or 0
+ * @param begin
+ * @param end
+ * @return the CRC-32C, with the Castagnoli polynomial as in iSCSI and ext4,
+ * of what came before and [begin, end)
+ */
+std::uint32_t crc32c(std::uint32_t crc, const char *begin,
+                     const char *end) noexcept;
+
+} // namespace redis::simd
+
+#endif // REDIS_SERVER_SIMD_HPP
@@ -0,0 +1,385 @@
+#include "snapshot.hpp"
+#include "packed.hpp"
+#include "simd.hpp"
+
+#include <bit>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+namespace ns = redis::snapshot;
+using time_point = redis::database::time_point;
+
+constexpr std::size_t header_size = ns::magic.size() + 8;
+constexpr std::size_t block_header_size = 12;
+constexpr std::size_t index_entry_size = 12;
+constexpr std::size_t trailer_size = 12 + ns::index_magic.size();
+
+template <typename T> void put(std::string &out, T value) {
+  const auto bits = std::uint64_t(value);
+  for (std::size_t i = 0; i < sizeof(T); ++i)
+    out.push_back(static_cast<char>(bits >> 8 * i));
+}
+
+void put_varint(std::string &out, std::uint64_t value) {
+  std::array<char, redis::packed::max_varint> buf;
+  out.append(buf.data(), redis::packed::encode_length(buf, value));
+}
+
+void put_string(std::string &out, std::string_view s) {
+  put_varint(out, s.size());
+  out.append(s);
+}
+
+std::uint32_t crc32c(std::string_view s) noexcept {
+  return redis::simd::crc32c(0, s.data(), s.data() + s.size());
+}
+
+// writes records into blocks, and the index of the blocks at the end
+class writer {
+public:
+  explicit writer(std::ostream &os) : os_(os) {
+    std::string header(ns::magic);
+    put(header, ns::version);
+    put(header, std::uint32_t());
+    write(header);
+  }
+
+  // start a record, to be appended to what's returned
+  std::string &begin(ns::type type, std::string_view key, time_point expiry) {
+    const bool expires = expiry != redis::database::never;
+    put(records_,
+        std::uint8_t(std::uint8_t(type) | (expires ? ns::expires : 0)));
+    if (expires)
+      put(records_, expiry.time_since_epoch().count());
+    put_string(records_, key);
+    return records_;
+  }
+
+  void end() {
+    ++count_;
+    if (records_.size() >= ns::block_size)
+      flush();
+  }
+
+  void finish() {
+    flush();
+    std::string index;
+    put(index, blocks_);
+    index += index_;
+    std::string trailer;
+    put(trailer, offset_);
+    put(trailer, crc32c(index));
+    trailer += ns::index_magic;
+    write(index);
+    write(trailer);
+  }
+
+private:
+  void flush() {
+    if (!count_)
+      return;
+    put(index_, offset_);
+    put(index_, count_);
+    ++blocks_;
+
+    std::string header;
+    put(header, std::uint32_t(records_.size()));
+    put(header, count_);
+    put(header, crc32c(records_));
+    write(header);
+    write(records_);
+    records_.clear();
+    count_ = 0;
+  }
+
+  void write(std::string_view s) {
+    os_.write(s.data(), std::streamsize(s.size()));
+    offset_ += s.size();
+  }
+
+  std::ostream &os_;
+  std::uint64_t offset_{};
+  std::string records_;
+  std::uint32_t count_{};
+  std::string index_;
+  std::uint64_t blocks_{};
+};
+
+// decodes what's between begin and end, throwing if it runs out
+class reader {
+public:
+  reader(const char *begin, const char *end) : p_(begin), end_(end) {}
+
+  template <typename T> T get() {
+    need(sizeof(T));
+    std::uint64_t bits{};
+    for (std::size_t i = 0; i < sizeof(T); ++i)
+      bits |= std::uint64_t(static_cast<unsigned char>(*p_++)) << 8 * i;
+    return T(bits);
+  }
+
+  std::uint64_t varint() {
+    std::uint64_t result = 0;
+    for (unsigned shift = 0; shift < 64; shift += 7) {
+      need(1);
+      const auto byte = static_cast<unsigned char>(*p_++);
+      result |= std::uint64_t(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+        return result;
+    }
+    throw ns::corrupt("varint too long");
+  }
+
+  std::string_view string() {
+    const auto size = varint();
+    need(size);
+    const std::string_view result(p_, size);
+    p_ += size;
+    return result;
+  }
+
+  // a count of things at least min_bytes each, bounded by what's left so
+  // that a bad one can't have anything reserve too much
+  std::size_t count(std::size_t min_bytes) {
+    const auto result = varint();
+    if (result > std::uint64_t(end_ - p_) / min_bytes)
+      throw ns::corrupt("count runs past its block");
+    return result;
+  }
+
+  [[nodiscard]] bool done() const noexcept { return p_ == end_; }
+
+private:
+  void need(std::uint64_t n) const {
+    if (n > std::uint64_t(end_ - p_))
+      throw ns::corrupt("record runs past its block");
+  }
+
+  const char *p_;
+  const char *end_;
+};
+
+redis::database::value_t read_value(reader &r, ns::type type,
+                                    const redis::database &db) {
+  using db_t = redis::database;
+  switch (type) {
+  case ns::type::string:
+    return db_t::make_string(r.string());
+  case ns::type::list: {
+    auto list = std::make_unique<db_t::list_t>();
+    for (auto n = r.count(1); n; --n)
+      list->push_back(r.string());
+    return list;
+  }
+  case ns::type::hash: {
+    auto hash = std::make_unique<db_t::hash_t>();
+    for (auto n = r.count(2); n; --n) {
+      const auto field = r.string();
+      if (!hash->set(field, r.string()))
+        throw ns::corrupt("repeated hash field");
+    }
+    return hash;
+  }
+  case ns::type::set: {
+    auto set = std::make_unique<db_t::set_t>(db.max_intset_entries());
+    for (auto n = r.count(1); n; --n) {
+      if (!set->insert(r.string()))
+        throw ns::corrupt("repeated set member");
+    }
+    return set;
+  }
+  case ns::type::zset: {
+    auto zset = std::make_unique<db_t::zset_t>();
+    for (auto n = r.count(9); n; --n) {
+      const auto score = std::bit_cast<double>(r.get<std::uint64_t>());
+      if (std::isnan(score) || !zset->insert(r.string(), score))
+        throw ns::corrupt("bad sorted set member");
+    }
+    return zset;
+  }
+  case ns::type::stream: {
+    auto stream = std::make_unique<db_t::stream_t>();
+    const redis::stream_id last{r.varint(), r.varint()};
+    std::vector<std::string_view> fields_and_values;
+    for (auto n = r.count(3); n; --n) {
+      const redis::stream_id id{r.varint(), r.varint()};
+      fields_and_values.resize(r.count(1));
+      for (auto &s : fields_and_values)
+        s = r.string();
+      if (id <= stream->last_id() || id > last ||
+          fields_and_values.size() < 2 || fields_and_values.size() % 2)
+        throw ns::corrupt("bad stream entry");
+      stream->append(id, fields_and_values);
+    }
+    stream->set_last_id(last);
+    return stream;
+  }
+  default:
+    throw ns::corrupt("unknown type " + std::to_string(int(type)));
+  }
+}
+
+void read_block(reader &r, std::uint32_t records, redis::database &db,
+                time_point now) {
+  for (; records; --records) {
+    const auto tag = r.get<std::uint8_t>();
+    auto expiry = redis::database::never;
+    if (tag & ns::expires)
+      expiry = time_point(std::chrono::milliseconds(r.get<std::int64_t>()));
+    const auto key = r.string();
+    auto value = read_value(r, ns::type(tag & ~ns::expires), db);
+    // as Redis does, keys that expired while the server was down are dropped
+    if (!(now < expiry))
+      continue;
+    if (!db.restore(key, std::move(value), expiry))
+      throw ns::corrupt("repeated key");
+  }
+  if (!r.done())
+    throw ns::corrupt("block has more than its records");
+}
+
+void load_blocks(std::span<const char> bytes, redis::database &db) {
+  if (bytes.size() < header_size + trailer_size)
+    throw ns::corrupt("truncated");
+  reader header(bytes.data() + ns::magic.size(), bytes.data() + header_size);
+  if (const auto version = header.get<std::uint32_t>();
+      version != ns::version)
+    throw ns::corrupt("unsupported version " + std::to_string(version));
+  if (header.get<std::uint32_t>())
+    throw ns::corrupt("reserved header bits set");
+
+  const auto *const trailer_begin = bytes.data() + bytes.size() - trailer_size;
+  reader trailer(trailer_begin, trailer_begin + trailer_size);
+  const auto index_offset = trailer.get<std::uint64_t>();
+  const auto index_crc = trailer.get<std::uint32_t>();
+  if (std::string_view(trailer_begin + 12, ns::index_magic.size()) !=
+          ns::index_magic ||
+      index_offset < header_size ||
+      index_offset > bytes.size() - trailer_size)
+    throw ns::corrupt("truncated");
+  const std::string_view index_bytes(bytes.data() + index_offset,
+                                     trailer_begin);
+  if (crc32c(index_bytes) != index_crc)
+    throw ns::corrupt("index checksum mismatch");
+
+  // the blocks go in the order they're written in, so that the file is read
+  // from front to back
+  reader index(index_bytes.begin(), index_bytes.end());
+  const auto blocks = index.get<std::uint64_t>();
+  if (blocks != (index_bytes.size() - 8) / index_entry_size ||
+      (index_bytes.size() - 8) % index_entry_size)
+    throw ns::corrupt("bad index");
+  struct block {
+    std::uint64_t offset;
+    std::uint32_t records;
+  };
+  std::vector<block> entries(blocks);
+  std::size_t keys = 0;
+  for (auto &entry : entries) {
+    entry = {index.get<std::uint64_t>(), index.get<std::uint32_t>()};
+    keys += entry.records;
+  }
+  db.reserve(db.size() + keys);
+
+  const auto now =
+      std::chrono::time_point_cast<std::chrono::milliseconds>(db.now());
+  for (const auto &entry : entries) {
+    if (entry.offset < header_size ||
+        entry.offset + block_header_size > index_offset)
+      throw ns::corrupt("bad index");
+    const auto *const begin = bytes.data() + entry.offset;
+    reader block_header(begin, begin + block_header_size);
+    const auto size = block_header.get<std::uint32_t>();
+    const auto records = block_header.get<std::uint32_t>();
+    const auto crc = block_header.get<std::uint32_t>();
+    if (records != entry.records ||
+        size > index_offset - entry.offset - block_header_size)
+      throw ns::corrupt("bad block header");
+    const auto *const records_begin = begin + block_header_size;
+    if (redis::simd::crc32c(0, records_begin, records_begin + size) != crc)
+      throw ns::corrupt("block checksum mismatch");
+    reader r(records_begin, records_begin + size);
+    read_block(r, records, db, now);
+  }
+}
+
+} // namespace
+
+void ns::save(database &db, std::ostream &os) {
+  writer w(os);
+  db.visit(redis::util::overloaded{
+      [&](auto &key, const redis::string_value &value, auto expiry) -> bool {
+        put_string(w.begin(ns::type::string, key, expiry), value);
+        w.end();
+        return true;
+      },
+      [&](auto &key, const database::list_t &list, auto expiry) -> bool {
+        auto &out = w.begin(ns::type::list, key, expiry);
+        put_varint(out, list.size());
+        for (const auto &s : list)
+          put_string(out, s);
+        w.end();
+        return true;
+      },
+      [&](auto &key, const database::hash_t &hash, auto expiry) -> bool {
+        auto &out = w.begin(ns::type::hash, key, expiry);
+        put_varint(out, hash.size());
+        hash.visit([&](std::string_view field, std::string_view value) {
+          put_string(out, field);
+          put_string(out, value);
+        });
+        w.end();
+        return true;
+      },
+      [&](auto &key, const database::set_t &set, auto expiry) -> bool {
+        auto &out = w.begin(ns::type::set, key, expiry);
+        put_varint(out, set.size());
+        set.visit([&](std::string_view member) { put_string(out, member); });
+        w.end();
+        return true;
+      },
+      [&](auto &key, const database::zset_t &zset, auto expiry) -> bool {
+        auto &out = w.begin(ns::type::zset, key, expiry);
+        put_varint(out, zset.size());
+        zset.visit(0, zset.size(), [&](std::string_view member, double score) {
+          put(out, std::bit_cast<std::uint64_t>(score));
+          put_string(out, member);
+        });
+        w.end();
+        return true;
+      },
+      [&](auto &key, const database::stream_t &stream, auto expiry) -> bool {
+        auto &out = w.begin(ns::type::stream, key, expiry);
+        put_varint(out, stream.last_id().ms);
+        put_varint(out, stream.last_id().seq);
+        put_varint(out, stream.size());
+        stream.visit(stream_id(), stream_id::max(), false,
+                     [&](stream_id id,
+                         const std::vector<std::string_view> &fields) {
+                       put_varint(out, id.ms);
+                       put_varint(out, id.seq);
+                       put_varint(out, fields.size());
+                       for (const auto s : fields)
+                         put_string(out, s);
+                       return true;
+                     });
+        w.end();
+        return true;
+      },
+      [](auto &, const std::monostate &, auto) -> bool { return true; },
+  });
+  w.finish();
+}
+
+bool ns::is_snapshot(std::span<const char> bytes) noexcept {
+  return bytes.size() >= magic.size() &&
+         std::string_view(bytes.data(), magic.size()) == magic;
+}
+
+void ns::load(std::span<const char> bytes, database &db) {
+  if (!is_snapshot(bytes))
+    throw corrupt("not a snapshot");
+  load_blocks(bytes, db);
+}
@@ -0,0 +1,86 @@
+#ifndef REDIS_SERVER_SNAPSHOT_HPP
+#define REDIS_SERVER_SNAPSHOT_HPP
+
+#include "database.hpp"
+
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+/**
+ * The binary format the keyspace is saved in, which is loaded by building
+ * the database's entries directly rather than by replaying commands.
+ * Integers are little endian, and varints 7 bits to a byte, low bits first.
+ *
+ *   header   magic, u32 version, u32 reserved (0)
+ *   block*   u32 size, u32 records, u32 CRC-32C of the records, records
+ *   index    u64 blocks, then each block's u64 offset and u32 records
+ *   trailer  u64 index offset, u32 CRC-32C of the index, index_magic
+ *
+ * A record is a type, with expires set if it's followed by an i64 expiry in
+ * milliseconds since the epoch, then the key and the value. A block is cut
+ * once its records reach block_size, but a record is never split between
+ * two, so that each can be checked and then decoded by itself. The index
+ * says how many keys there are before any block is read.
+ */
+namespace redis::snapshot {
+
+inline constexpr std::string_view magic = "REDISSNP";
+inline constexpr std::string_view index_magic = "SNPINDEX";
+inline constexpr std::uint32_t version = 1;
+inline constexpr std::size_t block_size = 1 << 16;
+
+enum class type : std::uint8_t {
+  // a varint length and the bytes
+  string,
+  // a varint count of strings
+  list,
+  // a varint count of fields, each a string and its value's
+  hash,
+  // a varint count of member strings
+  set,
+  // a varint count of members, each an f64 score and a string, in order
+  zset,
+  // the varint ms and seq of the last ID, a varint count of entries, and
+  // each entry's ID, a varint count of fields and values, and their strings
+  stream,
+};
+
+// set in a record's type if it's followed by an expiry
+inline constexpr std::uint8_t expires = 0x80;
+
+class corrupt : public std::runtime_error {
+public:
+  explicit corrupt(const std::string &what)
+      : std::runtime_error("corrupt snapshot: " + what) {}
+};
+
+/**
+ * Write every key in db, and its value and expiry, to os.
+ * @param db
+ * @param os
+ */
+void save(database &db, std::ostream &os);
+
+/**
+ * @param bytes
+ * @return whether bytes start like a snapshot, rather than like the commands
+ * the keyspace used to be saved as
+ */
+bool is_snapshot(std::span<const char> bytes) noexcept;
+
+/**
+ * Add the keys of a snapshot to db, but for those that have expired.
+ * @param bytes the whole snapshot
+ * @param db
+ * @throws corrupt if it isn't a snapshot of this version, or any of it
+ * fails its checksum or doesn't decode
+ */
+void load(std::span<const char> bytes, database &db);
+
+} // namespace redis::snapshot
+
+#endif // REDIS_SERVER_SNAPSHOT_HPP
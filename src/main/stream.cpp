@@ -0,0 +1,114 @@
+#include "stream.hpp"
+#include "packed.hpp"
+
+namespace {
+
+void append_varint(std::vector<char> &bytes, std::uint64_t i) {
+  std::array<char, redis::packed::max_varint> buf;
+  const auto size = redis::packed::encode_length(buf, i);
+  bytes.insert(bytes.end(), buf.begin(), buf.begin() + std::ptrdiff_t(size));
+}
+
+std::uint64_t read_varint(const char *&p) noexcept {
+  std::uint64_t result = 0;
+  for (unsigned shift = 0;; shift += 7) {
+    const auto byte = static_cast<unsigned char>(*p++);
+    result |= std::uint64_t(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return result;
+  }
+}
+
+} // namespace
+
+// an entry is the milliseconds since its master's, the sequence number, less
+// the master's if the milliseconds are the same, the number of fields times
+// 2, plus 1 if they're the master's, and then its fields and values, or only
+// its values
+
+void redis::stream::append(
+    stream_id id, std::span<const std::string_view> fields_and_values) {
+  if (nodes_.empty() || nodes_.back().count >= max_node_entries ||
+      nodes_.back().bytes.size() >= max_node_bytes) {
+    // a node is only appended to until it's full
+    if (!nodes_.empty())
+      nodes_.back().bytes.shrink_to_fit();
+    auto &n = nodes_.emplace_back();
+    n.master = id;
+    n.fields = std::uint32_t(fields_and_values.size() / 2);
+    for (std::size_t i = 0; i < fields_and_values.size(); i += 2)
+      packed::append(n.bytes, fields_and_values[i]);
+    n.entries = std::uint32_t(n.bytes.size());
+  }
+
+  auto &n = nodes_.back();
+  bool master_fields = fields_and_values.size() / 2 == n.fields;
+  const char *field = n.bytes.data();
+  for (std::size_t i = 0; master_fields && i < fields_and_values.size();
+       i += 2) {
+    const auto master_field = packed::decode(field);
+    master_fields = master_field == fields_and_values[i];
+    field = packed::next(master_field);
+  }
+
+  const auto ms = id.ms - n.master.ms;
+  append_varint(n.bytes, ms);
+  append_varint(n.bytes, ms ? id.seq : id.seq - n.master.seq);
+  append_varint(n.bytes, fields_and_values.size() | master_fields);
+  for (std::size_t i = master_fields; i < fields_and_values.size();
+       i += 1 + master_fields)
+    packed::append(n.bytes, fields_and_values[i]);
+  ++n.count;
+  ++size_;
+  last_id_ = id;
+}
+
+std::size_t redis::stream::trim(std::size_t max_length, bool approximate) {
+  const auto old_size = size_;
+  while (!nodes_.empty() && size_ - nodes_.front().count >= max_length) {
+    size_ -= nodes_.front().count;
+    nodes_.pop_front();
+  }
+  if (approximate || size_ <= max_length)
+    return old_size - size_;
+
+  // the entries left over are cut from the front of the first node, whose
+  // master stays as it was for those after them
+  auto &n = nodes_.front();
+  const auto drop = size_ - max_length;
+  stream_id id;
+  std::vector<std::string_view> fields_and_values;
+  const char *p = n.bytes.data() + n.entries;
+  for (std::size_t i = 0; i < drop; ++i)
+    p = decode(n, p, id, fields_and_values);
+  n.bytes.erase(n.bytes.begin() + n.entries,
+                n.bytes.begin() + (p - n.bytes.data()));
+  n.count -= std::uint32_t(drop);
+  size_ -= drop;
+  return old_size - size_;
+}
+
+const char *
+redis::stream::decode(const node &n, const char *p, stream_id &id,
+                      std::vector<std::string_view> &fields_and_values) {
+  const auto ms = read_varint(p);
+  const auto seq = read_varint(p);
+  id = {n.master.ms + ms, ms ? seq : n.master.seq + seq};
+  const auto size = read_varint(p);
+  const bool master_fields = size & 1;
+
+  fields_and_values.clear();
+  const char *field = n.bytes.data();
+  for (std::uint64_t i = 0; i < size / 2; ++i) {
+    const auto f = packed::decode(master_fields ? field : p);
+    if (master_fields)
+      field = packed::next(f);
+    else
+      p = packed::next(f);
+    const auto value = packed::decode(p);
+    p = packed::next(value);
+    fields_and_values.push_back(f);
+    fields_and_values.push_back(value);
+  }
+  return p;
+}
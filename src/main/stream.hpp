@@ -0,0 +1,167 @@
+#ifndef REDIS_SERVER_STREAM_HPP
+#define REDIS_SERVER_STREAM_HPP
+
+#include <algorithm>
+#include <compare>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace redis {
+
+/**
+ * A stream entry's ID: a time in milliseconds, and a sequence number among
+ * the entries added in that millisecond.
+ */
+struct stream_id {
+  std::uint64_t ms{};
+  std::uint64_t seq{};
+
+  auto operator<=>(const stream_id &) const = default;
+
+  static constexpr stream_id max() noexcept {
+    return {std::numeric_limits<std::uint64_t>::max(),
+            std::numeric_limits<std::uint64_t>::max()};
+  }
+};
+
+/**
+ * An append only log of entries, each some fields and values under an ID
+ * greater than the last's. The entries are packed, as in Redis' listpacks,
+ * into nodes of up to max_node_entries or max_node_bytes: each ID as varints
+ * relative to the first in its node, its master, and the fields only if
+ * they differ from the master entry's. As IDs only grow and entries are only
+ * trimmed from the front, the nodes stay in order of ID in a deque, where
+ * Redis keeps a radix tree, and a range is found by binary search on their
+ * masters.
+ */
+class stream {
+public:
+  // as Redis' default stream-node-max-entries and stream-node-max-bytes
+  static constexpr std::size_t max_node_entries = 100;
+  static constexpr std::size_t max_node_bytes = 4096;
+
+  [[nodiscard]] std::size_t size() const noexcept { return size_; }
+
+  [[nodiscard]] bool empty() const noexcept { return !size_; }
+
+  /**
+   * @return the greatest ID added, even if it's since been trimmed, or 0-0
+   */
+  [[nodiscard]] stream_id last_id() const noexcept { return last_id_; }
+
+  /**
+   * Raise last_id() to id, as if an entry with that ID had been added and
+   * since trimmed, as when a stream is loaded.
+   * @param id mustn't be less than last_id()
+   */
+  void set_last_id(stream_id id) noexcept { last_id_ = id; }
+
+  /**
+   * @param id must be greater than last_id()
+   * @param fields_and_values alternating, at least one of each
+   */
+  void append(stream_id id,
+              std::span<const std::string_view> fields_and_values);
+
+  /**
+   * Remove the oldest entries so that max_length are left, or, if
+   * approximate, only as many whole nodes of them as that allows, as
+   * MAXLEN ~ does.
+   * @param max_length
+   * @param approximate
+   * @return how many entries were removed
+   */
+  std::size_t trim(std::size_t max_length, bool approximate);
+
+  /**
+   * Call visitor(id, fields_and_values) with each entry with an ID from start
+   * up to and including end, in order, or in reverse order if reverse, for as
+   * long as it returns true.
+   * @tparam Visitor
+   * @param start
+   * @param end
+   * @param reverse
+   * @param visitor
+   */
+  template <typename Visitor>
+  void visit(stream_id start, stream_id end, bool reverse,
+             Visitor visitor) const;
+
+private:
+  struct node {
+    stream_id master;
+    std::uint32_t count{};
+    // how many fields the master entry has, packed at the start of bytes
+    std::uint32_t fields{};
+    // where the entries start, after the fields
+    std::uint32_t entries{};
+    std::vector<char> bytes;
+  };
+
+  // decode the entry of n at p into id and fields_and_values, returning
+  // where the next starts
+  static const char *decode(const node &n, const char *p, stream_id &id,
+                            std::vector<std::string_view> &fields_and_values);
+
+  std::deque<node> nodes_;
+  std::size_t size_{};
+  stream_id last_id_;
+};
+
+} // namespace redis
+
+template <typename Visitor>
+void redis::stream::visit(stream_id start, stream_id end, bool reverse,
+                          Visitor visitor) const {
+  if (start > end)
+    return;
+
+  const auto before = [](stream_id id, const node &n) { return id < n.master; };
+  stream_id id;
+  std::vector<std::string_view> fields_and_values;
+  if (!reverse) {
+    // from the last node whose master is no later than start
+    auto pos = std::upper_bound(nodes_.begin(), nodes_.end(), start, before);
+    if (pos != nodes_.begin())
+      --pos;
+    for (; pos != nodes_.end() && pos->master <= end; ++pos) {
+      const char *p = pos->bytes.data() + pos->entries;
+      for (std::uint32_t i = 0; i < pos->count; ++i) {
+        p = decode(*pos, p, id, fields_and_values);
+        if (id < start)
+          continue;
+        if (id > end || !visitor(id, std::as_const(fields_and_values)))
+          return;
+      }
+    }
+    return;
+  }
+
+  // a node's entries can only be decoded forwards, so where each starts is
+  // found first
+  auto pos = std::upper_bound(nodes_.begin(), nodes_.end(), end, before);
+  std::vector<const char *> entries;
+  while (pos != nodes_.begin()) {
+    --pos;
+    entries.clear();
+    const char *p = pos->bytes.data() + pos->entries;
+    for (std::uint32_t i = 0; i < pos->count; ++i) {
+      entries.push_back(p);
+      p = decode(*pos, p, id, fields_and_values);
+    }
+    for (auto entry = entries.rbegin(); entry != entries.rend(); ++entry) {
+      decode(*pos, *entry, id, fields_and_values);
+      if (id > end)
+        continue;
+      if (id < start || !visitor(id, std::as_const(fields_and_values)))
+        return;
+    }
+  }
+}
+
+#endif // REDIS_SERVER_STREAM_HPP
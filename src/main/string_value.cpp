@@ -0,0 +1,54 @@
+#include "string_value.hpp"
+
+#include <array>
+#include <charconv>
+
+namespace {
+
+// how many integers, from 0, are in the shared pool
+constexpr std::int64_t shared_integers = 10000;
+constexpr std::size_t shared_width = 4;
+
+constexpr std::size_t digits(std::int64_t i) {
+  return i < 10 ? 1 : i < 100 ? 2 : i < 1000 ? 3 : 4;
+}
+
+constexpr auto shared_pool = []() {
+  std::array<char, shared_integers * shared_width> result{};
+  for (std::int64_t i = 0; i < shared_integers; ++i) {
+    auto n = i;
+    for (auto pos = std::size_t(i) * shared_width + digits(i);
+         pos-- > std::size_t(i) * shared_width; n /= 10)
+      result[pos] = char('0' + n % 10);
+  }
+  return result;
+}();
+
+} // namespace
+
+redis::string_value::string_value(std::int64_t i) noexcept {
+  if (0 <= i && i < shared_integers) {
+    data_ = shared_pool.data() + std::size_t(i) * shared_width;
+    size_ = digits(i);
+    return;
+  }
+  // 20 characters are enough for any 64 bit integer, so this can't fail
+  data_ = nullptr;
+  size_ = std::size_t(std::to_chars(buf_, buf_ + sizeof(buf_), i).ptr - buf_);
+}
+
+std::optional<std::int64_t>
+redis::string_value::parse_integer(std::string_view s) noexcept {
+  if (s.empty() || s.size() > 20)
+    return {};
+  // from_chars would take these, and they'd come back different
+  const auto digits = s.substr(s[0] == '-');
+  if (digits.empty() || (digits[0] == '0' && s.size() > 1))
+    return {};
+
+  std::int64_t result;
+  const auto [ptr, ec] = std::from_chars(s.begin(), s.end(), result);
+  if (ec != std::errc() || ptr != s.end())
+    return {};
+  return result;
+}
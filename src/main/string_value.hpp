@@ -0,0 +1,50 @@
+#ifndef REDIS_SERVER_STRING_VALUE_HPP
+#define REDIS_SERVER_STRING_VALUE_HPP
+
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace redis {
+
+/**
+ * The text of a string value, which the database holds as an integer if it
+ * is one. Integers in a shared pool of small ones are already formatted, as
+ * in Redis, and any others are formatted into the object itself.
+ */
+class string_value {
+public:
+  explicit string_value(std::string_view s) noexcept
+      : data_(s.data()), size_(s.size()) {}
+
+  explicit string_value(std::int64_t i) noexcept;
+
+  [[nodiscard]] std::string_view view() const noexcept {
+    return {data_ ? data_ : buf_, size_};
+  }
+
+  operator std::string_view() const noexcept { return view(); }
+
+  friend bool operator==(const string_value &lhs,
+                         std::string_view rhs) noexcept {
+    return lhs.view() == rhs;
+  }
+
+  /**
+   * @param s
+   * @return s as an integer, if it's exactly how that integer is formatted,
+   * so that it can be held as one: a leading - is accepted, but not +,
+   * leading zeros, -0 or spaces
+   */
+  static std::optional<std::int64_t> parse_integer(std::string_view s) noexcept;
+
+private:
+  // or nullptr if the text is in buf_, so that copies needn't repoint it
+  const char *data_;
+  std::size_t size_;
+  char buf_[20];
+};
+
+} // namespace redis
+
+#endif // REDIS_SERVER_STRING_VALUE_HPP
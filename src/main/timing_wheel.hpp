@@ -0,0 +1,175 @@
+#ifndef REDIS_SERVER_TIMING_WHEEL_HPP
+#define REDIS_SERVER_TIMING_WHEEL_HPP
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace redis {
+
+/**
+ * A hierarchical timing wheel with millisecond ticks. Each level has 64 slots,
+ * each 64 times as wide as a slot of the level below, and entries cascade
+ * down a level whenever the wheel reaches their slot. Deadlines beyond the
+ * top level are kept aside until the wheel comes round to them.
+ * @tparam T
+ */
+template <typename T> class timing_wheel {
+public:
+  using time_point = std::chrono::sys_time<std::chrono::milliseconds>;
+
+  /**
+   * @param start no later than any time expire() will be called with
+   */
+  explicit timing_wheel(time_point start);
+
+  void insert(time_point deadline, T value);
+
+  /**
+   * Remove the entries due at or before now, soonest first, calling visitor
+   * with each one's deadline and value until it returns false. Entries may be
+   * inserted from visitor.
+   * @tparam Visitor
+   * @param now
+   * @param visitor
+   * @return false if visitor stopped it
+   */
+  template <typename Visitor> bool expire(time_point now, Visitor visitor);
+
+  void clear();
+
+  [[nodiscard]] std::size_t size() const { return size_; }
+
+  [[nodiscard]] bool empty() const { return !size_; }
+
+private:
+  static constexpr unsigned slot_bits = 6;
+  static constexpr std::uint64_t slot_mask = (1 << slot_bits) - 1;
+  // 64^5 ms is about 12 days
+  static constexpr unsigned levels = 5;
+
+  struct entry {
+    std::uint64_t tick;
+    T value;
+  };
+
+  static std::uint64_t to_tick(time_point t) {
+    return std::uint64_t(std::max(t.time_since_epoch().count(),
+                                  std::chrono::milliseconds::rep()));
+  }
+
+  void place(entry e);
+
+  void cascade(std::vector<entry> &entries);
+
+  std::array<std::array<std::vector<entry>, slot_mask + 1>, levels> slots_;
+  // which slots of each level aren't empty
+  std::array<std::uint64_t, levels> occupied_{};
+  std::vector<entry> overflow_;
+  // the next tick to expire
+  std::uint64_t current_;
+  std::size_t size_{};
+};
+
+} // namespace redis
+
+template <typename T>
+redis::timing_wheel<T>::timing_wheel(time_point start)
+    : current_(to_tick(start)) {}
+
+template <typename T>
+void redis::timing_wheel<T>::insert(time_point deadline, T value) {
+  place({to_tick(deadline), std::move(value)});
+  ++size_;
+}
+
+template <typename T>
+template <typename Visitor>
+bool redis::timing_wheel<T>::expire(time_point now, Visitor visitor) {
+  const auto now_tick = to_tick(now);
+  if (!size_) {
+    current_ = std::max(current_, now_tick);
+    return true;
+  }
+
+  while (current_ <= now_tick) {
+    if (!(current_ & slot_mask)) {
+      // a lap of one or more levels is complete, so bring the next one down
+      if (!(current_ & ((std::uint64_t(1) << (slot_bits * levels)) - 1)))
+        cascade(overflow_);
+      for (unsigned level = levels - 1; level > 0; --level) {
+        if (current_ & ((std::uint64_t(1) << (slot_bits * level)) - 1))
+          continue;
+        const auto slot = (current_ >> (slot_bits * level)) & slot_mask;
+        occupied_[level] &= ~(std::uint64_t(1) << slot);
+        cascade(slots_[level][slot]);
+      }
+    }
+
+    const auto slot = current_ & slot_mask;
+    for (auto &entries = slots_[0][slot]; !entries.empty();) {
+      auto e = std::move(entries.back());
+      entries.pop_back();
+      if (entries.empty()) {
+        // give back the memory of a burst
+        entries = {};
+        occupied_[0] &= ~(std::uint64_t(1) << slot);
+      }
+      --size_;
+      if (!visitor(time_point(std::chrono::milliseconds(e.tick)),
+                   std::move(e.value)))
+        return false;
+    }
+
+    // skip to the next occupied slot of this lap, or the start of the next
+    const auto later =
+        slot == slot_mask ? 0 : occupied_[0] & (~std::uint64_t() << (slot + 1));
+    const auto next = later ? (current_ & ~slot_mask) + std::countr_zero(later)
+                            : (current_ | slot_mask) + 1;
+    current_ = std::min(next, now_tick + 1);
+  }
+  return true;
+}
+
+template <typename T> void redis::timing_wheel<T>::clear() {
+  for (auto &level : slots_) {
+    for (auto &entries : level)
+      entries = {};
+  }
+  occupied_ = {};
+  overflow_ = {};
+  size_ = 0;
+}
+
+template <typename T> void redis::timing_wheel<T>::place(entry e) {
+  if (e.tick < current_) {
+    // overdue, so it goes in the slot that's expired next
+    const auto slot = current_ & slot_mask;
+    occupied_[0] |= std::uint64_t(1) << slot;
+    slots_[0][slot].push_back(std::move(e));
+    return;
+  }
+
+  // the lowest level at which it's in the current lap
+  for (unsigned level = 0; level < levels; ++level) {
+    if ((e.tick ^ current_) >> (slot_bits * (level + 1)))
+      continue;
+    const auto slot = (e.tick >> (slot_bits * level)) & slot_mask;
+    occupied_[level] |= std::uint64_t(1) << slot;
+    slots_[level][slot].push_back(std::move(e));
+    return;
+  }
+  overflow_.push_back(std::move(e));
+}
+
+template <typename T>
+void redis::timing_wheel<T>::cascade(std::vector<entry> &entries) {
+  for (auto &e : std::exchange(entries, {}))
+    place(std::move(e));
+}
+
+#endif // REDIS_SERVER_TIMING_WHEEL_HPP
@@ -0,0 +1,154 @@
+#include "uring.hpp"
+
+#include <cstring>
+
+#include <sys/syscall.h>
+
+namespace ns = redis::io;
+
+namespace {
+
+int io_uring_setup(unsigned entries, ::io_uring_params *params) {
+  return int(::syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete,
+                   unsigned flags) {
+  return int(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                       nullptr, 0));
+}
+
+int io_uring_register(int fd, unsigned opcode, void *arg, unsigned nr_args) {
+  return int(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+}
+
+ns::file_descriptor make_uring(unsigned entries, ::io_uring_params &params) {
+  // a larger completion queue lets multishot requests run ahead of us
+  params = {};
+  params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SINGLE_ISSUER |
+                 IORING_SETUP_DEFER_TASKRUN;
+  params.cq_entries = entries * 4;
+  try {
+    return ns::file_descriptor(io_uring_setup, entries, &params);
+  } catch (const std::system_error &e) {
+    if (e.code().value() != EINVAL)
+      throw;
+  }
+  // kernels before 6.1 don't know about the task run flags
+  params = {};
+  params.flags = IORING_SETUP_CQSIZE;
+  params.cq_entries = entries * 4;
+  return ns::file_descriptor(io_uring_setup, entries, &params);
+}
+
+std::size_t sq_region_len(const ::io_uring_params &params) {
+  auto result = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+    result = std::max(result, params.cq_off.cqes +
+                                  params.cq_entries * sizeof(::io_uring_cqe));
+  return result;
+}
+
+template <typename T> T *at(const ns::memory_map &region, unsigned offset) {
+  return reinterpret_cast<T *>(static_cast<char *>(std::get<0>(region.value())) +
+                               offset);
+}
+
+} // namespace
+
+ns::uring::uring(unsigned entries)
+    : params_(), fd_(make_uring(entries, params_)),
+      sq_region_(nullptr, sq_region_len(params_), PROT_READ | PROT_WRITE,
+                 MAP_SHARED | MAP_POPULATE, fd_.value(), IORING_OFF_SQ_RING),
+      sqes_region_(nullptr, params_.sq_entries * sizeof(::io_uring_sqe),
+                   PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                   fd_.value(), IORING_OFF_SQES),
+      sq_head_(at<unsigned>(sq_region_, params_.sq_off.head)),
+      sq_tail_(at<unsigned>(sq_region_, params_.sq_off.tail)),
+      sq_mask_(*at<unsigned>(sq_region_, params_.sq_off.ring_mask)),
+      sq_array_(at<unsigned>(sq_region_, params_.sq_off.array)),
+      sqes_(at<::io_uring_sqe>(sqes_region_, 0)), sqe_tail_(*sq_tail_),
+      sqe_head_(*sq_tail_) {
+  // older kernels need the completion queue mapping separately
+  if (!(params_.features & IORING_FEAT_SINGLE_MMAP))
+    cq_region_.emplace(nullptr,
+                       params_.cq_off.cqes +
+                           params_.cq_entries * sizeof(::io_uring_cqe),
+                       PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                       fd_.value(), IORING_OFF_CQ_RING);
+
+  const auto &cq_region = cq_region_ ? *cq_region_ : sq_region_;
+  cq_head_ = at<unsigned>(cq_region, params_.cq_off.head);
+  cq_tail_ = at<unsigned>(cq_region, params_.cq_off.tail);
+  cq_mask_ = *at<unsigned>(cq_region, params_.cq_off.ring_mask);
+  cqes_ = at<::io_uring_cqe>(cq_region, params_.cq_off.cqes);
+}
+
+::io_uring_sqe &ns::uring::get_sqe() {
+  const auto head = [this]() {
+    return std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+  };
+
+  if (sqe_tail_ - head() > sq_mask_)
+    submit();
+
+  auto &result = sqes_[sqe_tail_++ & sq_mask_];
+  std::memset(&result, 0, sizeof(result));
+  return result;
+}
+
+unsigned ns::uring::submit(unsigned wait_nr) {
+  // publish the entries handed out by get_sqe() in order
+  unsigned tail = *sq_tail_;
+  for (; sqe_head_ != sqe_tail_; ++sqe_head_, ++tail)
+    sq_array_[tail & sq_mask_] = sqe_head_ & sq_mask_;
+  std::atomic_ref<unsigned>(*sq_tail_).store(tail, std::memory_order_release);
+
+  const auto to_submit =
+      tail - std::atomic_ref<unsigned>(*sq_head_).load(std::memory_order_acquire);
+
+  if (!to_submit && !wait_nr)
+    return 0;
+
+  return unsigned(posix_call(io_uring_enter, fd_.value(), to_submit, wait_nr,
+                             wait_nr ? IORING_ENTER_GETEVENTS : 0u));
+}
+
+ns::provided_buffers::provided_buffers(uring &ring, std::uint16_t group,
+                                       std::uint16_t count, std::size_t size)
+    : ring_(ring), group_(group), mask_(count - 1), size_(size),
+      entries_region_(nullptr, count * sizeof(::io_uring_buf),
+                      PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1,
+                      0),
+      entries_(static_cast<::io_uring_buf_ring *>(
+          std::get<0>(entries_region_.value()))),
+      buffers_(count * size), tail_() {
+  if (!count || (count & mask_))
+    throw std::invalid_argument("buffer count must be a power of two");
+
+  ::io_uring_buf_reg reg{};
+  reg.ring_addr = reinterpret_cast<std::uintptr_t>(entries_);
+  reg.ring_entries = count;
+  reg.bgid = group;
+  posix_call(io_uring_register, ring_.fd(), unsigned(IORING_REGISTER_PBUF_RING),
+             static_cast<void *>(&reg), 1u);
+
+  for (std::uint16_t id = 0; id <= mask_; ++id)
+    recycle(id);
+}
+
+ns::provided_buffers::~provided_buffers() noexcept {
+  ::io_uring_buf_reg reg{};
+  reg.bgid = group_;
+  io_uring_register(ring_.fd(), IORING_UNREGISTER_PBUF_RING, &reg, 1);
+}
+
+void ns::provided_buffers::recycle(std::uint16_t id) {
+  // not entries_->bufs, which __DECLARE_FLEX_ARRAY misplaces in C++
+  auto &buf = reinterpret_cast<::io_uring_buf *>(entries_)[tail_ & mask_];
+  buf.addr = reinterpret_cast<std::uintptr_t>(addr(id));
+  buf.len = unsigned(size_);
+  buf.bid = id;
+  std::atomic_ref<std::uint16_t>(entries_->tail)
+      .store(++tail_, std::memory_order_release);
+}
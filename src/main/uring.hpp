@@ -0,0 +1,124 @@
+#ifndef REDIS_SERVER_URING_HPP
+#define REDIS_SERVER_URING_HPP
+
+#include "io.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+#include <linux/io_uring.h>
+
+namespace redis::io {
+
+/**
+ * RAII wrapper around an io_uring instance and its mapped submission and
+ * completion queues, driven through the raw system calls.
+ */
+class uring {
+public:
+  explicit uring(unsigned entries);
+  uring(const uring &) = delete;
+  uring &operator=(const uring &) = delete;
+
+  /**
+   * The next submission queue entry, zeroed. Entries already queued are
+   * submitted first if the submission queue is full.
+   * @return
+   */
+  ::io_uring_sqe &get_sqe();
+
+  /**
+   * Submit everything queued since the last call and wait for at least
+   * wait_nr completions.
+   * @param wait_nr
+   * @return the number of entries submitted
+   */
+  unsigned submit(unsigned wait_nr = 0);
+
+  /**
+   * Call visitor with each available completion, then mark them all seen.
+   * @tparam Visitor
+   * @param visitor
+   * @return the number of completions visited
+   */
+  template <typename Visitor> unsigned for_each_cqe(Visitor visitor);
+
+  [[nodiscard]] int fd() const noexcept { return fd_.value(); }
+
+private:
+  ::io_uring_params params_;
+  file_descriptor fd_;
+  memory_map sq_region_;
+  std::optional<memory_map> cq_region_;
+  memory_map sqes_region_;
+
+  unsigned *sq_head_;
+  unsigned *sq_tail_;
+  unsigned sq_mask_;
+  unsigned *sq_array_;
+  ::io_uring_sqe *sqes_;
+  unsigned sqe_tail_;
+  unsigned sqe_head_;
+
+  unsigned *cq_head_;
+  unsigned *cq_tail_;
+  unsigned cq_mask_;
+  ::io_uring_cqe *cqes_;
+};
+
+/**
+ * A ring of equally sized buffers registered with an io_uring as a buffer
+ * group, from which the kernel picks one for each receive completion. The
+ * buffers themselves are carved out of a ring_buffer's memfd region.
+ */
+class provided_buffers {
+public:
+  provided_buffers(uring &ring, std::uint16_t group, std::uint16_t count,
+                   std::size_t size);
+  provided_buffers(const provided_buffers &) = delete;
+  provided_buffers &operator=(const provided_buffers &) = delete;
+
+  ~provided_buffers() noexcept;
+
+  [[nodiscard]] char *addr(std::uint16_t id) const {
+    return buffers_.addr(std::uint64_t(id) * size_);
+  }
+
+  [[nodiscard]] std::size_t size() const { return size_; }
+
+  [[nodiscard]] std::uint16_t group() const { return group_; }
+
+  /**
+   * Hand a buffer back to the kernel once its contents have been consumed.
+   * @param id
+   */
+  void recycle(std::uint16_t id);
+
+private:
+  uring &ring_;
+  const std::uint16_t group_;
+  const std::uint16_t mask_;
+  const std::size_t size_;
+  memory_map entries_region_;
+  ::io_uring_buf_ring *const entries_;
+  ring_buffer buffers_;
+  std::uint16_t tail_;
+};
+
+} // namespace redis::io
+
+template <typename Visitor>
+unsigned redis::io::uring::for_each_cqe(Visitor visitor) {
+  const unsigned head = *cq_head_;
+  const unsigned tail =
+      std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire);
+
+  for (unsigned i = head; i != tail; ++i)
+    visitor(const_cast<const ::io_uring_cqe &>(cqes_[i & cq_mask_]));
+
+  std::atomic_ref<unsigned>(*cq_head_).store(tail, std::memory_order_release);
+  return tail - head;
+}
+
+#endif // REDIS_SERVER_URING_HPP
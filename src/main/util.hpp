@@ -1,10 +1,15 @@
 #ifndef REDIS_SERVER_UTIL_HPP
 #define REDIS_SERVER_UTIL_HPP
 
+#include "simd.hpp"
+
 #include <ankerl/unordered_dense.h>
 
+#include <algorithm>
 #include <cassert>
+#include <charconv>
 #include <cstdint>
+#include <optional>
 #include <string_view>
 #include <utility>
 
@@ -34,6 +39,8 @@ inline constexpr unsigned char toupper(const unsigned char c) {
   return ucase_lookup[c];
 }
 
+struct hashed_key;
+
 class cs_hash {
 public:
   using is_transparent = void;
@@ -42,8 +49,30 @@ public:
   auto operator()(const std::string_view s) const noexcept {
     return ankerl::unordered_dense::hash<std::string_view>{}(s);
   }
+
+  inline std::uint64_t operator()(const hashed_key &key) const noexcept;
+};
+
+/**
+ * A key together with its cs_hash, so that a batch of keys can be hashed up
+ * front and looked up in a cs_hash keyed map without hashing them again.
+ */
+struct hashed_key {
+  hashed_key() = default;
+  explicit hashed_key(std::string_view key) : key(key), hash(cs_hash{}(key)) {}
+
+  friend bool operator==(const hashed_key &lhs, std::string_view rhs) {
+    return lhs.key == rhs;
+  }
+
+  std::string_view key;
+  std::uint64_t hash{};
 };
 
+std::uint64_t cs_hash::operator()(const hashed_key &key) const noexcept {
+  return key.hash;
+}
+
 class ci_hash {
 public:
   using is_transparent = void;
@@ -81,25 +110,114 @@ public:
 template <typename Visitor>
 auto tokenize(const char *begin, const char *end, Visitor visitor)
     -> decltype(bool(visitor(begin, end)), void()) {
+  for (auto i = simd::find_non_space(begin, end); i != end;
+       i = simd::find_non_space(i, end)) {
+    const auto token_end = simd::find_space(i, end);
+    if (!visitor(i, token_end))
+      return;
+    i = token_end;
+  }
+}
 
-  const auto is_space = [](const unsigned char c) -> bool {
-    return ::isspace(c);
+/**
+ * Parse an amount of memory the way redis.conf does, e.g. "100", "1k" (1000
+ * bytes), "1kb" (1024 bytes), "2gb".
+ * @param s
+ * @return
+ */
+inline std::optional<std::uint64_t> parse_memory(std::string_view s) {
+  std::uint64_t result{};
+  auto [ptr, ec] = std::from_chars(s.begin(), s.end(), result);
+  if (ec != std::errc())
+    return {};
+
+  constexpr std::pair<std::string_view, std::uint64_t> units[] = {
+      {"", 1},           {"k", 1000},     {"kb", 1 << 10},
+      {"m", 1000000},    {"mb", 1 << 20}, {"g", 1000000000},
+      {"gb", 1ull << 30},
   };
 
-  const char *token_begin{};
+  const std::string_view unit(ptr, s.end());
+  for (const auto &[name, multiplier] : units) {
+    if (unit.size() != name.size())
+      continue;
+    bool match = true;
+    for (std::size_t i = 0; i < unit.size(); ++i)
+      match &= toupper(unit[i]) == toupper(name[i]);
+    if (match)
+      return result * multiplier;
+  }
+  return {};
+}
 
-  for (auto i = begin; i != end; ++i) {
-    if (token_begin && is_space(*i)) {
-      if (!visitor(std::exchange(token_begin, nullptr), i)) {
-        return;
+namespace detail {
+// how much of pattern, from p, matches the character c, or 0 if it doesn't
+inline std::size_t glob_match_one(std::string_view pattern, std::size_t p,
+                                  char c) {
+  if (pattern[p] == '?')
+    return 1;
+  if (pattern[p] == '\\' && p + 1 < pattern.size())
+    return pattern[p + 1] == c ? 2 : 0;
+  if (pattern[p] != '[')
+    return pattern[p] == c ? 1 : 0;
+
+  auto i = p + 1;
+  const bool negate = i < pattern.size() && pattern[i] == '^';
+  i += negate;
+  bool match = false;
+  while (i < pattern.size() && pattern[i] != ']') {
+    if (pattern[i] == '\\' && i + 1 < pattern.size()) {
+      match |= pattern[i + 1] == c;
+      i += 2;
+    } else if (i + 2 < pattern.size() && pattern[i + 1] == '-') {
+      const auto [lo, hi] = std::minmax(pattern[i], pattern[i + 2]);
+      match |= lo <= c && c <= hi;
+      i += 3;
+    } else {
+      match |= pattern[i++] == c;
+    }
+  }
+  // an unterminated class ends with the pattern
+  return match != negate ? std::min(i + 1, pattern.size()) - p : 0;
+}
+} // namespace detail
+
+/**
+ * Match s against a glob-style pattern, as KEYS and the SCAN family do: * for
+ * any run of characters, ? for any one, [abc], [^abc] and [a-z] for classes,
+ * and \ to escape the next character.
+ * @param pattern
+ * @param s
+ * @return
+ */
+inline bool glob_match(std::string_view pattern, std::string_view s) {
+  constexpr auto none = std::string_view::npos;
+  // the last * seen, and where in s it's been matched up to so far
+  std::size_t star = none;
+  std::size_t star_end = 0;
+  std::size_t p = 0;
+  for (std::size_t i = 0; i < s.size();) {
+    if (p < pattern.size() && pattern[p] == '*') {
+      star = p++;
+      star_end = i;
+      continue;
+    }
+    if (p < pattern.size()) {
+      if (const auto n = detail::glob_match_one(pattern, p, s[i])) {
+        p += n;
+        ++i;
+        continue;
       }
-    } else if (!token_begin && !is_space(*i)) {
-      token_begin = i;
     }
+    // let the last * take one more character, and try again after it
+    if (star == none)
+      return false;
+    p = star + 1;
+    i = ++star_end;
   }
-
-  if (token_begin)
-    visitor(token_begin, end);
+  while (p < pattern.size() && pattern[p] == '*')
+    ++p;
+  return p == pattern.size();
 }
 
 template <typename... Ts> struct overloaded : Ts... {
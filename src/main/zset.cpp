@@ -0,0 +1,168 @@
+#include "zset.hpp"
+
+#include <array>
+
+namespace {
+
+// whether (score, member) comes before (other_score, other)
+bool less(double score, std::string_view member, double other_score,
+          std::string_view other) noexcept {
+  return score < other_score || (score == other_score && member < other);
+}
+
+} // namespace
+
+redis::zset::zset(
+    std::initializer_list<std::pair<std::string_view, double>> entries) {
+  for (const auto &[member, score] : entries)
+    insert(member, score);
+}
+
+std::optional<double> redis::zset::score(std::string_view member) const {
+  if (index_) {
+    const auto pos = index_->scores.find(member);
+    if (pos == index_->scores.end())
+      return {};
+    return pos->second;
+  }
+
+  if (const char *const pos = find_packed(member))
+    return packed_score(packed::decode(pos));
+  return {};
+}
+
+bool redis::zset::insert(std::string_view member, double score) {
+  if (!index_ &&
+      (member.size() > max_packed_value ||
+       (count_ == max_packed_entries && !find_packed(member))))
+    convert();
+
+  if (index_) {
+    auto [pos, inserted] = index_->scores.try_emplace(member, score);
+    if (!inserted) {
+      if (pos->second == score)
+        return false;
+      index_->tree.erase(pos->second, member);
+      pos->second = score;
+    }
+    index_->tree.insert(score, member);
+    return inserted;
+  }
+
+  // the packed entries stay in order, so a member that moves is taken out
+  // and put back where it now belongs
+  bool inserted = true;
+  if (const char *const pos = find_packed(member)) {
+    const auto found = packed::decode(pos);
+    if (packed_score(found) == score)
+      return false;
+    const auto offset = pos - packed_.data();
+    packed_.erase(packed_.begin() + offset,
+                  packed_.begin() + (packed::next(found) - packed_.data()) +
+                      std::ptrdiff_t(sizeof(double)));
+    --count_;
+    inserted = false;
+  }
+
+  const char *pos = packed_.data();
+  for (const char *const end = pos + packed_.size(); pos != end;) {
+    const auto other = packed::decode(pos);
+    if (less(score, member, packed_score(other), other))
+      break;
+    pos = packed::next(other) + sizeof(double);
+  }
+
+  std::array<char, packed::max_varint> length;
+  const auto length_bytes = packed::encode_length(length, member.size());
+  std::array<char, sizeof(double)> score_bytes;
+  std::memcpy(score_bytes.data(), &score, sizeof(score));
+  const auto offset = pos - packed_.data();
+  packed_.insert(packed_.begin() + offset, score_bytes.begin(),
+                 score_bytes.end());
+  packed_.insert(packed_.begin() + offset, member.begin(), member.end());
+  packed_.insert(packed_.begin() + offset, length.begin(),
+                 length.begin() + std::ptrdiff_t(length_bytes));
+  ++count_;
+  return inserted;
+}
+
+bool redis::zset::erase(std::string_view member) {
+  if (index_) {
+    const auto pos = index_->scores.find(member);
+    if (pos == index_->scores.end())
+      return false;
+    index_->tree.erase(pos->second, member);
+    index_->scores.erase(pos);
+    return true;
+  }
+
+  const char *const pos = find_packed(member);
+  if (!pos)
+    return false;
+  const auto offset = pos - packed_.data();
+  packed_.erase(packed_.begin() + offset,
+                packed_.begin() +
+                    (packed::next(packed::decode(pos)) - packed_.data()) +
+                    std::ptrdiff_t(sizeof(double)));
+  --count_;
+  return true;
+}
+
+std::optional<std::size_t>
+redis::zset::rank(std::string_view member) const {
+  if (index_) {
+    const auto pos = index_->scores.find(member);
+    if (pos == index_->scores.end())
+      return {};
+    return index_->tree.rank(pos->second, member);
+  }
+
+  std::size_t result = 0;
+  for (const char *pos = packed_.data(), *const end = pos + packed_.size();
+       pos != end; ++result) {
+    const auto found = packed::decode(pos);
+    if (found == member)
+      return result;
+    pos = packed::next(found) + sizeof(double);
+  }
+  return {};
+}
+
+std::size_t redis::zset::count_below(double score, bool inclusive) const {
+  if (index_)
+    return index_->tree.count_below(score, inclusive);
+
+  std::size_t result = 0;
+  for (const char *pos = packed_.data(), *const end = pos + packed_.size();
+       pos != end; ++result) {
+    const auto found = packed::decode(pos);
+    const auto found_score = packed_score(found);
+    if (inclusive ? found_score > score : found_score >= score)
+      break;
+    pos = packed::next(found) + sizeof(double);
+  }
+  return result;
+}
+
+const char *redis::zset::find_packed(std::string_view member) const noexcept {
+  for (const char *pos = packed_.data(), *const end = pos + packed_.size();
+       pos != end;) {
+    const auto found = packed::decode(pos);
+    if (found == member)
+      return pos;
+    pos = packed::next(found) + sizeof(double);
+  }
+  return nullptr;
+}
+
+void redis::zset::convert() {
+  auto converted = std::make_unique<index>();
+  converted->scores.reserve(count_ + 1);
+  visit(0, count_, [&](std::string_view member, double score) {
+    converted->scores.try_emplace(member, score);
+    converted->tree.insert(score, member);
+  });
+  index_ = std::move(converted);
+  packed_ = {};
+  count_ = 0;
+}
@@ -0,0 +1,142 @@
+#ifndef REDIS_SERVER_ZSET_HPP
+#define REDIS_SERVER_ZSET_HPP
+
+#include "compact_string.hpp"
+#include "packed.hpp"
+#include "score_tree.hpp"
+#include "util.hpp"
+
+#include <ankerl/unordered_dense.h>
+
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <memory>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace redis {
+
+/**
+ * A sorted set: members, each with a score, ordered by score and then by
+ * member. A small one is kept as its members and scores packed in order into
+ * one buffer, as in Redis' listpack encoding. Once it grows past
+ * max_packed_entries, or is given a member longer than max_packed_value, it's
+ * converted for good to a hash map of members to scores, for lookups by
+ * member, beside a score_tree, for lookups by rank and score.
+ */
+class zset {
+public:
+  using map_t = ankerl::unordered_dense::map<compact_string, double,
+                                             util::cs_hash, std::equal_to<>>;
+
+  // as Redis' default zset-max-listpack-entries and zset-max-listpack-value
+  static constexpr std::size_t max_packed_entries = 128;
+  static constexpr std::size_t max_packed_value = 64;
+
+  zset() = default;
+
+  zset(std::initializer_list<std::pair<std::string_view, double>> entries);
+
+  [[nodiscard]] std::size_t size() const noexcept {
+    return index_ ? index_->scores.size() : count_;
+  }
+
+  [[nodiscard]] bool empty() const noexcept { return !size(); }
+
+  /**
+   * @return whether it's still in the packed encoding
+   */
+  [[nodiscard]] bool packed() const noexcept { return !index_; }
+
+  [[nodiscard]] std::optional<double> score(std::string_view member) const;
+
+  /**
+   * Add member, or move it to score.
+   * @param member
+   * @param score mustn't be NaN
+   * @return whether member is new
+   */
+  bool insert(std::string_view member, double score);
+
+  /**
+   * @param member
+   * @return whether there was such a member
+   */
+  bool erase(std::string_view member);
+
+  /**
+   * @param member
+   * @return how many members come before member, if it's there
+   */
+  [[nodiscard]] std::optional<std::size_t>
+  rank(std::string_view member) const;
+
+  /**
+   * @param score
+   * @param inclusive
+   * @return how many members have a score less than score, or no greater
+   * than it if inclusive
+   */
+  [[nodiscard]] std::size_t count_below(double score, bool inclusive) const;
+
+  /**
+   * Call visitor with each member, and its score, from rank start up to but
+   * not including rank stop, in order.
+   * @tparam Visitor
+   * @param start
+   * @param stop
+   * @param visitor
+   */
+  template <typename Visitor>
+  void visit(std::size_t start, std::size_t stop, Visitor visitor) const;
+
+private:
+  struct index {
+    map_t scores;
+    score_tree tree;
+  };
+
+  // the start of member's entry in packed_, or nullptr if there's no such
+  // member
+  const char *find_packed(std::string_view member) const noexcept;
+
+  static double packed_score(std::string_view member) noexcept {
+    double result;
+    std::memcpy(&result, packed::next(member), sizeof(result));
+    return result;
+  }
+
+  void convert();
+
+  // each member followed by its score's 8 bytes
+  std::vector<char> packed_;
+  std::uint32_t count_{};
+  std::unique_ptr<index> index_;
+};
+
+} // namespace redis
+
+template <typename Visitor>
+void redis::zset::visit(std::size_t start, std::size_t stop,
+                        Visitor visitor) const {
+  if (index_) {
+    auto pos = index_->tree.at(start);
+    for (; start < stop && pos != index_->tree.end(); ++start, ++pos)
+      visitor(pos->member.view(), pos->score);
+    return;
+  }
+
+  std::size_t rank = 0;
+  for (const char *pos = packed_.data(), *const end = pos + packed_.size();
+       pos != end && rank < stop; ++rank) {
+    const auto member = packed::decode(pos);
+    if (rank >= start)
+      visitor(member, packed_score(member));
+    pos = packed::next(member) + sizeof(double);
+  }
+}
+
+#endif // REDIS_SERVER_ZSET_HPP
@@ -0,0 +1,216 @@
+#include <catch2/catch_all.hpp>
+
+#include "identity_handler.hpp"
+
+#include <append_only_file.hpp>
+#include <commands.hpp>
+
+#include <chrono>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <sys/mman.h>
+
+using namespace std::chrono_literals;
+using namespace std::string_literals;
+using policy = redis::append_only_file::fsync_policy;
+
+namespace {
+
+using time_point = redis::database::time_point;
+
+// an in-memory file, by a path that opens it again
+class memory_file {
+public:
+  [[nodiscard]] std::string path() const {
+    return "/proc/self/fd/" + std::to_string(fd_.value());
+  }
+
+  [[nodiscard]] std::string contents() const {
+    std::string result(
+        std::size_t(redis::io::posix_call(::lseek, fd_.value(), 0, SEEK_END)),
+        '\0');
+    redis::io::posix_call(::pread, fd_.value(), result.data(), result.size(),
+                          0);
+    return result;
+  }
+
+  void clear() { redis::io::posix_call(::ftruncate, fd_.value(), 0); }
+
+  void append(std::string_view bytes) {
+    redis::io::posix_call(::pwrite, fd_.value(), bytes.data(), bytes.size(),
+                          ::lseek(fd_.value(), 0, SEEK_END));
+  }
+
+private:
+  redis::io::file_descriptor fd_{::memfd_create, "", 0};
+};
+
+time_point at(const redis::database::now_t &now) {
+  return std::chrono::time_point_cast<std::chrono::milliseconds>(now);
+}
+
+// a database whose clock is wherever now says, and which loads file
+redis::database make_database(const redis::database::now_t &now,
+                              const memory_file &file) {
+  return redis::database([&now]() { return now; },
+                         [&file]() {
+                           return std::make_unique<std::istringstream>(
+                               file.contents());
+                         });
+}
+
+std::string submit(redis::commands::cmd_t cmd,
+                   const redis::commands::args_t &args, redis::database &db) {
+  redis::test::identity_handler output;
+  cmd(args, db, output);
+  return output.result_;
+}
+
+} // namespace
+
+TEST_CASE("append only file records times as deadlines") {
+  memory_file file;
+  const redis::database::now_t now(1000s);
+  auto db = make_database(now, file);
+  redis::append_only_file aof(file.path(), policy::no);
+
+  using args = std::vector<std::string_view>;
+  const args fields{"f", "v"};
+  CHECK(aof.record({"SET", "k", "v", "EX", "10"}, db) ==
+        args{"SET", "k", "v", "PXAT", "1010000"});
+  CHECK(aof.record({"set", "k", "v", "px", "10"}, db) ==
+        args{"set", "k", "v", "PXAT", "1000010"});
+  CHECK(aof.record({"EXPIRE", "k", "-1"}, db) ==
+        args{"PEXPIREAT", "k", "999000"});
+  CHECK(aof.record({"PEXPIRE", "k", "500"}, db) ==
+        args{"PEXPIREAT", "k", "1000500"});
+  CHECK(aof.record({"XADD", "s", "MAXLEN", "~", "5", "*", "f", "v"}, db) ==
+        args{"XADD", "s", "MAXLEN", "~", "5", "1000000-*", "f", "v"});
+  // the same, or an error, whenever it's run
+  db.set("k", "v");
+  CHECK(aof.record({"SET", "k", "v", "EX", "x"}, db) ==
+        args{"SET", "k", "v", "EX", "x"});
+  CHECK(aof.record({"XADD", "k", "*", "f", "v"}, db) ==
+        args{"XADD", "k", "*", "f", "v"});
+
+  // a stream's IDs don't go backwards because the clock did
+  db.get_or_create_stream("s", at(now)).append({2000000, 0}, fields);
+  CHECK(aof.record({"XADD", "s", "*", "f", "v"}, db) ==
+        args{"XADD", "s", "2000000-*", "f", "v"});
+
+  CHECK(aof.record({"DEL", "k"}, db) == args{"DEL", "k"});
+  CHECK(file.contents().empty());
+  aof.write();
+  CHECK(file.contents().ends_with("*2\r\n$3\r\nDEL\r\n$1\r\nk\r\n"));
+  CHECK(aof.size() == file.contents().size());
+}
+
+TEST_CASE("append only file cuts off a torn command") {
+  memory_file file;
+  const auto whole = "*2\r\n$3\r\nDEL\r\n$1\r\nk\r\n"s;
+
+  for (const auto policy : {policy::always, policy::everysec, policy::no}) {
+    for (std::size_t torn = 0; torn < whole.size(); ++torn) {
+      file.append(whole);
+      file.append(whole.substr(0, torn));
+      redis::append_only_file aof(file.path(), policy);
+      CHECK(file.contents() == whole);
+      CHECK(aof.size() == whole.size());
+
+      aof.append({"DEL", "k"});
+      aof.write();
+      CHECK(file.contents() == whole + whole);
+      file.clear();
+    }
+  }
+}
+
+TEST_CASE("append only file refuses what isn't commands") {
+  for (const auto &bytes :
+       {"PING\r\n"s, "*1\r\n$4\r\nPINGPONG\r\n"s, "*1\r\n+PING\r\n"s,
+        "*-1\r\n"s, "*1\r\n$x\r\n"s, "*1" + std::string(32, '1')}) {
+    memory_file file;
+    file.append(bytes);
+    CHECK_THROWS_AS(redis::append_only_file(file.path(), policy::no),
+                    std::runtime_error);
+  }
+}
+
+TEST_CASE("append only file rewrite loads") {
+  memory_file file;
+  const redis::database::now_t now(1000s);
+  auto db = make_database(now, file);
+  const std::vector<std::string_view> fields{"f", "v"};
+  db.set("string", "some string", time_point(1010s));
+  db.get_or_create_list("list", at(now)) = {"a", "b"};
+  db.expire("list", time_point(1005s), at(now));
+  db.get_or_create_hash("hash", at(now)).set("field", "value");
+  db.get_or_create_set("set", at(now)).insert("member");
+  auto &zset = db.get_or_create_zset("zset", at(now));
+  zset.insert("x", 0.1);
+  zset.insert("y", -2);
+  auto &stream = db.get_or_create_stream("stream", at(now));
+  stream.append({1, 1}, fields);
+  auto &trimmed = db.get_or_create_stream("trimmed", at(now));
+  trimmed.append({5, 5}, fields);
+  trimmed.trim(0, false);
+
+  {
+    redis::append_only_file aof(file.path(), policy::always);
+    aof.rewrite(db);
+    aof.write();
+  }
+  db.clear();
+  CHECK(submit(redis_cmd_load, {"LOAD"}, db) == "+OK\r\n");
+
+  CHECK(db.size() == 7);
+  CHECK(*db.get_string("string", at(now)) == "some string");
+  CHECK(*db.expiry("string", at(now)) == time_point(1010s));
+  CHECK(submit(redis_cmd_lrange, {"LRANGE", "list", "0", "-1"}, db) ==
+        "*2\r\n$1\r\na\r\n$1\r\nb\r\n");
+  CHECK(*db.expiry("list", at(now)) == time_point(1005s));
+  CHECK(db.get_hash("hash", at(now))->get().get("field") == "value");
+  CHECK(db.get_set("set", at(now))->get().contains("member"));
+  CHECK(db.get_zset("zset", at(now))->get().score("x") == 0.1);
+  CHECK(db.get_zset("zset", at(now))->get().score("y") == -2);
+  CHECK(db.get_stream("stream", at(now))->get().size() == 1);
+  const auto &loaded = db.get_stream("trimmed", at(now))->get();
+  CHECK(loaded.empty());
+  CHECK(loaded.last_id() == redis::stream_id{5, 5});
+}
+
+TEST_CASE("append only file replays as of when commands ran") {
+  memory_file file;
+  redis::database::now_t now(1000s);
+  auto db = make_database(now, file);
+  redis::append_only_file aof(file.path(), policy::no);
+  const auto run = [&](redis::commands::cmd_t cmd,
+                       const std::vector<std::string_view> &args) {
+    redis::resp::null_handler output;
+    cmd(aof.record(args, db), db, output);
+  };
+
+  run(redis_cmd_set, {"SET", "k", "1", "EX", "10"});
+  now += 5s;
+  run(redis_cmd_incr, {"INCR", "k"});
+  run(redis_cmd_xadd, {"XADD", "s", "*", "f", "v"});
+  aof.write();
+
+  // replayed after k expired, it still expires when it did, rather than
+  // being recreated without an expiry by the INCR
+  now += 10s;
+  db.clear();
+  CHECK(submit(redis_cmd_load, {"LOAD"}, db) == "+OK\r\n");
+  CHECK_FALSE(db.exists("k", at(now)));
+  CHECK(db.get_stream("s", at(now))->get().last_id() ==
+        redis::stream_id{1005000, 0});
+
+  now -= 10s;
+  db.clear();
+  CHECK(submit(redis_cmd_load, {"LOAD"}, db) == "+OK\r\n");
+  CHECK(*db.get_string("k", at(now)) == "2");
+}
@@ -0,0 +1,64 @@
+#include <catch2/catch_all.hpp>
+
+#include <background_task.hpp>
+
+#include <stdexcept>
+
+#include <poll.h>
+#include <signal.h>
+#include <unistd.h>
+
+namespace ns = redis;
+
+TEST_CASE("background task reports how it went") {
+  CHECK(ns::background_task([]() { return true; }).wait());
+  CHECK_FALSE(ns::background_task([]() { return false; }).wait());
+  CHECK_FALSE(ns::background_task([]() -> bool {
+                throw std::runtime_error("failed");
+              }).wait());
+  // killed without reporting, by a signal Catch doesn't handle in the child
+  CHECK_FALSE(ns::background_task([]() {
+                ::raise(SIGKILL);
+                return true;
+              }).wait());
+}
+
+TEST_CASE("background task sees memory as it was at the fork") {
+  int value = 1;
+  ns::background_task task([&value]() {
+    ::usleep(10000);
+    return value == 1;
+  });
+  value = 2;
+  CHECK(task.pid() != ::getpid());
+  CHECK(task.wait());
+}
+
+TEST_CASE("background task fd is readable once it's done") {
+  int go[2];
+  REQUIRE(::pipe(go) == 0);
+  ns::background_task task([&go]() {
+    char c;
+    return ::read(go[0], &c, 1) == 1;
+  });
+
+  ::pollfd pfd{.fd = task.fd(), .events = POLLIN, .revents = 0};
+  CHECK(::poll(&pfd, 1, 0) == 0);
+  CHECK(::write(go[1], "x", 1) == 1);
+  CHECK(::poll(&pfd, 1, 5000) == 1);
+  CHECK(task.wait());
+  ::close(go[0]);
+  ::close(go[1]);
+}
+
+TEST_CASE("background task is killed if not waited for") {
+  pid_t pid;
+  {
+    ns::background_task task([]() {
+      ::pause();
+      return true;
+    });
+    pid = task.pid();
+  }
+  CHECK(::kill(pid, 0) == -1);
+}
@@ -0,0 +1,96 @@
+#include <catch2/catch_all.hpp>
+
+#include <bitmap.hpp>
+
+#include <array>
+#include <random>
+#include <string>
+
+namespace ns = redis::bitmap;
+
+namespace {
+
+// the bits as '0's and '1's, in offset order
+std::string bit_string(std::string_view bits) {
+  std::string result;
+  for (std::uint64_t i = 0; i < bits.size() * 8; ++i)
+    result += ns::get(bits, i) ? '1' : '0';
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("bitmap set and get") {
+  redis::compact_string bits;
+  CHECK(!ns::get(bits.view(), 0));
+  CHECK(!ns::set(bits, 1, true));
+  CHECK(bits.view() == "\x40");
+  CHECK(!ns::set(bits, 17, true));
+  CHECK(bits.size() == 3);
+  CHECK(bit_string(bits.view()) == "010000000000000001000000");
+  CHECK(ns::set(bits, 17, false));
+  CHECK(ns::get(bits.view(), 1));
+  CHECK(!ns::get(bits.view(), 17));
+  // past the end reads as zero
+  CHECK(!ns::get(bits.view(), 1000));
+}
+
+TEST_CASE("bitmap count and find over ranges") {
+  std::mt19937_64 rng(7);
+  for (const std::size_t size : {0, 1, 2, 9, 33, 100, 1000}) {
+    std::string bits(size, '\0');
+    for (auto &c : bits)
+      c = char(rng());
+    // runs of set and clear bytes, for find to skip
+    if (size > 40) {
+      std::fill(bits.begin() + 2, bits.begin() + 20, '\0');
+      std::fill(bits.begin() + 20, bits.begin() + 40, '\xff');
+    }
+    const auto text = bit_string(bits);
+    for (int i = 0; i < 200; ++i) {
+      const auto a = rng() % (size * 8 + 10);
+      const auto b = rng() % (size * 8 + 10);
+      const auto begin = std::min(a, b);
+      const auto end = std::max(a, b);
+      const auto clipped_begin = std::min<std::size_t>(begin, text.size());
+      const auto clipped_end = std::min<std::size_t>(end, text.size());
+      const auto range = std::string_view(text).substr(
+          clipped_begin, clipped_end - clipped_begin);
+      CHECK(ns::count(bits, begin, end) ==
+            std::uint64_t(std::ranges::count(range, '1')));
+      for (const bool bit : {false, true}) {
+        const auto pos = range.find(bit ? '1' : '0');
+        const auto found = ns::find(bits, bit, begin, end);
+        if (pos == std::string_view::npos)
+          CHECK(!found);
+        else
+          CHECK(found == clipped_begin + pos);
+      }
+    }
+  }
+}
+
+TEST_CASE("bitmap fields") {
+  redis::compact_string bits;
+  ns::set_field(bits, 4, 8, 0xab);
+  CHECK(bits.view() == "\x0a\xb0");
+  CHECK(ns::get_field(bits.view(), 4, 8) == 0xab);
+  CHECK(ns::get_field(bits.view(), 0, 4) == 0);
+  CHECK(ns::get_field(bits.view(), 12, 16) == 0);
+  ns::set_field(bits, 3, 64, ~std::uint64_t());
+  CHECK(ns::get_field(bits.view(), 3, 64) == ~std::uint64_t());
+  CHECK(ns::get_field(bits.view(), 0, 3) == 0);
+  CHECK(bits.size() == 9);
+}
+
+TEST_CASE("bitmap operations") {
+  const std::array<std::string_view, 3> sources{"\xff\x0f\xf0", "\x0f",
+                                                "\x01\x02\x03\x04"};
+  CHECK(ns::apply(ns::operation::and_, sources).view() ==
+        std::string_view("\x01\0\0\0", 4));
+  CHECK(ns::apply(ns::operation::or_, sources).view() == "\xff\x0f\xf3\x04");
+  CHECK(ns::apply(ns::operation::xor_, sources).view() == "\xf1\x0d\xf3\x04");
+  CHECK(ns::apply(ns::operation::not_, std::span(sources).first(1)).view() ==
+        std::string_view("\x00\xf0\x0f", 3));
+  CHECK(ns::apply(ns::operation::or_, {}).empty());
+}
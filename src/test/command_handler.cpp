@@ -0,0 +1,195 @@
+#include <catch2/catch_all.hpp>
+
+#include "identity_handler.hpp"
+
+#include <command_handler.hpp>
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ns = redis;
+using namespace std::literals;
+
+namespace {
+
+// keeps a copy of each command, and where its arguments were
+struct recording_router : public ns::router {
+  bool route(const std::vector<std::string_view> &args) override {
+    commands.emplace_back(args.begin(), args.end());
+    views.push_back(args);
+    return true;
+  }
+
+  std::vector<std::vector<std::string>> commands;
+  std::vector<std::vector<std::string_view>> views;
+};
+
+// keeps a copy of each write command, and has SET run as SET key journaled
+struct recording_journal : public ns::journal {
+  const std::vector<std::string_view> &
+  record(const std::vector<std::string_view> &args, ns::database &) override {
+    commands.emplace_back(args.begin(), args.end());
+    if (args.size() != 3 || args[0] != "SET")
+      return args;
+    rewritten = {args[0], args[1], "journaled"};
+    return rewritten;
+  }
+
+  std::vector<std::vector<std::string>> commands;
+  std::vector<std::string_view> rewritten;
+};
+
+class fixture {
+protected:
+  fixture()
+      : db_(std::chrono::system_clock::now,
+            []() { return std::make_unique<std::istream>(nullptr); },
+            []() { return std::make_unique<std::ostream>(nullptr); }) {}
+
+  ns::database db_;
+  ns::test::identity_handler output_;
+  recording_router router_;
+  ns::command_handler handler_{db_, output_, &router_};
+  ns::resp::parser parser_{handler_};
+};
+
+bool points_into(std::string_view arg, const std::string &input) {
+  return arg.data() >= input.data() &&
+         arg.data() + arg.size() <= input.data() + input.size();
+}
+
+} // namespace
+
+TEST_CASE_METHOD(fixture, "complete command arguments aren't copied") {
+  const std::string input = "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$5\r\nvalue\r\n"
+                            "GET key\r\n";
+  CHECK(parser_.parse(input.data(), input.data() + input.size()) ==
+        input.data() + input.size());
+  handler_.detach();
+
+  REQUIRE(router_.commands.size() == 2);
+  CHECK(router_.commands[0] == std::vector<std::string>{"SET", "key", "value"});
+  CHECK(router_.commands[1] == std::vector<std::string>{"GET", "key"});
+  for (const auto &args : router_.views) {
+    CHECK(std::all_of(args.begin(), args.end(),
+                      [&](auto arg) { return points_into(arg, input); }));
+  }
+}
+
+TEST_CASE_METHOD(fixture, "incomplete command is copied on detach") {
+  const std::string command = "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$5\r\nvalue\r\n";
+  const auto split = GENERATE_COPY(range(std::size_t(1), command.size()));
+
+  std::string input = command.substr(0, split);
+  const char *const end =
+      parser_.parse(input.data(), input.data() + input.size());
+  handler_.detach();
+
+  // the input buffer gets reused for the rest of the command
+  const std::string rest = input.substr(end - input.data()) + command.substr(split);
+  std::fill(input.begin(), input.end(), 'x');
+  input = rest;
+  CHECK(parser_.parse(input.data(), input.data() + input.size()) ==
+        input.data() + input.size());
+
+  REQUIRE(router_.commands.size() == 1);
+  CHECK(router_.commands[0] == std::vector<std::string>{"SET", "key", "value"});
+}
+
+TEST_CASE_METHOD(fixture, "argument split across buffers") {
+  const std::string first = "*2\r\n$4\r\nECHO\r\n$11\r\nhello";
+  const std::string second = " world\r\n";
+  parser_.parse(first.data(), first.data() + first.size());
+  parser_.parse(second.data(), second.data() + second.size());
+
+  REQUIRE(router_.commands.size() == 1);
+  CHECK(router_.commands[0] == std::vector<std::string>{"ECHO", "hello world"});
+}
+
+TEST_CASE_METHOD(fixture, "empty arguments") {
+  const std::string input = "*2\r\n$4\r\nECHO\r\n$0\r\n\r\n";
+  parser_.parse(input.data(), input.data() + input.size());
+
+  REQUIRE(router_.commands.size() == 1);
+  CHECK(router_.commands[0] == std::vector<std::string>{"ECHO", ""});
+}
+
+TEST_CASE_METHOD(fixture, "dispatch without a router") {
+  ns::command_handler handler{db_, output_};
+  ns::resp::parser parser{handler};
+  const std::string input = "*2\r\n$4\r\nECHO\r\n$5\r\nhello\r\n";
+  parser.parse(input.data(), input.data() + input.size());
+  CHECK(output_.result_ == "$5\r\nhello\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "batched commands run in order on execute") {
+  ns::command_handler handler{db_, output_, nullptr,
+                              ns::command_handler::mode::batched};
+  ns::resp::parser parser{handler};
+  const std::string command = "*3\r\n$3\r\nSET\r\n$3\r\nkey\r\n$5\r\nvalue\r\n"
+                              "*2\r\n$3\r\nGET\r\n$3\r\nkey\r\n"
+                              "*2\r\n$3\r\nDEL\r\n$3\r\nkey\r\n";
+  const auto split = GENERATE_COPY(range(std::size_t(1), command.size()));
+
+  std::string input = command.substr(0, split);
+  const char *const end =
+      parser.parse(input.data(), input.data() + input.size());
+  CHECK(output_.result_.empty());
+  handler.execute();
+  handler.detach();
+
+  const std::string rest = input.substr(end - input.data()) + command.substr(split);
+  std::fill(input.begin(), input.end(), 'x');
+  input = rest;
+  CHECK(parser.parse(input.data(), input.data() + input.size()) ==
+        input.data() + input.size());
+  handler.execute();
+
+  CHECK(output_.result_ == "+OK\r\n$5\r\nvalue\r\n:1\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "batched commands are routed") {
+  ns::command_handler handler{db_, output_, &router_,
+                              ns::command_handler::mode::batched};
+  ns::resp::parser parser{handler};
+  const std::string input = "GET a\r\n*2\r\n$3\r\nGET\r\n$1\r\nb\r\nGET c\r\n";
+  parser.parse(input.data(), input.data() + input.size());
+  CHECK(router_.commands.empty());
+  handler.execute();
+
+  REQUIRE(router_.commands.size() == 3);
+  CHECK(router_.commands[0] == std::vector<std::string>{"GET", "a"});
+  CHECK(router_.commands[1] == std::vector<std::string>{"GET", "b"});
+  CHECK(router_.commands[2] == std::vector<std::string>{"GET", "c"});
+}
+
+TEST_CASE_METHOD(fixture, "commands that may use memory are refused over the "
+                          "limit") {
+  db_.limit_memory(1, ns::eviction_policy::noeviction,
+                   [this]() { return db_.size(); });
+  ns::command_handler handler{db_, output_};
+  ns::resp::parser parser{handler};
+  const std::string input = "SET a 1\r\nSET b 2\r\nSET c 3\r\nGET a\r\nDEL a\r\n";
+  parser.parse(input.data(), input.data() + input.size());
+  CHECK(output_.result_ ==
+        "+OK\r\n+OK\r\n"
+        "-OOM command not allowed when used memory > 'maxmemory'.\r\n"
+        "$1\r\n1\r\n:1\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "write commands are journaled") {
+  recording_journal journal;
+  ns::command_handler handler{db_, output_, nullptr,
+                              ns::command_handler::mode::immediate, &journal};
+  ns::resp::parser parser{handler};
+  const std::string input = "SET a 1\r\nGET a\r\nDEL b\r\nECHO c\r\n";
+  parser.parse(input.data(), input.data() + input.size());
+
+  REQUIRE(journal.commands.size() == 2);
+  CHECK(journal.commands[0] == std::vector<std::string>{"SET", "a", "1"});
+  CHECK(journal.commands[1] == std::vector<std::string>{"DEL", "b"});
+  // what's run is what the journal says to run
+  CHECK(output_.result_ == "+OK\r\n$9\r\njournaled\r\n:0\r\n$1\r\nc\r\n");
+}
@@ -0,0 +1,71 @@
+#include <catch2/catch_all.hpp>
+
+#include <command_table.hpp>
+
+#include <string>
+#include <vector>
+
+namespace ns = redis::commands;
+
+TEST_CASE("find every command") {
+  for (const auto &cmd : ns::all()) {
+    CHECK(ns::find(cmd.name) == &cmd);
+
+    std::string lower(cmd.name);
+    for (auto &c : lower)
+      c = char(::tolower(c));
+    CHECK(ns::find(lower) == &cmd);
+  }
+}
+
+TEST_CASE("find mixed case") {
+  const auto *cmd = ns::find("lRanGe");
+  REQUIRE(cmd);
+  CHECK(cmd->name == "LRANGE");
+  CHECK(cmd->cmd == redis_cmd_lrange);
+}
+
+TEST_CASE("find unknown commands") {
+  CHECK(!ns::find(""));
+  CHECK(!ns::find("GE"));
+  CHECK(!ns::find("GETT"));
+  CHECK(!ns::find("NOSUCHCOMMAND"));
+  CHECK(!ns::find("LOAD"));
+}
+
+TEST_CASE("arity") {
+  const auto &get = *ns::find("GET");
+  CHECK(!get.accepts(1));
+  CHECK(get.accepts(2));
+  CHECK(!get.accepts(3));
+
+  const auto &del = *ns::find("DEL");
+  CHECK(!del.accepts(1));
+  CHECK(del.accepts(2));
+  CHECK(del.accepts(10));
+}
+
+TEST_CASE("keys") {
+  const auto keys = [](std::string_view name, const ns::args_t &args) {
+    std::vector<std::string_view> result;
+    ns::find(name)->for_each_key(
+        args, [&](std::string_view key) { result.push_back(key); });
+    return result;
+  };
+
+  using keys_t = std::vector<std::string_view>;
+  CHECK(keys("SET", {"SET", "k", "v", "EX", "1"}) == keys_t{"k"});
+  CHECK(keys("DEL", {"DEL", "a", "b", "c"}) == keys_t{"a", "b", "c"});
+  CHECK(keys("PING", {"PING", "msg"}).empty());
+  CHECK(keys("XREAD", {"XREAD", "COUNT", "1", "streams", "a", "b", "0", "$"}) ==
+        keys_t{"a", "b"});
+  CHECK(keys("XREAD", {"XREAD", "STREAMS", "a", "b", "0"}).empty());
+}
+
+TEST_CASE("flags") {
+  CHECK(ns::find("GET")->flags & ns::readonly);
+  CHECK(ns::find("SET")->flags & ns::write);
+  CHECK(ns::find("SAVE")->flags & ns::all_shards);
+  CHECK(ns::find("BGSAVE")->flags & ns::server);
+  CHECK_FALSE(ns::find("BGSAVE")->cmd);
+}
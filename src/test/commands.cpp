@@ -89,6 +89,83 @@ TEST_CASE_METHOD(fixture, "exists") {
   CHECK(result == ":2\r\n");
 }
 
+TEST_CASE_METHOD(fixture, "mget") {
+  submit(redis_cmd_set, {"SeT", "key1", "value1"});
+  submit(redis_cmd_set, {"SeT", "key3", "value3", "PX", "1000"});
+  submit(redis_cmd_rpush, {"rpush", "list", "a"});
+  CHECK(submit(redis_cmd_mget, {"mGet", "key1", "key2", "key3", "list",
+                                "key1"}) ==
+        "*5\r\n$6\r\nvalue1\r\n$-1\r\n$6\r\nvalue3\r\n$-1\r\n"
+        "$6\r\nvalue1\r\n");
+
+  now_ += std::chrono::seconds(1);
+  CHECK(submit(redis_cmd_mget, {"mGet", "key3", "key1", "key3"}) ==
+        "*3\r\n$-1\r\n$6\r\nvalue1\r\n$-1\r\n");
+  CHECK(submit(redis_cmd_exists, {"eXiSts", "key1", "key3"}) == ":1\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "mset") {
+  submit(redis_cmd_set, {"SeT", "key1", "old", "EX", "1"});
+  CHECK(submit(redis_cmd_mset, {"mSet", "key1", "value1", "key2", "value2",
+                                "key2", "value3"}) == "+OK\r\n");
+  now_ += std::chrono::seconds(2);
+  CHECK(submit(redis_cmd_mget, {"mGet", "key1", "key2"}) ==
+        "*2\r\n$6\r\nvalue1\r\n$6\r\nvalue3\r\n");
+  CHECK(submit(redis_cmd_mset, {"mSet", "key1", "value1", "key2"}) ==
+        "-ERR wrong number of arguments\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "msetnx") {
+  submit(redis_cmd_set, {"SeT", "key1", "value1", "EX", "1"});
+  CHECK(submit(redis_cmd_msetnx, {"msetNX", "key1", "new", "key2", "new"}) ==
+        ":0\r\n");
+  CHECK(submit(redis_cmd_get, {"gET", "key2"}) == "$-1\r\n");
+
+  // an expired key doesn't count as existing
+  now_ += std::chrono::seconds(1);
+  CHECK(submit(redis_cmd_msetnx, {"msetNX", "key1", "new", "key2", "new"}) ==
+        ":1\r\n");
+  CHECK(submit(redis_cmd_mget, {"mGet", "key1", "key2"}) ==
+        "*2\r\n$3\r\nnew\r\n$3\r\nnew\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "expire / ttl / persist") {
+  using namespace std::chrono_literals;
+  now_ += 1000s;
+  submit(redis_cmd_set, {"SeT", "string", "value"});
+  submit(redis_cmd_rpush, {"rpush", "list", "a"});
+
+  CHECK(submit(redis_cmd_ttl, {"ttl", "string"}) == ":-1\r\n");
+  CHECK(submit(redis_cmd_ttl, {"ttl", "missing"}) == ":-2\r\n");
+  CHECK(submit(redis_cmd_expire, {"expire", "string", "10"}) == ":1\r\n");
+  CHECK(submit(redis_cmd_pexpire, {"pexpire", "list", "1500"}) == ":1\r\n");
+  CHECK(submit(redis_cmd_expire, {"expire", "missing", "10"}) == ":0\r\n");
+  CHECK(submit(redis_cmd_expire, {"expire", "string", "x"}) ==
+        "-ERR value is not an integer or out of range\r\n");
+
+  now_ += 100ms;
+  CHECK(submit(redis_cmd_ttl, {"ttl", "string"}) == ":10\r\n");
+  CHECK(submit(redis_cmd_pttl, {"pttl", "string"}) == ":9900\r\n");
+  CHECK(submit(redis_cmd_pttl, {"pttl", "list"}) == ":1400\r\n");
+
+  CHECK(submit(redis_cmd_persist, {"persist", "string"}) == ":1\r\n");
+  CHECK(submit(redis_cmd_persist, {"persist", "string"}) == ":0\r\n");
+  CHECK(submit(redis_cmd_ttl, {"ttl", "string"}) == ":-1\r\n");
+
+  now_ += 1400ms;
+  CHECK(submit(redis_cmd_lrange, {"lrange", "list", "0", "-1"}) == "*0\r\n");
+  CHECK(submit(redis_cmd_pttl, {"pttl", "list"}) == ":-2\r\n");
+
+  CHECK(submit(redis_cmd_expireat, {"expireat", "string", "1"}) == ":1\r\n");
+  CHECK(submit(redis_cmd_exists, {"exists", "string"}) == ":0\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "incr keeps the expiry") {
+  submit(redis_cmd_set, {"SeT", "key", "1", "PX", "2000"});
+  CHECK(submit(redis_cmd_incr, {"incr", "key"}) == ":2\r\n");
+  CHECK(submit(redis_cmd_pttl, {"pttl", "key"}) == ":2000\r\n");
+}
+
 TEST_CASE_METHOD(fixture, "incr/decr") {
   CHECK(submit(redis_cmd_incr, {"iNCR", "key"}) == ":1\r\n");
   CHECK(submit(redis_cmd_get, {"gEt", "key"}) == "$1\r\n1\r\n");
@@ -101,6 +178,60 @@ TEST_CASE_METHOD(fixture, "incr/decr") {
   CHECK(submit(redis_cmd_get, {"gEt", "key"}) == "$1\r\n0\r\n");
 }
 
+TEST_CASE_METHOD(fixture, "incrby/decrby") {
+  CHECK(submit(redis_cmd_incrby, {"incrby", "key", "10"}) == ":10\r\n");
+  CHECK(submit(redis_cmd_decrby, {"decrby", "key", "25"}) == ":-15\r\n");
+  CHECK(submit(redis_cmd_get, {"get", "key"}) == "$3\r\n-15\r\n");
+  CHECK(submit(redis_cmd_incrby, {"incrby", "key", "x"}) ==
+        "-ERR value is not an integer or out of range\r\n");
+  CHECK(submit(redis_cmd_decrby,
+               {"decrby", "key", "-9223372036854775808"}) ==
+        "-ERR decrement would overflow\r\n");
+
+  submit(redis_cmd_set, {"set", "key", "9223372036854775806"});
+  CHECK(submit(redis_cmd_incr, {"incr", "key"}) ==
+        ":9223372036854775807\r\n");
+  CHECK(submit(redis_cmd_incr, {"incr", "key"}) ==
+        "-ERR increment or decrement would overflow\r\n");
+  CHECK(submit(redis_cmd_get, {"get", "key"}) ==
+        "$19\r\n9223372036854775807\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "incr of something other than an integer") {
+  // only the exact text of an integer is one
+  const auto value = GENERATE("x", "", "01", "+1", " 1", "1.0",
+                              "9223372036854775808");
+  submit(redis_cmd_set, {"set", "key", value});
+  CHECK(submit(redis_cmd_incr, {"incr", "key"}) ==
+        "-ERR value is not an integer or out of range\r\n");
+
+  submit(redis_cmd_rpush, {"rpush", "list", "a"});
+  CHECK(submit(redis_cmd_incr, {"incr", "list"}) ==
+        "-WRONGTYPE key refers to object of the wrong type\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "incrbyfloat") {
+  CHECK(submit(redis_cmd_incrbyfloat, {"incrbyfloat", "key", "10.5"}) ==
+        "$4\r\n10.5\r\n");
+  CHECK(submit(redis_cmd_incrbyfloat, {"incrbyfloat", "key", "-0.5"}) ==
+        "$2\r\n10\r\n");
+  // back to an integer
+  CHECK(submit(redis_cmd_incr, {"incr", "key"}) == ":11\r\n");
+  CHECK(submit(redis_cmd_incrbyfloat, {"incrbyfloat", "key", "5e3"}) ==
+        "$4\r\n5011\r\n");
+
+  CHECK(submit(redis_cmd_incrbyfloat, {"incrbyfloat", "key", "x"}) ==
+        "-ERR value is not a valid float\r\n");
+  CHECK(submit(redis_cmd_incrbyfloat, {"incrbyfloat", "key", "inf"}) ==
+        "-ERR value is not a valid float\r\n");
+  submit(redis_cmd_set, {"set", "key", "1e308"});
+  CHECK(submit(redis_cmd_incrbyfloat, {"incrbyfloat", "key", "1e308"}) ==
+        "-ERR increment would produce NaN or Infinity\r\n");
+  submit(redis_cmd_set, {"set", "key", "abc"});
+  CHECK(submit(redis_cmd_incrbyfloat, {"incrbyfloat", "key", "1"}) ==
+        "-ERR value is not a valid float\r\n");
+}
+
 TEST_CASE_METHOD(fixture, "rpush") {
   CHECK(submit(redis_cmd_rpush, {"RpUsH", "key", "a", "b", "c"}) == ":3\r\n");
   CHECK(submit(redis_cmd_lrange, {"lrange", "key", "0", "2"}) ==
@@ -127,8 +258,532 @@ TEST_CASE_METHOD(fixture, "lrange arguments") {
         "*0\r\n");
 }
 
+TEST_CASE_METHOD(fixture, "hset / hget / hdel") {
+  CHECK(submit(redis_cmd_hset, {"hset", "key", "a", "1", "b", "2"}) ==
+        ":2\r\n");
+  CHECK(submit(redis_cmd_hset, {"hset", "key", "b", "3", "c", "4"}) ==
+        ":1\r\n");
+  CHECK(submit(redis_cmd_hset, {"hset", "key", "d"}) ==
+        "-ERR wrong number of arguments\r\n");
+  CHECK(submit(redis_cmd_hget, {"hget", "key", "b"}) == "$1\r\n3\r\n");
+  CHECK(submit(redis_cmd_hget, {"hget", "key", "z"}) == "$-1\r\n");
+  CHECK(submit(redis_cmd_hget, {"hget", "missing", "b"}) == "$-1\r\n");
+  CHECK(submit(redis_cmd_hmget, {"hmget", "key", "a", "z", "c"}) ==
+        "*3\r\n$1\r\n1\r\n$-1\r\n$1\r\n4\r\n");
+  CHECK(submit(redis_cmd_hlen, {"hlen", "key"}) == ":3\r\n");
+  CHECK(submit(redis_cmd_hgetall, {"hgetall", "key"}) ==
+        "*6\r\n$1\r\na\r\n$1\r\n1\r\n$1\r\nb\r\n$1\r\n3\r\n"
+        "$1\r\nc\r\n$1\r\n4\r\n");
+
+  CHECK(submit(redis_cmd_get, {"get", "key"}) == "-WRONGTYPE\r\n");
+  submit(redis_cmd_set, {"set", "string", "x"});
+  CHECK(submit(redis_cmd_hget, {"hget", "string", "a"}) ==
+        "-WRONGTYPE key refers to object of the wrong type\r\n");
+
+  CHECK(submit(redis_cmd_hdel, {"hdel", "key", "a", "z", "b"}) == ":2\r\n");
+  CHECK(submit(redis_cmd_exists, {"exists", "key"}) == ":1\r\n");
+  // the last field takes the key with it
+  CHECK(submit(redis_cmd_hdel, {"hdel", "key", "c"}) == ":1\r\n");
+  CHECK(submit(redis_cmd_exists, {"exists", "key"}) == ":0\r\n");
+  CHECK(submit(redis_cmd_hlen, {"hlen", "key"}) == ":0\r\n");
+  CHECK(submit(redis_cmd_hgetall, {"hgetall", "key"}) == "*0\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "hincrby") {
+  CHECK(submit(redis_cmd_hincrby, {"hincrby", "key", "f", "5"}) == ":5\r\n");
+  CHECK(submit(redis_cmd_hincrby, {"hincrby", "key", "f", "-7"}) ==
+        ":-2\r\n");
+  CHECK(submit(redis_cmd_hget, {"hget", "key", "f"}) == "$2\r\n-2\r\n");
+  CHECK(submit(redis_cmd_hincrby, {"hincrby", "key", "f", "x"}) ==
+        "-ERR value is not an integer or out of range\r\n");
+
+  submit(redis_cmd_hset, {"hset", "key", "g", "abc", "h",
+                          "9223372036854775807"});
+  CHECK(submit(redis_cmd_hincrby, {"hincrby", "key", "g", "1"}) ==
+        "-ERR hash value is not an integer\r\n");
+  CHECK(submit(redis_cmd_hincrby, {"hincrby", "key", "h", "1"}) ==
+        "-ERR increment or decrement would overflow\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "hscan") {
+  for (int i = 0; i < 200; ++i) {
+    const auto n = std::to_string(i);
+    submit(redis_cmd_hset, {"hset", "key", "field" + n, n});
+  }
+
+  // a scan of a hash this big takes several calls
+  std::string cursor = "0";
+  std::size_t calls = 0;
+  std::size_t matches = 0;
+  do {
+    redis::test::identity_handler output;
+    redis_cmd_hscan({"hscan", "key", cursor, "match", "field1?", "COUNT", "50"},
+                    db_, output);
+    const auto &result = output.result_;
+    // *2\r\n$<n>\r\n<cursor>\r\n*<fields>\r\n...
+    const auto cursor_start = result.find("\r\n", 4) + 2;
+    cursor = result.substr(cursor_start,
+                           result.find("\r\n", cursor_start) - cursor_start);
+    const auto fields_start = result.find('*', cursor_start) + 1;
+    matches += std::stoul(result.substr(fields_start)) / 2;
+    ++calls;
+  } while (cursor != "0");
+  CHECK(calls == 4);
+  CHECK(matches == 10);
+
+  CHECK(submit(redis_cmd_hscan, {"hscan", "missing", "0"}) ==
+        "*2\r\n$1\r\n0\r\n*0\r\n");
+  CHECK(submit(redis_cmd_hscan, {"hscan", "key", "x"}) ==
+        "-ERR invalid cursor\r\n");
+  CHECK(submit(redis_cmd_hscan, {"hscan", "key", "0", "count"}) ==
+        "-ERR syntax error\r\n");
+  CHECK(submit(redis_cmd_hscan, {"hscan", "key", "0", "count", "0"}) ==
+        "-ERR syntax error\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "sadd / srem / sismember") {
+  CHECK(submit(redis_cmd_sadd, {"sadd", "key", "3", "1", "2", "1"}) ==
+        ":3\r\n");
+  CHECK(submit(redis_cmd_sadd, {"sadd", "key", "4", "3"}) == ":1\r\n");
+  CHECK(submit(redis_cmd_scard, {"scard", "key"}) == ":4\r\n");
+  CHECK(submit(redis_cmd_sismember, {"sismember", "key", "2"}) == ":1\r\n");
+  CHECK(submit(redis_cmd_sismember, {"sismember", "key", "5"}) == ":0\r\n");
+  CHECK(submit(redis_cmd_sismember, {"sismember", "missing", "5"}) ==
+        ":0\r\n");
+  CHECK(submit(redis_cmd_smembers, {"smembers", "key"}) ==
+        "*4\r\n$1\r\n1\r\n$1\r\n2\r\n$1\r\n3\r\n$1\r\n4\r\n");
+
+  CHECK(submit(redis_cmd_get, {"get", "key"}) == "-WRONGTYPE\r\n");
+  submit(redis_cmd_set, {"set", "string", "x"});
+  CHECK(submit(redis_cmd_sadd, {"sadd", "string", "a"}) ==
+        "-WRONGTYPE key refers to object of the wrong type\r\n");
+
+  CHECK(submit(redis_cmd_srem, {"srem", "key", "1", "5", "2"}) == ":2\r\n");
+  // the last member takes the key with it
+  CHECK(submit(redis_cmd_srem, {"srem", "key", "3", "4"}) == ":2\r\n");
+  CHECK(submit(redis_cmd_exists, {"exists", "key"}) == ":0\r\n");
+  CHECK(submit(redis_cmd_smembers, {"smembers", "key"}) == "*0\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "sinter / sunion / sdiff") {
+  submit(redis_cmd_sadd, {"sadd", "a", "1", "2", "3"});
+  submit(redis_cmd_sadd, {"sadd", "b", "2", "3", "4"});
+  CHECK(submit(redis_cmd_sinter, {"sinter", "a", "b"}) ==
+        "*2\r\n$1\r\n2\r\n$1\r\n3\r\n");
+  CHECK(submit(redis_cmd_sinter, {"sinter", "a", "missing"}) == "*0\r\n");
+  CHECK(submit(redis_cmd_sunion, {"sunion", "a", "b", "missing"}) ==
+        "*4\r\n$1\r\n1\r\n$1\r\n2\r\n$1\r\n3\r\n$1\r\n4\r\n");
+  CHECK(submit(redis_cmd_sunion, {"sunion", "missing"}) == "*0\r\n");
+  CHECK(submit(redis_cmd_sdiff, {"sdiff", "a", "b", "missing"}) ==
+        "*1\r\n$1\r\n1\r\n");
+  CHECK(submit(redis_cmd_sdiff, {"sdiff", "missing", "a"}) == "*0\r\n");
+
+  CHECK(submit(redis_cmd_sinterstore, {"sinterstore", "c", "a", "b"}) ==
+        ":2\r\n");
+  CHECK(submit(redis_cmd_smembers, {"smembers", "c"}) ==
+        "*2\r\n$1\r\n2\r\n$1\r\n3\r\n");
+  // the destination may be a source, and loses its expiry
+  submit(redis_cmd_pexpire, {"pexpire", "a", "1000"});
+  CHECK(submit(redis_cmd_sunionstore, {"sunionstore", "a", "a", "b"}) ==
+        ":4\r\n");
+  CHECK(submit(redis_cmd_pttl, {"pttl", "a"}) == ":-1\r\n");
+  CHECK(submit(redis_cmd_scard, {"scard", "a"}) == ":4\r\n");
+  // and an empty result deletes it, whatever it was
+  submit(redis_cmd_set, {"set", "string", "x"});
+  CHECK(submit(redis_cmd_sdiffstore, {"sdiffstore", "string", "b", "a"}) ==
+        ":0\r\n");
+  CHECK(submit(redis_cmd_exists, {"exists", "string"}) == ":0\r\n");
+
+  CHECK(submit(redis_cmd_sinter, {"sinter", "a", "string"}) == "*0\r\n");
+  submit(redis_cmd_set, {"set", "string", "x"});
+  CHECK(submit(redis_cmd_sinter, {"sinter", "a", "string"}) ==
+        "-WRONGTYPE key refers to object of the wrong type\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "zadd / zscore / zrank / zrem") {
+  CHECK(submit(redis_cmd_zadd, {"zadd", "key", "2", "b", "1", "a", "+inf",
+                                "c"}) == ":3\r\n");
+  CHECK(submit(redis_cmd_zcard, {"zcard", "key"}) == ":3\r\n");
+  CHECK(submit(redis_cmd_zscore, {"zscore", "key", "c"}) ==
+        "$3\r\ninf\r\n");
+  CHECK(submit(redis_cmd_zscore, {"zscore", "key", "d"}) == "$-1\r\n");
+  CHECK(submit(redis_cmd_zrank, {"zrank", "key", "b"}) == ":1\r\n");
+  CHECK(submit(redis_cmd_zrank, {"zrank", "missing", "b"}) == "$-1\r\n");
+
+  // NX only adds, XX only updates, and CH counts updates too
+  CHECK(submit(redis_cmd_zadd, {"zadd", "key", "nx", "5", "a", "3", "d"}) ==
+        ":1\r\n");
+  CHECK(submit(redis_cmd_zscore, {"zscore", "key", "a"}) == "$1\r\n1\r\n");
+  CHECK(submit(redis_cmd_zadd, {"zadd", "key", "XX", "CH", "0.5", "a", "4",
+                                "e"}) == ":1\r\n");
+  CHECK(submit(redis_cmd_zscore, {"zscore", "key", "a"}) ==
+        "$3\r\n0.5\r\n");
+  CHECK(submit(redis_cmd_zscore, {"zscore", "key", "e"}) == "$-1\r\n");
+  CHECK(submit(redis_cmd_zadd, {"zadd", "new", "xx", "1", "a"}) == ":0\r\n");
+  CHECK(submit(redis_cmd_exists, {"exists", "new"}) == ":0\r\n");
+  CHECK(submit(redis_cmd_zadd, {"zadd", "key", "nx", "xx", "1", "a"}) ==
+        "-ERR XX and NX options at the same time are not compatible\r\n");
+  CHECK(submit(redis_cmd_zadd, {"zadd", "key", "1", "a", "2"}) ==
+        "-ERR syntax error\r\n");
+  // nothing's added if any score is bad
+  CHECK(submit(redis_cmd_zadd, {"zadd", "key", "1", "x", "nan", "y"}) ==
+        "-ERR value is not a valid float\r\n");
+  CHECK(submit(redis_cmd_zscore, {"zscore", "key", "x"}) == "$-1\r\n");
+
+  CHECK(submit(redis_cmd_get, {"get", "key"}) == "-WRONGTYPE\r\n");
+  submit(redis_cmd_set, {"set", "string", "x"});
+  CHECK(submit(redis_cmd_zadd, {"zadd", "string", "1", "a"}) ==
+        "-WRONGTYPE key refers to object of the wrong type\r\n");
+
+  CHECK(submit(redis_cmd_zrem, {"zrem", "key", "a", "x", "b"}) == ":2\r\n");
+  // the last member takes the key with it
+  CHECK(submit(redis_cmd_zrem, {"zrem", "key", "c", "d"}) == ":2\r\n");
+  CHECK(submit(redis_cmd_exists, {"exists", "key"}) == ":0\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "zincrby") {
+  CHECK(submit(redis_cmd_zincrby, {"zincrby", "key", "2.5", "a"}) ==
+        "$3\r\n2.5\r\n");
+  CHECK(submit(redis_cmd_zincrby, {"zincrby", "key", "-1", "a"}) ==
+        "$3\r\n1.5\r\n");
+  CHECK(submit(redis_cmd_zincrby, {"zincrby", "key", "x", "a"}) ==
+        "-ERR value is not a valid float\r\n");
+  CHECK(submit(redis_cmd_zincrby, {"zincrby", "key", "inf", "b"}) ==
+        "$3\r\ninf\r\n");
+  CHECK(submit(redis_cmd_zincrby, {"zincrby", "key", "-inf", "b"}) ==
+        "-ERR resulting score is not a number (NaN)\r\n");
+  CHECK(submit(redis_cmd_zscore, {"zscore", "key", "b"}) == "$3\r\ninf\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "zrange / zrangebyscore / zcount") {
+  submit(redis_cmd_zadd,
+         {"zadd", "key", "1", "a", "2", "b", "2", "c", "3", "d", "4", "e"});
+  CHECK(submit(redis_cmd_zrange, {"zrange", "key", "1", "2"}) ==
+        "*2\r\n$1\r\nb\r\n$1\r\nc\r\n");
+  CHECK(submit(redis_cmd_zrange, {"zrange", "key", "-2", "100",
+                                  "withscores"}) ==
+        "*4\r\n$1\r\nd\r\n$1\r\n3\r\n$1\r\ne\r\n$1\r\n4\r\n");
+  CHECK(submit(redis_cmd_zrange, {"zrange", "key", "3", "1"}) == "*0\r\n");
+  CHECK(submit(redis_cmd_zrange, {"zrange", "missing", "0", "-1"}) ==
+        "*0\r\n");
+  CHECK(submit(redis_cmd_zrange, {"zrange", "key", "0", "1", "x"}) ==
+        "-ERR syntax error\r\n");
+
+  CHECK(submit(redis_cmd_zrangebyscore, {"zrangebyscore", "key", "(1",
+                                         "3"}) ==
+        "*3\r\n$1\r\nb\r\n$1\r\nc\r\n$1\r\nd\r\n");
+  CHECK(submit(redis_cmd_zrangebyscore,
+               {"zrangebyscore", "key", "-inf", "+inf", "LIMIT", "1", "2",
+                "WITHSCORES"}) ==
+        "*4\r\n$1\r\nb\r\n$1\r\n2\r\n$1\r\nc\r\n$1\r\n2\r\n");
+  CHECK(submit(redis_cmd_zrangebyscore, {"zrangebyscore", "key", "2", "(2"}) ==
+        "*0\r\n");
+  CHECK(submit(redis_cmd_zrangebyscore, {"zrangebyscore", "key", "5", "1"}) ==
+        "*0\r\n");
+  CHECK(submit(redis_cmd_zrangebyscore, {"zrangebyscore", "key", "x", "1"}) ==
+        "-ERR min or max is not a float\r\n");
+
+  CHECK(submit(redis_cmd_zcount, {"zcount", "key", "2", "3"}) == ":3\r\n");
+  CHECK(submit(redis_cmd_zcount, {"zcount", "key", "(2", "+inf"}) ==
+        ":2\r\n");
+  CHECK(submit(redis_cmd_zcount, {"zcount", "missing", "2", "3"}) ==
+        ":0\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "setbit / getbit") {
+  using namespace std::literals;
+  CHECK(submit(redis_cmd_setbit, {"setbit", "key", "7", "1"}) == ":0\r\n");
+  CHECK(submit(redis_cmd_get, {"get", "key"}) == "$1\r\n\x01\r\n");
+  CHECK(submit(redis_cmd_setbit, {"setbit", "key", "7", "0"}) == ":1\r\n");
+  CHECK(submit(redis_cmd_getbit, {"getbit", "key", "7"}) == ":0\r\n");
+  CHECK(submit(redis_cmd_getbit, {"getbit", "key", "100"}) == ":0\r\n");
+  CHECK(submit(redis_cmd_setbit, {"setbit", "key", "4294967296", "1"}) ==
+        "-ERR bit offset is not an integer or out of range\r\n");
+  CHECK(submit(redis_cmd_setbit, {"setbit", "key", "-1", "1"}) ==
+        "-ERR bit offset is not an integer or out of range\r\n");
+  CHECK(submit(redis_cmd_setbit, {"setbit", "key", "1", "2"}) ==
+        "-ERR bit is not an integer or out of range\r\n");
+
+  // an integer is changed as its digits
+  submit(redis_cmd_set, {"set", "number", "1"});
+  CHECK(submit(redis_cmd_getbit, {"getbit", "number", "2"}) == ":1\r\n");
+  CHECK(submit(redis_cmd_setbit, {"setbit", "number", "7", "0"}) == ":1\r\n");
+  CHECK(submit(redis_cmd_get, {"get", "number"}) == "$1\r\n0\r\n");
+
+  submit(redis_cmd_hset, {"hset", "hash", "field", "value"});
+  CHECK(submit(redis_cmd_setbit, {"setbit", "hash", "1", "1"}) ==
+        "-WRONGTYPE key refers to object of the wrong type\r\n");
+  CHECK(submit(redis_cmd_getbit, {"getbit", "hash", "1"}) ==
+        "-WRONGTYPE key refers to object of the wrong type\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "bitcount / bitpos") {
+  using namespace std::literals;
+  submit(redis_cmd_set, {"set", "key", "foobar"});
+  CHECK(submit(redis_cmd_bitcount, {"bitcount", "key"}) == ":26\r\n");
+  CHECK(submit(redis_cmd_bitcount, {"bitcount", "key", "0", "0"}) ==
+        ":4\r\n");
+  CHECK(submit(redis_cmd_bitcount, {"bitcount", "key", "1", "1"}) ==
+        ":6\r\n");
+  CHECK(submit(redis_cmd_bitcount, {"bitcount", "key", "-2", "-1"}) ==
+        ":7\r\n");
+  CHECK(submit(redis_cmd_bitcount, {"bitcount", "key", "1", "1", "BIT"}) ==
+        ":1\r\n");
+  CHECK(submit(redis_cmd_bitcount, {"bitcount", "key", "5", "30", "bit"}) ==
+        ":17\r\n");
+  CHECK(submit(redis_cmd_bitcount, {"bitcount", "key", "3", "1"}) ==
+        ":0\r\n");
+  CHECK(submit(redis_cmd_bitcount, {"bitcount", "key", "1"}) ==
+        "-ERR syntax error\r\n");
+  CHECK(submit(redis_cmd_bitcount, {"bitcount", "missing"}) == ":0\r\n");
+
+  submit(redis_cmd_set, {"set", "key", "\xff\xf0\x00"sv});
+  CHECK(submit(redis_cmd_bitpos, {"bitpos", "key", "0"}) == ":12\r\n");
+  submit(redis_cmd_set, {"set", "key", "\x00\xff\xf0"sv});
+  CHECK(submit(redis_cmd_bitpos, {"bitpos", "key", "1", "0"}) == ":8\r\n");
+  CHECK(submit(redis_cmd_bitpos, {"bitpos", "key", "1", "2"}) == ":16\r\n");
+  CHECK(submit(redis_cmd_bitpos, {"bitpos", "key", "1", "2", "-1",
+                                  "BYTE"}) == ":16\r\n");
+  CHECK(submit(redis_cmd_bitpos, {"bitpos", "key", "1", "7", "15", "BIT"}) ==
+        ":8\r\n");
+  CHECK(submit(redis_cmd_bitpos, {"bitpos", "key", "2"}) ==
+        "-ERR The bit argument must be 1 or 0.\r\n");
+
+  // with no end, the bits past the string count as clear
+  submit(redis_cmd_set, {"set", "key", "\xff\xff"sv});
+  CHECK(submit(redis_cmd_bitpos, {"bitpos", "key", "0"}) == ":16\r\n");
+  CHECK(submit(redis_cmd_bitpos, {"bitpos", "key", "0", "0", "-1"}) ==
+        ":-1\r\n");
+  CHECK(submit(redis_cmd_bitpos, {"bitpos", "missing", "0"}) == ":0\r\n");
+  CHECK(submit(redis_cmd_bitpos, {"bitpos", "missing", "1"}) == ":-1\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "bitop") {
+  using namespace std::literals;
+  submit(redis_cmd_set, {"set", "a", "\xf0"sv});
+  submit(redis_cmd_set, {"set", "b", "\x0f\xff"sv});
+  CHECK(submit(redis_cmd_bitop, {"bitop", "and", "dest", "a", "b"}) ==
+        ":2\r\n");
+  CHECK(submit(redis_cmd_get, {"get", "dest"}) == "$2\r\n\0\0\r\n"sv);
+  CHECK(submit(redis_cmd_bitop, {"bitop", "or", "dest", "a", "b"}) ==
+        ":2\r\n");
+  CHECK(submit(redis_cmd_get, {"get", "dest"}) == "$2\r\n\xff\xff\r\n");
+  CHECK(submit(redis_cmd_bitop, {"bitop", "xor", "dest", "a", "b", "b"}) ==
+        ":2\r\n");
+  CHECK(submit(redis_cmd_get, {"get", "dest"}) == "$2\r\n\xf0\0\r\n"sv);
+  CHECK(submit(redis_cmd_bitop, {"bitop", "not", "dest", "a"}) == ":1\r\n");
+  CHECK(submit(redis_cmd_get, {"get", "dest"}) == "$1\r\n\x0f\r\n");
+  CHECK(submit(redis_cmd_bitop, {"bitop", "not", "dest", "a", "b"}) ==
+        "-ERR BITOP NOT must be called with a single source key.\r\n");
+  CHECK(submit(redis_cmd_bitop, {"bitop", "nand", "dest", "a", "b"}) ==
+        "-ERR syntax error\r\n");
+
+  // an empty result deletes the destination
+  CHECK(submit(redis_cmd_bitop, {"bitop", "or", "dest", "missing"}) ==
+        ":0\r\n");
+  CHECK(submit(redis_cmd_exists, {"exists", "dest"}) == ":0\r\n");
+
+  // long enough for the vector kernels' main loops
+  const std::string odd(1 << 20, '\x55');
+  const std::string even(1 << 20, '\xaa');
+  submit(redis_cmd_set, {"set", "odd", odd});
+  submit(redis_cmd_set, {"set", "even", even});
+  submit(redis_cmd_setbit, {"setbit", "even", "9000000", "1"});
+  CHECK(submit(redis_cmd_bitop, {"bitop", "or", "dest", "odd", "even"}) ==
+        ":1125001\r\n");
+  CHECK(submit(redis_cmd_bitcount, {"bitcount", "dest"}) == ":8388609\r\n");
+  CHECK(submit(redis_cmd_bitop, {"bitop", "and", "dest", "odd", "even"}) ==
+        ":1125001\r\n");
+  CHECK(submit(redis_cmd_bitcount, {"bitcount", "dest"}) == ":0\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "bitop with an expired source") {
+  using namespace std::literals;
+  // erasing b, which expired, moves a, looked up before it, in the keyspace
+  submit(redis_cmd_set, {"set", "b", "\x0f"sv, "px", "1"});
+  submit(redis_cmd_set, {"set", "a", "\xf0"sv});
+  now_ += std::chrono::seconds(1);
+  CHECK(submit(redis_cmd_bitop, {"bitop", "or", "dest", "a", "b"}) ==
+        ":1\r\n");
+  CHECK(submit(redis_cmd_get, {"get", "dest"}) == "$1\r\n\xf0\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "bitfield") {
+  CHECK(submit(redis_cmd_bitfield, {"bitfield", "key", "INCRBY", "i5", "100",
+                                    "1", "GET", "u4", "0"}) ==
+        "*2\r\n:1\r\n:0\r\n");
+  CHECK(submit(redis_cmd_bitfield, {"bitfield", "key", "set", "u8", "#1",
+                                    "255", "get", "u8", "8", "get", "i8",
+                                    "8"}) == "*3\r\n:0\r\n:255\r\n:-1\r\n");
+
+  // u2 from 100 goes 0, 1, 2, 3, then wraps to 0 or saturates at 3
+  for (int i = 0; i < 3; ++i)
+    submit(redis_cmd_bitfield, {"bitfield", "key", "incrby", "u2", "102", "1"});
+  CHECK(submit(redis_cmd_bitfield,
+               {"bitfield", "key", "incrby", "u2", "102", "1", "overflow",
+                "sat", "incrby", "u2", "102", "-1", "incrby", "u2", "102",
+                "5", "overflow", "fail", "incrby", "u2", "102", "1"}) ==
+        "*4\r\n:0\r\n:0\r\n:3\r\n$-1\r\n");
+  CHECK(submit(redis_cmd_bitfield, {"bitfield", "key", "overflow", "wrap",
+                                    "set", "i8", "200", "200", "get", "i8",
+                                    "200"}) == "*2\r\n:0\r\n:-56\r\n");
+  CHECK(submit(redis_cmd_bitfield, {"bitfield", "key", "set", "i64", "300",
+                                    "-9223372036854775808", "incrby", "i64",
+                                    "300", "-1"}) ==
+        "*2\r\n:0\r\n:9223372036854775807\r\n");
+
+  CHECK(submit(redis_cmd_bitfield, {"bitfield", "key", "get", "u64", "0"}) ==
+        "-ERR Invalid bitfield type. Use something like i16 u8. Note that u64 "
+        "is not supported but i64 is.\r\n");
+  CHECK(submit(redis_cmd_bitfield,
+               {"bitfield", "key", "overflow", "maybe"}) ==
+        "-ERR Invalid OVERFLOW type specified\r\n");
+  CHECK(submit(redis_cmd_bitfield, {"bitfield", "key", "get", "u8"}) ==
+        "-ERR syntax error\r\n");
+  CHECK(submit(redis_cmd_bitfield, {"bitfield", "missing", "get", "u8",
+                                    "0"}) == "*1\r\n:0\r\n");
+  CHECK(submit(redis_cmd_exists, {"exists", "missing"}) == ":0\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "pfadd / pfcount / pfmerge") {
+  CHECK(submit(redis_cmd_pfadd, {"pfadd", "a", "x", "y", "z"}) == ":1\r\n");
+  CHECK(submit(redis_cmd_pfadd, {"pfadd", "a", "x"}) == ":0\r\n");
+  CHECK(submit(redis_cmd_pfcount, {"pfcount", "a"}) == ":3\r\n");
+  CHECK(submit(redis_cmd_pfadd, {"pfadd", "b"}) == ":1\r\n");
+  CHECK(submit(redis_cmd_pfadd, {"pfadd", "b", "z", "w"}) == ":1\r\n");
+  CHECK(submit(redis_cmd_pfcount, {"pfcount", "a", "b", "missing"}) ==
+        ":4\r\n");
+  CHECK(submit(redis_cmd_pfcount, {"pfcount", "missing"}) == ":0\r\n");
+
+  CHECK(submit(redis_cmd_pfmerge, {"pfmerge", "c", "a", "b"}) == "+OK\r\n");
+  CHECK(submit(redis_cmd_pfcount, {"pfcount", "c"}) == ":4\r\n");
+  CHECK(submit(redis_cmd_pfmerge, {"pfmerge", "c", "a"}) == "+OK\r\n");
+  CHECK(submit(redis_cmd_pfcount, {"pfcount", "c"}) == ":4\r\n");
+  CHECK(submit(redis_cmd_pfmerge, {"pfmerge", "empty"}) == "+OK\r\n");
+  CHECK(submit(redis_cmd_pfcount, {"pfcount", "empty"}) == ":0\r\n");
+
+  submit(redis_cmd_set, {"set", "string", "value"});
+  submit(redis_cmd_set, {"set", "number", "1"});
+  submit(redis_cmd_hset, {"hset", "hash", "field", "value"});
+  for (const auto key : {"string", "number"}) {
+    CHECK(submit(redis_cmd_pfadd, {"pfadd", key, "x"}) ==
+          "-WRONGTYPE Key is not a valid HyperLogLog string value.\r\n");
+    CHECK(submit(redis_cmd_pfcount, {"pfcount", key}) ==
+          "-WRONGTYPE Key is not a valid HyperLogLog string value.\r\n");
+    CHECK(submit(redis_cmd_pfmerge, {"pfmerge", "c", key}) ==
+          "-WRONGTYPE Key is not a valid HyperLogLog string value.\r\n");
+  }
+  CHECK(submit(redis_cmd_pfadd, {"pfadd", "hash", "x"}) ==
+        "-WRONGTYPE key refers to object of the wrong type\r\n");
+  CHECK(submit(redis_cmd_pfcount, {"pfcount", "a", "hash"}) ==
+        "-WRONGTYPE key refers to object of the wrong type\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "xadd / xlen") {
+  now_ += std::chrono::milliseconds(5);
+  CHECK(submit(redis_cmd_xadd, {"xadd", "s", "*", "a", "1"}) ==
+        "$3\r\n5-0\r\n");
+  CHECK(submit(redis_cmd_xadd, {"xadd", "s", "*", "a", "2"}) ==
+        "$3\r\n5-1\r\n");
+  CHECK(submit(redis_cmd_xadd, {"xadd", "s", "7-*", "a", "3"}) ==
+        "$3\r\n7-0\r\n");
+  CHECK(submit(redis_cmd_xadd, {"xadd", "s", "7", "a", "4"}) ==
+        "-ERR The ID specified in XADD is equal or smaller than the target "
+        "stream top item\r\n");
+  CHECK(submit(redis_cmd_xadd, {"xadd", "s", "7-5", "b", "5"}) ==
+        "$3\r\n7-5\r\n");
+  // the clock having gone back, * keeps to the last ID's time
+  CHECK(submit(redis_cmd_xadd, {"xadd", "s", "*", "a", "6"}) ==
+        "$3\r\n7-6\r\n");
+  CHECK(submit(redis_cmd_xlen, {"xlen", "s"}) == ":5\r\n");
+
+  CHECK(submit(redis_cmd_xadd, {"xadd", "s", "MAXLEN", "2", "8-0", "a", "7"}) ==
+        "$3\r\n8-0\r\n");
+  CHECK(submit(redis_cmd_xlen, {"xlen", "s"}) == ":2\r\n");
+  CHECK(submit(redis_cmd_xadd, {"xadd", "s", "maxlen", "~", "1", "9-0", "a",
+                                "8"}) == "$3\r\n9-0\r\n");
+  CHECK(submit(redis_cmd_xlen, {"xlen", "s"}) == ":3\r\n");
+
+  CHECK(submit(redis_cmd_xadd, {"xadd", "t", "NOMKSTREAM", "*", "a", "1"}) ==
+        "$-1\r\n");
+  CHECK(submit(redis_cmd_xlen, {"xlen", "t"}) == ":0\r\n");
+  CHECK(submit(redis_cmd_xadd, {"xadd", "t", "0-0", "a", "1"}) ==
+        "-ERR The ID specified in XADD must be greater than 0-0\r\n");
+  CHECK(submit(redis_cmd_xadd, {"xadd", "t", "1-x", "a", "1"}) ==
+        "-ERR Invalid stream ID specified as stream command argument\r\n");
+  CHECK(submit(redis_cmd_xadd, {"xadd", "t", "*", "a", "1", "b"}) ==
+        "-ERR wrong number of arguments for 'xadd' command\r\n");
+  CHECK(submit(redis_cmd_xadd, {"xadd", "t", "MAXLEN", "-1", "*", "a", "1"}) ==
+        "-ERR The MAXLEN argument must be >= 0.\r\n");
+  CHECK(submit(redis_cmd_xlen, {"xlen", "t"}) == ":0\r\n");
+
+  submit(redis_cmd_set, {"set", "string", "value"});
+  CHECK(submit(redis_cmd_xadd, {"xadd", "string", "*", "a", "1"}) ==
+        "-WRONGTYPE key refers to object of the wrong type\r\n");
+  CHECK(submit(redis_cmd_xlen, {"xlen", "string"}) ==
+        "-WRONGTYPE key refers to object of the wrong type\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "xrange / xrevrange") {
+  submit(redis_cmd_xadd, {"xadd", "s", "1-1", "a", "1"});
+  submit(redis_cmd_xadd, {"xadd", "s", "1-2", "a", "2", "b", "3"});
+  submit(redis_cmd_xadd, {"xadd", "s", "2-0", "c", "4"});
+
+  const std::string first = "*2\r\n$3\r\n1-1\r\n*2\r\n$1\r\na\r\n$1\r\n1\r\n";
+  const std::string second =
+      "*2\r\n$3\r\n1-2\r\n*4\r\n$1\r\na\r\n$1\r\n2\r\n$1\r\nb\r\n$1\r\n3\r\n";
+  const std::string third = "*2\r\n$3\r\n2-0\r\n*2\r\n$1\r\nc\r\n$1\r\n4\r\n";
+  CHECK(submit(redis_cmd_xrange, {"xrange", "s", "-", "+"}) ==
+        "*3\r\n" + first + second + third);
+  CHECK(submit(redis_cmd_xrange, {"xrange", "s", "1", "1"}) ==
+        "*2\r\n" + first + second);
+  CHECK(submit(redis_cmd_xrange, {"xrange", "s", "(1-1", "+", "COUNT", "1"}) ==
+        "*1\r\n" + second);
+  CHECK(submit(redis_cmd_xrange, {"xrange", "s", "-", "+", "count", "0"}) ==
+        "*-1\r\n");
+  CHECK(submit(redis_cmd_xrange, {"xrange", "s", "3", "+"}) == "*0\r\n");
+  CHECK(submit(redis_cmd_xrange, {"xrange", "missing", "-", "+"}) ==
+        "*0\r\n");
+  CHECK(submit(redis_cmd_xrevrange, {"xrevrange", "s", "+", "-"}) ==
+        "*3\r\n" + third + second + first);
+  CHECK(submit(redis_cmd_xrevrange, {"xrevrange", "s", "(2-0", "-", "COUNT",
+                                     "1"}) == "*1\r\n" + second);
+  CHECK(submit(redis_cmd_xrange, {"xrange", "s", "x", "+"}) ==
+        "-ERR Invalid stream ID specified as stream command argument\r\n");
+  CHECK(submit(redis_cmd_xrange, {"xrange", "s", "-", "+", "LIMIT", "1"}) ==
+        "-ERR syntax error\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "xread") {
+  submit(redis_cmd_xadd, {"xadd", "a", "1-1", "f", "1"});
+  submit(redis_cmd_xadd, {"xadd", "a", "1-2", "f", "2"});
+  submit(redis_cmd_xadd, {"xadd", "b", "3-0", "f", "3"});
+
+  const std::string a1 = "*2\r\n$3\r\n1-1\r\n*2\r\n$1\r\nf\r\n$1\r\n1\r\n";
+  const std::string a2 = "*2\r\n$3\r\n1-2\r\n*2\r\n$1\r\nf\r\n$1\r\n2\r\n";
+  const std::string b3 = "*2\r\n$3\r\n3-0\r\n*2\r\n$1\r\nf\r\n$1\r\n3\r\n";
+  CHECK(submit(redis_cmd_xread, {"xread", "STREAMS", "a", "b", "0", "0"}) ==
+        "*2\r\n*2\r\n$1\r\na\r\n*2\r\n" + a1 + a2 + "*2\r\n$1\r\nb\r\n*1\r\n" +
+            b3);
+  CHECK(submit(redis_cmd_xread, {"xread", "count", "1", "streams", "a",
+                                 "missing", "1-1", "0"}) ==
+        "*1\r\n*2\r\n$1\r\na\r\n*1\r\n" + a2);
+  CHECK(submit(redis_cmd_xread, {"xread", "STREAMS", "a", "b", "$", "$"}) ==
+        "*-1\r\n");
+  CHECK(submit(redis_cmd_xread, {"xread", "STREAMS", "a", "b", "0"}) ==
+        "-ERR Unbalanced 'xread' list of streams: for each stream key an ID "
+        "or '$' must be specified.\r\n");
+  CHECK(submit(redis_cmd_xread,
+               {"xread", "BLOCK", "0", "STREAMS", "a", "$"}) ==
+        "-ERR XREAD BLOCK is not supported\r\n");
+}
+
 TEST_CASE_METHOD(fixture, "save / load") {
   submit(redis_cmd_rpush, {"rpush", "list", "some", "list"});
+  submit(redis_cmd_hset, {"hset", "hash", "some", "hash"});
+  submit(redis_cmd_sadd, {"sadd", "set", "some", "set"});
+  submit(redis_cmd_zadd, {"zadd", "zset", "0.1", "some", "-inf", "zset"});
+  submit(redis_cmd_xadd, {"xadd", "stream", "1-1", "some", "stream"});
   submit(redis_cmd_set, {"set", "string", "some string"});
   CHECK(submit(redis_cmd_save, {"save"}) == "+OK\r\n");
   db_.clear();
@@ -138,4 +793,44 @@ TEST_CASE_METHOD(fixture, "save / load") {
   CHECK(submit(redis_cmd_get, {"get", "string"}) == "$11\r\nsome string\r\n");
   CHECK(submit(redis_cmd_lrange, {"lrange", "list", "0", "-1"}) ==
         "*2\r\n$4\r\nsome\r\n$4\r\nlist\r\n");
+  CHECK(submit(redis_cmd_hgetall, {"hgetall", "hash"}) ==
+        "*2\r\n$4\r\nsome\r\n$4\r\nhash\r\n");
+  CHECK(submit(redis_cmd_scard, {"scard", "set"}) == ":2\r\n");
+  CHECK(submit(redis_cmd_zrange, {"zrange", "zset", "0", "-1",
+                                  "withscores"}) ==
+        "*4\r\n$4\r\nzset\r\n$4\r\n-inf\r\n$4\r\nsome\r\n$3\r\n0.1\r\n");
+  CHECK(submit(redis_cmd_xrange, {"xrange", "stream", "-", "+"}) ==
+        "*1\r\n*2\r\n$3\r\n1-1\r\n*2\r\n$4\r\nsome\r\n$6\r\nstream\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "save / load expiry") {
+  submit(redis_cmd_rpush, {"rpush", "list", "some", "list"});
+  submit(redis_cmd_pexpire, {"pexpire", "list", "1000"});
+  submit(redis_cmd_set, {"set", "string", "some string", "PX", "2000"});
+  CHECK(submit(redis_cmd_save, {"save"}) == "+OK\r\n");
+  db_.clear();
+  CHECK(submit(redis_cmd_load, {"load"}) == "+OK\r\n");
+  CHECK(submit(redis_cmd_pttl, {"pttl", "list"}) == ":1000\r\n");
+  CHECK(submit(redis_cmd_pttl, {"pttl", "string"}) == ":2000\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "load commands") {
+  // the keyspace as it was saved before snapshots
+  stringbuf_.str("*3\r\n$3\r\nSET\r\n$6\r\nstring\r\n$4\r\nsome\r\n"
+                 "*4\r\n$5\r\nRPUSH\r\n$4\r\nlist\r\n$1\r\na\r\n"
+                 "$1\r\nb\r\n");
+  CHECK(submit(redis_cmd_load, {"load"}) == "+OK\r\n");
+  CHECK(submit(redis_cmd_get, {"get", "string"}) == "$4\r\nsome\r\n");
+  CHECK(submit(redis_cmd_lrange, {"lrange", "list", "0", "-1"}) ==
+        "*2\r\n$1\r\na\r\n$1\r\nb\r\n");
+}
+
+TEST_CASE_METHOD(fixture, "load corrupt snapshot") {
+  submit(redis_cmd_set, {"set", "string", "some string"});
+  CHECK(submit(redis_cmd_save, {"save"}) == "+OK\r\n");
+  auto bytes = stringbuf_.str();
+  bytes[bytes.size() / 2] ^= 1;
+  stringbuf_.str(bytes);
+  CHECK(submit(redis_cmd_load, {"load"}).starts_with("-ERR corrupt"));
+  CHECK(submit(redis_cmd_get, {"get", "string"}) == "$-1\r\n");
 }
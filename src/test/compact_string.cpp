@@ -0,0 +1,84 @@
+#include <catch2/catch_all.hpp>
+
+#include <compact_string.hpp>
+
+#include <string>
+#include <utility>
+
+namespace ns = redis;
+
+TEST_CASE("compact string size") {
+  CHECK(sizeof(ns::compact_string) == 16);
+}
+
+TEST_CASE("compact string inline or on the heap") {
+  const auto size = GENERATE(0, 1, 15, 16, 100);
+  const std::string s(std::size_t(size), 'x');
+  ns::compact_string str(s);
+  CHECK(str.is_inline() == (s.size() <= ns::compact_string::max_inline));
+  CHECK(str.size() == s.size());
+  CHECK(str == s);
+
+  const ns::compact_string copy(str);
+  CHECK(copy == s);
+  const ns::compact_string moved(std::move(str));
+  CHECK(moved == s);
+  CHECK(str.empty());
+}
+
+TEST_CASE("compact string assign") {
+  const auto from = GENERATE(0, 15, 16, 100);
+  const auto to = GENERATE(0, 15, 16, 100);
+  ns::compact_string str(std::string(std::size_t(from), 'a'));
+  const auto *const data = str.data();
+  str.assign(std::string(std::size_t(to), 'b'));
+  CHECK(str == std::string(std::size_t(to), 'b'));
+  // the same size on the heap reuses its characters
+  if (from == to && !str.is_inline())
+    CHECK(str.data() == data);
+}
+
+TEST_CASE("compact string assign from itself") {
+  ns::compact_string str(std::string(100, 'x') + "tail");
+  str.assign(str.view().substr(100));
+  CHECK(str == "tail");
+  str.assign(std::string(20, 'y'));
+  str.assign(str.view().substr(1));
+  CHECK(str == std::string(19, 'y'));
+}
+
+TEST_CASE("compact string copy and move assign") {
+  ns::compact_string a(std::string(20, 'a'));
+  ns::compact_string b("b");
+  b = a;
+  CHECK(b == a);
+  ns::compact_string c("c");
+  c = std::move(a);
+  CHECK(c == std::string(20, 'a'));
+  CHECK(a.empty());
+}
+
+TEST_CASE("compact string resize") {
+  const auto from = GENERATE(0, 15, 16, 100, 5000);
+  const auto to = GENERATE(0, 15, 16, 100, 5000);
+  ns::compact_string str(std::string(std::size_t(from), 'a'));
+  str.resize(std::size_t(to));
+  auto expected = std::string(std::size_t(from), 'a');
+  expected.resize(std::size_t(to));
+  CHECK(str == expected);
+}
+
+TEST_CASE("compact string grown a byte at a time") {
+  ns::compact_string str;
+  std::size_t moves = 0;
+  const char *data = str.data();
+  for (std::size_t size = 1; size <= 1 << 20; ++size) {
+    str.resize(size);
+    str.data()[size - 1] = 'x';
+    moves += str.data() != data;
+    data = str.data();
+  }
+  CHECK(str == std::string(1 << 20, 'x'));
+  // exact up to 4KB, and then in eighths of powers of two
+  CHECK(moves < 4096 + 8 * 8 + 2);
+}
@@ -2,6 +2,8 @@
 
 #include <chrono>
 #include <database.hpp>
+#include <string>
+#include <vector>
 
 namespace ns = redis;
 
@@ -10,7 +12,7 @@ TEST_CASE("set and get, no expiry") {
   dict.set("key", "value");
   auto result = dict.get_string("key", {});
   REQUIRE(!!result);
-  CHECK(result->get() == "value");
+  CHECK(*result == "value");
 }
 
 TEST_CASE("set and expired get") {
@@ -31,7 +33,7 @@ TEST_CASE("set and unexpired get") {
   dict.set("key", "value", later);
   auto result = dict.get_string("key", earlier);
   REQUIRE(!!result);
-  CHECK(result->get() == "value");
+  CHECK(*result == "value");
 }
 
 TEST_CASE("ex") {
@@ -55,3 +57,232 @@ TEST_CASE("pxat") {
   auto pxat = ns::database::pxat(42);
   CHECK(pxat.time_since_epoch().count() == 42);
 }
+
+TEST_CASE("expire any type") {
+  using namespace std::chrono_literals;
+  ns::database::time_point now(1s);
+  ns::database dict;
+  dict.create_list("list", now, {"a"});
+  dict.set("string", "value");
+
+  CHECK(dict.expire("list", now + 2s, now));
+  CHECK(dict.expire("string", now + 1s, now));
+  CHECK_FALSE(dict.expire("missing", now + 1s, now));
+  CHECK(dict.expiry("list", now) == now + 2s);
+  CHECK(dict.expiry("missing", now) == std::nullopt);
+
+  CHECK(dict.exists("string", now + 999ms));
+  CHECK_FALSE(dict.exists("string", now + 1s));
+  CHECK(!!dict.get_list("list", now + 1s));
+  CHECK(!dict.get_list("list", now + 2s));
+  CHECK(dict.expired_keys() == 2);
+}
+
+TEST_CASE("expire in the past deletes") {
+  using namespace std::chrono_literals;
+  ns::database::time_point now(1s);
+  ns::database dict;
+  dict.set("key", "value");
+  CHECK(dict.expire("key", now, now));
+  CHECK_FALSE(dict.exists("key", now));
+}
+
+TEST_CASE("stopped clock") {
+  using namespace std::chrono_literals;
+  ns::database::now_t clock(1h);
+  ns::database dict([&]() { return clock; });
+  dict.stop_clock(ns::database::now_t());
+  clock += 1h;
+  CHECK(dict.now() == ns::database::now_t());
+  dict.stop_clock({});
+  CHECK(dict.now() == clock);
+}
+
+TEST_CASE("persist") {
+  using namespace std::chrono_literals;
+  ns::database::time_point now(1s);
+  ns::database dict;
+  dict.set("key", "value", now + 1s);
+  CHECK(dict.expire("key", ns::database::never, now));
+  CHECK(dict.expiry("key", now) == ns::database::never);
+  CHECK(dict.active_expire(now + 1h, 1s));
+  CHECK(dict.exists("key", now + 1h));
+}
+
+TEST_CASE("set clears expiry") {
+  using namespace std::chrono_literals;
+  ns::database::time_point now(1s);
+  ns::database dict;
+  dict.set("key", "value", now + 1s);
+  dict.set("key", "value");
+  CHECK(dict.expiry("key", now) == ns::database::never);
+}
+
+TEST_CASE("active expire") {
+  using namespace std::chrono_literals;
+  const ns::database::time_point start(1700000000s);
+  ns::database dict([&]() { return start; });
+
+  for (int i = 0; i < 1000; ++i)
+    dict.set(std::to_string(i), "value",
+             start + std::chrono::milliseconds(1 + i % 100));
+  dict.set("persistent", "value");
+  // put back, brought forward and extended
+  dict.set("later", "value", start + 10ms);
+  dict.expire("later", start + 1h, start);
+  dict.set("sooner", "value", start + 1h);
+  dict.expire("sooner", start + 10ms, start);
+
+  CHECK(dict.active_expire(start + 50ms, 1s));
+  CHECK(dict.expired_keys() == 501);
+  CHECK_FALSE(dict.exists("sooner", start));
+  CHECK(dict.exists("later", start));
+
+  CHECK(dict.active_expire(start + 1min, 1s));
+  CHECK(dict.expired_keys() == 1001);
+  CHECK(dict.exists("later", start));
+  CHECK(dict.exists("persistent", start));
+
+  CHECK(dict.active_expire(start + 2h, 1s));
+  CHECK(dict.expired_keys() == 1002);
+  CHECK_FALSE(dict.exists("later", start));
+  CHECK(dict.exists("persistent", start));
+}
+
+TEST_CASE("active expire within its budget") {
+  using namespace std::chrono_literals;
+  const ns::database::time_point start(1700000000s);
+  ns::database dict([&]() { return start; });
+  for (int i = 0; i < 1000; ++i)
+    dict.set(std::to_string(i), "value", start + 1ms);
+
+  CHECK_FALSE(dict.active_expire(start + 1s, 0us));
+  CHECK(dict.expired_keys() == 32);
+  CHECK(dict.active_expire(start + 1s, 1s));
+  CHECK(dict.expired_keys() == 1000);
+}
+
+namespace {
+
+// room for 100 keys, of which the first 10 are hot when more are added
+void evict_cold_keys(ns::eviction_policy policy) {
+  using namespace std::chrono_literals;
+  auto now = ns::database::time_point(1700000000s);
+  ns::database dict([&]() { return now; });
+  dict.limit_memory(100, policy, [&]() { return dict.size(); });
+
+  for (int i = 0; i < 100; ++i) {
+    REQUIRE(dict.evict());
+    dict.set(std::to_string(i), "value");
+  }
+  now += 10s;
+  for (int i = 0; i < 10; ++i) {
+    for (int j = 0; j < 100; ++j)
+      CHECK(dict.get_string(std::to_string(i), now));
+  }
+  now += 10s;
+  for (int i = 100; i < 120; ++i) {
+    dict.set(std::to_string(i), "value");
+    REQUIRE(dict.evict());
+  }
+
+  CHECK(dict.evicted_keys() == 20);
+  CHECK(dict.size() == 100);
+  for (int i = 0; i < 10; ++i)
+    CHECK(dict.exists(std::to_string(i), now));
+}
+
+} // namespace
+
+TEST_CASE("evict least recently used") {
+  evict_cold_keys(ns::eviction_policy::allkeys_lru);
+}
+
+TEST_CASE("evict least frequently used") {
+  evict_cold_keys(ns::eviction_policy::allkeys_lfu);
+}
+
+TEST_CASE("evict soonest to expire") {
+  using namespace std::chrono_literals;
+  const ns::database::time_point now(1700000000s);
+  ns::database dict([&]() { return now; });
+  dict.limit_memory(100, ns::eviction_policy::volatile_ttl,
+                    [&]() { return dict.size(); });
+
+  for (int i = 0; i < 90; ++i)
+    dict.set(std::to_string(i), "value");
+  for (int i = 90; i < 100; ++i)
+    dict.set(std::to_string(i), "value", now + std::chrono::hours(i));
+  for (int i = 100; i < 105; ++i) {
+    dict.set(std::to_string(i), "value");
+    REQUIRE(dict.evict());
+  }
+  CHECK(dict.evicted_keys() == 5);
+  for (int i = 0; i < 90; ++i)
+    CHECK(dict.exists(std::to_string(i), now));
+
+  std::vector<std::string> evicted;
+  dict.on_evict([&](std::string_view key) {
+    CHECK(dict.exists(key, now));
+    evicted.emplace_back(key);
+  });
+  dict.set("105", "value");
+  REQUIRE(dict.evict());
+  REQUIRE(evicted.size() == 1);
+  CHECK(std::stoi(evicted[0]) >= 90);
+  CHECK_FALSE(dict.exists(evicted[0], now));
+
+  // only keys with an expiry can go
+  for (int i = 106; i < 111; ++i)
+    dict.set(std::to_string(i), "value");
+  CHECK_FALSE(dict.evict());
+  CHECK(dict.size() == 101);
+  for (int i = 0; i < 90; ++i)
+    CHECK(dict.exists(std::to_string(i), now));
+}
+
+TEST_CASE("no eviction") {
+  ns::database dict;
+  dict.limit_memory(1, ns::eviction_policy::noeviction,
+                    [&]() { return dict.size(); });
+  CHECK(dict.evict());
+  dict.set("a", "value");
+  CHECK(dict.evict());
+  dict.set("b", "value");
+  CHECK_FALSE(dict.evict());
+  CHECK(dict.size() == 2);
+  CHECK(dict.evicted_keys() == 0);
+}
+
+TEST_CASE("integers are held as such") {
+  ns::database dict;
+  dict.set("int", "-42");
+  dict.set("string", "042");
+  auto [value, inserted] = dict.upsert("int", {}, std::int64_t());
+  CHECK_FALSE(inserted);
+  CHECK(std::get<std::int64_t>(value) == -42);
+  CHECK(std::holds_alternative<ns::compact_string>(
+      dict.upsert("string", {}, std::int64_t()).first));
+  CHECK(*dict.get_string("int", {}) == "-42");
+  CHECK(*dict.get_string("string", {}) == "042");
+}
+
+TEST_CASE("upsert") {
+  using namespace std::chrono_literals;
+  const ns::database::time_point now(1700000000s);
+  ns::database dict([&]() { return now; });
+
+  auto [value, inserted] = dict.upsert("key", now, std::int64_t(1));
+  CHECK(inserted);
+  CHECK(std::get<std::int64_t>(value) == 1);
+  value = std::int64_t(2);
+  CHECK(*dict.get_string("key", now) == "2");
+
+  // an expired key is as good as missing
+  dict.expire("key", now + 1s, now);
+  auto [expired, reinserted] = dict.upsert("key", now + 1s, std::int64_t(3));
+  CHECK(reinserted);
+  CHECK(std::get<std::int64_t>(expired) == 3);
+  CHECK(dict.expiry("key", now + 1s) == ns::database::never);
+  CHECK(dict.expired_keys() == 1);
+}
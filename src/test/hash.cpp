@@ -0,0 +1,136 @@
+#include <catch2/catch_all.hpp>
+
+#include <hash.hpp>
+
+#include <map>
+#include <string>
+
+namespace ns = redis;
+
+namespace {
+
+std::map<std::string, std::string> fields(const ns::hash &hash) {
+  std::map<std::string, std::string> result;
+  hash.visit([&](std::string_view field, std::string_view value) {
+    CHECK(result.emplace(field, value).second);
+  });
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("hash empty") {
+  const ns::hash hash;
+  CHECK(hash.empty());
+  CHECK(hash.packed());
+  CHECK(!hash.get("a"));
+  CHECK(fields(hash).empty());
+}
+
+TEST_CASE("hash set, get and erase while packed") {
+  ns::hash hash{{"a", "1"}, {"b", "2"}, {"c", "3"}};
+  CHECK(hash.size() == 3);
+  CHECK(hash.get("b") == "2");
+
+  // values that grow, shrink and stay the same size
+  CHECK(!hash.set("a", std::string(8, 'x')));
+  CHECK(!hash.set("b", ""));
+  CHECK(!hash.set("c", "4"));
+  CHECK(hash.set("", "empty"));
+  CHECK(hash.packed());
+  CHECK(fields(hash) == std::map<std::string, std::string>{
+                            {"a", std::string(8, 'x')},
+                            {"b", ""},
+                            {"c", "4"},
+                            {"", "empty"},
+                        });
+
+  CHECK(hash.erase("b"));
+  CHECK(!hash.erase("b"));
+  CHECK(hash.erase(""));
+  CHECK(hash.size() == 2);
+  CHECK(!hash.get("b"));
+  CHECK(hash.get("c") == "4");
+}
+
+TEST_CASE("hash converts past max_packed_entries") {
+  ns::hash hash;
+  std::map<std::string, std::string> expected;
+  for (std::size_t i = 0; i < ns::hash::max_packed_entries; ++i) {
+    const auto field = std::to_string(i);
+    hash.set(field, field + "!");
+    expected.emplace(field, field + "!");
+  }
+  CHECK(hash.packed());
+  // updating a field that's there already doesn't add one
+  hash.set("0", "0!");
+  CHECK(hash.packed());
+
+  hash.set("new", "value");
+  expected.emplace("new", "value");
+  CHECK(!hash.packed());
+  CHECK(hash.size() == expected.size());
+  CHECK(fields(hash) == expected);
+
+  // and stays converted
+  for (std::size_t i = 0; i < ns::hash::max_packed_entries; ++i)
+    CHECK(hash.erase(std::to_string(i)));
+  CHECK(!hash.packed());
+  CHECK(hash.get("new") == "value");
+}
+
+TEST_CASE("hash converts for a long field or value") {
+  ns::hash by_field{{"a", "1"}};
+  by_field.set(std::string(ns::hash::max_packed_value + 1, 'f'), "2");
+  CHECK(!by_field.packed());
+  CHECK(by_field.get("a") == "1");
+
+  ns::hash by_value{{"a", "1"}};
+  by_value.set("a", std::string(ns::hash::max_packed_value, 'v'));
+  CHECK(by_value.packed());
+  by_value.set("a", std::string(ns::hash::max_packed_value + 1, 'v'));
+  CHECK(!by_value.packed());
+  CHECK(by_value.get("a") == std::string(ns::hash::max_packed_value + 1, 'v'));
+}
+
+TEST_CASE("hash scan") {
+  ns::hash hash;
+  std::map<std::string, std::string> expected;
+  for (std::size_t i = 0; i < 1000; ++i) {
+    hash.set("field" + std::to_string(i), std::to_string(i));
+    expected.emplace("field" + std::to_string(i), std::to_string(i));
+  }
+
+  std::map<std::string, std::string> seen;
+  std::uint64_t cursor = 0;
+  std::size_t calls = 0;
+  bool erased = false;
+  do {
+    cursor = hash.scan(cursor, 10, [&](auto field, auto value) {
+      seen.emplace(field, value);
+    });
+    ++calls;
+    // erasing and inserting between calls doesn't hide any of the others
+    if (!erased && seen.size() > 500) {
+      for (std::size_t i = 0; i < 1000; i += 7) {
+        const auto field = "field" + std::to_string(i);
+        if (!seen.contains(field)) {
+          hash.erase(field);
+          expected.erase(field);
+        }
+      }
+      hash.set("late", "arrival");
+      erased = true;
+    }
+  } while (cursor);
+  CHECK(calls > 50);
+  seen.erase("late");
+  CHECK(seen == expected);
+}
+
+TEST_CASE("hash scan while packed") {
+  const ns::hash hash{{"a", "1"}, {"b", "2"}};
+  std::size_t visited = 0;
+  CHECK(hash.scan(0, 1, [&](auto, auto) { ++visited; }) == 0);
+  CHECK(visited == 2);
+}
@@ -0,0 +1,126 @@
+#include <catch2/catch_all.hpp>
+
+#include <hyperloglog.hpp>
+
+#include <cstdlib>
+#include <string>
+
+namespace ns = redis::hyperloglog;
+
+namespace {
+
+// add the elements "prefix0" up to but not including "prefix<n>"
+void add_range(redis::compact_string &hll, std::string_view prefix,
+               std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i)
+    ns::add(hll, std::string(prefix) + std::to_string(i));
+}
+
+} // namespace
+
+TEST_CASE("hyperloglog starts empty and sparse") {
+  auto hll = ns::create();
+  CHECK(ns::valid(hll.view()));
+  CHECK(!ns::dense(hll.view()));
+  CHECK(ns::count(hll) == 0);
+
+  CHECK(ns::add(hll, "a"));
+  CHECK(!ns::add(hll, "a"));
+  CHECK(ns::valid(hll.view()));
+  CHECK(ns::count(hll) == 1);
+  CHECK(ns::add(hll, "b"));
+  CHECK(ns::count(hll) == 2);
+}
+
+TEST_CASE("hyperloglog counts within a few percent") {
+  auto hll = ns::create();
+  std::size_t added = 0;
+  for (const std::size_t n : {10, 100, 1000, 10000, 100000, 1000000}) {
+    for (; added < n; ++added)
+      ns::add(hll, "user:" + std::to_string(added));
+    REQUIRE(ns::valid(hll.view()));
+    INFO(n << (ns::dense(hll.view()) ? " dense" : " sparse"));
+    const auto estimate = double(ns::count(hll));
+    CHECK(std::abs(estimate - double(n)) <= std::max(1.0, 0.03 * double(n)));
+  }
+  CHECK(ns::dense(hll.view()));
+}
+
+TEST_CASE("hyperloglog converts to dense past sparse_max_bytes") {
+  auto hll = ns::create();
+  std::size_t n = 0;
+  while (!ns::dense(hll.view())) {
+    CHECK(hll.size() <= ns::sparse_max_bytes);
+    ns::add(hll, std::to_string(n++));
+  }
+  CHECK(ns::valid(hll.view()));
+  // roughly a thousand elements fit, as in Redis
+  CHECK(n > 500);
+  CHECK(n < 3000);
+
+  // the registers survive the conversion
+  auto sparse = ns::create();
+  add_range(sparse, "", n - 1);
+  ns::registers_t registers{};
+  ns::merge(registers, sparse.view());
+  auto dense = ns::from_registers(registers);
+  CHECK(ns::count(dense) == ns::count(sparse));
+  CHECK(ns::count(registers) == ns::count(sparse));
+}
+
+TEST_CASE("hyperloglog caches its count until it changes") {
+  auto hll = ns::create();
+  add_range(hll, "x", 5000);
+  const auto count = ns::count(hll);
+  CHECK(ns::count(hll) == count);
+  std::size_t i = 0;
+  while (!ns::add(hll, "y" + std::to_string(i)))
+    ++i;
+  ns::registers_t registers{};
+  ns::merge(registers, hll.view());
+  CHECK(ns::count(hll) == ns::count(registers));
+}
+
+TEST_CASE("hyperloglog merge counts the union") {
+  auto a = ns::create();
+  auto b = ns::create();
+  add_range(a, "", 30000);
+  add_range(b, "", 20000);
+  add_range(b, "b", 10000);
+  ns::registers_t registers{};
+  ns::merge(registers, a.view());
+  ns::merge(registers, b.view());
+  CHECK(std::abs(double(ns::count(registers)) - 40000) <= 0.03 * 40000);
+
+  // merging a sparse counter in
+  auto small = ns::create();
+  add_range(small, "small", 100);
+  ns::merge(registers, small.view());
+  auto merged = ns::from_registers(registers);
+  CHECK(ns::valid(merged.view()));
+  CHECK(std::abs(double(ns::count(merged)) - 40100) <= 0.03 * 40100);
+}
+
+TEST_CASE("hyperloglog validity") {
+  CHECK(!ns::valid(""));
+  CHECK(!ns::valid("HYLL"));
+  CHECK(!ns::valid("not a hyperloglog"));
+  auto hll = ns::create();
+  std::string s(hll.view());
+  CHECK(ns::valid(s));
+  // a register missing, or too many
+  s.back() = '\xfe';
+  CHECK(!ns::valid(s));
+  s.back() = '\xff';
+  s += '\x00';
+  CHECK(!ns::valid(s));
+  // an XZERO opcode cut short
+  s.resize(s.size() - 2);
+  CHECK(!ns::valid(s));
+
+  ns::registers_t registers{};
+  std::string dense(ns::from_registers(registers).view());
+  CHECK(ns::valid(dense));
+  dense.pop_back();
+  CHECK(!ns::valid(dense));
+}
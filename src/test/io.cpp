@@ -2,9 +2,13 @@
 
 #include <io.hpp>
 
+#include <memory>
 #include <random>
+#include <string>
 #include <string_view>
 
+#include <sys/socket.h>
+
 namespace ns = redis::io;
 using namespace std::literals;
 
@@ -68,3 +72,108 @@ TEST_CASE_METHOD(ofstreambuf_fixture, "failure to write marks stream bad") {
   CHECK(os.bad());
   CHECK(!os.good());
 }
+
+TEST_CASE("shared output is written in order") {
+  std::array<int, 2> fds{};
+  ns::posix_call(::socketpair, AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0,
+                 fds.data());
+  ns::file_descriptor reader([&fds]() { return fds[0]; });
+  ns::ofstreambuf sb{ns::file_descriptor([&fds]() { return fds[1]; }), 1 << 12};
+  std::ostream os{&sb};
+
+  const auto small = std::make_shared<const std::string>("small");
+  const auto large = std::make_shared<const std::string>(
+      ns::ofstreambuf::min_shared, 'x');
+  std::string expected;
+  for (std::size_t i = 0; i < 1 << 12; ++i) {
+    os << i;
+    sb.share(i % 2 ? small : large);
+    expected += std::to_string(i) + (i % 2 ? *small : *large);
+  }
+  CHECK(sb.pending() > 0);
+  // large is queued, not copied
+  CHECK(large.use_count() > 1);
+
+  std::string output;
+  std::array<char, 1 << 16> buf{};
+  while (output.size() < expected.size()) {
+    const auto n = ::read(reader.value(), buf.data(), buf.size());
+    if (n > 0)
+      output.append(buf.data(), n);
+    os.flush();
+    REQUIRE(os.good());
+  }
+
+  CHECK(sb.pending() == 0);
+  CHECK(output == expected);
+  CHECK(large.use_count() == 1);
+}
+
+TEST_CASE("output is kept while the socket is full") {
+  std::array<int, 2> fds{};
+  ns::posix_call(::socketpair, AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0,
+                 fds.data());
+  ns::file_descriptor reader([&fds]() { return fds[0]; });
+  ns::ofstreambuf sb{ns::file_descriptor([&fds]() { return fds[1]; }), 1 << 12};
+  std::ostream os{&sb};
+
+  std::string input(1 << 22, '\0');
+  std::mt19937 prng(42);
+  std::uniform_int_distribution<unsigned char> dist(0, 255);
+  std::generate(input.begin(), input.end(), [&]() { return dist(prng); });
+
+  os.write(input.data(), std::streamsize(input.size()));
+  os.flush();
+  CHECK(os.good());
+  CHECK(sb.pending() > 0);
+
+  std::string output;
+  std::array<char, 1 << 16> buf{};
+  while (output.size() < input.size()) {
+    const auto n = ::read(reader.value(), buf.data(), buf.size());
+    if (n > 0)
+      output.append(buf.data(), n);
+    os.flush();
+    REQUIRE(os.good());
+  }
+
+  CHECK(sb.pending() == 0);
+  CHECK(output == input);
+}
+
+TEST_CASE_METHOD(ofstreambuf_fixture, "held output is written on release") {
+  sb.hold();
+  const std::string input(1 << 14, 'x');
+  os << input;
+  os.flush();
+  CHECK(os.good());
+  CHECK(sb.pending() == input.size());
+  CHECK(ns::posix_call(::lseek, fd.value(), 0, SEEK_END) == 0);
+
+  sb.release();
+  os.flush();
+  CHECK(sb.pending() == 0);
+  CHECK(ns::posix_call(::lseek, fd.value(), 0, SEEK_END) ==
+        ::off_t(input.size()));
+}
+
+TEST_CASE("mapped_istream") {
+  ns::file_descriptor fd{::memfd_create, "", 0};
+  const auto contents = "some bytes\nmore bytes"s;
+  REQUIRE(::write(fd.value(), contents.data(), contents.size()) ==
+          ssize_t(contents.size()));
+
+  ns::mapped_istream is("/proc/self/fd/" + std::to_string(fd.value()));
+  const auto *sb = dynamic_cast<ns::mapped_streambuf *>(is.rdbuf());
+  REQUIRE(sb);
+  CHECK(std::string_view(sb->bytes().data(), sb->bytes().size()) == contents);
+  std::string line;
+  CHECK(std::getline(is, line));
+  CHECK(line == "some bytes");
+  CHECK(std::getline(is, line));
+  CHECK(line == "more bytes");
+  CHECK_FALSE(std::getline(is, line));
+
+  ns::mapped_istream missing("no such file");
+  CHECK(missing.get() == std::char_traits<char>::eof());
+}
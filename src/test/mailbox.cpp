@@ -0,0 +1,59 @@
+#include "catch2/catch_all.hpp"
+
+#include <mailbox.hpp>
+
+#include <string>
+#include <thread>
+
+namespace ns = redis;
+
+TEST_CASE("mailbox capacity must be a power of two") {
+  CHECK_THROWS(ns::mailbox<int>(0));
+  CHECK_THROWS(ns::mailbox<int>(3));
+  CHECK(ns::mailbox<int>(4).capacity() == 4);
+}
+
+TEST_CASE("mailbox push and pop") {
+  ns::mailbox<std::string> mb(2);
+
+  CHECK(!mb.try_pop());
+  CHECK(mb.try_push("a"));
+  CHECK(mb.try_push("b"));
+
+  std::string c = "c";
+  CHECK(!mb.try_push(std::move(c)));
+  CHECK(c == "c");
+
+  CHECK(mb.try_pop() == "a");
+  CHECK(mb.try_push(std::move(c)));
+  CHECK(mb.try_pop() == "b");
+  CHECK(mb.try_pop() == "c");
+  CHECK(!mb.try_pop());
+}
+
+TEST_CASE("mailbox preserves order across threads") {
+  constexpr int count = 1 << 16;
+  ns::mailbox<int> mb(1 << 6);
+
+  std::thread producer([&]() {
+    for (int i = 0; i < count;) {
+      if (mb.try_push(int(i)))
+        ++i;
+      else
+        std::this_thread::yield();
+    }
+  });
+
+  int expected = 0;
+  bool in_order = true;
+  while (expected < count) {
+    if (auto value = mb.try_pop())
+      in_order &= *value == expected++;
+    else
+      std::this_thread::yield();
+  }
+
+  producer.join();
+  CHECK(in_order);
+  CHECK(!mb.try_pop());
+}
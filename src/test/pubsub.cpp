@@ -0,0 +1,140 @@
+#include <catch2/catch_all.hpp>
+
+#include "identity_handler.hpp"
+
+#include <pubsub.hpp>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ns = redis;
+
+namespace {
+
+class recorder : public ns::subscriber {
+public:
+  void deliver(const ns::pubsub::frame_t &frame) override {
+    frames.push_back(frame);
+  }
+
+  std::vector<std::string> received() const {
+    std::vector<std::string> result;
+    for (const auto &frame : frames)
+      result.push_back(*frame);
+    return result;
+  }
+
+  std::vector<ns::pubsub::frame_t> frames;
+};
+
+using names_t = std::vector<std::string_view>;
+
+std::string message(std::string_view channel, std::string_view message) {
+  return *ns::pubsub::message(channel, message);
+}
+
+} // namespace
+
+TEST_CASE("pubsub message frames") {
+  CHECK(message("news", "hello") ==
+        "*3\r\n$7\r\nmessage\r\n$4\r\nnews\r\n$5\r\nhello\r\n");
+  CHECK(message("", "") == "*3\r\n$7\r\nmessage\r\n$0\r\n\r\n$0\r\n\r\n");
+}
+
+TEST_CASE("pubsub subscribe and publish to channels") {
+  ns::pubsub pubsub;
+  recorder a, b;
+  ns::test::identity_handler output;
+  pubsub.subscribe(a, names_t{"news", "sport", "news"}, output);
+  CHECK(output.result_ == "*3\r\n$9\r\nsubscribe\r\n$4\r\nnews\r\n:1\r\n"
+                          "*3\r\n$9\r\nsubscribe\r\n$5\r\nsport\r\n:2\r\n"
+                          "*3\r\n$9\r\nsubscribe\r\n$4\r\nnews\r\n:2\r\n");
+  pubsub.subscribe(b, names_t{"news"}, output);
+  CHECK(pubsub.subscriptions(a) == 2);
+  CHECK(pubsub.subscriptions(b) == 1);
+
+  const auto frame = ns::pubsub::message("news", "hello");
+  CHECK(pubsub.publish(frame) == 2);
+  CHECK(pubsub.publish(ns::pubsub::message("sport", "goal")) == 1);
+  CHECK(pubsub.publish(ns::pubsub::message("weather", "rain")) == 0);
+
+  // every subscriber is handed the same frame
+  REQUIRE(a.frames.size() == 2);
+  REQUIRE(b.frames.size() == 1);
+  CHECK(a.frames[0] == frame);
+  CHECK(b.frames[0] == frame);
+  CHECK(a.received()[1] == message("sport", "goal"));
+
+  output.result_.clear();
+  pubsub.unsubscribe(a, names_t{"news", "weather"}, output);
+  CHECK(output.result_ ==
+        "*3\r\n$11\r\nunsubscribe\r\n$4\r\nnews\r\n:1\r\n"
+        "*3\r\n$11\r\nunsubscribe\r\n$7\r\nweather\r\n:1\r\n");
+  CHECK(pubsub.publish(frame) == 1);
+
+  output.result_.clear();
+  pubsub.unsubscribe(a, {}, output);
+  CHECK(output.result_ == "*3\r\n$11\r\nunsubscribe\r\n$5\r\nsport\r\n:0\r\n");
+  output.result_.clear();
+  pubsub.unsubscribe(a, {}, output);
+  CHECK(output.result_ == "*3\r\n$11\r\nunsubscribe\r\n$-1\r\n:0\r\n");
+  CHECK(pubsub.subscriptions(a) == 0);
+}
+
+TEST_CASE("pubsub patterns") {
+  ns::pubsub pubsub;
+  recorder a, b, c;
+  ns::test::identity_handler output;
+  pubsub.psubscribe(a, names_t{"news.*", "*"}, output);
+  pubsub.psubscribe(b, names_t{"news.*", "n?ws.[a-m]*"}, output);
+  pubsub.psubscribe(c, names_t{"news.sport", "weather\\*"}, output);
+  pubsub.subscribe(c, names_t{"news.art"}, output);
+  CHECK(pubsub.subscriptions(c) == 3);
+
+  // a channel gets one message for each pattern that matches it
+  CHECK(pubsub.publish(ns::pubsub::message("news.art", "x")) == 5);
+  // patterns are matched in order of the length of their literal prefixes
+  CHECK(a.received() ==
+        std::vector<std::string>{
+            "*4\r\n$8\r\npmessage\r\n$1\r\n*\r\n$8\r\nnews.art\r\n$1\r\nx\r\n",
+            "*4\r\n$8\r\npmessage\r\n$6\r\nnews.*\r\n$8\r\nnews.art\r\n$1\r\n"
+            "x\r\n",
+        });
+  CHECK(b.frames.size() == 2);
+  CHECK(c.received() == std::vector<std::string>{message("news.art", "x")});
+
+  CHECK(pubsub.publish(ns::pubsub::message("news.sport", "x")) == 4);
+  CHECK(pubsub.publish(ns::pubsub::message("news", "x")) == 1);
+  CHECK(pubsub.publish(ns::pubsub::message("nows.b", "x")) == 2);
+  CHECK(pubsub.publish(ns::pubsub::message("weather*", "x")) == 2);
+  CHECK(pubsub.publish(ns::pubsub::message("weathers", "x")) == 1);
+
+  output.result_.clear();
+  pubsub.punsubscribe(b, {}, output);
+  CHECK(output.result_.starts_with("*3\r\n$12\r\npunsubscribe\r\n"));
+  CHECK(pubsub.subscriptions(b) == 0);
+  CHECK(pubsub.publish(ns::pubsub::message("news.art", "x")) == 3);
+
+  output.result_.clear();
+  pubsub.punsubscribe(a, names_t{"*"}, output);
+  CHECK(output.result_ == "*3\r\n$12\r\npunsubscribe\r\n$1\r\n*\r\n:1\r\n");
+  CHECK(pubsub.publish(ns::pubsub::message("news.art", "x")) == 2);
+}
+
+TEST_CASE("pubsub unsubscribe all") {
+  ns::pubsub pubsub;
+  recorder a, b;
+  ns::test::identity_handler output;
+  pubsub.subscribe(a, names_t{"x", "y"}, output);
+  pubsub.psubscribe(a, names_t{"*", "x*"}, output);
+  pubsub.subscribe(b, names_t{"x"}, output);
+  pubsub.psubscribe(b, names_t{"x*"}, output);
+
+  pubsub.unsubscribe_all(a);
+  CHECK(pubsub.subscriptions(a) == 0);
+  CHECK(pubsub.publish(ns::pubsub::message("x", "m")) == 2);
+  CHECK(pubsub.publish(ns::pubsub::message("y", "m")) == 0);
+  CHECK(a.frames.empty());
+  CHECK(b.frames.size() == 2);
+}
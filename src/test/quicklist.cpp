@@ -0,0 +1,61 @@
+#include <catch2/catch_all.hpp>
+
+#include <quicklist.hpp>
+
+#include <deque>
+#include <string>
+#include <vector>
+
+namespace ns = redis;
+
+namespace {
+
+std::vector<std::string> elements(const ns::quicklist &list) {
+  return {list.begin(), list.end()};
+}
+
+} // namespace
+
+TEST_CASE("quicklist empty") {
+  const ns::quicklist list;
+  CHECK(list.empty());
+  CHECK(list.begin() == list.end());
+  CHECK(list.at(0) == list.end());
+}
+
+TEST_CASE("quicklist push at both ends") {
+  ns::quicklist list{"b", "c"};
+  list.push_front("a");
+  list.push_back("");
+  list.push_back("d");
+  CHECK(list.size() == 5);
+  CHECK(elements(list) == std::vector<std::string>{"a", "b", "c", "", "d"});
+}
+
+TEST_CASE("quicklist across many nodes") {
+  // against a deque, with elements of every length of varint
+  std::deque<std::string> expected;
+  ns::quicklist list;
+  for (std::size_t i = 0; i < 5000; ++i) {
+    const auto size = i % 7 == 0 ? 20000 : i % 3 == 0 ? 200 : i % 10;
+    std::string s(size, char('a' + i % 26));
+    if (i % 2) {
+      list.push_back(s);
+      expected.push_back(s);
+    } else {
+      list.push_front(s);
+      expected.push_front(s);
+    }
+  }
+
+  REQUIRE(list.size() == expected.size());
+  CHECK(elements(list) == std::vector<std::string>(expected.begin(),
+                                                   expected.end()));
+  for (std::size_t i = 0; i < expected.size(); i += 7) {
+    const auto it = list.at(i);
+    REQUIRE(it != list.end());
+    CHECK(*it == expected[i]);
+  }
+  CHECK(*list.at(expected.size() - 1) == expected.back());
+  CHECK(list.at(expected.size()) == list.end());
+}
@@ -4,6 +4,7 @@
 
 #include <resp.hpp>
 
+#include <sstream>
 #include <stack>
 #include <string>
 #include <vector>
@@ -150,3 +151,121 @@ TEST_CASE("writing resp") {
 
   CHECK(os.str() == "*2\r\n+OK\r\n:42\r\n-ERR\r\n");
 }
+
+namespace {
+// everything written to an ofstreambuf, via a memfd
+struct buffer_writer_fixture {
+  redis::io::file_descriptor fd{::memfd_create, "", 0};
+  redis::io::ofstreambuf sb{
+      redis::io::file_descriptor{::dup, fd.value()}, 1 << 12};
+  ns::buffer_writer writer{sb};
+
+  std::string written() {
+    sb.pubsync();
+    std::string result(::lseek(fd.value(), 0, SEEK_CUR), '\0');
+    ::pread(fd.value(), result.data(), result.size(), 0);
+    return result;
+  }
+};
+} // namespace
+
+TEST_CASE_METHOD(buffer_writer_fixture, "buffer_writer writes resp") {
+  auto chars = [&](std::string_view s) {
+    writer.chars(s.data(), s.data() + s.size());
+  };
+
+  writer.begin_array(2);
+  writer.begin_simple_string();
+  chars("OK");
+  writer.end_simple_string();
+  writer.begin_integer();
+  chars("42");
+  writer.end_integer();
+  writer.end_array();
+  writer.begin_error();
+  chars("ERR");
+  writer.end_error();
+  writer.begin_bulk_string(3);
+  chars("abc");
+  writer.end_bulk_string();
+  writer.begin_bulk_string(-1);
+  writer.end_bulk_string();
+
+  CHECK(written() == "*2\r\n+OK\r\n:42\r\n-ERR\r\n$3\r\nabc\r\n$-1\r\n");
+}
+
+TEST_CASE_METHOD(buffer_writer_fixture, "buffer_writer whole values") {
+  writer.simple_string("OK");
+  writer.error("ERR no");
+  writer.integer(0);
+  writer.integer(1023);
+  writer.integer(1024);
+  writer.integer(-5);
+  writer.bulk_string("");
+  writer.bulk_string("value");
+  writer.null_bulk_string();
+
+  CHECK(written() ==
+        "+OK\r\n-ERR no\r\n:0\r\n:1023\r\n:1024\r\n:-5\r\n$0\r\n\r\n"
+        "$5\r\nvalue\r\n$-1\r\n");
+}
+
+TEST_CASE_METHOD(buffer_writer_fixture,
+                 "buffer_writer matches writer beyond the buffer size") {
+  std::ostringstream os;
+  ns::writer expected(os);
+
+  for (auto *h : std::initializer_list<ns::handler *>{&writer, &expected}) {
+    for (std::size_t len : {10, 1000, 5000, 100000}) {
+      const std::string value(len, char('a' + len % 26));
+      h->bulk_string(value);
+      h->simple_string(value);
+      h->integer(std::int64_t(len));
+    }
+  }
+
+  CHECK(written() == os.str());
+}
+
+TEST_CASE("nested arrays") {
+  const auto s = "*3\r\n*2\r\n:1\r\n*0\r\n$-1\r\n*1\r\n+x\r\n"s;
+
+  // all at once, and a byte at a time
+  for (std::size_t step : {s.size(), std::size_t(1)}) {
+    redis::test::identity_handler h;
+    ns::basic_parser<redis::test::identity_handler> p(h);
+
+    std::string pending;
+    for (std::size_t i = 0; i < s.size(); i += step) {
+      pending += s.substr(i, step);
+      const char *const end =
+          p.parse(pending.data(), pending.data() + pending.size());
+      pending.erase(0, end - pending.data());
+    }
+
+    CHECK(pending.empty());
+    CHECK(h.result_ == s);
+    CHECK(h.stack_.empty());
+  }
+}
+
+TEST_CASE("arrays nested too deeply") {
+  redis::test::identity_handler h;
+  ns::parser p(h);
+
+  std::string s;
+  for (std::size_t i = 0; i <= ns::parser::max_depth; ++i)
+    s += "*1\r\n";
+
+  CHECK_THROWS_AS(p.parse(s.data(), s.data() + s.size()), ns::resp_error);
+}
+
+TEST_CASE("malformed input") {
+  const auto s = GENERATE(as<std::string>(), "$3\r\nabcde\r\n", "$-2\r\n",
+                          "*-2\r\n", "$x\r\n", "+a\rb\r\n", "*1\r\nGET k\r\n");
+
+  redis::test::identity_handler h;
+  ns::parser p(h);
+
+  CHECK_THROWS_AS(p.parse(s.data(), s.data() + s.size()), ns::resp_error);
+}
@@ -0,0 +1,95 @@
+#include <catch2/catch_all.hpp>
+
+#include <score_tree.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <random>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns = redis;
+
+namespace {
+
+using model_t = std::set<std::pair<double, std::string>>;
+
+// every entry of tree, in order, and that at() and rank() agree with it
+void check(const ns::score_tree &tree, const model_t &model) {
+  REQUIRE(tree.size() == model.size());
+  auto pos = tree.at(0);
+  std::size_t rank = 0;
+  for (const auto &[score, member] : model) {
+    REQUIRE(pos != tree.end());
+    CHECK(pos->score == score);
+    CHECK(pos->member.view() == member);
+    if (rank % 97 == 0) {
+      CHECK(tree.rank(score, member) == rank);
+      CHECK(tree.at(rank)->member.view() == member);
+    }
+    ++pos;
+    ++rank;
+  }
+  CHECK(pos == tree.end());
+}
+
+} // namespace
+
+TEST_CASE("score_tree empty") {
+  const ns::score_tree tree;
+  CHECK(tree.size() == 0);
+  CHECK(tree.at(0) == tree.end());
+  CHECK(tree.rank(1, "a") == 0);
+  CHECK(tree.count_below(1, true) == 0);
+}
+
+TEST_CASE("score_tree orders by score and then by member") {
+  ns::score_tree tree;
+  tree.insert(2, "a");
+  tree.insert(1, "b");
+  tree.insert(1, "a");
+  check(tree, {{1, "a"}, {1, "b"}, {2, "a"}});
+  CHECK(tree.count_below(1, false) == 0);
+  CHECK(tree.count_below(1, true) == 2);
+  CHECK(tree.count_below(1.5, false) == 2);
+  CHECK(tree.count_below(2, true) == 3);
+}
+
+TEST_CASE("score_tree splits and merges nodes") {
+  ns::score_tree tree;
+  model_t model;
+  std::mt19937_64 prng(42);
+  // several levels deep, with many scores tied
+  for (int i = 0; i < 100000; ++i) {
+    const double score = double(prng() % 1000);
+    auto member = std::to_string(prng() % 1000000);
+    if (model.emplace(score, member).second)
+      tree.insert(score, member);
+  }
+  check(tree, model);
+
+  const auto below = [&](double score, bool inclusive) {
+    return std::size_t(std::distance(
+        model.begin(), inclusive ? model.upper_bound({score, "\xff"})
+                                 : model.lower_bound({score, ""})));
+  };
+  for (const double score : {-1.0, 0.0, 0.5, 500.0, 999.0, 1000.0}) {
+    CHECK(tree.count_below(score, false) == below(score, false));
+    CHECK(tree.count_below(score, true) == below(score, true));
+  }
+
+  // erase most of it, in random order, so that nodes borrow and merge
+  // until the tree is a leaf again
+  std::vector<model_t::value_type> entries(model.begin(), model.end());
+  std::shuffle(entries.begin(), entries.end(), prng);
+  for (std::size_t i = 0; i < entries.size(); ++i) {
+    tree.erase(entries[i].first, entries[i].second);
+    model.erase(entries[i]);
+    if (i % 20000 == 0 || model.size() < 100)
+      check(tree, model);
+  }
+  CHECK(tree.size() == 0);
+  CHECK(tree.at(0) == tree.end());
+}
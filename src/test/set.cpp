@@ -0,0 +1,172 @@
+#include <catch2/catch_all.hpp>
+
+#include <set.hpp>
+
+#include <algorithm>
+#include <random>
+#include <set>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace ns = redis;
+
+namespace {
+
+std::set<std::string> members(const ns::set &set) {
+  std::set<std::string> result;
+  set.visit([&](std::string_view member) {
+    CHECK(result.emplace(member).second);
+  });
+  return result;
+}
+
+std::vector<std::string> ordered_members(const ns::set &set) {
+  std::vector<std::string> result;
+  set.visit([&](std::string_view member) { result.emplace_back(member); });
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("set of integers") {
+  ns::set set{"3", "-1", "10", "3"};
+  CHECK(set.is_intset());
+  CHECK(set.size() == 3);
+  CHECK(ordered_members(set) == std::vector<std::string>{"-1", "3", "10"});
+  CHECK(set.contains("10"));
+  CHECK(!set.contains("4"));
+  // not how 10 is formatted, so not 10
+  CHECK(!set.contains("010"));
+  CHECK(!set.contains("x"));
+
+  CHECK(set.erase("3"));
+  CHECK(!set.erase("3"));
+  CHECK(!set.erase("x"));
+  CHECK(ordered_members(set) == std::vector<std::string>{"-1", "10"});
+}
+
+TEST_CASE("set converts for a member that isn't an integer") {
+  ns::set set{"1", "2"};
+  CHECK(set.insert("010"));
+  CHECK(!set.is_intset());
+  CHECK(members(set) == std::set<std::string>{"1", "2", "010"});
+  CHECK(set.contains("2"));
+  CHECK(set.erase("1"));
+  CHECK(!set.contains("1"));
+}
+
+TEST_CASE("set converts past max_intset_entries") {
+  ns::set set(4);
+  for (int i = 0; i < 4; ++i)
+    CHECK(set.insert(std::to_string(i)));
+  CHECK(!set.insert("0"));
+  CHECK(set.is_intset());
+  CHECK(set.insert("4"));
+  CHECK(!set.is_intset());
+  CHECK(members(set) == std::set<std::string>{"0", "1", "2", "3", "4"});
+}
+
+TEST_CASE("set batch insert") {
+  ns::set set;
+  const std::vector<std::string_view> batch{"5", "1", "5", "3"};
+  CHECK(set.insert(batch) == 3);
+  const std::vector<std::string_view> more{"2", "3", "4"};
+  CHECK(set.insert(more) == 2);
+  CHECK(set.is_intset());
+  CHECK(ordered_members(set) ==
+        std::vector<std::string>{"1", "2", "3", "4", "5"});
+
+  const std::vector<std::string_view> mixed{"6", "x", "1"};
+  CHECK(set.insert(mixed) == 2);
+  CHECK(!set.is_intset());
+  CHECK(set.size() == 7);
+
+  // too many to stay an intset
+  ns::set small(2);
+  CHECK(small.insert(batch) == 3);
+  CHECK(!small.is_intset());
+}
+
+TEST_CASE("set algebra") {
+  const ns::set a{"1", "2", "3", "4"};
+  const ns::set b{"3", "4", "5"};
+  const ns::set c{"4", "5", "x"};
+  using sets = std::vector<const ns::set *>;
+
+  // intsets are merged, and the others looked up
+  auto result = ns::set::intersect(sets{&a, &b}, 512);
+  CHECK(result.is_intset());
+  CHECK(ordered_members(result) == std::vector<std::string>{"3", "4"});
+  result = ns::set::intersect(sets{&a, &b, &c}, 512);
+  CHECK(members(result) == std::set<std::string>{"4"});
+
+  result = ns::set::unite(sets{&a, &b}, 512);
+  CHECK(result.is_intset());
+  CHECK(ordered_members(result) ==
+        std::vector<std::string>{"1", "2", "3", "4", "5"});
+  result = ns::set::unite(sets{&a, &c}, 512);
+  CHECK(!result.is_intset());
+  CHECK(members(result) ==
+        std::set<std::string>{"1", "2", "3", "4", "5", "x"});
+  // a union too big to be an intset
+  result = ns::set::unite(sets{&a, &b}, 3);
+  CHECK(!result.is_intset());
+  CHECK(result.size() == 5);
+
+  result = ns::set::subtract(a, sets{&b}, 512);
+  CHECK(result.is_intset());
+  CHECK(ordered_members(result) == std::vector<std::string>{"1", "2"});
+  result = ns::set::subtract(a, sets{&c}, 512);
+  CHECK(members(result) == std::set<std::string>{"1", "2", "3"});
+  result = ns::set::subtract(c, sets{&a, &b}, 512);
+  CHECK(members(result) == std::set<std::string>{"x"});
+  CHECK(ns::set::subtract(a, sets{}, 512).size() == 4);
+}
+
+TEST_CASE("set algebra of large intsets") {
+  // big enough for the SIMD merges, and for very different sizes to be
+  // searched rather than merged
+  std::mt19937_64 prng(42);
+  const auto random_set = [&](std::size_t size) {
+    ns::set result(1 << 20);
+    std::vector<std::string> members;
+    for (std::size_t i = 0; i < size; ++i)
+      members.push_back(std::to_string(prng() % 100000));
+    const std::vector<std::string_view> views(members.begin(), members.end());
+    result.insert(views);
+    return result;
+  };
+  const auto ints = [](const ns::set &set) {
+    std::vector<std::int64_t> result;
+    set.visit([&](std::string_view member) {
+      result.push_back(std::stoll(std::string(member)));
+    });
+    return result;
+  };
+
+  for (const auto &[a_size, b_size] : {std::pair(20000, 30000),
+                                       std::pair(100, 50000)}) {
+    const auto a = random_set(std::size_t(a_size));
+    const auto b = random_set(std::size_t(b_size));
+    const auto a_ints = ints(a);
+    const auto b_ints = ints(b);
+    const std::vector<const ns::set *> both{&a, &b};
+
+    std::vector<std::int64_t> expected;
+    std::set_intersection(a_ints.begin(), a_ints.end(), b_ints.begin(),
+                          b_ints.end(), std::back_inserter(expected));
+    CHECK(ints(ns::set::intersect(both, 1 << 20)) == expected);
+
+    expected.clear();
+    std::set_union(a_ints.begin(), a_ints.end(), b_ints.begin(),
+                   b_ints.end(), std::back_inserter(expected));
+    CHECK(ints(ns::set::unite(both, 1 << 20)) == expected);
+
+    expected.clear();
+    std::set_difference(a_ints.begin(), a_ints.end(), b_ints.begin(),
+                        b_ints.end(), std::back_inserter(expected));
+    CHECK(ints(ns::set::subtract(a, std::span(both).subspan(1), 1 << 20)) ==
+          expected);
+  }
+}
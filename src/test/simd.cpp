@@ -0,0 +1,270 @@
+#include <catch2/catch_all.hpp>
+
+#include <simd.hpp>
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace ns = redis::simd;
+
+namespace {
+
+// switches to an implementation for the duration of a test
+class use_isa {
+public:
+  explicit use_isa(ns::isa i) : previous_(ns::current()) { ns::use(i); }
+  use_isa(const use_isa &) = delete;
+  use_isa &operator=(const use_isa &) = delete;
+  ~use_isa() { ns::use(previous_); }
+
+private:
+  const ns::isa previous_;
+};
+
+bool is_space(unsigned char c) { return ::isspace(c); }
+
+const char *find_crlf(const char *begin, const char *end) {
+  const std::string_view crlf = "\r\n";
+  return std::search(begin, end, crlf.begin(), crlf.end());
+}
+
+} // namespace
+
+TEST_CASE("scanning matches the standard algorithms") {
+  const auto isa = GENERATE(ns::isa::scalar, ns::isa::sse2, ns::isa::avx2);
+  if (!ns::supported(isa))
+    SKIP("not supported on this CPU");
+  use_isa scope(isa);
+
+  std::mt19937 prng(42);
+  // mostly letters, so that the delimiters are sparse enough to need a few
+  // vectors' worth of scanning
+  std::uniform_int_distribution<int> dist(0, 40);
+  const std::string alphabet = "\r\n \t\v\f";
+
+  for (std::size_t len = 0; len < 200; ++len) {
+    std::string s(len, '\0');
+    std::generate(s.begin(), s.end(), [&]() {
+      const auto i = std::size_t(dist(prng));
+      return i < alphabet.size() ? alphabet[i] : char('a' + i % 26);
+    });
+
+    for (std::size_t offset = 0; offset < std::min(len, std::size_t(40));
+         ++offset) {
+      const char *const begin = s.data() + offset;
+      const char *const end = s.data() + s.size();
+      INFO("\"" << s << "\" from " << offset);
+      CHECK(ns::find_crlf(begin, end) == find_crlf(begin, end));
+      CHECK(ns::find(begin, end, '\n') == std::find(begin, end, '\n'));
+      CHECK(ns::find_space(begin, end) == std::find_if(begin, end, is_space));
+      CHECK(ns::find_non_space(begin, end) ==
+            std::find_if_not(begin, end, is_space));
+    }
+  }
+}
+
+TEST_CASE("scanning high bytes") {
+  const auto isa = GENERATE(ns::isa::scalar, ns::isa::sse2, ns::isa::avx2);
+  if (!ns::supported(isa))
+    SKIP("not supported on this CPU");
+  use_isa scope(isa);
+
+  // bytes that are whitespace once their top bit is ignored, or wrap around
+  // when '\t' is subtracted
+  std::string s;
+  for (int c = 128; c < 256; ++c)
+    s += char(c);
+  s += "\x01\x08\x0e\x1f!";
+  s += " ";
+
+  CHECK(ns::find_space(s.data(), s.data() + s.size()) ==
+        s.data() + s.size() - 1);
+  CHECK(ns::find_crlf(s.data(), s.data() + s.size()) == s.data() + s.size());
+}
+
+TEST_CASE("bitmap functions match the standard algorithms") {
+  const auto isa = GENERATE(ns::isa::scalar, ns::isa::sse2, ns::isa::avx2);
+  if (!ns::supported(isa))
+    SKIP("not supported on this CPU");
+  use_isa scope(isa);
+
+  std::mt19937 prng(42);
+  const auto random_bytes = [&](std::size_t len) {
+    std::string result(len, '\0');
+    std::generate(result.begin(), result.end(),
+                  [&]() { return char(prng()); });
+    return result;
+  };
+  const auto popcount = [](std::string_view s) {
+    std::uint64_t result = 0;
+    for (const auto c : s)
+      result += unsigned(std::popcount(static_cast<unsigned char>(c)));
+    return result;
+  };
+
+  // long enough for a few of the AVX2 popcount's 31 block runs
+  for (const std::size_t len : {0, 1, 7, 8, 31, 32, 33, 100, 993, 3000}) {
+    const auto a = random_bytes(len);
+    const auto b = random_bytes(len);
+    for (std::size_t offset = 0; offset < std::min(len, std::size_t(9));
+         ++offset) {
+      const auto s = std::string_view(a).substr(offset);
+      INFO(len << " from " << offset);
+      CHECK(ns::popcount(s.data(), s.data() + s.size()) == popcount(s));
+    }
+
+    auto result = a;
+    ns::bitwise_and(result.data(), b.data(), len);
+    for (std::size_t i = 0; i < len; ++i)
+      CHECK(result[i] == char(a[i] & b[i]));
+    result = a;
+    ns::bitwise_or(result.data(), b.data(), len);
+    for (std::size_t i = 0; i < len; ++i)
+      CHECK(result[i] == char(a[i] | b[i]));
+    result = a;
+    ns::bitwise_xor(result.data(), b.data(), len);
+    for (std::size_t i = 0; i < len; ++i)
+      CHECK(result[i] == char(a[i] ^ b[i]));
+
+    // a run of zeros or ones, broken at each position in turn
+    for (const char c : {'\0', '\xff'}) {
+      std::string run(len, c);
+      CHECK(ns::find_not(run.data(), run.data() + len, c) == run.data() + len);
+      for (std::size_t i = 0; i < len; i += 7) {
+        run[i] = char(c ^ 0x10);
+        CHECK(ns::find_not(run.data(), run.data() + len, c) == run.data() + i);
+        run[i] = c;
+      }
+    }
+  }
+}
+
+TEST_CASE("HyperLogLog functions match the standard algorithms") {
+  const auto isa = GENERATE(ns::isa::scalar, ns::isa::sse2, ns::isa::avx2);
+  if (!ns::supported(isa))
+    SKIP("not supported on this CPU");
+  use_isa scope(isa);
+
+  std::mt19937 prng(42);
+  const auto random_registers = [&](std::size_t len) {
+    std::vector<std::uint8_t> result(len);
+    std::generate(result.begin(), result.end(),
+                  [&]() { return std::uint8_t(prng() % 64); });
+    return result;
+  };
+
+  for (const std::size_t len : {0, 4, 12, 16, 20, 36, 40, 44, 100, 16384}) {
+    INFO(len);
+    const auto a = random_registers(len);
+    const auto b = random_registers(len);
+    // packed 6 bits each, least significant first, as the dense encoding is
+    std::vector<std::uint8_t> packed(len * 6 / 8);
+    for (std::size_t i = 0; i < len; ++i) {
+      for (unsigned bit = 0; bit < 6; ++bit) {
+        if (b[i] >> bit & 1)
+          packed[(i * 6 + bit) / 8] |= std::uint8_t(1 << (i * 6 + bit) % 8);
+      }
+    }
+    auto result = a;
+    ns::max_registers(result.data(), packed.data(), len);
+    for (std::size_t i = 0; i < len; ++i)
+      CHECK(result[i] == std::max(a[i], b[i]));
+
+    double sum = 0;
+    for (const auto x : a)
+      sum += std::ldexp(1.0, -int(x));
+    // added up in another order
+    CHECK_THAT(ns::harmonic_sum(a.data(), a.data() + len),
+               Catch::Matchers::WithinRel(sum, 1e-12));
+  }
+}
+
+TEST_CASE("crc32c") {
+  const auto isa = GENERATE(ns::isa::scalar, ns::isa::sse2, ns::isa::avx2);
+  if (!ns::supported(isa))
+    SKIP("not supported on this CPU");
+  use_isa scope(isa);
+
+  const auto crc = [](std::string_view s, std::uint32_t crc = 0) {
+    return ns::crc32c(crc, s.data(), s.data() + s.size());
+  };
+  CHECK(crc("") == 0);
+  CHECK(crc("123456789") == 0xe3069283);
+  CHECK(crc(std::string(32, '\0')) == 0x8a9136aa);
+  CHECK(crc(std::string(32, '\xff')) == 0x62a8ab43);
+
+  // in pieces, at every offset, the same as all at once
+  std::mt19937 prng(42);
+  std::string s(100, '\0');
+  std::generate(s.begin(), s.end(), [&]() { return char(prng()); });
+  const auto whole = crc(s);
+  for (std::size_t i = 0; i <= s.size(); ++i) {
+    const std::string_view v = s;
+    CHECK(crc(v.substr(i), crc(v.substr(0, i))) == whole);
+  }
+}
+
+TEST_CASE("best implementation is used by default") {
+  CHECK(ns::supported(ns::current()));
+  CHECK(ns::supported(ns::isa::scalar));
+}
+
+TEST_CASE("set algebra matches the standard algorithms") {
+  const auto isa = GENERATE(ns::isa::scalar, ns::isa::sse2, ns::isa::avx2);
+  if (!ns::supported(isa))
+    SKIP("not supported on this CPU");
+  use_isa scope(isa);
+
+  std::mt19937_64 prng(42);
+  // sorted distinct integers from a range that's narrow enough for the two
+  // sets to overlap, at either extreme of int64_t
+  const auto random_set = [&](std::size_t size, std::int64_t low,
+                              std::uint64_t range) {
+    std::vector<std::int64_t> result;
+    for (std::size_t i = 0; i < size; ++i)
+      result.push_back(std::int64_t(std::uint64_t(low) + prng() % range));
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+  };
+
+  for (const auto low : {std::numeric_limits<std::int64_t>::min(),
+                         std::int64_t(-50),
+                         std::numeric_limits<std::int64_t>::max() - 199}) {
+    for (std::size_t a_size = 0; a_size < 70; a_size += 3) {
+      for (std::size_t b_size = 0; b_size < 70; b_size += 5) {
+        const auto a = random_set(a_size, low, 200);
+        const auto b = random_set(b_size, low, 200);
+        INFO("sizes " << a.size() << " and " << b.size() << " from " << low);
+
+        std::vector<std::int64_t> expected, result(a.size() + b.size());
+        std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                              std::back_inserter(expected));
+        auto end = ns::intersect(a.data(), a.data() + a.size(), b.data(),
+                                 b.data() + b.size(), result.data());
+        CHECK(std::vector(result.data(), end) == expected);
+
+        expected.clear();
+        std::set_union(a.begin(), a.end(), b.begin(), b.end(),
+                       std::back_inserter(expected));
+        end = ns::unite(a.data(), a.data() + a.size(), b.data(),
+                        b.data() + b.size(), result.data());
+        CHECK(std::vector(result.data(), end) == expected);
+
+        expected.clear();
+        std::set_difference(a.begin(), a.end(), b.begin(), b.end(),
+                            std::back_inserter(expected));
+        end = ns::subtract(a.data(), a.data() + a.size(), b.data(),
+                           b.data() + b.size(), result.data());
+        CHECK(std::vector(result.data(), end) == expected);
+      }
+    }
+  }
+}
@@ -0,0 +1,146 @@
+#include <catch2/catch_all.hpp>
+
+#include <snapshot.hpp>
+
+#include <chrono>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ns = redis::snapshot;
+using namespace std::chrono_literals;
+
+namespace {
+
+using time_point = redis::database::time_point;
+
+// a database whose clock is at now
+redis::database make_database(time_point now = time_point(1s)) {
+  return redis::database([now]() { return redis::database::now_t(now); });
+}
+
+std::string save(redis::database &db) {
+  std::ostringstream os;
+  ns::save(db, os);
+  return std::move(os).str();
+}
+
+void load(const std::string &bytes, redis::database &db) {
+  ns::load({bytes.data(), bytes.size()}, db);
+}
+
+std::vector<std::string> list(redis::database &db, std::string_view key) {
+  std::vector<std::string> result;
+  for (const auto &s : db.get_list(key, {})->get())
+    result.emplace_back(s);
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("snapshot round trip") {
+  const time_point now(1s);
+  auto db = make_database(now);
+  db.set("string", "some string");
+  db.set("integer", "-42", now + 10s);
+  db.get_or_create_list("list", now) = {"a", "b", "c"};
+  db.get_or_create_hash("hash", now).set("field", "value");
+  auto &set = db.get_or_create_set("set", now);
+  set.insert("1");
+  set.insert("member");
+  auto &zset = db.get_or_create_zset("zset", now);
+  zset.insert("x", -std::numeric_limits<double>::infinity());
+  zset.insert("y", 0.5);
+  const std::vector<std::string_view> fields{"f", "v"};
+  auto &stream = db.get_or_create_stream("stream", now);
+  stream.append({1, 1}, fields);
+  stream.append({2, 0}, fields);
+  db.expire("list", now + 5s, now);
+
+  const auto bytes = save(db);
+  CHECK(ns::is_snapshot({bytes.data(), bytes.size()}));
+  auto loaded = make_database(now);
+  load(bytes, loaded);
+
+  CHECK(loaded.size() == 7);
+  CHECK(*loaded.get_string("string", now) == "some string");
+  CHECK(*loaded.get_string("integer", now) == "-42");
+  CHECK(*loaded.expiry("integer", now) == now + 10s);
+  CHECK(list(loaded, "list") == std::vector<std::string>{"a", "b", "c"});
+  CHECK(*loaded.expiry("list", now) == now + 5s);
+  CHECK(*loaded.expiry("string", now) == redis::database::never);
+  CHECK(loaded.get_hash("hash", now)->get().get("field") == "value");
+  CHECK(loaded.get_set("set", now)->get().contains("1"));
+  CHECK(loaded.get_set("set", now)->get().contains("member"));
+  const auto &loaded_zset = loaded.get_zset("zset", now)->get();
+  CHECK(loaded_zset.score("x") == -std::numeric_limits<double>::infinity());
+  CHECK(loaded_zset.rank("y") == 1);
+  const auto &loaded_stream = loaded.get_stream("stream", now)->get();
+  CHECK(loaded_stream.size() == 2);
+  CHECK(loaded_stream.last_id() == redis::stream_id{2, 0});
+}
+
+TEST_CASE("snapshot keeps a trimmed stream's last ID") {
+  auto db = make_database();
+  const std::vector<std::string_view> fields{"f", "v"};
+  auto &stream = db.get_or_create_stream("stream", {});
+  stream.append({5, 5}, fields);
+  stream.trim(0, false);
+
+  auto loaded = make_database();
+  load(save(db), loaded);
+  const auto &loaded_stream = loaded.get_stream("stream", {})->get();
+  CHECK(loaded_stream.empty());
+  CHECK(loaded_stream.last_id() == redis::stream_id{5, 5});
+}
+
+TEST_CASE("snapshot spans blocks") {
+  auto db = make_database();
+  const std::string value(100, 'v');
+  for (int i = 0; i < 10000; ++i)
+    db.set("key:" + std::to_string(i), value);
+
+  const auto bytes = save(db);
+  CHECK(bytes.size() > 10 * ns::block_size);
+  auto loaded = make_database();
+  load(bytes, loaded);
+  CHECK(loaded.size() == 10000);
+  CHECK(*loaded.get_string("key:9999", {}) == value);
+}
+
+TEST_CASE("snapshot drops keys that have expired") {
+  auto db = make_database(time_point(1s));
+  db.set("gone", "value", time_point(2s));
+  db.set("kept", "value", time_point(4s));
+
+  auto loaded = make_database(time_point(3s));
+  load(save(db), loaded);
+  CHECK(loaded.size() == 1);
+  CHECK(loaded.exists("kept", time_point(3s)));
+}
+
+TEST_CASE("corrupt snapshots are refused") {
+  auto db = make_database();
+  for (int i = 0; i < 100; ++i)
+    db.set("key:" + std::to_string(i), "value");
+  const auto bytes = save(db);
+
+  // a byte flipped anywhere past the magic is caught by a checksum, or by
+  // the header, index or trailer not adding up
+  for (std::size_t i = ns::magic.size(); i < bytes.size(); ++i) {
+    auto flipped = bytes;
+    flipped[i] ^= 0x20;
+    auto loaded = make_database();
+    CHECK_THROWS_AS(load(flipped, loaded), ns::corrupt);
+  }
+
+  auto loaded = make_database();
+  CHECK_THROWS_AS(load(bytes.substr(0, bytes.size() - 1), loaded),
+                  ns::corrupt);
+  CHECK_THROWS_AS(load(bytes.substr(0, ns::magic.size()), loaded),
+                  ns::corrupt);
+  CHECK_THROWS_AS(load("*1\r\n$4\r\nPING\r\n", loaded), ns::corrupt);
+  CHECK_FALSE(ns::is_snapshot({"*1\r\n", 4}));
+}
@@ -0,0 +1,144 @@
+#include <catch2/catch_all.hpp>
+
+#include <stream.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns = redis;
+
+namespace {
+
+using entry_t = std::pair<ns::stream_id, std::vector<std::string>>;
+
+std::vector<entry_t> entries(const ns::stream &stream,
+                             ns::stream_id start = {},
+                             ns::stream_id end = ns::stream_id::max(),
+                             bool reverse = false,
+                             std::size_t count =
+                                 std::numeric_limits<std::size_t>::max()) {
+  std::vector<entry_t> result;
+  stream.visit(start, end, reverse,
+               [&](ns::stream_id id,
+                   const std::vector<std::string_view> &fields_and_values) {
+                 result.emplace_back(id, std::vector<std::string>(
+                                             fields_and_values.begin(),
+                                             fields_and_values.end()));
+                 return result.size() < count;
+               });
+  return result;
+}
+
+void append(ns::stream &stream, ns::stream_id id,
+            std::vector<std::string_view> fields_and_values) {
+  stream.append(id, fields_and_values);
+}
+
+} // namespace
+
+TEST_CASE("stream empty") {
+  const ns::stream stream;
+  CHECK(stream.empty());
+  CHECK(stream.last_id() == ns::stream_id());
+  CHECK(entries(stream).empty());
+}
+
+TEST_CASE("stream entries with the master's fields or their own") {
+  ns::stream stream;
+  append(stream, {5, 0}, {"a", "1", "b", "2"});
+  append(stream, {5, 1}, {"a", "3", "b", "4"});
+  append(stream, {7, 0}, {"a", "5"});
+  append(stream, {7, 9}, {"b", "6", "a", "7"});
+  append(stream, {1000, 0}, {"a", std::string(300, 'x'), "b", ""});
+  CHECK(stream.size() == 5);
+  CHECK(stream.last_id() == ns::stream_id{1000, 0});
+
+  const std::vector<entry_t> expected{
+      {{5, 0}, {"a", "1", "b", "2"}},
+      {{5, 1}, {"a", "3", "b", "4"}},
+      {{7, 0}, {"a", "5"}},
+      {{7, 9}, {"b", "6", "a", "7"}},
+      {{1000, 0}, {"a", std::string(300, 'x'), "b", ""}},
+  };
+  CHECK(entries(stream) == expected);
+  CHECK(entries(stream, {5, 1}, {7, 9}) ==
+        std::vector(expected.begin() + 1, expected.end() - 1));
+  CHECK(entries(stream, {6, 0}, {6, 100}).empty());
+  CHECK(entries(stream, {7, 0}, {5, 0}).empty());
+  CHECK(entries(stream, {}, ns::stream_id::max(), true) ==
+        std::vector(expected.rbegin(), expected.rend()));
+  CHECK(entries(stream, {5, 1}, {7, 0}, true, 1) ==
+        std::vector{expected[2]});
+}
+
+TEST_CASE("stream ranges across nodes") {
+  ns::stream stream;
+  constexpr std::uint64_t n = 10 * ns::stream::max_node_entries + 7;
+  for (std::uint64_t i = 1; i <= n; ++i) {
+    const auto value = std::to_string(i);
+    append(stream, {i / 3, i}, {"field", value});
+  }
+  CHECK(stream.size() == n);
+
+  const auto ids = [](const std::vector<entry_t> &found) {
+    std::vector<std::uint64_t> result;
+    for (const auto &[id, fields_and_values] : found) {
+      CHECK(fields_and_values ==
+            std::vector<std::string>{"field", std::to_string(id.seq)});
+      result.push_back(id.seq);
+    }
+    return result;
+  };
+  const auto range = [](std::uint64_t first, std::uint64_t last) {
+    std::vector<std::uint64_t> result;
+    for (auto i = first; i <= last; ++i)
+      result.push_back(i);
+    return result;
+  };
+  const auto reversed = [](std::vector<std::uint64_t> v) {
+    std::reverse(v.begin(), v.end());
+    return v;
+  };
+
+  CHECK(ids(entries(stream)) == range(1, n));
+  CHECK(ids(entries(stream, {99 / 3, 99}, {301 / 3, 301})) == range(99, 301));
+  CHECK(ids(entries(stream, {99 / 3, 99}, {301 / 3, 301}, true)) ==
+        reversed(range(99, 301)));
+  CHECK(ids(entries(stream, {500 / 3, 500}, ns::stream_id::max(), false,
+                    3)) == range(500, 502));
+  CHECK(ids(entries(stream, {}, {500 / 3, 500}, true, 3)) ==
+        reversed(range(498, 500)));
+}
+
+TEST_CASE("stream trim") {
+  ns::stream stream;
+  constexpr std::uint64_t n = 3 * ns::stream::max_node_entries;
+  for (std::uint64_t i = 1; i <= n; ++i)
+    append(stream, {i, 0}, {"f", std::to_string(i)});
+
+  // approximately, only whole nodes go
+  CHECK(stream.trim(n - 10, true) == 0);
+  CHECK(stream.trim(n - ns::stream::max_node_entries - 10, true) ==
+        ns::stream::max_node_entries);
+  CHECK(stream.size() == n - ns::stream::max_node_entries);
+
+  // exactly, the rest come out of the first node left
+  CHECK(stream.trim(150, false) == 50);
+  CHECK(stream.size() == 150);
+  auto found = entries(stream);
+  REQUIRE(found.size() == 150);
+  CHECK(found.front().first == ns::stream_id{151, 0});
+  CHECK(found.front().second == std::vector<std::string>{"f", "151"});
+  CHECK(found.back().first == ns::stream_id{n, 0});
+  CHECK(entries(stream, {}, {151, 0}).size() == 1);
+
+  CHECK(stream.trim(0, false) == 150);
+  CHECK(stream.empty());
+  CHECK(entries(stream).empty());
+  CHECK(stream.last_id() == ns::stream_id{n, 0});
+  append(stream, {n + 1, 0}, {"f", "v"});
+  CHECK(entries(stream).size() == 1);
+}
@@ -0,0 +1,46 @@
+#include <catch2/catch_all.hpp>
+
+#include <string_value.hpp>
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+
+namespace ns = redis;
+
+TEST_CASE("string value of an integer") {
+  const auto i = GENERATE(std::int64_t(0), std::int64_t(9), std::int64_t(10),
+                          std::int64_t(9999), std::int64_t(10000),
+                          std::int64_t(-1),
+                          std::numeric_limits<std::int64_t>::min(),
+                          std::numeric_limits<std::int64_t>::max());
+  const ns::string_value value(i);
+  CHECK(value == std::to_string(i));
+  // copies don't point into the original
+  std::optional<ns::string_value> copy;
+  {
+    const ns::string_value original(i);
+    copy = original;
+  }
+  CHECK(*copy == std::to_string(i));
+}
+
+TEST_CASE("string value of a string") {
+  const std::string s = "value";
+  CHECK(ns::string_value(s).view().data() == s.data());
+}
+
+TEST_CASE("parse integer") {
+  CHECK(ns::string_value::parse_integer("0") == 0);
+  CHECK(ns::string_value::parse_integer("-1") == -1);
+  CHECK(ns::string_value::parse_integer("123") == 123);
+  CHECK(ns::string_value::parse_integer("-9223372036854775808") ==
+        std::numeric_limits<std::int64_t>::min());
+  CHECK(ns::string_value::parse_integer("9223372036854775807") ==
+        std::numeric_limits<std::int64_t>::max());
+
+  const auto s = GENERATE("", "-", "-0", "00", "01", "+1", " 1", "1 ", "1.0",
+                          "1e3", "9223372036854775808", "x");
+  CHECK_FALSE(ns::string_value::parse_integer(s));
+}
@@ -0,0 +1,117 @@
+#include <catch2/catch_all.hpp>
+
+#include <timing_wheel.hpp>
+
+#include <string>
+#include <vector>
+
+namespace ns = redis;
+using namespace std::chrono_literals;
+
+namespace {
+
+using time_point = ns::timing_wheel<int>::time_point;
+
+// everything the wheel expires at now, with its deadline
+std::vector<std::pair<time_point, int>> expire(ns::timing_wheel<int> &wheel,
+                                               time_point now) {
+  std::vector<std::pair<time_point, int>> result;
+  CHECK(wheel.expire(now, [&](time_point deadline, int value) {
+    result.emplace_back(deadline, value);
+    return true;
+  }));
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("timing wheel expires entries once they're due") {
+  const time_point start(1700000000000ms);
+  ns::timing_wheel<int> wheel(start);
+  wheel.insert(start + 5ms, 1);
+  wheel.insert(start + 100ms, 2);
+  wheel.insert(start + 5ms, 3);
+  CHECK(wheel.size() == 3);
+
+  CHECK(expire(wheel, start + 4ms).empty());
+  const auto due = expire(wheel, start + 50ms);
+  REQUIRE(due.size() == 2);
+  CHECK(due[0].first == start + 5ms);
+  CHECK(due[1].first == start + 5ms);
+  CHECK(due[0].second + due[1].second == 4);
+
+  CHECK(expire(wheel, start + 99ms).empty());
+  CHECK(expire(wheel, start + 100ms) ==
+        std::vector<std::pair<time_point, int>>{{start + 100ms, 2}});
+  CHECK(wheel.empty());
+}
+
+TEST_CASE("timing wheel expires in deadline order across levels") {
+  const time_point start(1700000000123ms);
+  ns::timing_wheel<int> wheel(start);
+  // from the first level up to beyond the last
+  const std::vector<std::chrono::milliseconds> offsets{
+      30ms, 70ms, 5000ms, 300000ms, 24h, 30 * 24h};
+  for (std::size_t i = offsets.size(); i-- > 0;)
+    wheel.insert(start + offsets[i], int(i));
+
+  std::vector<int> order;
+  for (auto now = start; !wheel.empty(); now += 1min) {
+    for (const auto &[deadline, value] : expire(wheel, now)) {
+      CHECK(deadline == start + offsets[value]);
+      CHECK(now - deadline < 1min);
+      order.push_back(value);
+    }
+  }
+  CHECK(order == std::vector<int>{0, 1, 2, 3, 4, 5});
+}
+
+TEST_CASE("timing wheel expires overdue entries next") {
+  const time_point start(1700000000000ms);
+  ns::timing_wheel<int> wheel(start);
+  wheel.insert(start + 10ms, 1);
+  CHECK(expire(wheel, start + 5ms).empty());
+  wheel.insert(start - 1s, 2);
+  CHECK(expire(wheel, start + 6ms) ==
+        std::vector<std::pair<time_point, int>>{{start - 1s, 2}});
+}
+
+TEST_CASE("timing wheel stops when asked to") {
+  const time_point start(1700000000000ms);
+  ns::timing_wheel<int> wheel(start);
+  for (int i = 0; i < 10; ++i)
+    wheel.insert(start + std::chrono::milliseconds(i), i);
+
+  int visited = 0;
+  CHECK_FALSE(wheel.expire(start + 1s, [&](time_point, int) {
+    return ++visited < 4;
+  }));
+  CHECK(visited == 4);
+  CHECK(wheel.size() == 6);
+  CHECK(expire(wheel, start + 1s).size() == 6);
+}
+
+TEST_CASE("timing wheel entries can be inserted while expiring") {
+  const time_point start(1700000000000ms);
+  ns::timing_wheel<int> wheel(start);
+  wheel.insert(start + 1ms, 1);
+
+  std::vector<int> values;
+  wheel.expire(start + 1s, [&](time_point deadline, int value) {
+    values.push_back(value);
+    if (value < 3)
+      wheel.insert(deadline + 100ms, value + 1);
+    return true;
+  });
+  CHECK(values == std::vector<int>{1, 2, 3});
+}
+
+TEST_CASE("timing wheel clear") {
+  const time_point start(1700000000000ms);
+  ns::timing_wheel<int> wheel(start);
+  wheel.insert(start + 1ms, 1);
+  wheel.insert(start + 1h, 2);
+  wheel.clear();
+  CHECK(wheel.empty());
+  CHECK(expire(wheel, start + 2h).empty());
+}
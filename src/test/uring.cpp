@@ -0,0 +1,100 @@
+#include "catch2/catch_all.hpp"
+
+#include <uring.hpp>
+
+#include <string_view>
+#include <vector>
+
+#include <sys/socket.h>
+
+namespace ns = redis::io;
+using namespace std::literals;
+
+namespace {
+
+struct socket_pair {
+  socket_pair() { ns::posix_call(::socketpair, AF_UNIX, SOCK_STREAM, 0, fds); }
+  ~socket_pair() {
+    ::close(fds[0]);
+    ::close(fds[1]);
+  }
+  int fds[2]{};
+};
+
+std::vector<::io_uring_cqe> reap(ns::uring &ring, std::size_t n) {
+  std::vector<::io_uring_cqe> result;
+  while (result.size() < n) {
+    ring.submit(1);
+    ring.for_each_cqe([&](const auto &cqe) { result.push_back(cqe); });
+  }
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("uring nop") {
+  ns::uring ring(8);
+
+  for (std::uint64_t i = 0; i < 3; ++i) {
+    auto &sqe = ring.get_sqe();
+    sqe.opcode = IORING_OP_NOP;
+    sqe.user_data = i;
+  }
+
+  const auto cqes = reap(ring, 3);
+  REQUIRE(cqes.size() == 3);
+  for (std::uint64_t i = 0; i < 3; ++i)
+    CHECK(cqes[i].user_data == i);
+}
+
+TEST_CASE("uring submits when the submission queue is full") {
+  ns::uring ring(2);
+
+  for (int i = 0; i < 5; ++i)
+    ring.get_sqe().opcode = IORING_OP_NOP;
+
+  CHECK(reap(ring, 5).size() == 5);
+}
+
+TEST_CASE("uring multishot recv into provided buffers") {
+  ns::uring ring(8);
+  ns::provided_buffers buffers(ring, 7, 4, 1 << 12);
+  socket_pair sp;
+
+  auto &sqe = ring.get_sqe();
+  sqe.opcode = IORING_OP_RECV;
+  sqe.fd = sp.fds[0];
+  sqe.ioprio = IORING_RECV_MULTISHOT;
+  sqe.flags = IOSQE_BUFFER_SELECT;
+  sqe.buf_group = buffers.group();
+  ring.submit();
+
+  for (auto msg : {"hello"sv, "world"sv}) {
+    ns::posix_call(::write, sp.fds[1], msg.data(), msg.size());
+    const auto cqe = reap(ring, 1).front();
+    REQUIRE(cqe.res == int(msg.size()));
+    REQUIRE(cqe.flags & IORING_CQE_F_BUFFER);
+    CHECK(cqe.flags & IORING_CQE_F_MORE);
+    const auto id = std::uint16_t(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+    CHECK(std::string_view(buffers.addr(id), cqe.res) == msg);
+    buffers.recycle(id);
+  }
+}
+
+TEST_CASE("uring send") {
+  ns::uring ring(8);
+  socket_pair sp;
+  const auto msg = "hello world"sv;
+
+  auto &sqe = ring.get_sqe();
+  sqe.opcode = IORING_OP_SEND;
+  sqe.fd = sp.fds[0];
+  sqe.addr = reinterpret_cast<std::uintptr_t>(msg.data());
+  sqe.len = msg.size();
+
+  CHECK(reap(ring, 1).front().res == int(msg.size()));
+
+  std::array<char, 64> buf{};
+  const auto n = ns::posix_call(::read, sp.fds[1], buf.data(), buf.size());
+  CHECK(std::string_view(buf.data(), n) == msg);
+}
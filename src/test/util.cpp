@@ -68,3 +68,41 @@ TEST_CASE("tokenize with no leading or trailing whitespace") {
   ns::tokenize(s.data(), s.data() + s.size(), [&](auto...) { return ++count; });
   CHECK(count == 2);
 }
+
+TEST_CASE("parse_memory") {
+  CHECK(ns::parse_memory("0") == 0);
+  CHECK(ns::parse_memory("100") == 100);
+  CHECK(ns::parse_memory("1k") == 1000);
+  CHECK(ns::parse_memory("1KB") == 1024);
+  CHECK(ns::parse_memory("3mb") == 3 << 20);
+  CHECK(ns::parse_memory("2G") == 2000000000);
+  CHECK(ns::parse_memory("2gb") == 2ull << 30);
+  CHECK(!ns::parse_memory(""));
+  CHECK(!ns::parse_memory("mb"));
+  CHECK(!ns::parse_memory("1tb"));
+  CHECK(!ns::parse_memory("-1"));
+}
+
+TEST_CASE("glob_match") {
+  CHECK(ns::glob_match("", ""));
+  CHECK(ns::glob_match("*", ""));
+  CHECK(ns::glob_match("*", "anything"));
+  CHECK(ns::glob_match("h?llo", "hello"));
+  CHECK(!ns::glob_match("h?llo", "hllo"));
+  CHECK(ns::glob_match("h*llo", "hllo"));
+  CHECK(ns::glob_match("h*llo", "heeeello"));
+  CHECK(ns::glob_match("*a*b*", "xxaxxbxx"));
+  CHECK(!ns::glob_match("*a*b", "xxaxxbxx"));
+  CHECK(ns::glob_match("h[ae]llo", "hallo"));
+  CHECK(!ns::glob_match("h[ae]llo", "hillo"));
+  CHECK(ns::glob_match("h[^e]llo", "hallo"));
+  CHECK(!ns::glob_match("h[^e]llo", "hello"));
+  CHECK(ns::glob_match("h[a-b]llo", "hbllo"));
+  CHECK(ns::glob_match("h[b-a]llo", "hbllo"));
+  CHECK(!ns::glob_match("h[a-b]llo", "hcllo"));
+  CHECK(ns::glob_match("h\\*llo", "h*llo"));
+  CHECK(!ns::glob_match("h\\*llo", "hello"));
+  CHECK(ns::glob_match("[\\]]", "]"));
+  CHECK(!ns::glob_match("field1?", "field1"));
+  CHECK(!ns::glob_match("abc", "abcd"));
+}
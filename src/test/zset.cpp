@@ -0,0 +1,94 @@
+#include <catch2/catch_all.hpp>
+
+#include <zset.hpp>
+
+#include <cmath>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ns = redis;
+
+namespace {
+
+using entries_t = std::vector<std::pair<std::string, double>>;
+
+entries_t entries(const ns::zset &zset, std::size_t start = 0,
+                  std::size_t stop = std::numeric_limits<std::size_t>::max()) {
+  entries_t result;
+  zset.visit(start, stop, [&](std::string_view member, double score) {
+    result.emplace_back(member, score);
+  });
+  return result;
+}
+
+} // namespace
+
+TEST_CASE("zset empty") {
+  const ns::zset zset;
+  CHECK(zset.empty());
+  CHECK(zset.packed());
+  CHECK(!zset.score("a"));
+  CHECK(!zset.rank("a"));
+  CHECK(zset.count_below(0, true) == 0);
+  CHECK(entries(zset).empty());
+}
+
+// the same behaviour while packed and once converted
+TEST_CASE("zset insert, score, rank and erase") {
+  ns::zset zset{{"b", 2}, {"a", 2}, {"c", 1}};
+  const bool convert = GENERATE(false, true);
+  if (convert) {
+    zset.insert(std::string(ns::zset::max_packed_value + 1, 'z'), 10);
+    CHECK(!zset.packed());
+  } else {
+    CHECK(zset.packed());
+  }
+
+  CHECK(zset.score("a") == 2);
+  CHECK(!zset.score("d"));
+  CHECK(zset.rank("c") == 0);
+  CHECK(zset.rank("a") == 1);
+  CHECK(zset.rank("b") == 2);
+  CHECK(!zset.rank("d"));
+
+  // moving a member reorders it
+  CHECK(!zset.insert("c", 3));
+  CHECK(!zset.insert("c", 3));
+  CHECK(zset.rank("c") == 2);
+  CHECK(zset.insert("d", -std::numeric_limits<double>::infinity()));
+  CHECK(entries(zset, 0, 4) == entries_t{{"d", -INFINITY},
+                                         {"a", 2},
+                                         {"b", 2},
+                                         {"c", 3}});
+  CHECK(entries(zset, 1, 3) == entries_t{{"a", 2}, {"b", 2}});
+  CHECK(zset.count_below(2, false) == 1);
+  CHECK(zset.count_below(2, true) == 3);
+
+  CHECK(zset.erase("a"));
+  CHECK(!zset.erase("a"));
+  CHECK(!zset.score("a"));
+  CHECK(zset.rank("b") == 1);
+  CHECK(zset.size() == (convert ? 4 : 3));
+}
+
+TEST_CASE("zset converts past max_packed_entries") {
+  ns::zset zset;
+  for (std::size_t i = 0; i < ns::zset::max_packed_entries; ++i)
+    zset.insert(std::to_string(i), double(i % 10));
+  CHECK(zset.packed());
+  // moving a member that's there already doesn't add one
+  zset.insert("0", 100);
+  CHECK(zset.packed());
+  const auto before = entries(zset);
+
+  zset.insert("new", 5);
+  CHECK(!zset.packed());
+  CHECK(zset.size() == ns::zset::max_packed_entries + 1);
+  auto after = entries(zset);
+  CHECK(after[std::size_t(*zset.rank("new"))] ==
+        std::pair<std::string, double>("new", 5));
+  after.erase(after.begin() + std::ptrdiff_t(*zset.rank("new")));
+  CHECK(after == before);
+}